@@ -6,7 +6,7 @@
 #include "HeedCluster.h"
 
 namespace Heed {
-extern long last_particle_number;
+extern thread_local long last_particle_number;
 
 /// Charged particle which can be traced through the geometry.
 ///
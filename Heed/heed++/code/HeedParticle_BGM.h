@@ -6,7 +6,7 @@
 #include "wcpplib/particle/eparticle.h"
 
 namespace Heed {
-extern long last_particle_number;
+extern thread_local long last_particle_number;
 
 /// Definition of the particle which can be traced through the geometry.
 /// 2003, I. Smirnov
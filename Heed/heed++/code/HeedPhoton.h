@@ -9,7 +9,7 @@
 //#define SFER_PHOTOEL  // make direction of photoelectron absolutely random
 
 namespace Heed {
-extern long last_particle_number;
+extern thread_local long last_particle_number;
 
 /// Definition of the photon which can be emitted at atomic relaxation cascades
 /// and traced through the geometry.
@@ -26,7 +26,7 @@ The file is provided "as is" without express or implied warranty.
 
 namespace Heed {
 
-int vecerror = 0;
+thread_local int vecerror = 0;
 
 void absref_transmit::print(std::ostream& file, int l) const {
   if (l <= 0) return;
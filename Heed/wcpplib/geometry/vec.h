@@ -52,7 +52,7 @@ works in this way. So now vfloat is synonym of double.
 
 namespace Heed {
 
-extern int vecerror;
+extern thread_local int vecerror;
 
 class vec;
 class basis;  // It is ortogonal basis
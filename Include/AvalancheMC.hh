@@ -1,12 +1,15 @@
 #ifndef G_AVALANCHE_MC_H
 #define G_AVALANCHE_MC_H
 
+#include <cstdint>
+#include <memory>
 #include <string>
 #include <vector>
 #include <array>
 
 #include "FundamentalConstants.hh"
 #include "Sensor.hh"
+#include "ThreadPool.hh"
 #include "ViewDrift.hh"
 
 namespace Garfield {
@@ -82,6 +85,20 @@ class AvalancheMC {
   void SetTimeWindow(const double t0, const double t1);
   void UnsetTimeWindow() { m_hasTimeWindow = false; }
 
+  /** Compute the drift lines of each avalanche generation in parallel.
+    * \param nThreads number of threads (0: number of hardware threads)
+    *
+    * Each drift line draws from its own random number stream, derived from
+    * the generator of the calling thread, and the endpoints and secondaries
+    * are merged in the order of the serial calculation. Repeated runs thus
+    * give the same avalanche, irrespective of the number of threads.
+    * Signals are accumulated per thread and added to the sensor at the end.
+    * The avalanche size limit is checked against the size at the start
+    * of each generation.
+    */
+  void EnableParallelTransport(const unsigned int nThreads = 0);
+  void DisableParallelTransport() { m_pool.reset(); }
+
   /// Treat positive charge carriers as holes (default: ions).
   void SetHoles() { m_useIons = false; }
   void SetIons() { m_useIons = true; }
@@ -234,9 +251,53 @@ class AvalancheMC {
 
   bool m_debug = false;
 
+  /// Thread pool for parallel avalanches (null: serial).
+  std::unique_ptr<ThreadPool> m_pool;
+
+  /// Outcome of a drift line calculation.
+  struct DriftLineResult {
+    EndPoint endPoint;
+    bool hasEndPoint = false;
+    /// Change in the number of electrons, holes and ions.
+    int ne = 0, nh = 0, ni = 0;
+  };
+  /// Drift line of an avalanche generation computed in parallel.
+  struct DriftLineTask {
+    unsigned int point;  ///< Index of the starting point.
+    int type;            ///< Electron (-1), hole (1) or ion (2).
+    bool ok = false;
+    DriftLineResult result;
+    /// Points at which secondaries were produced.
+    std::vector<DriftPoint> secondaries;
+    /// Drift line (kept only for plotting).
+    std::vector<DriftPoint> drift;
+  };
+  /// Buffers of a worker thread.
+  struct Worker {
+    std::vector<DriftPoint> drift;
+    Sensor::SignalBuffer signals;
+  };
+
   /// Compute a drift line with starting point (x0, y0, z0).
   bool DriftLine(const double x0, const double y0, const double z0,
                  const double t0, const int type, const bool aval = false);
+  /// Compute a drift line without adding it to the endpoints and signals.
+  bool DriftLine(const std::array<double, 3>& xi, const double ti,
+                 const int type, const bool aval,
+                 std::vector<DriftPoint>& drift,
+                 DriftLineResult& result) const;
+  /// Add a drift line to the endpoints and avalanche size.
+  void AddEndPoint(const int type, const DriftLineResult& result);
+  /// Compute the drift lines of one avalanche generation in parallel.
+  void DriftGeneration(const std::vector<DriftPoint>& aval,
+                       const bool withElectrons, const bool withHoles,
+                       const uint64_t seed, const uint64_t generation,
+                       std::vector<Worker>& workers,
+                       std::vector<DriftPoint>& newAval);
+  /// Collect the points along a drift line where secondaries were produced.
+  void AddSecondaries(const int type, const std::vector<DriftPoint>& drift,
+                      std::vector<DriftPoint>& points) const;
+  void PlotDriftLine(const int type, const std::vector<DriftPoint>& drift);
   /// Compute an avalanche with starting point (x0, y0, z0).
   bool Avalanche(const double x0, const double y0, const double z0,
                  const double t0, const unsigned int ne, const unsigned int nh,
@@ -245,7 +306,8 @@ class AvalancheMC {
 
   void AddPoint(const std::array<double, 3>& x, const double t,
                 const unsigned int ne, const unsigned int nh,
-                const unsigned int ni, std::vector<DriftPoint>& points) {
+                const unsigned int ni,
+                std::vector<DriftPoint>& points) const {
     DriftPoint point;
     point.x = x;
     point.t = t;
@@ -270,35 +332,42 @@ class AvalancheMC {
                        const std::array<double, 3>& x,
                        const std::array<double, 3>& e,
                        const std::array<double, 3>& b) const;
+  /// Compute the drift velocity and further transport coefficients
+  /// (Medium::TransportCoefficients flags) in one call.
+  bool GetTransport(const int type, Medium* medium, const unsigned int what,
+                    const std::array<double, 3>& x,
+                    const std::array<double, 3>& e,
+                    const std::array<double, 3>& b,
+                    Medium::TransportCoefficients& c) const;
   /// Compute end point and effective velocity for a step.
   void StepRKF(const int type, const std::array<double, 3>& x0,
                const std::array<double, 3>& v0, const double dt,
                std::array<double, 3>& xf, std::array<double, 3>& vf,
                int& status) const;
   /// Add a diffusion step.
-  bool AddDiffusion(const int type, Medium* medium, const double step,
+  void AddDiffusion(const double step, const double dl, const double dt,
                     std::array<double, 3>& x,
-                    const std::array<double, 3>& v,
-                    const std::array<double, 3>& e,
-                    const std::array<double, 3>& b);
+                    const std::array<double, 3>& v) const;
   /// Terminate a drift line close to the boundary.
   void Terminate(const std::array<double, 3>& x0, const double t0,
                  std::array<double, 3>& x, double& t) const;
   /// Compute multiplication and losses along the current drift line.
   bool ComputeGainLoss(const int type, std::vector<DriftPoint>& driftLine,
-                       int& status);
+                       int& status, DriftLineResult& result) const;
   /// Compute Townsend and attachment coefficients along the current drift line.
   bool ComputeAlphaEta(const int q, 
                        const std::vector<DriftPoint>& driftLine,
                        std::vector<double>& alphas,
                        std::vector<double>& etas) const;
   bool Equilibrate(std::vector<double>& alphas) const;
-  /// Compute the induced signal for the current drift line.
-  void ComputeSignal(const double q,
-                     const std::vector<DriftPoint>& driftLine) const;
+  /// Compute the induced signal for the current drift line
+  /// (and add it to a buffer, if provided).
+  void ComputeSignal(const double q, const std::vector<DriftPoint>& driftLine,
+                     Sensor::SignalBuffer* buffer = nullptr) const;
   /// Compute the induced charge for the current drift line.
   void ComputeInducedCharge(const double q,
-                            const std::vector<DriftPoint>& driftLine) const;
+                            const std::vector<DriftPoint>& driftLine,
+                            Sensor::SignalBuffer* buffer = nullptr) const;
   void PrintError(const std::string& fcn, const std::string& par, 
                   const int type, const std::array<double, 3>& x) const;
 
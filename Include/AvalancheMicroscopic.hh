@@ -1,13 +1,20 @@
 #ifndef G_AVALANCHE_MICROSCOPIC_H
 #define G_AVALANCHE_MICROSCOPIC_H
 
+#include <array>
+#include <limits>
+#include <map>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <tuple>
 #include <vector>
 
 #include <TH1.h>
 
 #include "GarfieldConstants.hh"
 #include "Sensor.hh"
+#include "ThreadPool.hh"
 #include "ViewDrift.hh"
 
 namespace Garfield {
@@ -105,6 +112,20 @@ class AvalancheMicroscopic {
   /// Set number of collisions to be skipped for plotting
   void SetCollisionSteps(const unsigned int n) { m_nCollSkip = n; }
 
+  /** Transport the electrons/holes of each avalanche generation in parallel.
+    * \param nThreads number of threads (0: number of hardware threads)
+    *
+    * Each electron/hole draws from its own random number stream, derived
+    * from the generator of the calling thread, and the results are merged
+    * in stack order. An avalanche is thus reproducible irrespective of the
+    * number of threads (but differs from the one obtained in serial mode).
+    * Histogramming, plotting and user handles are serialised.
+    * \remark The energy range of the gas tables should be set beforehand,
+    *         since it cannot be adjusted safely during the transport.
+    */
+  void EnableParallelTransport(const unsigned int nThreads = 0);
+  void DisableParallelTransport() { m_pool.reset(); }
+
   /// Define a time interval (only carriers inside the interval are simulated).
   void SetTimeWindow(const double t0, const double t1);
   void UnsetTimeWindow();
@@ -125,6 +146,10 @@ class AvalancheMicroscopic {
   unsigned int GetNumberOfElectronEndpoints() const {
     return m_endpointsElectrons.size();
   }
+  /// Return the number of null collisions in the last simulated avalanche.
+  size_t GetNumberOfNullCollisions() const { return m_nNullCollisions; }
+  /// Return the number of real collisions in the last simulated avalanche.
+  size_t GetNumberOfRealCollisions() const { return m_nRealCollisions; }
   /** Return the coordinates and time of start and end point of a given
     * electron drift line.
     * \param i index of the drift line
@@ -248,6 +273,9 @@ class AvalancheMicroscopic {
   int m_nHoles = 0;
   /// Number of ions produced
   int m_nIons = 0;
+  /// Number of null and real collisions
+  size_t m_nNullCollisions = 0;
+  size_t m_nRealCollisions = 0;
 
   bool m_usePlotting = false;
   ViewDrift* m_viewer = nullptr;
@@ -272,10 +300,78 @@ class AvalancheMicroscopic {
   bool m_useBfield = false;
 
   // Rotation matrices
-  double m_rb11 = 1., m_rb12 = 0., m_rb13 = 0.;
-  double m_rb21 = 0., m_rb22 = 1., m_rb23 = 0.;
-  double m_rb31 = 0., m_rb32 = 0., m_rb33 = 1.;
-  double m_rx22 = 1., m_rx23 = 0., m_rx32 = 0., m_rx33 = 1.;
+  struct RotationMatrix {
+    double rb11 = 1., rb12 = 0., rb13 = 0.;
+    double rb21 = 0., rb22 = 1., rb23 = 0.;
+    double rb31 = 0., rb32 = 0., rb33 = 1.;
+    double rx22 = 1., rx23 = 0., rx32 = 0., rx33 = 1.;
+  };
+
+  struct DeexcitationProduct {
+    double t, s, energy;
+    int type;
+  };
+
+  // Energy range of a null-collision rate (id and revision of the medium,
+  // band, upper edge).
+  typedef std::tuple<int, unsigned long, int, double> NullCollisionRange;
+
+  // Working variables and results of the transport of one or more
+  // electrons/holes (the whole generation in serial mode, a single stack
+  // entry in parallel mode).
+  struct TransportState {
+    // Current drift medium and null-collision rate.
+    Medium* medium = nullptr;
+    int id = -1;
+    bool useBandStructure = false;
+    double fLim = 0., fInv = 0.;
+    // Factors by which null-collision rates have been increased.
+    std::map<NullCollisionRange, double> nullScale;
+    bool nullScaleChanged = false;
+    RotationMatrix rot;
+    // Mutex guarding shared objects (null in serial mode).
+    std::mutex* mutex = nullptr;
+    // Media whose collision tables have been frozen for parallel transport,
+    // with the highest energy covered by the tables (negative if the
+    // medium cannot be used concurrently); null in serial mode.
+    const std::map<Medium*, double>* frozen = nullptr;
+    // Medium for which eMax and mediumMutex have been looked up.
+    Medium* tableMedium = nullptr;
+    double eMax = std::numeric_limits<double>::max();
+    // Mutex guarding the medium (if it cannot be used concurrently).
+    std::mutex* mediumMutex = nullptr;
+    // Media whose tables need to be frozen (or extended to a given energy)
+    // before the transport of the present item can continue.
+    std::vector<std::pair<Medium*, double> > requests;
+    // Buffer the induced currents instead of adding them to the sensor.
+    bool bufferSignals = false;
+    // Secondaries to be transported in the next generation.
+    std::vector<Electron> stack;
+    std::vector<Electron> endpointsElectrons;
+    std::vector<Electron> endpointsHoles;
+    std::vector<photon> photons;
+    int nElectrons = 0, nHoles = 0, nIons = 0;
+    size_t nNullCollisions = 0, nRealCollisions = 0;
+    // Buffered signals (q, t, dt, induced current on each electrode).
+    std::vector<double> signals;
+    // Scratch space
+    std::vector<std::pair<int, double> > secondaries;
+    std::vector<DeexcitationProduct> dxcProducts;
+  };
+
+  // Entries of the stack, the endpoints, the photons and the buffered
+  // signals of a transport state which belong to one electron/hole.
+  struct TransportSegment {
+    unsigned int thread = 0;
+    std::array<size_t, 5> begin, end;
+  };
+
+  // Thread pool for parallel transport (null: serial)
+  std::unique_ptr<ThreadPool> m_pool;
+
+  // Factors by which null-collision rates found to be lower than the
+  // real collision rate have been increased (kept across calls).
+  std::map<NullCollisionRange, double> m_nullScale;
 
   // Transport cuts
   double m_deltaCut = 0.;
@@ -314,17 +410,39 @@ class AvalancheMicroscopic {
                          const double t0, double e0, const double dx0,
                          const double dy0, const double dz0, const bool aval,
                          bool hole);
+  // Transport an electron/hole up to the next update of the stack.
+  bool TransportItem(Electron& item, const bool aval, TransportState& state);
+  // Check if the frozen tables of a medium cover a given energy
+  // (otherwise add a request to the transport state).
+  static bool CheckTables(Medium* medium, const double energy,
+                          TransportState& state);
+  // Move the results of a transport state to the stack and the endpoints.
+  void Merge(TransportState& state, std::vector<Electron>& stack);
+  // Move a segment of the results of a transport state.
+  void Merge(TransportState& state, const TransportSegment& segment,
+             std::vector<Electron>& stack);
+  static std::array<size_t, 5> GetSizes(const TransportState& state);
+  // Add the counters of a transport state and clear its lists
+  // (after their contents have been merged).
+  void Finish(TransportState& state);
   // Photon transport
   void TransportPhoton(const double x, const double y, const double z,
-                       const double t, const double e,
-                       std::vector<Electron>& stack);
+                       const double t, const double e, TransportState& state);
+
+  void AddSignal(TransportState& state, const double q, const double t,
+                 const double dt, const double x, const double y,
+                 const double z, const double vx, const double vy,
+                 const double vz) const;
 
-  void ComputeRotationMatrix(const double bx, const double by, const double bz,
-                             const double bmag, const double ex,
-                             const double ey, const double ez);
+  static void ComputeRotationMatrix(const double bx, const double by,
+                                    const double bz, const double bmag,
+                                    const double ex, const double ey,
+                                    const double ez, RotationMatrix& rot);
 
-  void RotateGlobal2Local(double& dx, double& dy, double& dz) const;
-  void RotateLocal2Global(double& dx, double& dy, double& dz) const;
+  static void RotateGlobal2Local(double& dx, double& dy, double& dz,
+                                 const RotationMatrix& rot);
+  static void RotateLocal2Global(double& dx, double& dy, double& dz,
+                                 const RotationMatrix& rot);
 
   static bool IsInactive(const Electron& item) {
     return item.status == StatusLeftDriftMedium ||
@@ -332,15 +450,16 @@ class AvalancheMicroscopic {
            item.status == StatusOutsideTimeWindow ||
            item.status == StatusLeftDriftArea || item.status == StatusAttached;
   }
-  void Update(std::vector<Electron>::iterator it, const double x,
-              const double y, const double z, const double t,
-              const double energy, const double kx, const double ky,
-              const double kz, const int band);
-  void AddToEndPoints(const Electron& item, const bool hole) {
+  static void Update(Electron& item, const double x, const double y,
+                     const double z, const double t, const double energy,
+                     const double kx, const double ky, const double kz,
+                     const int band);
+  static void AddToEndPoints(const Electron& item, const bool hole,
+                             TransportState& state) {
     if (hole) {
-      m_endpointsHoles.push_back(item);
+      state.endpointsHoles.push_back(item);
     } else {
-      m_endpointsElectrons.push_back(item);
+      state.endpointsElectrons.push_back(item);
     }
   }
 
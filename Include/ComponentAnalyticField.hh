@@ -1,8 +1,10 @@
 #ifndef G_COMPONENT_ANALYTIC_FIELD_H
 #define G_COMPONENT_ANALYTIC_FIELD_H
 
+#include <atomic>
 #include <cmath>
 #include <complex>
+#include <mutex>
 
 #include "ComponentBase.hh"
 #include "FundamentalConstants.hh"
@@ -53,6 +55,10 @@ class ComponentAnalyticField : public ComponentBase {
     }
   }
 
+  void ElectricFieldBatch(const size_t n, const double* x, const double* y,
+                          const double* z, double* ex, double* ey, double* ez,
+                          double* v, Medium** m, int* status) override;
+
   bool GetVoltageRange(double& pmin, double& pmax) override;
 
   void WeightingField(const double x, const double y, const double z,
@@ -60,14 +66,14 @@ class ComponentAnalyticField : public ComponentBase {
                       const std::string& label) override {
     wx = wy = wz = 0.;
     double volt = 0.;
-    if (!m_sigset) PrepareSignals();
+    if (!m_sigset) PrepareSignalsOnce();
     Wfield(x, y, z, wx, wy, wz, volt, label, false);
   }
   double WeightingPotential(const double x, const double y, const double z,
                             const std::string& label) override {
     double wx = 0., wy = 0., wz = 0.;
     double volt = 0.;
-    if (!m_sigset) PrepareSignals();
+    if (!m_sigset) PrepareSignalsOnce();
     Wfield(x, y, z, wx, wy, wz, volt, label, true);
     return volt;
   }
@@ -123,6 +129,11 @@ class ComponentAnalyticField : public ComponentBase {
                  const double q);
   void ClearCharges();
   void PrintCharges() const;
+  /// Get the number of point charges.
+  unsigned int GetNumberOfCharges() const { return m_ch3d.size(); }
+  /// Get the position [cm] and charge [fC] of a point charge.
+  bool GetCharge(const unsigned int i, double& x, double& y, double& z,
+                 double& q) const;
 
   /** Return the cell type.
     * Cells are classified according to the number
@@ -191,8 +202,11 @@ class ComponentAnalyticField : public ComponentBase {
  private:
   bool m_chargeCheck = false;
 
-  bool m_cellset = false;
-  bool m_sigset = false;
+  std::atomic<bool> m_cellset{false};
+  std::atomic<bool> m_sigset{false};
+  /// Lock for the (lazy) set-up of the cell and of the weighting fields,
+  /// which may be triggered by several threads evaluating the field.
+  std::mutex m_prepareMutex;
 
   bool m_polar = false;
 
@@ -238,6 +252,9 @@ class ComponentAnalyticField : public ComponentBase {
     int nTrap;
   };
   std::vector<Wire> m_w;
+  // Coordinates and charges of the wires as contiguous arrays,
+  // used by the field kernels (filled by Prepare).
+  std::vector<double> m_wx, m_wy, m_we;
 
   // Stretching weight
   std::vector<double> weight;
@@ -334,6 +351,10 @@ class ComponentAnalyticField : public ComponentBase {
 
   void CellInit();
   bool Prepare();
+  /// Set up the cell if this has not been done yet.
+  bool PrepareOnce();
+  /// Set up the weighting fields if this has not been done yet.
+  bool PrepareSignalsOnce();
   bool CellCheck();
   bool CellType();
   std::string GetCellType(const Cell) const;
@@ -375,8 +396,13 @@ class ComponentAnalyticField : public ComponentBase {
   // Evaluation of the electric field
   int Field(const double xin, const double yin, const double zin, double& ex,
             double& ey, double& ez, double& volt, const bool opt);
+  // Check if a point is behind a plane (-4) or inside a wire (index + 1).
+  int Locate(const double xpos, const double ypos, double& volt) const;
   void FieldA00(const double xpos, const double ypos, double& ex, double& ey,
                 double& volt, const bool opt) const;
+  // Field (added to ex, ey, volt) at several points, for cells of type A.
+  void FieldA00(const size_t n, const double* xpos, const double* ypos,
+                double* ex, double* ey, double* volt, const bool opt) const;
   void FieldB1X(const double xpos, const double ypos, double& ex, double& ey,
                 double& volt, const bool opt) const;
   void FieldB1Y(const double xpos, const double ypos, double& ex, double& ey,
@@ -21,13 +21,6 @@ class ComponentAnsys121 : public ComponentFieldMap {
                      double& ey, double& ez, double& v, Medium*& m,
                      int& status) override;
 
-  void WeightingField(const double x, const double y, const double z,
-                      double& wx, double& wy, double& wz,
-                      const std::string& label) override;
-
-  double WeightingPotential(const double x, const double y, const double z,
-                            const std::string& label) override;
-
   bool Initialise(std::string elist = "ELIST.lis",
                   std::string nlist = "NLIST.lis",
                   std::string mplist = "MPLIST.lis",
@@ -39,6 +32,12 @@ class ComponentAnsys121 : public ComponentFieldMap {
  protected:
   void UpdatePeriodicity() override;
 
+  void WeightingFieldFromHandle(const double x, const double y,
+                                const double z, double& wx, double& wy,
+                                double& wz, const int iw) override;
+  double WeightingPotentialFromHandle(const double x, const double y,
+                                      const double z, const int iw) override;
+
   double GetElementVolume(const unsigned int i) override;
   void GetAspectRatio(const unsigned int i, double& dmin,
                       double& dmax) override;
@@ -2,8 +2,12 @@
 #define G_COMPONENT_BASE_H
 
 #include <array>
+#include <deque>
+#include <mutex>
 #include <string>
+#include <vector>
 
+#include "FieldQueryContext.hh"
 #include "GeometryBase.hh"
 
 namespace Garfield {
@@ -49,6 +53,45 @@ class ComponentBase {
   virtual void ElectricField(const double x, const double y, const double z,
                              double& ex, double& ey, double& ez, double& v,
                              Medium*& m, int& status) = 0;
+  /** Calculate the drift field and potential at a given point, using
+    * the search hints stored in a caller-owned context instead of
+    * those of the calling thread.
+    *
+    * For components which keep their search state in the context
+    * (finite-element field maps, TCAD) and for ComponentAnalyticField,
+    * this function can be called concurrently from several threads.
+    * Their lazy initialisation (element search structures, charges) is
+    * done under a lock. For other components, the first evaluation
+    * should be done before the component is shared between threads.
+    */
+  void ElectricField(FieldQueryContext& context, const double x,
+                     const double y, const double z, double& ex, double& ey,
+                     double& ez, double& v, Medium*& m, int& status);
+  /// Calculate the drift field at a given point, using a caller-owned context.
+  void ElectricField(FieldQueryContext& context, const double x,
+                     const double y, const double z, double& ex, double& ey,
+                     double& ez, Medium*& m, int& status);
+  /// Get the medium at a given location, using a caller-owned context.
+  Medium* GetMedium(FieldQueryContext& context, const double x,
+                    const double y, const double z);
+  /** Calculate the drift field (and potential) at a batch of points.
+    *
+    * \param n number of points.
+    * \param x,y,z coordinates [cm], arrays of length n.
+    * \param ex,ey,ez components of the electric field [V/cm].
+    * \param v potential [V], can be null if not needed.
+    * \param m media at the points.
+    * \param status status flags (see above).
+    *
+    * The default implementation calls ElectricField point by point.
+    * Components override it to do their set-up and checks once per batch
+    * and to keep the search state warm between neighbouring points.
+    */
+  virtual void ElectricFieldBatch(const size_t n, const double* x,
+                                  const double* y, const double* z,
+                                  double* ex, double* ey, double* ez,
+                                  double* v, Medium** m, int* status);
+
   /// Calculate the voltage range [V].
   virtual bool GetVoltageRange(double& vmin, double& vmax) = 0;
 
@@ -63,6 +106,23 @@ class ComponentBase {
   virtual double WeightingPotential(const double x, const double y,
                                     const double z, const std::string& label);
 
+  /** Get a handle for the weighting field of an electrode, which can be
+    * passed to WeightingField and WeightingPotential instead of the label.
+    * This avoids looking up the label in every call (e. g. for readouts
+    * with many electrodes). A negative value indicates an unknown label.
+    */
+  virtual int GetWeightingFieldHandle(const std::string& label);
+  /// Calculate the weighting field for a handle from GetWeightingFieldHandle.
+  void WeightingField(const double x, const double y, const double z,
+                      double& wx, double& wy, double& wz, const int handle) {
+    WeightingFieldFromHandle(x, y, z, wx, wy, wz, handle);
+  }
+  /// Calculate the weighting potential for a handle.
+  double WeightingPotential(const double x, const double y, const double z,
+                            const int handle) {
+    return WeightingPotentialFromHandle(x, y, z, handle);
+  }
+
   /** Calculate the magnetic field at a given point.
     *
     * \param x,y,z coordinates [cm].
@@ -175,6 +235,9 @@ class ComponentBase {
   }
   void DisableRotationSymmetryZ() { EnableRotationSymmetryZ(false); }
 
+  /// Get the name of the class.
+  const std::string& GetClassName() const { return m_className; }
+
   /// Switch on debugging messages.
   void EnableDebugging() { m_debug = true; }
   /// Switch off debugging messages.
@@ -256,6 +319,52 @@ class ComponentBase {
   /// Switch on/off debugging messages
   bool m_debug = false;
 
+  /// Slot of this component in a FieldQueryContext.
+  FieldQueryContext::Slot m_hintSlot;
+  /// Search hint (e. g. the last element found) for the calling thread.
+  int& Hint() const { return FieldQueryContext::Current().Hint(m_hintSlot); }
+
+  /// Labels of the weighting fields, indexed by handle. Handles can be
+  /// requested and used concurrently by several threads (e. g. by sensors
+  /// sharing the component). Labels are never removed, so a label stays
+  /// at the same address once it has been added. Unlike a std::mutex, the
+  /// list can be copied, such that the components stay copyable.
+  class HandleLabels {
+   public:
+    HandleLabels() = default;
+    HandleLabels(const HandleLabels& rhs) : m_labels(rhs.Copy()) {}
+    HandleLabels& operator=(const HandleLabels& rhs) {
+      if (this == &rhs) return *this;
+      auto labels = rhs.Copy();
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_labels.swap(labels);
+      return *this;
+    }
+    /// Get the handle of a label (added if not yet known).
+    int Find(const std::string& label);
+    /// Get the label of a handle (null if the handle is unknown).
+    const std::string* Get(const int handle) const;
+
+   private:
+    mutable std::mutex m_mutex;
+    std::deque<std::string> m_labels;
+
+    std::deque<std::string> Copy() const {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      return m_labels;
+    }
+  };
+  HandleLabels m_handleLabels;
+  /// Weighting field for a handle (default: calculated using the label).
+  virtual void WeightingFieldFromHandle(const double x, const double y,
+                                        const double z, double& wx,
+                                        double& wy, double& wz,
+                                        const int handle);
+  /// Weighting potential for a handle.
+  virtual double WeightingPotentialFromHandle(const double x, const double y,
+                                              const double z,
+                                              const int handle);
+
   /// Reset the component.
   virtual void Reset() = 0;
   /// Verify periodicities.
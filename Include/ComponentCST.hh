@@ -42,6 +42,8 @@ class ComponentCST : public ComponentFieldMap {
 
   double WeightingPotential(const double x, const double y, const double z,
                             const std::string& label) override;
+  using ComponentFieldMap::WeightingField;
+  using ComponentFieldMap::WeightingPotential;
   /**
    * Deprecated version of the interface based on text file import of field
    * data.
@@ -198,6 +200,13 @@ class ComponentCST : public ComponentFieldMap {
   double GetElementVolume(const unsigned int i) override;
   void GetAspectRatio(const unsigned int i, double& dmin,
                       double& dmax) override;
+  void WriteSnapshotData(std::vector<char>& buffer) const override;
+  bool ReadSnapshotData(SnapshotReader& in) override;
+  void WeightingFieldFromHandle(const double x, const double y, const double z,
+                                double& wx, double& wy, double& wz,
+                                const int iw) override;
+  double WeightingPotentialFromHandle(const double x, const double y,
+                                      const double z, const int iw) override;
   //  static bool Greater(const double& a, const double& b) {
   //    return (a > b);
   //  };
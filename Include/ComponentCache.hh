@@ -0,0 +1,153 @@
+#ifndef G_COMPONENT_CACHE_H
+#define G_COMPONENT_CACHE_H
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "ComponentBase.hh"
+
+namespace Garfield {
+
+/// Proxy which caches the electric field of another (slow) component
+/// on an adaptive octree and answers queries by trilinear interpolation.
+///
+/// The octree is built lazily: a cell is sampled the first time a point
+/// inside it is requested. The field is evaluated at the eight corners;
+/// if the interpolated field at the centre of the cell or at the centres
+/// of its faces deviates from the exact one by more than the tolerance,
+/// the cell is split. Cells with corners in different media or inside a
+/// wire, and cells close to a wire or point charge of a cached
+/// ComponentAnalyticField, are refined down to the maximum depth and then
+/// left to the exact component.
+/// Weighting fields, magnetic fields, media and wire checks are forwarded.
+
+class ComponentCache : public ComponentBase {
+ public:
+  /// Constructor
+  ComponentCache();
+  /// Destructor
+  ~ComponentCache() {}
+
+  /// Set the component to be cached.
+  void SetComponent(ComponentBase* c);
+  /// Set the region to be cached (default: bounding box of the component).
+  void SetArea(const double xmin, const double ymin, const double zmin,
+               const double xmax, const double ymax, const double zmax);
+  /// Set the relative tolerance of the interpolated field (default: 1e-3).
+  void SetTolerance(const double tol);
+  /// Set the minimum and maximum depth of the octree (default: 2, 10).
+  void SetRefinement(const unsigned int minDepth, const unsigned int maxDepth);
+  /// Discard all cached values (not while other threads query the field).
+  void ClearCache();
+
+  /// Write the cached field to a file.
+  bool Save(const std::string& filename);
+  /** Read the cached field from a file written by Save.
+    * The file is rejected if it was made for another type of component,
+    * a component with a different bounding box or field (compared at the
+    * corners and the centre of the cache area), or with a different
+    * cache area, tolerance or refinement depth.
+    */
+  bool Load(const std::string& filename);
+  /// Print the number of cells and (in debug mode) of interpolated and
+  /// exact queries.
+  void PrintStatistics() const;
+
+  void ElectricField(const double x, const double y, const double z, double& ex,
+                     double& ey, double& ez, Medium*& m, int& status) override;
+  void ElectricField(const double x, const double y, const double z, double& ex,
+                     double& ey, double& ez, double& v, Medium*& m,
+                     int& status) override;
+  bool GetVoltageRange(double& vmin, double& vmax) override;
+
+  void WeightingField(const double x, const double y, const double z,
+                      double& wx, double& wy, double& wz,
+                      const std::string& label) override;
+  double WeightingPotential(const double x, const double y, const double z,
+                            const std::string& label) override;
+  void MagneticField(const double x, const double y, const double z, double& bx,
+                     double& by, double& bz, int& status) override;
+  Medium* GetMedium(const double x, const double y, const double z) override;
+
+  bool IsReady() override;
+  bool GetBoundingBox(double& xmin, double& ymin, double& zmin, double& xmax,
+                      double& ymax, double& zmax) override;
+  bool IsWireCrossed(const double x0, const double y0, const double z0,
+                     const double x1, const double y1, const double z1,
+                     double& xc, double& yc, double& zc) override;
+  bool IsInTrapRadius(const double q0, const double x0, const double y0,
+                      const double z0, double& xw, double& yw,
+                      double& rw) override;
+
+ private:
+  enum CellState { Empty = 0, Interpolate, Exact, Split };
+  struct Node {
+    /// Field and potential (ex, ey, ez, v) at the eight corners.
+    /// Corner i has the upper x/y/z coordinate if bit 0/1/2 of i is set.
+    double f[8][4];
+    Medium* medium = nullptr;
+    std::atomic<int> state{Empty};
+    std::unique_ptr<Node[]> children;
+  };
+
+  ComponentBase* m_component = nullptr;
+
+  bool m_hasArea = false;
+  double m_xmin[3] = {0., 0., 0.};
+  double m_xmax[3] = {0., 0., 0.};
+
+  double m_tolerance = 1.e-3;
+  unsigned int m_minDepth = 2;
+  unsigned int m_maxDepth = 10;
+  // Potential difference used as scale for the tolerance on the potential.
+  double m_vScale = 0.;
+
+  std::unique_ptr<Node> m_root;
+  // Set once the root cell has been set up (or the set-up has failed).
+  std::atomic<bool> m_initialised{false};
+  // Serialises the set-up, clearing, saving and loading of the cache.
+  std::mutex m_mutex;
+  // Serialise the sampling of a cell (selected by the address of the node).
+  static constexpr unsigned int nStripes = 64;
+  std::mutex m_stripes[nStripes];
+
+  // Wires (x, y, radius) and point charges (x, y, z) of an analytic field.
+  std::vector<std::array<double, 3> > m_wires;
+  std::vector<std::array<double, 3> > m_charges;
+  // Periodic lengths in x and y of an analytic field (0 if not periodic).
+  double m_period[2] = {0., 0.};
+
+  std::atomic<unsigned long> m_nCells{0};
+  // Numbers of queries, only counted in debug mode.
+  std::atomic<unsigned long> m_nInterpolated{0};
+  std::atomic<unsigned long> m_nExact{0};
+
+  void Reset() override;
+  void UpdatePeriodicity() override;
+
+  bool Initialise();
+  void Evaluate(const double x, const double y, const double z, double& ex,
+                double& ey, double& ez, double& v, Medium*& m, int& status,
+                const bool opt);
+  void Sample(Node& node, const double* x0, const double* dx,
+              const unsigned int depth);
+  std::mutex& StripeMutex(const Node& node) {
+    return m_stripes[(reinterpret_cast<uintptr_t>(&node) / sizeof(Node)) %
+                     nStripes];
+  }
+  bool IsNearSingularity(const double* x0, const double* dx) const;
+  bool GetComponentBox(double* bmin, double* bmax) const;
+  void Fingerprint(const double* xmin, const double* xmax,
+                   double f[9][4]) const;
+  void WriteNode(std::ostream& out, const Node& node) const;
+  bool ReadNode(std::istream& in, Node& node, const double* x0,
+                const double* dx);
+};
+}
+#endif
@@ -20,13 +20,6 @@ class ComponentComsol : public ComponentFieldMap {
                      double& ey, double& ez, double& v, Medium*& m,
                      int& status) override;
 
-  void WeightingField(const double x, const double y, const double z,
-                      double& wx, double& wy, double& wz,
-                      const std::string& label) override;
-
-  double WeightingPotential(const double x, const double y, const double z,
-                            const std::string& label) override;
-
   Medium* GetMedium(const double x, const double y, const double z) override;
 
   bool Initialise(std::string header = "mesh.mphtxt",
@@ -38,6 +31,12 @@ class ComponentComsol : public ComponentFieldMap {
  protected:
   void UpdatePeriodicity() override { UpdatePeriodicityCommon(); }
 
+  void WeightingFieldFromHandle(const double x, const double y,
+                                const double z, double& wx, double& wy,
+                                double& wz, const int iw) override;
+  double WeightingPotentialFromHandle(const double x, const double y,
+                                      const double z, const int iw) override;
+
   double GetElementVolume(const unsigned int i) override;
   void GetAspectRatio(const unsigned int i, double& dmin,
                       double& dmax) override;
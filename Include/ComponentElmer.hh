@@ -26,12 +26,6 @@ class ComponentElmer : public ComponentFieldMap {
                      double& ey, double& ez, double& v, Medium*& m,
                      int& status) override;
 
-  void WeightingField(const double x, const double y, const double z,
-                      double& wx, double& wy, double& wz,
-                      const std::string& label) override;
-  double WeightingPotential(const double x, const double y, const double z,
-                            const std::string& label) override;
-
   Medium* GetMedium(const double x, const double y, const double z) override;
 
   /** Import a field map from a set of files.
@@ -56,6 +50,12 @@ class ComponentElmer : public ComponentFieldMap {
   // Verify periodicities
   void UpdatePeriodicity() override { UpdatePeriodicityCommon(); }
 
+  void WeightingFieldFromHandle(const double x, const double y,
+                                const double z, double& wx, double& wy,
+                                double& wz, const int iw) override;
+  double WeightingPotentialFromHandle(const double x, const double y,
+                                      const double z, const int iw) override;
+
   double GetElementVolume(const unsigned int i) override;
   void GetAspectRatio(const unsigned int i, double& dmin,
                       double& dmax) override;
@@ -1,10 +1,17 @@
 #ifndef G_COMPONENT_FIELD_MAP_H
 #define G_COMPONENT_FIELD_MAP_H
 
+#include <atomic>
 #include <iostream>
+#include <mutex>
+#include <string>
+#include <vector>
+
 #include "ComponentBase.hh"
+#include "ElementGrid.hh"
+#include "Snapshot.hh"
 #include "TMatrixD.h"
-#include "TetrahedralTree.hh"
+#include "TextFile.hh"
 
 namespace Garfield {
 
@@ -71,29 +78,68 @@ class ComponentFieldMap : public ComponentBase {
   virtual void ElectricField(const double x, const double y, const double z,
                              double& ex, double& ey, double& ez, double& v,
                              Medium*& m, int& status) override = 0;
-
-  virtual void WeightingField(const double x, const double y, const double z,
-                              double& wx, double& wy, double& wz,
-                              const std::string& label) override = 0;
-
-  virtual double WeightingPotential(const double x, const double y,
-                                    const double z,
-                                    const std::string& label) override = 0;
+  void ElectricFieldBatch(const size_t n, const double* x, const double* y,
+                          const double* z, double* ex, double* ey, double* ez,
+                          double* v, Medium** m, int* status) override;
+
+  void WeightingField(const double x, const double y, const double z,
+                      double& wx, double& wy, double& wz,
+                      const std::string& label) override;
+  double WeightingPotential(const double x, const double y, const double z,
+                            const std::string& label) override;
+  using ComponentBase::WeightingField;
+  using ComponentBase::WeightingPotential;
+  /// Get the handle (index) of a weighting field that has been loaded.
+  int GetWeightingFieldHandle(const std::string& label) override {
+    return FindWeightingField(label);
+  }
+  /** Store the weighting potentials in single precision
+    * (halves the memory needed by maps with many electrodes).
+    */
+  void EnableSinglePrecisionWeightingFields(const bool on = true);
 
   // Options
   void EnableCheckMapIndices() {
     m_checkMultipleElement = true;
-    m_lastElement = -1;
+    LastElement() = -1;
   }
   void DisableCheckMapIndices() { m_checkMultipleElement = false; }
   void EnableDeleteBackgroundElements() { m_deleteBackground = true; }
   void DisableDeleteBackgroundElements() { m_deleteBackground = false; }
 
-  /// Enable or disable the usage of the tetrahedral tree
-  /// for searching the element in the mesh.
+  /// Enable or disable the usage of a grid of element bounding boxes
+  /// for searching the element in the mesh (default: enabled).
+  void EnableElementGrid(const bool on = true) { m_useElementGrid = on; }
+  /// Same as EnableElementGrid (the grid replaces the tetrahedral tree).
   void EnableTetrahedralTreeForElementSearch(const bool on = true) {
-    m_useTetrahedralTree = on;
+    EnableElementGrid(on);
   }
+  /** Enable or disable the walk from the previously found element
+    * through its face neighbours to the element containing a point,
+    * before searching the whole mesh (default: enabled).
+    */
+  void EnableElementWalk(const bool on = true) { m_useElementWalk = on; }
+  /// Print how often the previous element, the walk through the neighbours
+  /// and the search of the whole mesh were used to locate a point
+  /// (counted only in debug mode).
+  void PrintElementSearchStatistics() const;
+  /// Reset the counters of the element search.
+  void ResetElementSearchStatistics();
+
+  /// Set the number of threads used for parsing field map files
+  /// (0: number of hardware threads, default).
+  void SetNumberOfReadThreads(const unsigned int n) { m_nReadThreads = n; }
+
+  /** Write the mesh, potentials, materials, weighting fields and element
+    * search structures to a binary snapshot file, which can be read back
+    * much faster than the original field map files.
+    */
+  bool SaveSnapshot(const std::string& filename);
+  /** Restore the field map from a snapshot written by SaveSnapshot
+    * (for the same type of component). The file is memory-mapped.
+    * The materials have to be associated with media again afterwards.
+    */
+  bool LoadSnapshot(const std::string& filename);
 
   friend class ViewFEMesh;
 
@@ -120,8 +166,6 @@ class ComponentFieldMap : public ComponentBase {
     double x, y, z;
     // Potential
     double v;
-    // Weighting potentials
-    std::vector<double> w;
   };
   std::vector<Node> nodes;
 
@@ -141,6 +185,15 @@ class ComponentFieldMap : public ComponentBase {
   int nWeightingFields = 0;
   std::vector<std::string> wfields;
   std::vector<bool> wfieldsOk;
+  /// Values of a weighting potential at the nodes.
+  struct NodeValues {
+    std::vector<double> d;
+    /// Single-precision values (used instead of d if not empty).
+    std::vector<float> f;
+    double operator[](const size_t i) const { return f.empty() ? d[i] : f[i]; }
+  };
+  /// Weighting potentials, one array per weighting field.
+  std::vector<NodeValues> m_wpot;
 
   // Bounding box
   bool hasBoundingBox = false;
@@ -163,6 +216,9 @@ class ComponentFieldMap : public ComponentBase {
   // Option to delete meshing in conductors
   bool m_deleteBackground = true;
 
+  // Number of threads for reading files (0: hardware threads).
+  unsigned int m_nReadThreads = 0;
+
   // Warnings flag
   bool m_warning = false;
   unsigned int m_nWarnings = 0;
@@ -201,6 +257,27 @@ class ComponentFieldMap : public ComponentBase {
   int ReadInteger(char* token, int def, bool& error);
   double ReadDouble(char* token, double def, bool& error);
 
+  /// Find the data lines in an ANSYS list, skipping blank lines, page breaks
+  /// and lines starting with one of the given headers. For records which
+  /// span several lines, the index of the first line is returned.
+  static std::vector<size_t> FindAnsysRecords(
+      const TextFile& file, const std::vector<std::string>& headers,
+      const unsigned int nLinesPerRecord = 1);
+  /// Read the nodes from an ANSYS node list (NLIST).
+  bool ReadAnsysNodes(const std::string& filename, const double funit,
+                      bool& ok);
+  /** Read the potentials from an ANSYS nodal solution list (PRNSOL).
+    * \param filename name of the file.
+    * \param header name of the calling function, for error messages.
+    * \param v potentials, indexed by node number - 1.
+    * \param nRead number of potentials read.
+    * \param ok set to false in case of out-of-range node numbers.
+    * \return false if the file cannot be opened or parsed.
+    */
+  bool ReadAnsysPotentials(const std::string& filename,
+                           const std::string& header, std::vector<double>& v,
+                           int& nRead, bool& ok);
+
   virtual double GetElementVolume(const unsigned int i) = 0;
   virtual void GetAspectRatio(const unsigned int i, double& dmin,
                               double& dmax) = 0;
@@ -215,25 +292,84 @@ class ComponentFieldMap : public ComponentBase {
     std::cerr << m_className << "::" << header << ":\n"
               << "    Field map not yet initialised.\n";
   }
+  /// Get the index of a weighting field (-1 if there is none).
+  int FindWeightingField(const std::string& label) const;
+  /// Get the index of a weighting field, adding it if it does not exist.
+  int AddWeightingField(const std::string& label);
+  /// Store the potentials of a weighting field at the nodes.
+  void SetWeightingPotentials(const int iw, std::vector<double>& values);
+  /// Remove all weighting fields.
+  void ClearWeightingFields();
+
+  void WeightingFieldFromHandle(const double x, const double y,
+                                const double z, double& wx, double& wy,
+                                double& wz, const int iw) override = 0;
+  double WeightingPotentialFromHandle(const double x, const double y,
+                                      const double z,
+                                      const int iw) override = 0;
+
   void PrintElement(const std::string& header, const double x, const double y,
                     const double z, const double t1, const double t2,
                     const double t3, const double t4, const Element& element,
                     const unsigned int n, const int iw = -1) const;
 
+  /// Append raw bytes to a snapshot.
+  static void Append(std::vector<char>& buffer, const void* src,
+                     const size_t n) {
+    Snapshot::Append(buffer, src, n);
+  }
+  /// Append a vector (preceded by its size) to a snapshot.
+  template <typename T>
+  static void AppendVector(std::vector<char>& buffer,
+                           const std::vector<T>& v) {
+    Snapshot::AppendVector(buffer, v);
+  }
+  /// Set up the element search structures for a newly loaded field map.
+  void PrepareElementSearch();
+  /// Cursor over the contents of a snapshot.
+  typedef Snapshot::Reader SnapshotReader;
+  /// Write data held by a derived class to a snapshot.
+  virtual void WriteSnapshotData(std::vector<char>& /*buffer*/) const {}
+  /// Read data held by a derived class from a snapshot.
+  virtual bool ReadSnapshotData(SnapshotReader& /*in*/) { return true; }
+
  private:
   /// Scan for multiple elements that contain a point
   bool m_checkMultipleElement = false;
 
-  // Tetrahedral tree
-  bool m_useTetrahedralTree = false;
-  bool m_isTreeInitialized = false;
-  TetrahedralTree* m_tetTree = nullptr;
+  /// Store weighting potentials in single precision?
+  bool m_singlePrecisionWeightingFields = false;
 
-  /// Flag to check if bounding boxes of elements are cached
-  bool m_cacheElemBoundingBoxes = false;
+  // Grid of element bounding boxes for the element search.
+  bool m_useElementGrid = true;
+  std::atomic<bool> m_isGridInitialized{false};
+  ElementGrid m_grid;
 
-  /// Keep track of the last element found.
-  int m_lastElement = -1;
+  // Neighbouring elements for the walk search.
+  bool m_useElementWalk = true;
+  std::atomic<bool> m_hasNeighbours{false};
+  /// Neighbour across the face (3D) or edge (2D) opposite to corner i
+  /// of element j (index 4 * j + i), -1 at the boundary of the mesh.
+  /// For quadrilaterals, i is the edge from corner i to corner i + 1.
+  std::vector<int> m_neighbours;
+
+  /// Number of points found in the previous element, by the walk
+  /// and by searching the whole mesh (or grid cell), in debug mode.
+  std::atomic<unsigned long> m_nFoundInLast{0};
+  std::atomic<unsigned long> m_nFoundByWalk{0};
+  std::atomic<unsigned long> m_nGlobalSearches{0};
+
+  /// Flag to check if bounding boxes of elements are cached
+  std::atomic<bool> m_cacheElemBoundingBoxes{false};
+  /// Lock for the (lazy) set-up of bounding boxes and element grid.
+  std::mutex m_searchMutex;
+
+  /// Element found in the previous call (stored in the query context).
+  int& LastElement() const {
+    int& last = Hint();
+    if (last >= nElements) last = -1;
+    return last;
+  }
 
   /// Calculate local coordinates for curved quadratic triangles.
   int Coordinates3(double x, double y, double z, double& t1, double& t2,
@@ -278,8 +414,19 @@ class ComponentFieldMap : public ComponentBase {
   /// Calculate the bounding boxes of all elements after initialization.
   void CalculateElementBoundingBoxes();
 
-  /// Initialize the tetrahedral tree.
-  bool InitializeTetrahedralTree();
+  /// Calculate the element bounding boxes and initialize the element
+  /// grid and neighbour lists (if requested), unless done already.
+  bool InitializeElementSearch(const std::string& header);
+  /// Initialize the element grid.
+  bool InitializeElementGrid();
+  /// Set up the table of neighbouring elements.
+  void InitializeNeighbours();
+  /** Walk from element e towards the point (x, y, z), crossing at each
+    * step the face with the most negative (linear) local coordinate.
+    * Returns the element reached, or -1 if the walk leaves the mesh.
+    */
+  int WalkToElement(const double x, const double y, const double z,
+                    int e) const;
 };
 }
 
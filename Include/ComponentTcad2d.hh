@@ -2,6 +2,7 @@
 #define G_COMPONENT_TCAD_2D_H
 
 #include "ComponentBase.hh"
+#include "ElementGrid.hh"
 
 namespace Garfield {
 
@@ -38,6 +39,16 @@ class ComponentTcad2d : public ComponentBase {
   /// Import mesh and field map from files.
   bool Initialise(const std::string& gridfilename,
                   const std::string& datafilename);
+  /** Write the mesh, the imported data and the element search structures
+    * to a binary snapshot file, which can be read back much faster than
+    * the original files.
+    */
+  bool SaveSnapshot(const std::string& filename) const;
+  /** Restore the mesh and data from a snapshot written by SaveSnapshot
+    * (instead of calling Initialise). The media have to be associated with
+    * the regions again afterwards.
+    */
+  bool LoadSnapshot(const std::string& filename);
 
   /// List all currently defined regions.
   void PrintRegions() const;
@@ -152,6 +163,9 @@ class ComponentTcad2d : public ComponentBase {
   };
   std::vector<Element> m_elements;
 
+  // Grid of element bounding boxes for the element search.
+  ElementGrid m_grid;
+
   struct Defect {
     // Electron cross-section
     double xsece;
@@ -185,8 +199,12 @@ class ComponentTcad2d : public ComponentBase {
   double m_xMinBB, m_yMinBB, m_zMinBB;
   double m_xMaxBB, m_yMaxBB, m_zMaxBB;
 
-  // Element from the previous call
-  int m_lastElement = 0;
+  // Element from the previous call (stored in the query context)
+  int& LastElement() const {
+    int& last = Hint();
+    if (last >= static_cast<int>(m_elements.size())) last = -1;
+    return last;
+  }
 
   void Reset() override;
   void UpdatePeriodicity() override;
@@ -206,6 +224,7 @@ class ComponentTcad2d : public ComponentBase {
   bool LoadData(const std::string& datafilename);
   bool ReadDataset(std::ifstream& datafile, const std::string& dataset);
   void FindNeighbours();
+  bool BuildElementGrid();
   void Cleanup();
 
   int FindRegion(const std::string& name) const;
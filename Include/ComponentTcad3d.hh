@@ -2,6 +2,7 @@
 #define G_COMPONENT_TCAD_3D_H
 
 #include "ComponentBase.hh"
+#include "ElementGrid.hh"
 
 namespace Garfield {
 
@@ -29,6 +30,16 @@ class ComponentTcad3d : public ComponentBase {
   /// Import mesh and field map from files.
   bool Initialise(const std::string& gridfilename,
                   const std::string& datafilename);
+  /** Write the mesh, the imported data and the element search structures
+    * to a binary snapshot file, which can be read back much faster than
+    * the original files.
+    */
+  bool SaveSnapshot(const std::string& filename) const;
+  /** Restore the mesh and data from a snapshot written by SaveSnapshot
+    * (instead of calling Initialise). The media have to be associated with
+    * the regions again afterwards.
+    */
+  bool LoadSnapshot(const std::string& filename);
 
   /// List all currently defined regions.
   void PrintRegions();
@@ -103,6 +114,9 @@ class ComponentTcad3d : public ComponentBase {
   };
   std::vector<Element> m_elements;
 
+  // Grid of element bounding boxes for the element search.
+  ElementGrid m_grid;
+
   // Face
   struct Face {
     // Indices of edges
@@ -118,8 +132,12 @@ class ComponentTcad3d : public ComponentBase {
   double m_xMinBB, m_yMinBB, m_zMinBB;
   double m_xMaxBB, m_yMaxBB, m_zMaxBB;
 
-  // Element from the previous call
-  int m_lastElement = 0;
+  // Element from the previous call (stored in the query context)
+  int& LastElement() const {
+    int& last = Hint();
+    if (last >= static_cast<int>(m_elements.size())) last = -1;
+    return last;
+  }
 
   void Reset() override;
   void UpdatePeriodicity() override;
@@ -150,6 +168,7 @@ class ComponentTcad3d : public ComponentBase {
   bool LoadGrid(const std::string& gridfilename);
   bool LoadData(const std::string& datafilename);
   bool ReadDataset(std::ifstream& datafile, const std::string& dataset);
+  bool BuildElementGrid();
   void Cleanup();
 
   void MapCoordinates(double& x, double& y, double& z, bool& xmirr, bool& ymirr,
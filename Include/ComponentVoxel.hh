@@ -1,6 +1,12 @@
 #ifndef G_COMPONENT_VOXEL_H
 #define G_COMPONENT_VOXEL_H
 
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
 #include "ComponentBase.hh"
 
 namespace Garfield {
@@ -19,6 +25,9 @@ class ComponentVoxel : public ComponentBase {
                      int& status) override;
   void ElectricField(const double x, const double y, const double z, double& ex,
                      double& ey, double& ez, Medium*& m, int& status) override;
+  void ElectricFieldBatch(const size_t n, const double* x, const double* y,
+                          const double* z, double* ex, double* ey, double* ez,
+                          double* v, Medium** m, int* status) override;
 
   void WeightingField(const double x, const double y, const double z,
                       double& wx, double& wy, double& wz,
@@ -34,9 +43,13 @@ class ComponentVoxel : public ComponentBase {
 
   /// Offset coordinates in the weighting field, such that the
   /// same numerical weighting field map can be used for electrodes at
-  /// different positions.
+  /// different positions. Only used for electrodes without a weighting
+  /// field map of their own (see LoadWeightingField).
   void SetWeightingFieldOffset(const double x, const double y, const double z);
 
+  /// Store the field maps loaded subsequently in single precision.
+  void EnableSinglePrecision(const bool on = true) { m_single = on; }
+
   Medium* GetMedium(const double x, const double y, const double z) override;
 
   bool GetVoltageRange(double& vmin, double& vmax) override;
@@ -78,6 +91,30 @@ class ComponentVoxel : public ComponentBase {
   /// Import magnetic field values from a file.
   bool LoadMagneticField(const std::string& filename, const std::string& format,
                          const double scaleX = 1., const double scaleB = 1.);
+  /// Import the weighting field (and potential) of an electrode from a file,
+  /// using the same mesh and formats as LoadElectricField.
+  bool LoadWeightingField(const std::string& filename,
+                          const std::string& format, const bool withPotential,
+                          const std::string& label, const double scaleX = 1.,
+                          const double scaleE = 1., const double scaleP = 1.);
+
+  /** Write the mesh, the electric field, the regions and (if present)
+    * the magnetic field to a binary file, which can be read by LoadBinary.
+    * The values are written in the precision in which they are stored.
+    */
+  bool SaveBinary(const std::string& filename) const;
+  /** Read a binary file written by SaveBinary. If map is true, the file
+    * is memory-mapped instead of read, so loading is instantaneous
+    * and the pages are shared between processes using the same file.
+    * This replaces SetMesh and LoadElectricField/LoadMagneticField;
+    * the media need to be set afterwards.
+    */
+  bool LoadBinary(const std::string& filename, const bool map = true);
+  /// Use the electric field of a binary file (on the same mesh)
+  /// as the weighting field of an electrode.
+  bool LoadWeightingFieldBinary(const std::string& filename,
+                                const std::string& label,
+                                const bool map = true);
 
   /// Return the indices of the element at a given point.
   bool GetElement(const double xi, const double yi, const double zi,
@@ -97,16 +134,51 @@ class ComponentVoxel : public ComponentBase {
 
  private:
   std::vector<Medium*> m_media;
-  struct Element {
-    double fx, fy, fz;  //< Field
-    double v;           //< Potential
+  /// Field values (fx, fy, fz, v) at the mesh elements, stored contiguously
+  /// with index (i * nY + j) * nZ + k, in double or single precision.
+  struct Grid {
+    std::vector<double> values;
+    std::vector<float> valuesF;
+    /// Data in use (owned or in a memory-mapped file).
+    const double* data = nullptr;
+    const float* dataF = nullptr;
+    /// Keeps a memory-mapped file alive.
+    std::shared_ptr<void> mapping;
+
+    Grid() = default;
+    Grid(const Grid& grid) { *this = grid; }
+    Grid& operator=(const Grid& grid);
+    bool Empty() const { return !data && !dataF; }
+    void Allocate(const size_t n, const bool single);
+    void Clear();
+    void Get(const size_t i, double* f) const {
+      if (dataF) {
+        const float* p = dataF + 4 * i;
+        f[0] = p[0];
+        f[1] = p[1];
+        f[2] = p[2];
+        f[3] = p[3];
+      } else {
+        const double* p = data + 4 * i;
+        f[0] = p[0];
+        f[1] = p[1];
+        f[2] = p[2];
+        f[3] = p[3];
+      }
+    }
+    void Set(const size_t i, const double fx, const double fy,
+             const double fz, const double v);
   };
   /// Electric field values and potentials at each mesh element.
-  std::vector<std::vector<std::vector<Element> > > m_efields;
+  Grid m_efields;
   /// Magnetic field values at each mesh element.
-  std::vector<std::vector<std::vector<Element> > > m_bfields;
+  Grid m_bfields;
+  /// Weighting field maps of individual electrodes.
+  std::map<std::string, Grid> m_wfields;
   /// Region indices.
-  std::vector<std::vector<std::vector<int> > > m_regions;
+  std::vector<int32_t> m_regionValues;
+  const int32_t* m_regions = nullptr;
+  std::shared_ptr<void> m_regionMapping;
   // Dimensions of the mesh
   unsigned int m_nX = 0, m_nY = 0, m_nZ = 0;
   double m_xMin = 0., m_yMin = 0., m_zMin = 0.;
@@ -114,6 +186,7 @@ class ComponentVoxel : public ComponentBase {
   double m_dx = 0., m_dy = 0., m_dz = 0.;
 
   bool m_interpolate = false;
+  bool m_single = false;
 
   bool m_hasMesh = false;
   bool m_hasPotential = false;
@@ -128,19 +201,30 @@ class ComponentVoxel : public ComponentBase {
   // Voltage range
   double m_pMin = 0., m_pMax = 0.;
 
+  size_t Index(const unsigned int i, const unsigned int j,
+               const unsigned int k) const {
+    return (size_t(i) * m_nY + j) * m_nZ + k;
+  }
   /// Read data from file.
   bool LoadData(const std::string& filename, std::string format,
                 const bool withPotential, const bool withRegion,
                 const double scaleX, const double scaleF, const double scaleP,
-                const char field);
+                Grid& grid, int32_t* regions, double& pmin, double& pmax);
+  /** Read (or map) a binary file. If full is true, the mesh, regions,
+    * electric and magnetic field of the component are set up;
+    * otherwise only the electric field is read into the given grid,
+    * after checking that the mesh matches.
+    */
+  bool ReadBinary(const std::string& filename, const bool map, Grid& grid,
+                  const bool full);
 
   void Reset() override;
   void UpdatePeriodicity() override;
 
   /// Look up/interpolate the field at a given point.
   bool GetField(const double x, const double y, const double z,
-                const std::vector<std::vector<std::vector<Element> > >& field,
-                double& fx, double& fy, double& fz, double& p, int& region);
+                const Grid& field, double& fx, double& fy, double& fz,
+                double& p, int& region);
   /// Reduce a coordinate to the basic cell (in case of periodicity).
   double Reduce(const double xin, const double xmin, const double xmax,
                 const bool simplePeriodic, const bool mirrorPeriodic,
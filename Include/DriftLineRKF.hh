@@ -118,9 +118,10 @@ class DriftLineRKF {
   bool GetVelocity(const double ex, const double ey, const double ez,
                    const double bx, const double by, const double bz,
                    double& vx, double& vy, double& vz) const;
-  bool GetDiffusion(const double ex, const double ey, const double ez,
+  bool GetTransport(const double ex, const double ey, const double ez,
                     const double bx, const double by, const double bz,
-                    double& dl, double& dt) const;
+                    const unsigned int what,
+                    Medium::TransportCoefficients& c) const;
   bool GetTownsend(const double ex, const double ey, const double ez,
                    const double bx, const double by, const double bz,
                    double& alpha) const;
@@ -0,0 +1,102 @@
+#ifndef G_ELEMENT_GRID_H
+#define G_ELEMENT_GRID_H
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace Garfield {
+
+/// Uniform grid over the bounding boxes of the elements of a field map,
+/// used to speed up the element search.
+///
+/// Each cell holds the (sorted) indices of the elements whose bounding box
+/// overlaps the cell. The lists of all cells are stored back to back in a
+/// single array, so a query is a couple of multiplications and returns a
+/// range within that array, without any allocation.
+
+class ElementGrid {
+ public:
+  /// Range of element indices.
+  struct Range {
+    const int* first;
+    const int* last;
+    const int* begin() const { return first; }
+    const int* end() const { return last; }
+    size_t size() const { return last - first; }
+  };
+
+  /// Constructor
+  ElementGrid() {}
+  /// Destructor
+  ~ElementGrid() {}
+
+  /** Build the grid.
+    * \param boxes bounding boxes (xmin, ymin, zmin, xmax, ymax, zmax).
+    * \param is3d if false, the grid has a single cell along z.
+    * \param nThreads number of threads (0: number of hardware threads).
+    * \return false if there are no boxes or the element lists would have
+    *         more entries than can be indexed by 32-bit offsets.
+    */
+  bool Build(const std::vector<std::array<double, 6> >& boxes,
+             const bool is3d, const unsigned int nThreads = 0);
+  /// Remove all cells.
+  void Clear();
+  /// Has the grid been built?
+  bool IsBuilt() const { return !m_offsets.empty(); }
+
+  /// Get the index of the cell containing a point (false if outside).
+  bool GetCell(const double x, const double y, const double z,
+               size_t& cell) const {
+    cell = 0;
+    const double p[3] = {x, y, z};
+    for (unsigned int i = 0; i < 3; ++i) {
+      if (m_n[i] == 1) continue;
+      if (!(p[i] >= m_min[i] && p[i] <= m_max[i])) return false;
+      const double u = (p[i] - m_min[i]) * m_scale[i];
+      const unsigned int k = std::min(static_cast<unsigned int>(u), m_n[i] - 1);
+      cell = cell * m_n[i] + k;
+    }
+    return true;
+  }
+
+  /// Get the elements whose bounding box overlaps the cell containing a point.
+  Range GetElements(const double x, const double y, const double z) const {
+    size_t cell = 0;
+    if (!GetCell(x, y, z, cell)) return Range{nullptr, nullptr};
+    const int* data = m_elements.data();
+    return Range{data + m_offsets[cell], data + m_offsets[cell + 1]};
+  }
+
+  /// Get the number of cells along x, y, z.
+  const std::array<unsigned int, 3>& GetNumberOfCells() const { return m_n; }
+  /// Get the total length of the element lists.
+  size_t GetNumberOfEntries() const { return m_elements.size(); }
+
+  /// Append the grid to a buffer.
+  void Write(std::vector<char>& buffer) const;
+  /// Read a grid written by Write; returns false if the data is corrupt.
+  bool Read(const char*& p, const char* end, const int nElements);
+
+ private:
+  std::array<double, 3> m_min = {{0., 0., 0.}};
+  std::array<double, 3> m_max = {{0., 0., 0.}};
+  /// Number of cells per unit length.
+  std::array<double, 3> m_scale = {{0., 0., 0.}};
+  std::array<unsigned int, 3> m_n = {{1, 1, 1}};
+
+  /// Start of the element list of each cell (plus the end of the last one).
+  /// 32-bit to keep the grid and the snapshots compact; Build checks that
+  /// the total length of the lists fits.
+  std::vector<uint32_t> m_offsets;
+  std::vector<int> m_elements;
+
+  void SetResolution(const double target, const bool is3d);
+  void GetCellRange(const std::array<double, 6>& box, unsigned int* k0,
+                    unsigned int* k1) const;
+};
+}
+
+#endif
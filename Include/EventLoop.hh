@@ -0,0 +1,142 @@
+#ifndef G_EVENT_LOOP_H
+#define G_EVENT_LOOP_H
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "Sensor.hh"
+#include "Track.hh"
+
+namespace Garfield {
+
+/// Simulate a series of events (primary ionisation by a track, transport of
+/// the ionisation electrons, induced signals) on several threads.
+///
+/// Each thread gets its own sensor, track and transport object, created by
+/// user-supplied factories. Components, media and field maps can be shared
+/// between the sensors. Each event draws from its own random number stream
+/// (derived from a seed and the event number), so the results of an event
+/// do not depend on the number of threads or on the order in which the
+/// events are processed.
+///
+/// \remark Objects shared between the threads must be safe to use
+///         concurrently. This is the case for field maps, for the
+///         transport tables used by AvalancheMC and for the collision
+///         sampling in MediumMagboltz, once the tables have been set up
+///         with FreezeMicroscopicTables.
+
+class EventLoop {
+ public:
+  /// Summary of an event, handed to the sink.
+  struct Event {
+    /// Event number
+    unsigned long index;
+    /// Thread which processed the event
+    unsigned int thread;
+    /// Number of clusters along the track
+    unsigned int nClusters;
+    /// Number of primary electrons
+    unsigned int nElectrons;
+    /// Energy deposit [eV]
+    double energy;
+    /// Sensor holding the signals of this event
+    Sensor* sensor;
+  };
+
+  /// Create a sensor (called once per thread).
+  typedef std::function<Sensor*()> SensorFactory;
+  /// Create a track for a given sensor (called once per thread).
+  typedef std::function<Track*(Sensor*)> TrackFactory;
+  /// Transport a primary electron, given its position, time, kinetic
+  /// energy and direction.
+  typedef std::function<void(double x, double y, double z, double t, double e,
+                             double dx, double dy, double dz)>
+      Transport;
+  /// Create the transport function for a given sensor (once per thread).
+  typedef std::function<Transport(Sensor*)> TransportFactory;
+  /// Set the starting point (x0, y0, z0), time t0 and direction
+  /// (dx0, dy0, dz0) of the track of a given event.
+  typedef std::function<void(unsigned long event, double& x0, double& y0,
+                             double& z0, double& t0, double& dx0,
+                             double& dy0, double& dz0)>
+      TrackGenerator;
+  /// Process the results of an event.
+  typedef std::function<void(const Event& event)> Sink;
+
+  /// Constructor
+  EventLoop() = default;
+  /// Destructor
+  ~EventLoop() {}
+
+  /// Set the function which creates the sensor of each thread.
+  /// The event loop takes ownership of the sensors.
+  void SetSensorFactory(SensorFactory f) { m_sensorFactory = f; }
+  /// Set the function which creates the track of each thread.
+  /// The event loop takes ownership of the tracks.
+  void SetTrackFactory(TrackFactory f) { m_trackFactory = f; }
+  /// Set the function which creates the transport of each thread.
+  void SetTransportFactory(TransportFactory f) { m_transportFactory = f; }
+  /// Set the function which receives the results of each event.
+  /// The sink is called by one thread at a time, but not necessarily
+  /// in the order of the event numbers.
+  void SetSink(Sink f) { m_sink = f; }
+
+  /// Set a fixed starting point and direction of the tracks.
+  void SetTrackStart(const double x0, const double y0, const double z0,
+                     const double t0, const double dx0, const double dy0,
+                     const double dz0);
+  /// Set a function which draws the starting point and direction of the
+  /// track of each event (using the random number stream of the event).
+  void SetTrackGenerator(TrackGenerator f) { m_trackGenerator = f; }
+
+  /// Set the number of threads (0: number of hardware threads).
+  void SetNumberOfThreads(const unsigned int n) { m_nThreads = n; }
+  /// Set the seed of the random number streams. By default, the seed is
+  /// drawn from the generator of the calling thread at the start of Run.
+  void SetSeed(const uint64_t seed) {
+    m_seed = seed;
+    m_hasSeed = true;
+  }
+
+  /// Simulate a given number of events.
+  bool Run(const unsigned long nEvents);
+
+  /// Switch on debugging messages.
+  void EnableDebugging() { m_debug = true; }
+  void DisableDebugging() { m_debug = false; }
+
+ private:
+  std::string m_className = "EventLoop";
+
+  SensorFactory m_sensorFactory;
+  TrackFactory m_trackFactory;
+  TransportFactory m_transportFactory;
+  TrackGenerator m_trackGenerator;
+  Sink m_sink;
+
+  double m_x0 = 0., m_y0 = 0., m_z0 = 0., m_t0 = 0.;
+  double m_dx0 = 1., m_dy0 = 0., m_dz0 = 0.;
+
+  unsigned int m_nThreads = 0;
+  uint64_t m_seed = 0;
+  bool m_hasSeed = false;
+
+  bool m_debug = false;
+
+  // Objects used by one thread.
+  struct Worker {
+    std::unique_ptr<Sensor> sensor;
+    std::unique_ptr<Track> track;
+    Transport transport;
+  };
+
+  void ProcessEvent(const unsigned long index, const unsigned int thread,
+                    const uint64_t seed, Worker& worker, Event& event);
+};
+}
+
+#endif
@@ -0,0 +1,78 @@
+#ifndef G_FIELD_QUERY_CONTEXT_H
+#define G_FIELD_QUERY_CONTEXT_H
+
+#include <vector>
+
+namespace Garfield {
+
+/// Search hints (e. g. the mesh element or component in which the previous
+/// point was found) used during field evaluation.
+///
+/// Components and sensors do not keep these hints themselves but look them
+/// up in the context of the calling thread. Each thread has its own default
+/// context, so several threads can share a single (read-only) field map
+/// and still benefit from a warm last-element cache. A caller can also
+/// own a context and pass it to the evaluation functions explicitly.
+
+class FieldQueryContext {
+ public:
+  /// Constructor
+  FieldQueryContext() = default;
+  /// Destructor
+  ~FieldQueryContext() {}
+
+  /** Slot reserved by a component or sensor for its hints.
+    *
+    * The slot is returned to a free list when the owner is destroyed.
+    * A copy of the owner reserves a new slot, such that the two objects
+    * do not overwrite each other's hints.
+    */
+  class Slot {
+   public:
+    Slot() : m_index(Acquire()) {}
+    Slot(const Slot&) : m_index(Acquire()) {}
+    Slot& operator=(const Slot&) { return *this; }
+    ~Slot() { Release(m_index); }
+    operator unsigned int() const { return m_index; }
+
+   private:
+    unsigned int m_index;
+  };
+
+  /** Retrieve the hint stored in a given slot (-1 if not set).
+    * The reference is invalidated when a hint with a higher slot is
+    * requested (e. g. by another component), so it must not be kept
+    * across calls to other components.
+    */
+  int& Hint(const unsigned int slot) {
+    if (slot >= m_hints.size()) m_hints.resize(slot + 1, -1);
+    return m_hints[slot];
+  }
+  /// Forget all hints.
+  void Reset() { m_hints.assign(m_hints.size(), -1); }
+
+  /// Get the context used by the calling thread.
+  static FieldQueryContext& Current() {
+    return m_threadContext ? *m_threadContext : Default();
+  }
+
+ private:
+  std::vector<int> m_hints;
+
+  /// Context of the calling thread (null until first use or after
+  /// the default context has been restored).
+  static thread_local FieldQueryContext* m_threadContext;
+  /// Select and return the default context of the calling thread.
+  static FieldQueryContext& Default();
+  friend void SetThreadFieldQueryContext(FieldQueryContext* context);
+
+  static unsigned int Acquire();
+  static void Release(const unsigned int slot);
+};
+
+/// Set the context to be used by the calling thread.
+/// Passing a null pointer restores the thread's default context.
+void SetThreadFieldQueryContext(FieldQueryContext* context);
+}
+
+#endif
@@ -29,6 +29,7 @@
 #pragma link C++ class Garfield::ComponentAnsys123;
 #pragma link C++ class Garfield::ComponentAnsys121;
 #pragma link C++ class Garfield::ComponentConstant;
+#pragma link C++ class Garfield::ComponentCache;
 #pragma link C++ class Garfield::ComponentUser;
 #pragma link C++ class Garfield::ComponentCST;
 
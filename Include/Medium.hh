@@ -1,10 +1,12 @@
 #ifndef G_MEDIUM_H
 #define G_MEDIUM_H
 
+#include <atomic>
 #include <string>
 #include <vector>
 
 #include "FundamentalConstants.hh"
+#include "TransportTable.hh"
 
 namespace Garfield {
 
@@ -19,6 +21,9 @@ class Medium {
 
   /// Return the id number of the class instance.
   int GetId() const { return m_id; }
+  /// Get the number of times the collision rate tables have been
+  /// (re)calculated, e. g. after a change of the composition.
+  unsigned long GetRevision() const { return m_revision; }
   /// Get the medium name/identifier.
   const std::string& GetName() const { return m_name; }
   /// Is this medium a gas?
@@ -84,6 +89,26 @@ class Medium {
   /// Get the Fano factor.
   double GetFanoFactor() { return m_fano; }
 
+  /// Transport coefficients at a given field (see ElectronTransport).
+  struct TransportCoefficients {
+    /// Quantities to be computed in addition to the drift velocity.
+    enum : unsigned int {
+      Diffusion = 1,
+      Townsend = 2,
+      Attachment = 4,
+      LorentzAngle = 8,
+      All = 15
+    };
+    /// Drift velocity [cm / ns]
+    double vx = 0., vy = 0., vz = 0.;
+    /// Longitudinal and transverse diffusion coefficients [cm1/2]
+    double dl = 0., dt = 0.;
+    /// Townsend (ions: dissociation) and attachment coefficients [cm-1]
+    double alpha = 0., eta = 0.;
+    /// Lorentz angle
+    double lor = 0.;
+  };
+
   // Transport parameters for electrons
   /// Drift velocity [cm / ns]
   virtual bool ElectronVelocity(const double ex, const double ey,
@@ -117,6 +142,18 @@ class Medium {
                                     const double ez, const double bx,
                                     const double by, const double bz,
                                     double& lor);
+  /** Drift velocity and further transport coefficients in one call.
+    * In gases, the field scaling, the angle between E and B and the search
+    * in the tables are done only once for all quantities.
+    * \param what quantities to compute in addition to the velocity
+    *        (combination of TransportCoefficients flags).
+    * \return false if the velocity or (if requested) the diffusion
+    *         coefficients could not be computed.
+    */
+  virtual bool ElectronTransport(
+      const double ex, const double ey, const double ez, const double bx,
+      const double by, const double bz, TransportCoefficients& c,
+      const unsigned int what = TransportCoefficients::All);
 
   // Microscopic electron transport properties
 
@@ -131,6 +168,14 @@ class Medium {
 
   /// Null-collision rate [ns-1]
   virtual double GetElectronNullCollisionRate(const int band = 0);
+  /** Null-collision rate [ns-1] for an electron with a given energy.
+    * \param e electron energy [eV]
+    * \param band band index
+    * \param emax the rate is an upper bound of the collision rate
+    *        at all energies below emax (> e)
+    */
+  virtual double GetElectronNullCollisionRate(const double e, const int band,
+                                              double& emax);
   /// Collision rate [ns-1] for given electron energy
   virtual double GetElectronCollisionRate(const double e, const int band = 0);
   /// Sample the collision type. Update energy and direction vector.
@@ -142,6 +187,17 @@ class Medium {
   virtual bool GetDeexcitationProduct(const unsigned int i, double& t,
                                       double& s, int& type,
                                       double& energy) const;
+  /** Set up the tables used for microscopic tracking (up to at least an
+    * electron energy emax) and stop modifying them on demand, such that
+    * the collision rates and GetElectronCollision can be called
+    * concurrently by several threads. Can be called again (from a single
+    * thread) to extend the energy range.
+    * \return highest electron energy [eV] covered by the tables, or a
+    *         negative value if the medium does not support concurrent use.
+    */
+  virtual double FreezeMicroscopicTables(const double emax);
+  /// Allow the tables used for microscopic tracking to be modified again.
+  virtual void ReleaseMicroscopicTables() {}
 
   // Transport parameters for holes
   virtual bool HoleVelocity(const double ex, const double ey, const double ez,
@@ -159,6 +215,11 @@ class Medium {
   virtual bool HoleAttachment(const double ex, const double ey, const double ez,
                               const double bx, const double by, const double bz,
                               double& eta);
+  /// Drift velocity and further transport coefficients in one call.
+  virtual bool HoleTransport(
+      const double ex, const double ey, const double ez, const double bx,
+      const double by, const double bz, TransportCoefficients& c,
+      const unsigned int what = TransportCoefficients::All);
 
   // Transport parameters for ions
   virtual bool IonVelocity(const double ex, const double ey, const double ez,
@@ -171,6 +232,11 @@ class Medium {
   virtual bool IonDissociation(const double ex, const double ey,
                                const double ez, const double bx,
                                const double by, const double bz, double& diss);
+  /// Drift velocity, diffusion and dissociation coefficients in one call.
+  virtual bool IonTransport(
+      const double ex, const double ey, const double ez, const double bx,
+      const double by, const double bz, TransportCoefficients& c,
+      const unsigned int what = TransportCoefficients::All);
 
   /// Set the range of fields to be covered by the transport tables.
   void SetFieldGrid(double emin, double emax, const size_t ne, bool logE,
@@ -343,6 +409,12 @@ class Medium {
   void SetInterpolationMethodIonMobility(const unsigned int intrp);
   void SetInterpolationMethodIonDissociation(const unsigned int intrp);
 
+  /// Precompute the interpolation coefficients of the transport tables
+  /// (done automatically after loading or generating a table).
+  void CompileTables();
+  /// Use the precomputed tables (default) or the original interpolation.
+  void EnableCompiledTables(const bool on = true) { m_useCompiledTables = on; }
+
   // Scaling of fields and transport parameters.
   virtual double ScaleElectricField(const double e) const { return e; }
   virtual double UnScaleElectricField(const double e) const { return e; }
@@ -374,12 +446,35 @@ class Medium {
   void DisableDebugging() { m_debug = false; }
 
  protected:
+  /// Collision counter which can be incremented concurrently.
+  /// Unlike std::atomic, it can be copied (with the value at that time),
+  /// such that the media stay copyable.
+  class Counter {
+   public:
+    Counter(const unsigned int n = 0) : m_n(n) {}
+    Counter(const Counter& rhs) : m_n(rhs.m_n.load()) {}
+    Counter& operator=(const Counter& rhs) {
+      m_n = rhs.m_n.load();
+      return *this;
+    }
+    Counter& operator++() {
+      m_n.fetch_add(1, std::memory_order_relaxed);
+      return *this;
+    }
+    operator unsigned int() const { return m_n.load(); }
+
+   private:
+    std::atomic<unsigned int> m_n;
+  };
+
   std::string m_className = "Medium";
 
   static int m_idCounter;
 
   // Id number
   int m_id;
+  // Number of updates of the collision rate tables
+  unsigned long m_revision = 0;
   // Name
   std::string m_name = "";
   // Temperature [K]
@@ -449,6 +544,19 @@ class Medium {
   std::vector<std::vector<std::vector<double> > > m_iDifT;
   std::vector<std::vector<std::vector<double> > > m_iDis;
 
+  // Compiled forms of the tables (see CompileTables).
+  struct CompiledTables {
+    TransportTable velE, velX, velB;
+    TransportTable difL, difT;
+    TransportTable difM[6];
+    TransportTable alp, att, lor;
+    TransportTable mob, dis;
+  };
+  bool m_useCompiledTables = true;
+  CompiledTables m_eTables;
+  CompiledTables m_hTables;
+  CompiledTables m_iTables;
+
   // Thresholds for Townsend, attachment and dissociation coefficients.
   unsigned int m_eThrAlp = 0;
   unsigned int m_eThrAtt = 0;
@@ -474,27 +582,70 @@ class Medium {
   unsigned int m_intpMob = 2;
   unsigned int m_intpDis = 2;
 
+  // Electric and magnetic field at which the tables are interpolated.
+  struct Field {
+    Field(const double ex0, const double ey0, const double ez0,
+          const double bx0, const double by0, const double bz0)
+        : ex(ex0), ey(ey0), ez(ez0), bx(bx0), by(by0), bz(bz0) {}
+    double ex, ey, ez;
+    double bx, by, bz;
+    // Magnitudes of E and B.
+    double e = 0., b = 0.;
+    // Scaled electric field, magnetic field and angle between E and B.
+    TransportTable::Point p = TransportTable::Point(0., 0., 0.);
+  };
+  // Compute magnitudes, scaled field and angle (false if E is zero).
+  bool SetField(Field& f) const;
+
   bool Velocity(const double ex, const double ey, const double ez,
                 const double bx, const double by, const double bz,
                 const std::vector<std::vector<std::vector<double> > >& velE,
                 const std::vector<std::vector<std::vector<double> > >& velB,
                 const std::vector<std::vector<std::vector<double> > >& velX,
-                const double q, double& vx, double& vy, double& vz) const;
+                const CompiledTables& compiled, const double q, double& vx,
+                double& vy, double& vz) const;
+  bool Velocity(Field& f,
+                const std::vector<std::vector<std::vector<double> > >& velE,
+                const std::vector<std::vector<std::vector<double> > >& velB,
+                const std::vector<std::vector<std::vector<double> > >& velX,
+                const CompiledTables& compiled, const double q, double& vx,
+                double& vy, double& vz) const;
+  // Velocity for a given (signed) mobility.
+  void Langevin(const Field& f, const double mu, double& vx, double& vy,
+                double& vz) const;
   bool Diffusion(const double ex, const double ey, const double ez,
                  const double bx, const double by, const double bz,
                  const std::vector<std::vector<std::vector<double> > >& difL,
                  const std::vector<std::vector<std::vector<double> > >& difT,
-                 double& dl, double& dt) const;
+                 const CompiledTables& compiled, double& dl, double& dt) const;
+  void Diffusion(Field& f,
+                 const std::vector<std::vector<std::vector<double> > >& difL,
+                 const std::vector<std::vector<std::vector<double> > >& difT,
+                 const CompiledTables& compiled, double& dl, double& dt) const;
   bool Diffusion(const double ex, const double ey, const double ez,
     const double bx, const double by, const double bz,
     const std::vector<std::vector<std::vector<std::vector<double> > > >& diff,
-    double cov[3][3]) const;
+    const CompiledTables& compiled, double cov[3][3]) const;
   bool Alpha(const double ex, const double ey, const double ez,
              const double bx, const double by, const double bz,
              const std::vector<std::vector<std::vector<double> > >& tab,
+             const TransportTable& compiled,
              unsigned int intp, const unsigned int thr, 
              const std::pair<unsigned int, unsigned int>& extr, 
              double& alpha) const; 
+  double Alpha(Field& f,
+               const std::vector<std::vector<std::vector<double> > >& tab,
+               const TransportTable& compiled, unsigned int intp,
+               const unsigned int thr,
+               const std::pair<unsigned int, unsigned int>& extr) const;
+  double LorentzAngle(Field& f) const;
+  void IonDrift(Field& f, double& vx, double& vy, double& vz) const;
+  // Interpolate the tables of electrons (type -1), holes (1) or ions (2)
+  // in one pass.
+  bool Transport(const double ex, const double ey, const double ez,
+                 const double bx, const double by, const double bz,
+                 const int type, TransportCoefficients& c,
+                 const unsigned int what) const;
   double GetAngle(const double ex, const double ey, const double ez,
                   const double bx, const double by, const double bz,
                   const double e, const double b) const;
@@ -502,6 +653,16 @@ class Medium {
                    const std::vector<std::vector<std::vector<double> > >& table,
                    double& y, const unsigned int intp,
                    const std::pair<unsigned int, unsigned int>& extr) const;
+  bool Interpolate(TransportTable::Point& p,
+                   const std::vector<std::vector<std::vector<double> > >& table,
+                   const TransportTable& compiled, double& y,
+                   const unsigned int intp,
+                   const std::pair<unsigned int, unsigned int>& extr) const {
+    if (m_useCompiledTables && !table.empty() && compiled.Interpolate(p, y)) {
+      return true;
+    }
+    return Interpolate(p.e, p.b, p.a, table, y, intp, extr);
+  }
 
   double Interpolate1D(const double e, const std::vector<double>& table,
                        const std::vector<double>& fields,
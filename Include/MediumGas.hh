@@ -21,6 +21,29 @@ class MediumGas : public Medium {
 
   bool IsGas() const override { return true; }
 
+  // Transport coefficients interpolated from the tables in one pass.
+  bool ElectronTransport(const double ex, const double ey, const double ez,
+                         const double bx, const double by, const double bz,
+                         TransportCoefficients& c,
+                         const unsigned int what =
+                             TransportCoefficients::All) override {
+    return Transport(ex, ey, ez, bx, by, bz, -1, c, what);
+  }
+  bool HoleTransport(const double ex, const double ey, const double ez,
+                     const double bx, const double by, const double bz,
+                     TransportCoefficients& c,
+                     const unsigned int what =
+                         TransportCoefficients::All) override {
+    return Transport(ex, ey, ez, bx, by, bz, 1, c, what);
+  }
+  bool IonTransport(const double ex, const double ey, const double ez,
+                    const double bx, const double by, const double bz,
+                    TransportCoefficients& c,
+                    const unsigned int what =
+                        TransportCoefficients::All) override {
+    return Transport(ex, ey, ez, bx, by, bz, 2, c, what);
+  }
+
   /// Set the gas mixture.
   bool SetComposition(const std::string& gas1, const double f1 = 1.,
                       const std::string& gas2 = "", const double f2 = 0.,
@@ -2,6 +2,10 @@
 #define G_MEDIUM_MAGBOLTZ_9
 
 #include <array>
+#include <iosfwd>
+#include <string>
+#include <utility>
+#include <vector>
 
 #include "MagboltzInterface.hh"
 #include "MediumGas.hh"
@@ -77,6 +81,9 @@ class MediumMagboltz : public MediumGas {
 
   /// Get the overall null-collision rate [ns-1].
   double GetElectronNullCollisionRate(const int band) override;
+  /// Get the null-collision rate [ns-1] for energies up to emax.
+  double GetElectronNullCollisionRate(const double e, const int band,
+                                      double& emax) override;
   /// Get the (real) collision rate [ns-1] at a given electron energy e [eV].
   double GetElectronCollisionRate(const double e, const int band) override;
   /// Get the collision rate [ns-1] for a specific level.
@@ -88,12 +95,17 @@ class MediumMagboltz : public MediumGas {
                             std::vector<std::pair<int, double> >& secondaries,
                             int& ndxc, int& band) override;
   void ComputeDeexcitation(int iLevel, int& fLevel);
+  /// Get the number of deexcitation products of the last collision
+  /// sampled by the calling thread.
   unsigned int GetNumberOfDeexcitationProducts() const override {
-    return m_dxcProducts.size();
+    return DxcProducts().size();
   }
   bool GetDeexcitationProduct(const unsigned int i, double& t, double& s,
                               int& type, double& energy) const override;
 
+  double FreezeMicroscopicTables(const double emax) override;
+  void ReleaseMicroscopicTables() override { m_frozen = false; }
+
   double GetPhotonCollisionRate(const double e) override;
   bool GetPhotonCollision(const double e, int& type, int& level, double& e1,
                           double& ctheta, int& nsec, double& esec) override;
@@ -164,6 +176,28 @@ class MediumMagboltz : public MediumGas {
   /// angles in the currently set grid.
   void GenerateGasTable(const int numCollisions = 10,
                         const bool verbose = true);
+  /** Generate a new gas table using several worker processes.
+    * Each grid point is computed by a separate (forked) process; points
+    * for which a worker fails or exceeds the time limit are retried.
+    * Since fork only duplicates the calling thread, this function must be
+    * called while the program runs a single thread. It fails if a
+    * ThreadPool (e. g. for parallel transport) exists.
+    * \param numCollisions number of collisions (in multiples of 10^7)
+    * \param nWorkers max. number of simultaneous workers
+    *        (0: number of hardware threads)
+    * \param checkpoint file to which the results are appended as they
+    *        become available; the points found in this file (from an
+    *        interrupted run with the same settings) are not recomputed
+    * \param verbose print the Magboltz output of the workers
+    * \param timeout max. time [s] for a grid point, after which the worker
+    *        is stopped and the point is retried (0: no limit)
+    * \return false if not all grid points could be computed
+    */
+  bool GenerateGasTableParallel(const int numCollisions = 10,
+                                const unsigned int nWorkers = 0,
+                                const std::string& checkpoint = "",
+                                const bool verbose = false,
+                                const double timeout = 0.);
 
  private:
   static constexpr int nEnergyStepsLog = 200;
@@ -183,6 +217,8 @@ class MediumMagboltz : public MediumGas {
   double m_eHigh, m_eHighLog;
   double m_lnStep;
   bool m_useAutoAdjust = true;
+  // Are the tables kept fixed (for use by several threads)?
+  bool m_frozen = false;
 
   // Flag enabling/disabling output of cross-section table to file
   bool m_useCsOutput = false;
@@ -218,9 +254,27 @@ class MediumMagboltz : public MediumGas {
   std::vector<double> m_cfTotLog;
   // Null-collision frequency
   double m_cfNull = 0.;
+  // Number of energy bins per band of the energy-dependent
+  // null-collision frequency.
+  static constexpr unsigned int nBinsNullBand = 100;
+  // Max. collision frequency at energies below the upper edge of each band
+  // (linear binning).
+  std::vector<double> m_cfNullBands;
   // Collision frequencies
   std::vector<std::vector<double> > m_cf;
   std::vector<std::vector<double> > m_cfLog;
+  // Alias tables for sampling the collision process,
+  // one record per energy bin and table entry.
+  struct CollisionEntry {
+    // Probability of selecting the first of the two levels.
+    double threshold;
+    std::array<unsigned int, 2> level;
+    // Angular distribution parameters of the two levels.
+    std::array<double, 2> cut;
+    std::array<double, 2> par;
+  };
+  std::vector<CollisionEntry> m_alias;
+  std::vector<CollisionEntry> m_aliasLog;
 
   // Collision counters
   // 0: elastic
@@ -229,9 +283,9 @@ class MediumMagboltz : public MediumGas {
   // 3: inelastic
   // 4: excitation
   // 5: super-elastic
-  std::array<unsigned int, nCsTypes> m_nCollisions;
+  std::array<Counter, nCsTypes> m_nCollisions;
   // Number of collisions for each cross-section term
-  std::vector<unsigned int> m_nCollisionsDetailed;
+  std::vector<Counter> m_nCollisionsDetailed;
 
   // Penning transfer
   // Penning transfer probability (by level)
@@ -239,7 +293,7 @@ class MediumMagboltz : public MediumGas {
   // Mean distance of Penning ionisation (by level)
   std::array<double, Magboltz::nMaxLevels> m_lambdaPenning;
   // Number of Penning ionisations
-  unsigned int m_nPenning = 0;
+  Counter m_nPenning;
 
   // Deexcitation
   // Flag enabling/disabling detailed simulation of de-excitation process
@@ -291,7 +345,9 @@ class MediumMagboltz : public MediumGas {
     // Energy of the electron or photon
     double energy;
   };
-  std::vector<dxcProd> m_dxcProducts;
+  // De-excitation products of the last collision sampled by the calling
+  // thread (each thread keeps its own list).
+  std::vector<dxcProd>& DxcProducts() const;
 
   // Ionisation potentials
   std::array<double, m_nMaxGases> m_ionPot;
@@ -322,6 +378,10 @@ class MediumMagboltz : public MediumGas {
 
   int GetGasNumberMagboltz(const std::string& input) const;
   bool Mixer(const bool verbose = false);
+  void BuildAliasTable(const std::vector<double>& p,
+                       const std::vector<double>& cut,
+                       const std::vector<double>& par,
+                       CollisionEntry* table) const;
   void SetupGreenSawada();
   void SetScatteringParameters(const int model, const double parIn, double& cut,
                                double& parOut) const;
@@ -341,6 +401,23 @@ class MediumMagboltz : public MediumGas {
                                 const int igas1, const int igas2) const;
   void ComputeDeexcitationInternal(int iLevel, int& fLevel);
   bool ComputePhotonCollisionTable(const bool verbose);
+
+  // Gas table generation
+  void InitGasTable();
+  void RunGasTablePoint(const double e, const double b, const double a,
+                        const int numCollisions, const bool verbose,
+                        std::vector<double>& val,
+                        std::vector<ExcLevel>& excLevels,
+                        std::vector<IonLevel>& ionLevels);
+  void SetExcitationIonisationLevels(const std::vector<ExcLevel>& excLevels,
+                                     const std::vector<IonLevel>& ionLevels);
+  void SetGasTablePoint(const unsigned int i, const unsigned int j,
+                        const unsigned int k, const std::vector<double>& val);
+  std::string GetGasTableHeader(const int numCollisions) const;
+  static void ReadGasTableRecords(
+      std::istream& is, std::vector<ExcLevel>& excLevels,
+      std::vector<IonLevel>& ionLevels,
+      std::vector<std::pair<unsigned int, std::vector<double> > >& points);
 };
 }
 #endif
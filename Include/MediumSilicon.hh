@@ -1,6 +1,8 @@
 #ifndef G_MEDIUM_SILICON_H
 #define G_MEDIUM_SILICON_H
 
+#include <vector>
+
 #include "Medium.hh"
 
 namespace Garfield {
@@ -72,6 +74,8 @@ class MediumSilicon : public Medium {
   // Microscopic transport properties
   bool SetMaxElectronEnergy(const double e);
   double GetMaxElectronEnergy() const { return m_eFinalG; }
+  double FreezeMicroscopicTables(const double emax) override;
+  void ReleaseMicroscopicTables() override { m_frozen = false; }
 
   bool Initialise();
 
@@ -95,6 +99,9 @@ class MediumSilicon : public Medium {
 
   // Get the null-collision rate [ns-1]
   double GetElectronNullCollisionRate(const int band) override;
+  // Get the null-collision rate [ns-1] for energies up to emax
+  double GetElectronNullCollisionRate(const double e, const int band,
+                                      double& emax) override;
   // Get the (real) collision rate [ns-1] at a given electron energy
   double GetElectronCollisionRate(const double e, const int band) override;
   // Sample the collision type
@@ -210,6 +217,8 @@ class MediumSilicon : public Medium {
   double m_eStepXL;
   double m_eFinalG = 10.;
   double m_eStepG;
+  // Are the tables kept fixed (for use by several threads)?
+  bool m_frozen = false;
   double m_eFinalV = 8.5;
   double m_eStepV;
   static const int nEnergyStepsXL = 2000;
@@ -234,6 +243,11 @@ class MediumSilicon : public Medium {
   double m_cfNullElectronsX;
   double m_cfNullElectronsL;
   double m_cfNullElectronsG;
+  // Max. scattering rates below the upper edge of each energy band
+  static const int nBinsNullBand = 50;
+  std::vector<double> m_cfNullBandsX;
+  std::vector<double> m_cfNullBandsL;
+  std::vector<double> m_cfNullBandsG;
   std::vector<double> m_cfTotElectronsX;
   std::vector<double> m_cfTotElectronsL;
   std::vector<double> m_cfTotElectronsG;
@@ -257,13 +271,13 @@ class MediumSilicon : public Medium {
   std::vector<int> m_scatTypeHoles;
 
   // Collision counters
-  unsigned int m_nCollElectronAcoustic = 0;
-  unsigned int m_nCollElectronOptical = 0;
-  unsigned int m_nCollElectronIntervalley = 0;
-  unsigned int m_nCollElectronImpurity = 0;
-  unsigned int m_nCollElectronIonisation = 0;
-  std::vector<unsigned int> m_nCollElectronDetailed;
-  std::vector<unsigned int> m_nCollElectronBand;
+  Counter m_nCollElectronAcoustic;
+  Counter m_nCollElectronOptical;
+  Counter m_nCollElectronIntervalley;
+  Counter m_nCollElectronImpurity;
+  Counter m_nCollElectronIonisation;
+  std::vector<Counter> m_nCollElectronDetailed;
+  std::vector<Counter> m_nCollElectronBand;
 
   // Density of states tables
   double m_eStepDos;
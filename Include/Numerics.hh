@@ -84,6 +84,30 @@ bool Boxin3(const std::vector<std::vector<std::vector<double> > >& value,
             const std::vector<double>& zAxis, const int nx, const int ny,
             const int nz, const double xx, const double yy, const double zz,
             double& f, const int iOrder);
+
+/// Radix-2 fast Fourier transform. The bit-reversal permutation and the
+/// twiddle factors are computed once for a given length.
+class FFT {
+ public:
+  FFT() = default;
+  explicit FFT(const size_t n) { SetSize(n); }
+  /// Set the length of the transform (rounded up to a power of two).
+  void SetSize(const size_t n);
+  /// Get the length of the transform.
+  size_t GetSize() const { return m_n; }
+  /// In-place forward transform of GetSize() values.
+  void Forward(std::complex<double>* a) const { Transform(a, false); }
+  /// In-place inverse transform (including the normalisation by 1 / n).
+  void Inverse(std::complex<double>* a) const;
+
+ private:
+  size_t m_n = 0;
+  std::vector<size_t> m_permutation;
+  // exp(-2 pi i k / n), k < n / 2.
+  std::vector<std::complex<double> > m_twiddle;
+
+  void Transform(std::complex<double>* a, const bool inverse) const;
+};
 }
 
 inline double InterpolateBinarySearch(const std::vector<double>& x,
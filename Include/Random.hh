@@ -7,11 +7,43 @@
 
 namespace Garfield {
 
-/// Random number generator
+/// Default random number generator, shared by all threads.
 extern RandomEngineRoot randomEngine;
 
+/// Engine set by the calling thread (null if the default engine is used).
+/// Declared here such that GetRandomEngine can be inlined.
+extern thread_local RandomEngine* threadRandomEngine;
+
+/// Random number generator used by the calling thread.
+/// Unless a thread-specific engine has been set, this is randomEngine.
+inline RandomEngine& GetRandomEngine() {
+  return threadRandomEngine ? *threadRandomEngine : randomEngine;
+}
+/// Set the random number generator to be used by the calling thread
+/// (e. g. a RandomEngineXoshiro stream owned by a worker thread).
+/// Passing a null pointer restores the default (global) engine.
+void SetThreadRandomEngine(RandomEngine* engine);
+
+/// Use a given engine in the calling thread for the lifetime of this
+/// object. The previous engine is restored on destruction, also when
+/// the scope is left by an exception.
+class ScopedThreadRandomEngine {
+ public:
+  explicit ScopedThreadRandomEngine(RandomEngine& engine)
+      : m_previous(threadRandomEngine) {
+    threadRandomEngine = &engine;
+  }
+  ~ScopedThreadRandomEngine() { threadRandomEngine = m_previous; }
+  ScopedThreadRandomEngine(const ScopedThreadRandomEngine&) = delete;
+  ScopedThreadRandomEngine& operator=(const ScopedThreadRandomEngine&) =
+      delete;
+
+ private:
+  RandomEngine* m_previous;
+};
+
 /// Draw a random number uniformly distributed in the range [0, 1).
-inline double RndmUniform() { return randomEngine.Draw(); }
+inline double RndmUniform() { return GetRandomEngine().Draw(); }
 
 /// Draw a random number uniformly distributed in the range (0, 1).
 inline double RndmUniformPos() {
@@ -21,27 +53,7 @@ inline double RndmUniformPos() {
 }
 
 /// Draw a Gaussian random variate with mean zero and standard deviation one.
-inline double RndmGaussian() {
-  static bool cached = false;
-  static double u = 0.;
-  if (cached) {
-    cached = false;
-    return u;
-  }
-  // Box-Muller algorithm
-  u = 2. * RndmUniform() - 1.;
-  double v = 2. * RndmUniform() - 1.;
-  double r2 = u * u + v * v;
-  while (r2 > 1.) {
-    u = 2. * RndmUniform() - 1.;
-    v = 2. * RndmUniform() - 1.;
-    r2 = u * u + v * v;
-  }
-  const double p = sqrt(-2. * log(r2) / r2);
-  u *= p;
-  cached = true;
-  return v * p;
-}
+inline double RndmGaussian() { return GetRandomEngine().DrawGaussian(); }
 
 /// Draw a Gaussian random variate with mean mu and standard deviation sigma.
 inline double RndmGaussian(const double mu, const double sigma) {
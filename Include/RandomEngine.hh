@@ -1,6 +1,8 @@
 #ifndef G_RANDOM_ENGINE_H
 #define G_RANDOM_ENGINE_H
 
+#include <cmath>
+
 namespace Garfield {
 
 /// Abstract base class for random number generators.
@@ -18,6 +20,36 @@ class RandomEngine {
   virtual void Seed(const unsigned int s) = 0;
   /// Print some information about the random number generator.
   virtual void Print() = 0;
+
+  /// Draw a Gaussian random variate with mean zero and standard deviation one.
+  /// The second variate produced by the Box-Muller algorithm is cached
+  /// in the engine, such that each stream keeps its own state.
+  double DrawGaussian() {
+    if (m_gaussCached) {
+      m_gaussCached = false;
+      return m_gaussCache;
+    }
+    double u = 2. * Draw() - 1.;
+    double v = 2. * Draw() - 1.;
+    double r2 = u * u + v * v;
+    while (r2 > 1. || r2 <= 0.) {
+      u = 2. * Draw() - 1.;
+      v = 2. * Draw() - 1.;
+      r2 = u * u + v * v;
+    }
+    const double p = sqrt(-2. * log(r2) / r2);
+    m_gaussCache = u * p;
+    m_gaussCached = true;
+    return v * p;
+  }
+
+ protected:
+  /// Discard the cached Gaussian variate (to be called when re-seeding).
+  void ResetGaussianCache() { m_gaussCached = false; }
+
+ private:
+  bool m_gaussCached = false;
+  double m_gaussCache = 0.;
 };
 }
 
@@ -0,0 +1,74 @@
+#ifndef G_RANDOM_ENGINE_XOSHIRO_H
+#define G_RANDOM_ENGINE_XOSHIRO_H
+
+#include <cstdint>
+
+#include "RandomEngine.hh"
+
+namespace Garfield {
+
+/// xoshiro256** random number generator with jump-ahead.
+///
+/// Each instance is an independent stream. For reproducible results in
+/// multi-threaded applications, a stream can be derived from a
+/// (run seed, event number, thread index) triple, such that the
+/// random numbers used for a given event do not depend on the scheduling.
+/// See D. Blackman and S. Vigna, ACM Trans. Math. Softw. 47 (2021).
+
+class RandomEngineXoshiro : public RandomEngine {
+ public:
+  /// Constructor
+  RandomEngineXoshiro();
+  /// Constructor, initialising the stream for a given seed, event and thread.
+  RandomEngineXoshiro(const uint64_t seed, const uint64_t event,
+                      const uint64_t thread = 0);
+  /// Destructor
+  ~RandomEngineXoshiro() {}
+
+  /// Call the random number generator.
+  double Draw() override {
+    // Use the upper 53 bits.
+    return (Next() >> 11) * (1. / 9007199254740992.);
+  }
+  /// Initialise the random number generator.
+  void Seed(const unsigned int s) override { SetStream(s, 0, 0); }
+  /// Print information about the generator and the stream.
+  void Print() override;
+
+  /// Initialise the state from a (run seed, event number, thread index)
+  /// triple. Different triples give statistically independent streams.
+  void SetStream(const uint64_t seed, const uint64_t event,
+                 const uint64_t thread);
+  /// Advance the stream by 2^128 draws.
+  void Jump();
+  /// Advance the stream by 2^192 draws.
+  void LongJump();
+
+  /// Draw a 64-bit random integer.
+  uint64_t Next() {
+    const uint64_t result = Rotl(m_s[1] * 5, 7) * 9;
+    const uint64_t t = m_s[1] << 17;
+    m_s[2] ^= m_s[0];
+    m_s[3] ^= m_s[1];
+    m_s[1] ^= m_s[2];
+    m_s[0] ^= m_s[3];
+    m_s[2] ^= t;
+    m_s[3] = Rotl(m_s[3], 45);
+    return result;
+  }
+
+ private:
+  uint64_t m_s[4];
+
+  uint64_t m_seed = 0;
+  uint64_t m_event = 0;
+  uint64_t m_thread = 0;
+
+  static uint64_t Rotl(const uint64_t x, const int k) {
+    return (x << k) | (x >> (64 - k));
+  }
+  void Jump(const uint64_t poly[4]);
+};
+}
+
+#endif
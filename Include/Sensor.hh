@@ -1,9 +1,13 @@
 #ifndef G_SENSOR_H
 #define G_SENSOR_H
 
+#include <array>
 #include <vector>
 
 #include "ComponentBase.hh"
+#include "ElementGrid.hh"
+#include "Numerics.hh"
+#include "SignalStore.hh"
 
 namespace Garfield {
 
@@ -27,6 +31,43 @@ class Sensor {
   void AddElectrode(ComponentBase* comp, const std::string& label);
   /// Get the number of electrodes attached to the sensor.
   unsigned int GetNumberOfElectrodes() const { return m_electrodes.size(); }
+  /** Get the handle of the first electrode with a given label
+    * (-1 if there is none). The electrodes are numbered in the order in
+    * which they were added. Electrodes sharing a label have separate handles.
+    */
+  int GetElectrodeHandle(const std::string& label) const;
+  /// Get the label of an electrode.
+  std::string GetElectrodeLabel(const int electrode) const;
+
+  /** Neglect the weighting field of an electrode outside a box
+    * (applies to all electrodes with the given label).
+    */
+  void SetElectrodeBoundingBox(const std::string& label, const double xmin,
+                               const double ymin, const double zmin,
+                               const double xmax, const double ymax,
+                               const double zmax);
+  /// Neglect the weighting field of an electrode beyond a distance r
+  /// from a point (e. g. the centre of the electrode).
+  void SetElectrodeCutoff(const std::string& label, const double x,
+                          const double y, const double z, const double r);
+  /** Sample the weighting fields of all electrodes on a grid covering the
+    * user area and neglect them in cells in which the magnitude of the
+    * weighting field is below a threshold at all corners. As estimate of
+    * the cutoff error, the weighting field is evaluated at the centres of
+    * the cells outside the support of an electrode (bounding box, cutoff
+    * and map) and the largest value is stored.
+    * \param threshold weighting field magnitude [1/cm].
+    * \param nx,ny,nz number of cells.
+    */
+  bool ComputeElectrodeSupport(const double threshold, const unsigned int nx,
+                               const unsigned int ny, const unsigned int nz);
+  /// Remove the bounding boxes, cutoffs and maps of all electrodes.
+  void ClearElectrodeSupport();
+  /** Get the estimated cutoff error of an electrode, i. e. the largest
+    * neglected weighting field [1/cm] found by ComputeElectrodeSupport
+    * at the cell centres (-1 if not known).
+    */
+  double GetElectrodeCutoffError(const int electrode) const;
   /// Remove all components, electrodes and reset the sensor.
   void Clear();
 
@@ -38,6 +79,29 @@ class Sensor {
   void ElectricField(const double x, const double y, const double z, double& ex,
                      double& ey, double& ez, Medium*& medium, int& status);
 
+  /// Get the drift field and potential at (x, y, z),
+  /// using the search hints stored in a caller-owned context.
+  /// This function can be called concurrently from several threads
+  /// (each with its own context), see ComponentBase::ElectricField.
+  void ElectricField(FieldQueryContext& context, const double x,
+                     const double y, const double z, double& ex, double& ey,
+                     double& ez, double& v, Medium*& medium,
+                     int& status) const;
+  /// Get the drift field at (x, y, z), using a caller-owned context.
+  void ElectricField(FieldQueryContext& context, const double x,
+                     const double y, const double z, double& ex, double& ey,
+                     double& ez, Medium*& medium, int& status) const;
+
+  /** Get the drift field (and potential) at a batch of points.
+    * \param n number of points.
+    * \param x,y,z coordinates [cm], arrays of length n.
+    * \param ex,ey,ez,v field [V/cm] and potential [V] (v can be null).
+    * \param medium,status media and status flags at the points.
+    */
+  void ElectricFieldBatch(const size_t n, const double* x, const double* y,
+                          const double* z, double* ex, double* ey, double* ez,
+                          double* v, Medium** medium, int* status);
+
   /// Get the magnetic field at (x, y, z).
   void MagneticField(const double x, const double y, const double z, double& bx,
                      double& by, double& bz, int& status);
@@ -49,10 +113,19 @@ class Sensor {
   /// Get the weighting potential at (x, y, z).
   double WeightingPotential(const double x, const double y, const double z,
                             const std::string& label);
+  /// Get the weighting field of a single electrode (given by its handle).
+  void WeightingField(const double x, const double y, const double z,
+                      double& wx, double& wy, double& wz, const int electrode);
+  /// Get the weighting potential of a single electrode.
+  double WeightingPotential(const double x, const double y, const double z,
+                            const int electrode);
 
   /// Get the medium at (x, y, z).
   bool GetMedium(const double x, const double y, const double z,
                  Medium*& medium);
+  /// Get the medium at (x, y, z), using a caller-owned context.
+  bool GetMedium(FieldQueryContext& context, const double x, const double y,
+                 const double z, Medium*& medium) const;
 
   /// Set the user area to the default.
   bool SetArea();
@@ -76,6 +149,38 @@ class Sensor {
   void AddSignal(const double q, const double t, const double dt,
                  const double x, const double y, const double z,
                  const double vx, const double vy, const double vz);
+  /// Compute the currents induced on each electrode by a charge q moving
+  /// with velocity (vx, vy, vz) at (x, y, z), without adding them to the
+  /// signals. The array must hold GetNumberOfElectrodes() values.
+  void ComputeInducedCurrents(const double q, const double x, const double y,
+                              const double z, const double vx,
+                              const double vy, const double vz,
+                              double* currents) const;
+  /// Add precomputed currents (one per electrode, see
+  /// ComputeInducedCurrents) over the time step [t, t + dt].
+  void AddSignal(const double q, const double t, const double dt,
+                 const double* currents);
+
+  /// Signals and induced charges accumulated separately from the sensor
+  /// (e. g. by a worker thread), to be added to it with AddSignalBuffer.
+  struct SignalBuffer {
+    SignalStore signals;
+    std::vector<double> charge;
+    bool filled = false;
+  };
+  /// Size a buffer according to the electrodes and time window and clear it.
+  void ResetSignalBuffer(SignalBuffer& buffer) const;
+  /// Add an induced current to a buffer instead of the electrodes.
+  void AddSignal(SignalBuffer& buffer, const double q, const double t,
+                 const double dt, const double x, const double y,
+                 const double z, const double vx, const double vy,
+                 const double vz) const;
+  /// Add an induced charge to a buffer instead of the electrodes.
+  void AddInducedCharge(SignalBuffer& buffer, const double q, const double x0,
+                        const double y0, const double z0, const double x1,
+                        const double y1, const double z1) const;
+  /// Add the contents of a buffer to the signals and induced charges.
+  void AddSignalBuffer(const SignalBuffer& buffer);
   void AddInducedCharge(const double q, const double x0, const double y0,
                         const double z0, const double x1, const double y1,
                         const double z1);
@@ -103,6 +208,33 @@ class Sensor {
   /// Retrieve the total induced charge for a given electrode,
   /// calculated using the weighting potentials at the start and end points.
   double GetInducedCharge(const std::string& label);
+  /// Retrieve the total signal of an electrode (given by its handle).
+  double GetSignal(const int electrode, const unsigned int bin);
+  /// Retrieve the electron signal of an electrode.
+  double GetElectronSignal(const int electrode, const unsigned int bin);
+  /// Retrieve the ion or hole signal of an electrode.
+  double GetIonSignal(const int electrode, const unsigned int bin);
+  /// Retrieve the induced charge of an electrode.
+  double GetInducedCharge(const int electrode);
+  /// Copy the total signal of an electrode (all time bins) to a vector.
+  bool GetSignal(const int electrode, std::vector<double>& signal);
+  /// Copy the electron signal of an electrode to a vector.
+  bool GetElectronSignal(const int electrode, std::vector<double>& signal);
+  /// Copy the ion or hole signal of an electrode to a vector.
+  bool GetIonSignal(const int electrode, std::vector<double>& signal);
+  /** Copy the total signals of all electrodes to a vector,
+    * with the time bins of electrode i at [i * nsteps, (i + 1) * nsteps).
+    */
+  void GetSignalMatrix(std::vector<double>& signals);
+  /** Get the ranges [first, last) of time bins in which a signal may have
+    * been induced on an electrode; the signal in all other bins is zero.
+    * Signals are stored in blocks of time bins which are only allocated
+    * when a current is induced in them, so the ranges are aligned to
+    * blocks of SignalStore::BlockSize bins.
+    */
+  bool GetSignalRanges(
+      const int electrode,
+      std::vector<std::pair<unsigned int, unsigned int> >& ranges) const;
   /// Set the function to be used for evaluating the transfer function.
   void SetTransferFunction(double (*f)(double t));
   /// Set the points to be used for interpolating the transfer function.
@@ -110,8 +242,17 @@ class Sensor {
                            const std::vector<double>& values);
   /// Evaluate the transfer function at a given time.
   double GetTransferFunction(const double t);
-  /// Convolute the induced current with the transfer function.
+  /** Convolute the induced current with the transfer function.
+    * The convolution is done by FFT; the transform of the (sampled)
+    * transfer function is cached until the function or the time window
+    * are changed.
+    */
   bool ConvoluteSignal();
+  /** Set values of the convoluted signal below a fraction of its maximum
+    * to zero, such that no storage is allocated for them in the sparse
+    * signal store (default: 0, i. e. all values are kept).
+    */
+  void SetConvolutionCutoff(const double fraction);
   /// Replace the current signal curve by its integral.
   bool IntegrateSignal();
   /// Set the function to be used for evaluating the noise component.
@@ -119,6 +260,15 @@ class Sensor {
   /// Add noise to the induced signal.
   void AddNoise(const bool total = true, const bool electron = false,
                 const bool ion = false);
+  /** Add Gaussian noise with a given spectrum to the induced signal.
+    * White noise with standard deviation sigma in each time bin is
+    * filtered with the amplitude response f (as function of the frequency
+    * in GHz), i. e. for f = 1 the noise is white. The noise of different
+    * electrodes is uncorrelated.
+    */
+  void AddColoredNoise(double (*f)(double freq), const double sigma,
+                       const bool total = true, const bool electron = false,
+                       const bool ion = false);
   /** Determine the threshold crossings of the current signal curve.
     * \param thr threshold value
     * \param label electrode for which to compute the threshold crossings
@@ -155,18 +305,50 @@ class Sensor {
 
   // Components
   std::vector<ComponentBase*> m_components;
-  ComponentBase* m_lastComponent = nullptr;
+  // Slot in the FieldQueryContext holding the index of the last component
+  // in which a medium was found.
+  FieldQueryContext::Slot m_hintSlot;
 
   // Electrodes
   struct Electrode {
     ComponentBase* comp;
     std::string label;
-    std::vector<double> signal;
-    std::vector<double> electronsignal;
-    std::vector<double> ionsignal;
-    double charge;
+    // Handle of the weighting field in the component (-1: use the label).
+    int handle;
+    // Support region, outside which the weighting field is neglected.
+    bool hasBox = false;
+    std::array<double, 6> box = {{0., 0., 0., 0., 0., 0.}};
+    bool hasCutoff = false;
+    std::array<double, 3> centre = {{0., 0., 0.}};
+    double cutoff2 = 0.;
+    bool hasMap = false;
+    double cutoffError = -1.;
   };
   std::vector<Electrode> m_electrodes;
+  // Electrodes with the label last requested by the label-based getters.
+  bool m_hasLastLabel = false;
+  std::string m_lastLabel;
+  std::vector<unsigned int> m_lastLabelElectrodes;
+
+  // Electrodes with a support region?
+  bool m_hasSupport = false;
+  // Do the lists below need to be updated?
+  bool m_supportChanged = false;
+  // Electrodes without support region.
+  std::vector<int> m_unrestricted;
+  // Boxes of the electrodes with a bounding box or cutoff (but no map).
+  ElementGrid m_electrodeGrid;
+  std::vector<int> m_gridElectrodes;
+  // Map of the electrodes to be evaluated in each cell.
+  std::array<double, 3> m_mapMin = {{0., 0., 0.}};
+  std::array<double, 3> m_mapScale = {{0., 0., 0.}};
+  std::array<unsigned int, 3> m_mapN = {{0, 0, 0}};
+  std::vector<unsigned int> m_mapOffsets;
+  std::vector<int> m_mapElectrodes;
+
+  // Signals and induced charges.
+  SignalStore m_signals;
+  std::vector<double> m_charge;
 
   // Time window for signals
   unsigned int m_nTimeBins = 200;
@@ -180,6 +362,12 @@ class Sensor {
   double (*m_fTransfer)(double t) = nullptr;
   std::vector<double> m_transferFunctionTimes;
   std::vector<double> m_transferFunctionValues;
+  // FFT used for the convolution and the noise generation.
+  Numerics::FFT m_fft;
+  // Transform of the sampled transfer function (empty if not yet computed).
+  std::vector<std::complex<double> > m_fTransferFFT;
+  // Relative threshold below which convoluted values are set to zero.
+  double m_convolutionCutoff = 0.;
 
   // Noise
   bool m_hasNoiseFunction = false;
@@ -205,6 +393,95 @@ class Sensor {
                       double& ymax, double& zmax);
 
   double InterpolateTransferFunctionTable(const double t) const;
+  // Get the indices of the electrodes with a given label.
+  const std::vector<unsigned int>& FindElectrodes(const std::string& label);
+  // Set the length of the FFT according to the number of time bins.
+  void InitialiseFFT();
+  void StoreConvolutedSignal(const unsigned int electrode,
+                             const std::vector<double>& signal);
+  // Look up the weighting field handles of the electrodes.
+  void UpdateElectrodeHandles();
+  // Rebuild the lists of electrodes with and without support regions.
+  void UpdateElectrodeSupport();
+  // Get the cell of the electrode map containing a point (-1 if outside).
+  long GetMapCell(const double x, const double y, const double z) const;
+  // Check if a point is inside the bounding box and cutoff of an electrode.
+  bool IsInBox(const Electrode& electrode, const double x, const double y,
+               const double z) const {
+    if (electrode.hasBox &&
+        (x < electrode.box[0] || y < electrode.box[1] ||
+         z < electrode.box[2] || x > electrode.box[3] ||
+         y > electrode.box[4] || z > electrode.box[5])) {
+      return false;
+    }
+    if (!electrode.hasCutoff) return true;
+    const double dx = x - electrode.centre[0];
+    const double dy = y - electrode.centre[1];
+    const double dz = z - electrode.centre[2];
+    return dx * dx + dy * dy + dz * dz <= electrode.cutoff2;
+  }
+  // Check if a point is inside the support region of an electrode.
+  bool IsInSupport(const int i, const double x, const double y,
+                   const double z) const;
+  // Call f(i) for each electrode i whose weighting field matters at a point.
+  template <typename F>
+  void ForEachElectrode(const double x, const double y, const double z,
+                        F f) const {
+    const int nElectrodes = m_electrodes.size();
+    if (!m_hasSupport) {
+      for (int i = 0; i < nElectrodes; ++i) f(i);
+      return;
+    }
+    if (m_supportChanged) {
+      for (int i = 0; i < nElectrodes; ++i) {
+        if (IsInSupport(i, x, y, z)) f(i);
+      }
+      return;
+    }
+    for (const int i : m_unrestricted) f(i);
+    if (m_electrodeGrid.IsBuilt()) {
+      for (const int j : m_electrodeGrid.GetElements(x, y, z)) {
+        const int i = m_gridElectrodes[j];
+        if (IsInBox(m_electrodes[i], x, y, z)) f(i);
+      }
+    }
+    const long cell = GetMapCell(x, y, z);
+    if (cell < 0) return;
+    for (unsigned int k = m_mapOffsets[cell]; k < m_mapOffsets[cell + 1];
+         ++k) {
+      const int i = m_mapElectrodes[k];
+      if (IsInBox(m_electrodes[i], x, y, z)) f(i);
+    }
+  }
+  void ElectrodeWeightingField(const Electrode& electrode, const double x,
+                               const double y, const double z, double& wx,
+                               double& wy, double& wz) const {
+    if (electrode.handle >= 0) {
+      electrode.comp->WeightingField(x, y, z, wx, wy, wz, electrode.handle);
+    } else {
+      electrode.comp->WeightingField(x, y, z, wx, wy, wz, electrode.label);
+    }
+  }
+  double ElectrodeWeightingPotential(const Electrode& electrode,
+                                     const double x, const double y,
+                                     const double z) const {
+    return electrode.handle >= 0
+               ? electrode.comp->WeightingPotential(x, y, z, electrode.handle)
+               : electrode.comp->WeightingPotential(x, y, z, electrode.label);
+  }
+  // Scaling factor from the accumulated signals to the returned ones.
+  double SignalScale() const {
+    return m_signalConversion / (m_nEvents * m_tStep);
+  }
+  // Copy a component of the signal of an electrode (scaled).
+  bool CopySignal(const SignalStore::Component c, const int electrode,
+                  std::vector<double>& signal) const;
+  // Return the time bin of a signal contribution (-1 if out of range).
+  int GetSignalBin(const double t, const double dt) const;
+  // Distribute a current over the time bins covered by [t, t + dt].
+  void FillSignal(SignalStore& signals, const unsigned int electrode,
+                  const SignalStore::Component c, const double t,
+                  const double dt, const int bin, const double cur) const;
 };
 }
 
@@ -0,0 +1,97 @@
+#ifndef G_SIGNAL_STORE_H
+#define G_SIGNAL_STORE_H
+
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+namespace Garfield {
+
+/// Signals (total, electron and ion/hole components) of a set of
+/// electrodes, stored in blocks of time bins.
+///
+/// A block is only allocated when a value is added to one of its bins,
+/// so long time windows with localised signals need little memory.
+/// Reset drops all blocks but keeps the memory for the next event.
+
+class SignalStore {
+ public:
+  /// Components of the signal.
+  enum Component { Total = 0, Electron = 1, Ion = 2 };
+  /// Number of time bins per block.
+  static constexpr unsigned int BlockSize = 256;
+
+  /// Constructor
+  SignalStore() {}
+  /// Destructor
+  ~SignalStore() {}
+
+  /// Remove all blocks and set the number of electrodes and time bins.
+  void Reset(const unsigned int nElectrodes, const unsigned int nBins);
+  /// Get the number of electrodes.
+  unsigned int GetNumberOfElectrodes() const { return m_blocks.size(); }
+  /// Get the number of time bins.
+  unsigned int GetNumberOfBins() const { return m_nBins; }
+  /// Get the number of allocated blocks.
+  size_t GetNumberOfBlocks() const { return m_nBlocks; }
+  /// Check if no block has been allocated for an electrode.
+  bool IsEmpty(const unsigned int electrode) const {
+    return m_blocks[electrode].empty();
+  }
+
+  /// Add a value to the total signal and to one of the components
+  /// (only to the total signal if the component is Total).
+  void Add(const unsigned int electrode, const Component c,
+           const unsigned int bin, const double value) {
+    double* b = GetBlock(electrode, bin / BlockSize);
+    const unsigned int k = bin % BlockSize;
+    b[k] += value;
+    if (c != Total) b[c * BlockSize + k] += value;
+  }
+  /// Add a value to a single component.
+  void AddTo(const unsigned int electrode, const Component c,
+             const unsigned int bin, const double value) {
+    GetBlock(electrode, bin / BlockSize)[c * BlockSize + bin % BlockSize] +=
+        value;
+  }
+  /// Set the value of a component.
+  void Set(const unsigned int electrode, const Component c,
+           const unsigned int bin, const double value) {
+    GetBlock(electrode, bin / BlockSize)[c * BlockSize + bin % BlockSize] =
+        value;
+  }
+  /// Get the value of a component (zero if the bin is not allocated).
+  double Get(const unsigned int electrode, const Component c,
+             const unsigned int bin) const {
+    const double* b = FindBlock(electrode, bin / BlockSize);
+    return b ? b[c * BlockSize + bin % BlockSize] : 0.;
+  }
+  /// Add the contents of another store with the same dimensions.
+  void Add(const SignalStore& other);
+
+  /// Copy a component of an electrode, multiplied by a factor,
+  /// to an array of GetNumberOfBins() values.
+  void Copy(const unsigned int electrode, const Component c,
+            const double scale, double* values) const;
+  /// Get the ranges [first, last) of time bins which have been allocated
+  /// for an electrode (all other bins are zero).
+  void GetRanges(const unsigned int electrode,
+                 std::vector<std::pair<unsigned int, unsigned int> >& ranges)
+      const;
+
+ private:
+  unsigned int m_nBins = 0;
+  /// Allocated blocks of each electrode: pairs of block number within the
+  /// time window and position in m_data, sorted by block number.
+  std::vector<std::vector<std::pair<unsigned int, unsigned int> > > m_blocks;
+  /// Values (total, electron, ion) of the allocated blocks.
+  std::vector<double> m_data;
+  size_t m_nBlocks = 0;
+
+  double* GetBlock(const unsigned int electrode, const unsigned int block);
+  const double* FindBlock(const unsigned int electrode,
+                          const unsigned int block) const;
+};
+}
+
+#endif
@@ -0,0 +1,76 @@
+#ifndef G_SNAPSHOT_H
+#define G_SNAPSHOT_H
+
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace Garfield {
+
+/// Binary snapshot of the data of a component: a header (format tag,
+/// byte order, version, checksum) followed by the payload. Snapshots are
+/// read back through a memory mapping, so loading them is much faster than
+/// parsing the original text files.
+
+class Snapshot {
+ public:
+  /// Cursor over the payload of a snapshot.
+  struct Reader {
+    const char* p;
+    const char* end;
+    bool Read(void* dst, const size_t n) {
+      if (static_cast<size_t>(end - p) < n) return false;
+      memcpy(dst, p, n);
+      p += n;
+      return true;
+    }
+    template <typename T>
+    bool ReadVector(std::vector<T>& v) {
+      uint64_t n = 0;
+      if (!Read(&n, sizeof(n)) || (end - p) / sizeof(T) < n) return false;
+      v.resize(n);
+      return n == 0 || Read(v.data(), n * sizeof(T));
+    }
+    bool ReadString(std::string& s);
+  };
+
+  /// Append raw bytes to a payload.
+  static void Append(std::vector<char>& buffer, const void* src,
+                     const size_t n) {
+    const char* p = static_cast<const char*>(src);
+    buffer.insert(buffer.end(), p, p + n);
+  }
+  /// Append a vector (preceded by its size) to a payload.
+  template <typename T>
+  static void AppendVector(std::vector<char>& buffer,
+                           const std::vector<T>& v) {
+    const uint64_t n = v.size();
+    Append(buffer, &n, sizeof(n));
+    if (n > 0) Append(buffer, v.data(), n * sizeof(T));
+  }
+  /// Append a string (preceded by its length) to a payload.
+  static void AppendString(std::vector<char>& buffer, const std::string& s);
+
+  /** Write a payload, preceded by the header, to a file.
+    * \param tag format identifier (8 characters).
+    * \param version version of the format.
+    * \param recordSize size of a structure which is stored verbatim.
+    * \param error description of the problem if the file cannot be written.
+    */
+  static bool Write(const std::string& filename, const char* tag,
+                    const uint32_t version, const uint32_t recordSize,
+                    const std::vector<char>& payload, std::string& error);
+  /** Map a snapshot into memory and check its header and checksum.
+    * On success, the mapping is held by `mapping` and `in` covers the
+    * payload.
+    */
+  static bool Open(const std::string& filename, const char* tag,
+                   const uint32_t version, const uint32_t recordSize,
+                   std::shared_ptr<void>& mapping, Reader& in,
+                   std::string& error);
+};
+}
+
+#endif
@@ -0,0 +1,72 @@
+#ifndef G_TEXT_FILE_H
+#define G_TEXT_FILE_H
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "ThreadPool.hh"
+
+namespace Garfield {
+
+/// Text file which is read into memory in one go and split into lines,
+/// so that the lines can be parsed in parallel (used by the field map
+/// readers). Tokens are separated by blanks.
+
+class TextFile {
+ public:
+  /// Constructor (number of threads, 0: number of hardware threads).
+  explicit TextFile(const unsigned int nThreads = 0) : m_nThreads(nThreads) {}
+  /// Destructor
+  ~TextFile() {}
+
+  /// Read a file and split it into lines.
+  bool Read(const std::string& filename);
+  /// Get the number of lines.
+  size_t GetNumberOfLines() const { return m_lines.size(); }
+  /// Get a line (null-terminated, without the line break).
+  const char* GetLine(const size_t i) const {
+    return m_data.data() + m_lines[i];
+  }
+
+  /** Call f(begin, end) for blocks of consecutive indices covering [0, n).
+    * The blocks are processed in parallel (on the thread pool set up by
+    * Read for a large file), unless n is small.
+    */
+  void ParallelFor(const size_t n,
+                   const std::function<void(size_t, size_t)>& f) const;
+
+  /// Move to the start of the next token; returns false if there is none.
+  static bool SkipBlanks(const char*& p) {
+    while (*p == ' ' || *p == '\t') ++p;
+    return *p != '\0';
+  }
+  /// Move past n tokens; returns false if there are fewer.
+  static bool SkipTokens(const char*& p, const unsigned int n = 1);
+  /// Read an integer and move past the token; returns false if the
+  /// token is not an integer (p is then left at the token).
+  static bool ReadInteger(const char*& p, int& value);
+  /// Read a floating-point number and move past the token; returns false
+  /// if the token is not a number (p is then left at the token).
+  static bool ReadDouble(const char*& p, double& value);
+  /// Check if the first token of a line is a given string.
+  static bool FirstTokenIs(const char* line, const char* token);
+  /// Check if a line contains no tokens.
+  static bool IsBlank(const char* line) { return !SkipBlanks(line); }
+
+ private:
+  unsigned int m_nThreads = 0;
+  /// Thread pool (null if the file is read and parsed serially).
+  std::unique_ptr<ThreadPool> m_pool;
+  std::vector<char> m_data;
+  /// Offsets of the starts of the lines.
+  std::vector<size_t> m_lines;
+
+  static void SkipToken(const char*& p) {
+    while (*p != ' ' && *p != '\t' && *p != '\0') ++p;
+  }
+};
+}
+
+#endif
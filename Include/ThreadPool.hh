@@ -0,0 +1,85 @@
+#ifndef G_THREAD_POOL_H
+#define G_THREAD_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Garfield {
+
+/// Pool of persistent worker threads for data-parallel loops.
+///
+/// The indices of a loop are split into one contiguous range per thread.
+/// A thread which has finished its own range steals the upper half of
+/// the remaining indices of another thread, so the load stays balanced
+/// even when the cost per index (e. g. the number of collisions of an
+/// electron) varies strongly.
+
+class ThreadPool {
+ public:
+  /// Constructor (0: use the number of hardware threads).
+  explicit ThreadPool(const unsigned int nThreads = 0);
+  /// Destructor
+  ~ThreadPool();
+
+  /// Number of threads (including the calling thread) taking part in a loop.
+  unsigned int GetNumberOfThreads() const { return m_workers.size() + 1; }
+  /// Number of worker threads of all pools which currently exist
+  /// (e. g. to check that it is safe to fork the process).
+  static unsigned int GetNumberOfWorkerThreads();
+
+  /** Call f(i, thread) for all i in [0, n).
+    * The calling thread takes part in the loop (with thread index 0),
+    * the workers have indices 1 ... GetNumberOfThreads() - 1.
+    * The function returns when all indices have been processed.
+    * If f throws an exception, the remaining indices are skipped and
+    * the (first) exception is rethrown in the calling thread.
+    * Calls from within a loop (of any pool) and calls while another
+    * thread is running a loop on the same pool are run sequentially
+    * by the calling thread.
+    */
+  void ParallelFor(const size_t n,
+                   const std::function<void(size_t, unsigned int)>& f);
+
+ private:
+  std::vector<std::thread> m_workers;
+
+  std::mutex m_mutex;
+  // Held by the thread running a loop on the pool.
+  std::mutex m_loopMutex;
+  std::condition_variable m_start;
+  std::condition_variable m_done;
+
+  // Indices of the current loop not yet taken by a thread.
+  struct Range {
+    std::mutex mutex;
+    size_t begin = 0;
+    size_t end = 0;
+  };
+  std::unique_ptr<Range[]> m_ranges;
+
+  // Current loop.
+  const std::function<void(size_t, unsigned int)>* m_task = nullptr;
+  // Set when an exception has been thrown in the current loop.
+  std::atomic<bool> m_abort{false};
+  // Number of workers which have not yet finished the current loop.
+  unsigned int m_busy = 0;
+  // Loop counter.
+  unsigned long m_epoch = 0;
+  bool m_stop = false;
+  // First exception thrown in the current loop.
+  std::exception_ptr m_exception;
+
+  void Work(const unsigned int thread);
+  bool Next(const unsigned int thread, size_t& i);
+  void Run(const std::function<void(size_t, unsigned int)>& f,
+           const unsigned int thread);
+};
+}
+
+#endif
@@ -0,0 +1,142 @@
+#ifndef G_TRANSPORT_TABLE_H
+#define G_TRANSPORT_TABLE_H
+
+#include <memory>
+#include <vector>
+
+namespace Garfield {
+
+/// Compiled form of a table of transport parameters, for fast interpolation.
+///
+/// The values are stored contiguously. For one-dimensional tables (E only),
+/// the coefficients of the Newton polynomial used by Numerics::Divdif are
+/// precomputed for each interval; for three-dimensional tables (E, B, angle),
+/// the shape functions of Numerics::Boxin3 are evaluated directly.
+/// On uniform and logarithmic grids the interval containing a point is
+/// computed instead of searched for. The results agree with the original
+/// functions up to rounding.
+///
+/// The tables of a medium share a Grid. A Point locates a field
+/// configuration in the grid once and can then be used to interpolate
+/// any number of tables defined on that grid.
+
+class TransportTable {
+ public:
+  class Grid;
+
+  /// Field configuration (E, B, angle) at which tables are interpolated.
+  struct Point {
+    Point(const double e0, const double b0, const double a0)
+        : e(e0), b(b0), a(a0) {}
+    double e, b, a;
+
+    // Location in the grid (filled on first use).
+    const Grid* grid = nullptr;
+    /// Is E within the range of the grid?
+    bool inside = false;
+    /// Index of the node if E is at one of the ends of the grid (1D).
+    int node = -1;
+    /// Coordinates (E, B, angle) clamped to the grid.
+    double x[3];
+    /// Intervals containing the clamped coordinates.
+    unsigned int ig[3];
+    // Shape functions for interpolation orders 0 - 2 (3D),
+    // evaluated on demand.
+    bool hasShape[3] = {false, false, false};
+    int i0[3][3], i1[3][3];
+    double f[3][3][4];
+  };
+
+  /// Grid of electric fields, magnetic fields and angles.
+  class Grid {
+   public:
+    /** Set up the grid.
+      * \param tab2d use the full grid (otherwise only the electric field).
+      * \return false if the grid is not strictly increasing.
+      */
+    bool Set(const std::vector<double>& efields,
+             const std::vector<double>& bfields,
+             const std::vector<double>& angles, const bool tab2d);
+    /// Locate a point in the grid.
+    void Locate(Point& p) const;
+
+   private:
+    friend class TransportTable;
+    /// Nodes along one axis.
+    struct Axis {
+      enum class Spacing { Irregular = 0, Uniform, Logarithmic };
+      std::vector<double> x;
+      Spacing spacing = Spacing::Irregular;
+      /// Number of intervals per unit length (or per unit of log x).
+      double scale = 0.;
+
+      bool Set(const std::vector<double>& values);
+      /// Index i of the interval x[i] <= u < x[i + 1] (clamped to the grid).
+      unsigned int FindInterval(const double u) const;
+    };
+
+    Axis m_e;
+    Axis m_b;
+    Axis m_a;
+    bool m_tab2d = false;
+    /// Tolerance for points at the ends of the grid (1D).
+    double m_tol = 0.;
+  };
+
+  /// Constructor
+  TransportTable() {}
+  /// Destructor
+  ~TransportTable() {}
+
+  /** Compile a table.
+    * \param tab table [angle][B][E].
+    * \param grid grid on which the table is defined.
+    * \param order interpolation order.
+    * \param eLinear linear interpolation is used below this field.
+    * \return false if the table cannot be compiled.
+    */
+  bool Build(const std::vector<std::vector<std::vector<double> > >& tab,
+             const std::shared_ptr<const Grid>& grid, const unsigned int order,
+             const double eLinear = 0.);
+  /// Remove the table.
+  void Clear();
+  /// Has the table been compiled?
+  bool IsBuilt() const { return !m_values.empty(); }
+
+  /** Interpolate the table at a point (which is located in the grid
+    * if this has not been done before).
+    * \return false if the point requires extrapolation (one-dimensional
+    *         tables), in which case the original function has to be used.
+    */
+  bool Interpolate(Point& p, double& y) const {
+    if (m_values.empty()) return false;
+    if (p.grid != m_grid.get()) m_grid->Locate(p);
+    return m_grid->m_tab2d ? Interpolate3D(p, y) : Interpolate1D(p, y);
+  }
+  /// Interpolate the table at a single point.
+  bool Interpolate(const double e, const double b, const double a,
+                   double& y) const {
+    Point p(e, b, a);
+    return Interpolate(p, y);
+  }
+
+ private:
+  std::shared_ptr<const Grid> m_grid;
+  unsigned int m_order = 2;
+  double m_eLinear = 0.;
+
+  /// Table values [angle][B][E] (3D) or node values (1D).
+  std::vector<double> m_values;
+
+  // Newton coefficients (1D).
+  /// Highest interpolation order.
+  unsigned int m_maxOrder = 0;
+  /// Coefficients and nodes of each interval.
+  std::vector<double> m_coefficients;
+
+  bool Interpolate1D(const Point& p, double& y) const;
+  bool Interpolate3D(Point& p, double& y) const;
+};
+}
+
+#endif
@@ -8,6 +8,7 @@
 #include "FundamentalConstants.hh"
 #include "GarfieldConstants.hh"
 #include "Random.hh"
+#include "RandomEngineXoshiro.hh"
 
 namespace {
 
@@ -46,6 +47,12 @@ void AvalancheMC::EnablePlotting(ViewDrift* view) {
   m_viewer = view;
 }
 
+void AvalancheMC::EnableParallelTransport(const unsigned int nThreads) {
+  m_pool.reset(new ThreadPool(nThreads));
+  std::cout << m_className << "::EnableParallelTransport: Using "
+            << m_pool->GetNumberOfThreads() << " threads.\n";
+}
+
 void AvalancheMC::SetTimeSteps(const double d) {
   m_stepModel = FixedTime;
   if (d < Small) {
@@ -232,11 +239,31 @@ bool AvalancheMC::DriftIon(const double x0, const double y0, const double z0,
 bool AvalancheMC::DriftLine(const double xi, const double yi, const double zi,
                             const double ti, const int type, const bool aval) {
 
+  DriftLineResult result;
+  const bool ok = DriftLine({xi, yi, zi}, ti, type, aval, m_drift, result);
+  if (!result.hasEndPoint) return ok;
+  AddEndPoint(type, result);
+
+  // Compute the induced signal and induced charge if requested.
+  const double scale = type < 0 ? -m_scaleE : type == 1 ? m_scaleH : m_scaleI;
+  if (m_doSignal) ComputeSignal(scale, m_drift);
+  if (m_doInducedCharge) ComputeInducedCharge(scale, m_drift);
+
+  // Plot the drift line if requested.
+  if (m_viewer) PlotDriftLine(type, m_drift);
+  return ok;
+}
+
+bool AvalancheMC::DriftLine(const std::array<double, 3>& xi, const double ti,
+                            const int type, const bool aval,
+                            std::vector<DriftPoint>& drift,
+                            DriftLineResult& result) const {
 
   // Reset the drift line.
-  m_drift.clear();
+  drift.clear();
+  result = DriftLineResult();
   // Check the initial position.
-  std::array<double, 3> x0 = {xi, yi, zi};
+  std::array<double, 3> x0 = xi;
   std::array<double, 3> e0 = {0., 0., 0.};
   std::array<double, 3> b0 = {0., 0., 0.};
   Medium* medium = nullptr;
@@ -255,7 +282,7 @@ bool AvalancheMC::DriftLine(const double xi, const double yi, const double zi,
   // Stop here if initial position or time are invalid.
   if (status != 0) return false;
   // Add the first point to the line.
-  AddPoint(x0, t0, 0, 0, 0, m_drift);
+  AddPoint(x0, t0, 0, 0, 0, drift);
   if (m_debug) {
     std::cout << m_className + "::DriftLine: Starting at " 
               << PrintVec(x0) + ".\n";
@@ -271,13 +298,16 @@ bool AvalancheMC::DriftLine(const double xi, const double yi, const double zi,
       break;
     }
 
-    // Compute the drift velocity at this point.
-    std::array<double, 3> v0;
-    if (!GetVelocity(type, medium, x0, e0, b0, v0)) {
+    // Compute the drift velocity (and diffusion coefficients) at this point.
+    Medium::TransportCoefficients coeff;
+    unsigned int what = 0;
+    if (m_useDiffusion) what |= Medium::TransportCoefficients::Diffusion;
+    if (!GetTransport(type, medium, what, x0, e0, b0, coeff)) {
       status = StatusCalculationAbandoned;
       std::cerr << m_className + "::DriftLine: Abandoning the calculation.\n";
       break;
     }
+    const std::array<double, 3> v0 = {coeff.vx, coeff.vy, coeff.vz};
 
     // Make sure the drift velocity vector has a non-vanishing component.
     const double vmag = Mag(v0);
@@ -318,11 +348,7 @@ bool AvalancheMC::DriftLine(const double xi, const double yi, const double zi,
     }
 
     if (m_useDiffusion) {
-      if (!AddDiffusion(type, medium, sqrt(vmag * dt), x1, v0, e0, b0)) {
-        status = StatusCalculationAbandoned;
-        std::cerr << m_className + "::DriftLine: Abandoning the calculation.\n";
-        break;
-      }
+      AddDiffusion(sqrt(vmag * dt), coeff.dl, coeff.dt, x1, v0);
     }
     if (m_debug) {
       std::cout << m_className + "::DriftLine: Next point: " 
@@ -340,7 +366,7 @@ bool AvalancheMC::DriftLine(const double xi, const double yi, const double zi,
                   << PrintVec(x1) + ".\n";
       }
       // Add the point to the drift line.
-      AddPoint(x1, t1, 0, 0, 0, m_drift);
+      AddPoint(x1, t1, 0, 0, 0, drift);
       break;
     }
     // Check if the particle has crossed a wire.
@@ -357,7 +383,7 @@ bool AvalancheMC::DriftLine(const double xi, const double yi, const double zi,
       std::array<double, 3> d1 = {x1[0] - x0[0], x1[1] - x0[1], x1[2] - x0[2]};
       const double tc = t0 + (t1 - t0) * Mag(dc) / Mag(d1);
       // Add the point to the drift line.
-      AddPoint(xc, tc, 0, 0, 0, m_drift);
+      AddPoint(xc, tc, 0, 0, 0, drift);
       break;
     }
 
@@ -366,81 +392,78 @@ bool AvalancheMC::DriftLine(const double xi, const double yi, const double zi,
       status = StatusOutsideTimeWindow;
     }
     // Add the point to the drift line.
-    AddPoint(x1, t1, 0, 0, 0, m_drift);
+    AddPoint(x1, t1, 0, 0, 0, drift);
     // Update the current position and time.
     x0 = x1;
     t0 = t1;
   }
 
   // Compute Townsend and attachment coefficients for each drift step.
-  unsigned int nElectronsOld = m_nElectrons;
-  unsigned int nHolesOld = m_nHoles;
-  unsigned int nIonsOld = m_nIons;
-
   if ((type == -1 || type == 1) && (aval || m_useAttachment) && 
       (m_sizeCut == 0 || m_nElectrons < m_sizeCut)) {
-    ComputeGainLoss(type, m_drift, status);
+    ComputeGainLoss(type, drift, status, result);
     if (status == StatusAttached && m_debug) {
       std::cout << m_className + "::DriftLine: Attached at " 
-                << PrintVec(m_drift.back().x) + ".\n";
+                << PrintVec(drift.back().x) + ".\n";
     }
   }
 
   if (m_debug) {
     std::cout << m_className << "::DriftLine: Stopped at "
-              << PrintVec(m_drift.back().x) + ".\n";
+              << PrintVec(drift.back().x) + ".\n";
   }
   // Create an "endpoint".
-  EndPoint endPoint;
-  endPoint.x0 = {xi, yi, zi};
+  EndPoint& endPoint = result.endPoint;
+  endPoint.x0 = xi;
   endPoint.t0 = ti;
-  endPoint.x1 = m_drift.back().x;
-  endPoint.t1 = m_drift.back().t;
+  endPoint.x1 = drift.back().x;
+  endPoint.t1 = drift.back().t;
   endPoint.status = status;
-  if (type == -1) {
-    m_endpointsElectrons.push_back(std::move(endPoint));
-  } else if (type == 1) {
-    m_endpointsHoles.push_back(std::move(endPoint));
-  } else if (type == 2) {
-    m_endpointsIons.push_back(std::move(endPoint));
-  }
+  result.hasEndPoint = true;
 
   if (m_debug) {
-    const int nNewElectrons = m_nElectrons - nElectronsOld;
-    const int nNewHoles = m_nHoles - nHolesOld;
-    const int nNewIons = m_nIons - nIonsOld;
     std::cout << m_className << "::DriftLine: Produced\n"
-              << "      " << nNewElectrons << " electrons,\n"
-              << "      " << nNewHoles << " holes, and\n"
-              << "      " << nNewIons << " ions.\n";
+              << "      " << result.ne << " electrons,\n"
+              << "      " << result.nh << " holes, and\n"
+              << "      " << result.ni << " ions.\n";
   }
 
-  // Compute the induced signal and induced charge if requested.
-  const double scale = type < 0 ? -m_scaleE : type == 1 ? m_scaleH : m_scaleI;
-  if (m_doSignal) ComputeSignal(scale, m_drift);
-  if (m_doInducedCharge) ComputeInducedCharge(scale, m_drift);
+  if (status == StatusCalculationAbandoned) return false;
+  return true;
+}
 
-  // Plot the drift line if requested.
-  if (m_viewer && !m_drift.empty()) {
-    const unsigned int nPoints = m_drift.size();
-    // Register the new drift line and get its ID.
-    int id;
-    if (type < 0) {
-      m_viewer->NewElectronDriftLine(nPoints, id, xi, yi, zi);
-    } else if (type == 1) {
-      m_viewer->NewHoleDriftLine(nPoints, id, xi, yi, zi);
-    } else {
-      m_viewer->NewIonDriftLine(nPoints, id, xi, yi, zi);
-    }
-    // Set the points along the trajectory.
-    for (unsigned int i = 0; i < nPoints; ++i) {
-      const auto& x = m_drift[i].x;
-      m_viewer->SetDriftLinePoint(id, i, x[0], x[1], x[2]);
-    }
+void AvalancheMC::AddEndPoint(const int type, const DriftLineResult& result) {
+  m_nElectrons += result.ne;
+  m_nHoles += result.nh;
+  m_nIons += result.ni;
+  if (type == -1) {
+    m_endpointsElectrons.push_back(result.endPoint);
+  } else if (type == 1) {
+    m_endpointsHoles.push_back(result.endPoint);
+  } else if (type == 2) {
+    m_endpointsIons.push_back(result.endPoint);
   }
+}
 
-  if (status == StatusCalculationAbandoned) return false;
-  return true;
+void AvalancheMC::PlotDriftLine(const int type,
+                                const std::vector<DriftPoint>& drift) {
+  if (drift.empty()) return;
+  const unsigned int nPoints = drift.size();
+  const auto& x0 = drift.front().x;
+  // Register the new drift line and get its ID.
+  int id;
+  if (type < 0) {
+    m_viewer->NewElectronDriftLine(nPoints, id, x0[0], x0[1], x0[2]);
+  } else if (type == 1) {
+    m_viewer->NewHoleDriftLine(nPoints, id, x0[0], x0[1], x0[2]);
+  } else {
+    m_viewer->NewIonDriftLine(nPoints, id, x0[0], x0[1], x0[2]);
+  }
+  // Set the points along the trajectory.
+  for (unsigned int i = 0; i < nPoints; ++i) {
+    const auto& x = drift[i].x;
+    m_viewer->SetDriftLinePoint(id, i, x[0], x[1], x[2]);
+  }
 }
 
 bool AvalancheMC::AvalancheElectron(const double x0, const double y0,
@@ -496,6 +519,43 @@ bool AvalancheMC::Avalanche(const double x0, const double y0, const double z0,
   }
 
   std::vector<DriftPoint> newAval;
+  if (m_pool && m_pool->GetNumberOfThreads() > 1) {
+    // Trigger any lazy initialisation (user area, field maps, weighting
+    // fields, transport tables) before starting the threads.
+    std::array<double, 3> e0, b0, v0;
+    Medium* medium = nullptr;
+    if (GetField(xi, e0, b0, medium) == 0) {
+      GetVelocity(withElectrons ? -1 : 1, medium, xi, e0, b0, v0);
+    }
+    std::vector<double> currents(m_sensor->GetNumberOfElectrodes(), 0.);
+    if (m_doSignal && !currents.empty()) {
+      m_sensor->ComputeInducedCurrents(1., x0, y0, z0, 0., 0., 0.,
+                                       currents.data());
+    }
+    // Derive the seed of the random number streams from the generator
+    // of this thread.
+    const uint64_t seed =
+        static_cast<uint64_t>(RndmUniform() * 9007199254740992.);
+    std::vector<Worker> workers(m_pool->GetNumberOfThreads());
+    for (auto& worker : workers) {
+      worker.drift.reserve(10000);
+      m_sensor->ResetSignalBuffer(worker.signals);
+    }
+    uint64_t generation = 0;
+    while (!aval.empty()) {
+      DriftGeneration(aval, withElectrons, withHoles, seed, generation,
+                      workers, newAval);
+      aval.swap(newAval);
+      newAval.clear();
+      ++generation;
+    }
+    // Add the signals accumulated by the threads.
+    for (const auto& worker : workers) {
+      m_sensor->AddSignalBuffer(worker.signals);
+    }
+    return true;
+  }
+
   while (!aval.empty()) {
     for (const auto& point : aval) {
       if (withElectrons) {
@@ -506,15 +566,8 @@ bool AvalancheMC::Avalanche(const double x0, const double y0, const double z0,
           if (!DriftLine(point.x[0], point.x[1], point.x[2], point.t, -1, true)) {
             continue;
           }
-          // Loop over the drift line.
-          const unsigned int nPoints = m_drift.size();
-          for (unsigned int j = 0; j < nPoints - 2; ++j) {
-            const auto& p = m_drift[j];
-            if (p.ne == 0 && p.nh == 0 && p.ni == 0) continue;
-            // Add the point to the table.
-            AddPoint(m_drift[j + 1].x, m_drift[j + 1].t, p.ne, p.nh, p.ni, 
-                     newAval);
-          }
+          // Add the points where secondaries were produced to the table.
+          AddSecondaries(-1, m_drift, newAval);
         }
       }
 
@@ -533,15 +586,8 @@ bool AvalancheMC::Avalanche(const double x0, const double y0, const double z0,
           if (!DriftLine(point.x[0], point.x[1], point.x[2], point.t, +1, true)) {
             continue;
           }
-          // Loop over the drift line.
-          const unsigned int nPoints = m_drift.size();
-          for (unsigned int j = 0; j < nPoints - 1; ++j) {
-            const auto& p = m_drift[j];
-            if (p.ne == 0 && p.nh == 0 && p.ni == 0) continue;
-            // Add the point to the table.
-            AddPoint(m_drift[j + 1].x, m_drift[j + 1].t, p.ne, p.nh, p.ni, 
-                     newAval);
-          }
+          // Add the points where secondaries were produced to the table.
+          AddSecondaries(+1, m_drift, newAval);
         }
       }
     }
@@ -551,6 +597,81 @@ bool AvalancheMC::Avalanche(const double x0, const double y0, const double z0,
   return true;
 }
 
+void AvalancheMC::DriftGeneration(const std::vector<DriftPoint>& aval,
+                                  const bool withElectrons,
+                                  const bool withHoles, const uint64_t seed,
+                                  const uint64_t generation,
+                                  std::vector<Worker>& workers,
+                                  std::vector<DriftPoint>& newAval) {
+  // Make a list of drift lines, in the order of the serial calculation.
+  std::vector<DriftLineTask> tasks;
+  const unsigned int nPoints = aval.size();
+  for (unsigned int i = 0; i < nPoints; ++i) {
+    const auto& point = aval[i];
+    std::vector<int> types;
+    if (withElectrons) types.insert(types.end(), point.ne, -1);
+    if (withHoles) {
+      types.insert(types.end(), point.ni, 2);
+      types.insert(types.end(), point.nh, 1);
+    }
+    for (const auto type : types) {
+      DriftLineTask task;
+      task.point = i;
+      task.type = type;
+      tasks.push_back(std::move(task));
+    }
+  }
+
+  // Compute the drift lines.
+  m_pool->ParallelFor(tasks.size(), [&](const size_t i,
+                                        const unsigned int thread) {
+    RandomEngineXoshiro engine(seed, generation, i);
+    ScopedThreadRandomEngine scope(engine);
+    auto& task = tasks[i];
+    auto& worker = workers[thread];
+    const auto& point = aval[task.point];
+    const int type = task.type;
+    task.ok = DriftLine(point.x, point.t, type, type != 2, worker.drift,
+                        task.result);
+    if (task.result.hasEndPoint) {
+      const double scale =
+          type < 0 ? -m_scaleE : type == 1 ? m_scaleH : m_scaleI;
+      if (m_doSignal) ComputeSignal(scale, worker.drift, &worker.signals);
+      if (m_doInducedCharge) {
+        ComputeInducedCharge(scale, worker.drift, &worker.signals);
+      }
+      if (m_viewer) task.drift = worker.drift;
+    }
+    if (task.ok && type != 2) {
+      AddSecondaries(type, worker.drift, task.secondaries);
+    }
+  });
+
+  // Collect the results.
+  for (const auto& task : tasks) {
+    if (!task.result.hasEndPoint) continue;
+    AddEndPoint(task.type, task.result);
+    if (m_viewer) PlotDriftLine(task.type, task.drift);
+    newAval.insert(newAval.end(), task.secondaries.begin(),
+                   task.secondaries.end());
+  }
+}
+
+void AvalancheMC::AddSecondaries(const int type,
+                                 const std::vector<DriftPoint>& drift,
+                                 std::vector<DriftPoint>& points) const {
+  // Skip the last point (and for electrons the last but one).
+  const unsigned int nSkip = type < 0 ? 2 : 1;
+  const unsigned int nPoints = drift.size();
+  // Loop over the drift line.
+  for (unsigned int j = 0; j + nSkip < nPoints; ++j) {
+    const auto& p = drift[j];
+    if (p.ne == 0 && p.nh == 0 && p.ni == 0) continue;
+    // Add the point to the table.
+    AddPoint(drift[j + 1].x, drift[j + 1].t, p.ne, p.nh, p.ni, points);
+  }
+}
+
 int AvalancheMC::GetField(const std::array<double, 3>& x,
                           std::array<double, 3>& e, std::array<double, 3>& b,
                           Medium*& medium) const {
@@ -652,6 +773,69 @@ double AvalancheMC::GetAttachment(const int type, Medium* medium,
   return eta;
 }
 
+bool AvalancheMC::GetTransport(const int type, Medium* medium,
+                               const unsigned int what,
+                               const std::array<double, 3>& x,
+                               const std::array<double, 3>& e,
+                               const std::array<double, 3>& b,
+                               Medium::TransportCoefficients& c) const {
+  if ((m_useTcadVelocity && type < 2) || m_useTcadTrapping) {
+    // Get the coefficients one by one.
+    c = Medium::TransportCoefficients();
+    std::array<double, 3> v;
+    if (!GetVelocity(type, medium, x, e, b, v)) return false;
+    c.vx = v[0];
+    c.vy = v[1];
+    c.vz = v[2];
+    if (what & Medium::TransportCoefficients::Diffusion) {
+      bool ok = false;
+      if (type < 0) {
+        ok = medium->ElectronDiffusion(e[0], e[1], e[2], b[0], b[1], b[2],
+                                       c.dl, c.dt);
+      } else if (type == 1) {
+        ok = medium->HoleDiffusion(e[0], e[1], e[2], b[0], b[1], b[2],
+                                   c.dl, c.dt);
+      } else if (type == 2) {
+        ok = medium->IonDiffusion(e[0], e[1], e[2], b[0], b[1], b[2],
+                                  c.dl, c.dt);
+      }
+      if (!ok) {
+        PrintError("GetTransport", "diffusion", type, x);
+        return false;
+      }
+    }
+    if (what & Medium::TransportCoefficients::Townsend) {
+      if (type < 0) {
+        medium->ElectronTownsend(e[0], e[1], e[2], b[0], b[1], b[2], c.alpha);
+      } else if (type == 1) {
+        medium->HoleTownsend(e[0], e[1], e[2], b[0], b[1], b[2], c.alpha);
+      }
+    }
+    if (what & Medium::TransportCoefficients::Attachment) {
+      c.eta = GetAttachment(type, medium, x, e, b);
+    }
+    return true;
+  }
+  bool ok = false;
+  if (type < 0) {
+    ok = medium->ElectronTransport(e[0], e[1], e[2], b[0], b[1], b[2], c, what);
+  } else if (type == 1) {
+    ok = medium->HoleTransport(e[0], e[1], e[2], b[0], b[1], b[2], c, what);
+  } else if (type == 2) {
+    ok = medium->IonTransport(e[0], e[1], e[2], b[0], b[1], b[2], c, what);
+  }
+  if (!ok) {
+    PrintError("GetTransport", "transport coefficients", type, x);
+    return false;
+  }
+  if (m_debug) {
+    std::cout << m_className << "::GetTransport: Velocity at "
+              << PrintVec(x) << " = (" << c.vx << ", " << c.vy << ", "
+              << c.vz << ")\n";
+  }
+  return true;
+}
+
 void AvalancheMC::StepRKF(const int type, const std::array<double, 3>& x0, 
                           const std::array<double, 3>& v0, const double dt,
                           std::array<double, 3>& xf, std::array<double, 3>& vf,
@@ -703,26 +887,9 @@ void AvalancheMC::StepRKF(const int type, const std::array<double, 3>& x0,
   }
 }
 
-bool AvalancheMC::AddDiffusion(const int type, Medium* medium,
-                               const double step, 
-                               std::array<double, 3>& x,
-                               const std::array<double, 3>& v,
-                               const std::array<double, 3>& e,
-                               const std::array<double, 3>& b) {
-  bool ok = false;
-  double dl = 0., dt = 0.;
-  if (type < 0) {
-    ok = medium->ElectronDiffusion(e[0], e[1], e[2], b[0], b[1], b[2], dl, dt);
-  } else if (type == 1) {
-    ok = medium->HoleDiffusion(e[0], e[1], e[2], b[0], b[1], b[2], dl, dt);
-  } else if (type == 2) {
-    ok = medium->IonDiffusion(e[0], e[1], e[2], b[0], b[1], b[2], dl, dt);
-  }
-  if (!ok) {
-    PrintError("AddDiffusion", "diffusion", type, x);
-    return false;
-  }
-
+void AvalancheMC::AddDiffusion(const double step, const double dl,
+                               const double dt, std::array<double, 3>& x,
+                               const std::array<double, 3>& v) const {
   // Draw a random diffusion direction in the particle frame.
   const std::array<double, 3> d = {step * RndmGaussian(0., dl), 
                                    step * RndmGaussian(0., dt),
@@ -743,7 +910,6 @@ bool AvalancheMC::AddDiffusion(const int type, Medium* medium,
   x[0] += cphi * ctheta * d[0] - sphi * d[1] - cphi * stheta * d[2];
   x[1] += sphi * ctheta * d[0] + cphi * d[1] - sphi * stheta * d[2];
   x[2] +=        stheta * d[0] +                      ctheta * d[2];
-  return true;
 }
 
 void AvalancheMC::Terminate(const std::array<double, 3>& x0, const double t0,
@@ -779,7 +945,8 @@ void AvalancheMC::Terminate(const std::array<double, 3>& x0, const double t0,
 }
 
 bool AvalancheMC::ComputeGainLoss(const int type, 
-    std::vector<DriftPoint>& driftLine, int& status) {
+    std::vector<DriftPoint>& driftLine, int& status,
+    DriftLineResult& result) const {
 
   const unsigned int nPoints = driftLine.size();
   std::vector<double> alps(nPoints, 0.);
@@ -825,11 +992,11 @@ bool AvalancheMC::ComputeGainLoss(const int type,
       if (ne <= 0) {
         status = StatusAttached;
         if (type == -1) {
-          --m_nElectrons;
+          --result.ne;
         } else if (type == 1) {
-          --m_nHoles;
+          --result.nh;
         } else {
-          --m_nIons;
+          --result.ni;
         }
         driftLine.resize(i + 2);
         driftLine[i + 1].x[0] = 0.5 * (driftLine[i].x[0] + driftLine[i + 1].x[0]);
@@ -843,10 +1010,10 @@ bool AvalancheMC::ComputeGainLoss(const int type,
     if (ne > 1) {
       if (type == -1) {
         driftLine[i].ne = ne - 1;
-        m_nElectrons += ne - 1;
+        result.ne += ne - 1;
       } else if (type == 1) {
         driftLine[i].nh = ne - 1;
-        m_nHoles += ne - 1;
+        result.nh += ne - 1;
       } else {
         driftLine[i].ni = ne - 1;
       }
@@ -855,14 +1022,14 @@ bool AvalancheMC::ComputeGainLoss(const int type,
       if (type == -1) {
         if (m_useIons) {
           driftLine[i].ni = ni;
-          m_nIons += ni;
+          result.ni += ni;
         } else {
           driftLine[i].nh = ni;
-          m_nHoles += ni;
+          result.nh += ni;
         }
       } else {
         driftLine[i].ne = ni;
-        m_nElectrons += ni;
+        result.ne += ni;
       }
     }
     // If trapped, exit the loop over the drift line.
@@ -924,20 +1091,19 @@ bool AvalancheMC::ComputeAlphaEta(const int type,
         }
         continue;
       }
-      // Get the drift velocity.
-      std::array<double, 3> v;
-      if (!GetVelocity(type, medium, x, e, b, v)) continue;
-      // Get Townsend and attachment coefficients.
-      double alpha = 0.;
-      if (type < 0) {
-        medium->ElectronTownsend(e[0], e[1], e[2], b[0], b[1], b[2], alpha);
-      } else {
-        medium->HoleTownsend(e[0], e[1], e[2], b[0], b[1], b[2], alpha);
+      // Get the drift velocity, Townsend and attachment coefficients.
+      Medium::TransportCoefficients coeff;
+      if (!GetTransport(type, medium,
+                        Medium::TransportCoefficients::Townsend |
+                            Medium::TransportCoefficients::Attachment,
+                        x, e, b, coeff)) {
+        continue;
       }
-      const double eta = GetAttachment(type, medium, x, e, b);
-      for (unsigned int k = 0; k < 3; ++k) vd[k] += wg[j] * v[k];
-      alps[i] += wg[j] * alpha;
-      etas[i] += wg[j] * eta;
+      vd[0] += wg[j] * coeff.vx;
+      vd[1] += wg[j] * coeff.vy;
+      vd[2] += wg[j] * coeff.vz;
+      alps[i] += wg[j] * coeff.alpha;
+      etas[i] += wg[j] * coeff.eta;
     }
 
     // Compute the scaling factor for the projected length.
@@ -1058,8 +1224,9 @@ bool AvalancheMC::Equilibrate(std::vector<double>& alphas) const {
   return true;
 }
 
-void AvalancheMC::ComputeSignal(
-    const double q, const std::vector<DriftPoint>& driftLine) const {
+void AvalancheMC::ComputeSignal(const double q,
+                                const std::vector<DriftPoint>& driftLine,
+                                Sensor::SignalBuffer* buffer) const {
   const unsigned int nPoints = driftLine.size();
   if (nPoints < 2) return;
   for (unsigned int i = 0; i < nPoints - 1; ++i) {
@@ -1074,16 +1241,27 @@ void AvalancheMC::ComputeSignal(
     const double y = p0.x[1] + 0.5 * dy;
     const double z = p0.x[2] + 0.5 * dz;
     const double s = 1. / dt;
-    m_sensor->AddSignal(q, p0.t, dt, x, y, z, dx * s, dy * s, dz * s);
+    if (buffer) {
+      m_sensor->AddSignal(*buffer, q, p0.t, dt, x, y, z, dx * s, dy * s,
+                          dz * s);
+    } else {
+      m_sensor->AddSignal(q, p0.t, dt, x, y, z, dx * s, dy * s, dz * s);
+    }
   }
 }
 
 void AvalancheMC::ComputeInducedCharge(
-    const double q, const std::vector<DriftPoint>& driftLine) const {
+    const double q, const std::vector<DriftPoint>& driftLine,
+    Sensor::SignalBuffer* buffer) const {
   if (driftLine.size() < 2) return;
   const auto& x0 = driftLine.front().x;
   const auto& x1 = driftLine.back().x;
-  m_sensor->AddInducedCharge(q, x0[0], x0[1], x0[2], x1[0], x1[1], x1[2]);
+  if (buffer) {
+    m_sensor->AddInducedCharge(*buffer, q, x0[0], x0[1], x0[2], x1[0], x1[1],
+                               x1[2]);
+  } else {
+    m_sensor->AddInducedCharge(q, x0[0], x0[1], x0[2], x1[0], x1[1], x1[2]);
+  }
 }
 
 void AvalancheMC::PrintError(const std::string& fcn, const std::string& par,
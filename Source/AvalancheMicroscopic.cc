@@ -1,12 +1,16 @@
 #include <algorithm>
+#include <atomic>
 #include <cmath>
 #include <functional>
 #include <iostream>
+#include <limits>
+#include <map>
 #include <string>
 
 #include "AvalancheMicroscopic.hh"
 #include "FundamentalConstants.hh"
 #include "Random.hh"
+#include "RandomEngineXoshiro.hh"
 
 namespace {
 
@@ -17,6 +21,38 @@ void PrintStatus(const std::string& hdr, const std::string& status,
   std::cout << hdr << eh << status << " at " << x << ", " << y << ", " << z
             << "\n";
 }
+
+/// Lock a mutex (if there is one) for the lifetime of the object.
+class OptionalLock {
+ public:
+  explicit OptionalLock(std::mutex* mutex) : m_mutex(mutex) {
+    if (m_mutex) m_mutex->lock();
+  }
+  ~OptionalLock() {
+    if (m_mutex) m_mutex->unlock();
+  }
+
+ private:
+  std::mutex* m_mutex;
+};
+
+/// Media whose collision tables have been frozen for parallel transport.
+/// The tables are released when the object goes out of scope.
+class FrozenMedia {
+ public:
+  ~FrozenMedia() {
+    for (const auto& m : media) m.first->ReleaseMicroscopicTables();
+  }
+  /// Freeze the tables of a medium, covering at least a given energy.
+  /// If this fails, the medium will be used under a lock.
+  void Freeze(Garfield::Medium* medium, const double emax) {
+    const double e = medium->FreezeMicroscopicTables(emax);
+    if (e < emax) medium->ReleaseMicroscopicTables();
+    media[medium] = e < emax ? -1. : e;
+  }
+
+  std::map<Garfield::Medium*, double> media;
+};
 }
 
 namespace Garfield {
@@ -402,6 +438,7 @@ bool AvalancheMicroscopic::DriftElectron(const double x0, const double y0,
 
   // Reset the particle counters.
   m_nElectrons = m_nHoles = m_nIons = 0;
+  m_nNullCollisions = m_nRealCollisions = 0;
 
   return TransportElectron(x0, y0, z0, t0, e0, dx0, dy0, dz0, false, false);
 }
@@ -418,10 +455,18 @@ bool AvalancheMicroscopic::AvalancheElectron(const double x0, const double y0,
 
   // Reset the particle counters.
   m_nElectrons = m_nHoles = m_nIons = 0;
+  m_nNullCollisions = m_nRealCollisions = 0;
 
   return TransportElectron(x0, y0, z0, t0, e0, dx0, dy0, dz0, true, false);
 }
 
+void AvalancheMicroscopic::EnableParallelTransport(
+    const unsigned int nThreads) {
+  m_pool.reset(new ThreadPool(nThreads));
+  std::cout << m_className << "::EnableParallelTransport: Using "
+            << m_pool->GetNumberOfThreads() << " threads.\n";
+}
+
 bool AvalancheMicroscopic::TransportElectron(const double x0, const double y0,
                                              const double z0, const double t0,
                                              double e0, const double dx0,
@@ -448,38 +493,13 @@ bool AvalancheMicroscopic::TransportElectron(const double x0, const double y0,
   }
 
   // If the medium is a semiconductor, we may use "band structure" stepping.
-  bool useBandStructure =
+  const bool useBandStructure =
       medium->IsSemiconductor() && m_useBandStructureDefault;
   if (m_debug) {
     std::cout << hdr << "Start drifting in medium " << medium->GetName()
               << ".\n";
   }
 
-  // Get the id number of the drift medium.
-  int id = medium->GetId();
-
-  // Numerical prefactors in equation of motion
-  const double c1 = SpeedOfLight * sqrt(2. / ElectronMass);
-  const double c2 = c1 * c1 / 4.;
-
-  // Electric and magnetic field
-  double ex = 0., ey = 0., ez = 0.;
-  double bx = 0., by = 0., bz = 0., bmag = 0.;
-  int status = 0;
-  // Cyclotron frequency
-  double cwt = 1., swt = 0.;
-  double wb = 0.;
-  // Flag indicating if magnetic field is usable
-  bool bOk = true;
-
-  // Direction, velocity and energy after a step
-  double newKx = 0., newKy = 0., newKz = 0.;
-  double newVx = 0., newVy = 0., newVz = 0.;
-  double newEnergy = 0.;
-
-  // Numerical factors
-  double a1 = 0., a2 = 0., a3 = 0., a4 = 0.;
-
   // Make sure the initial energy is positive.
   e0 = std::max(e0, Small);
 
@@ -487,8 +507,6 @@ bool AvalancheMicroscopic::TransportElectron(const double x0, const double y0,
   std::vector<Electron> stackNew;
   stackOld.reserve(10000);
   stackNew.reserve(1000);
-  std::vector<std::pair<double, double> > stackPhotons;
-  std::vector<std::pair<int, double> > secondaries;
 
   // Put the initial electron on the stack.
   if (useBandStructure) {
@@ -522,12 +540,54 @@ bool AvalancheMicroscopic::TransportElectron(const double x0, const double y0,
   }
 
   // Get the null-collision rate.
-  double fLim = medium->GetElectronNullCollisionRate(stackOld.front().band);
+  const double fLim =
+      medium->GetElectronNullCollisionRate(stackOld.front().band);
   if (fLim <= 0.) {
     std::cerr << hdr << "Got null-collision rate <= 0.\n";
     return false;
   }
-  double fInv = 1. / fLim;
+
+  // Set up the transport state.
+  TransportState state;
+  state.medium = medium;
+  state.id = medium->GetId();
+  state.useBandStructure = useBandStructure;
+  state.fLim = fLim;
+  state.fInv = 1. / fLim;
+  state.nullScale = m_nullScale;
+
+  // In parallel mode, each electron/hole is transported with its own
+  // (copy of the) transport state and random number stream.
+  const bool parallel = m_pool && m_pool->GetNumberOfThreads() > 1;
+  std::mutex mutex;
+  FrozenMedia frozen;
+  uint64_t seed = 0;
+  uint64_t generation = 0;
+  std::vector<TransportState> states;
+  if (parallel) {
+    state.mutex = &mutex;
+    state.bufferSignals = m_useSignal;
+    // Derive the seed of the streams from the generator of this thread.
+    seed = static_cast<uint64_t>(RndmUniform() * 9007199254740992.);
+    // Trigger any lazy initialisation (user area, field maps, weighting
+    // fields) before starting the threads.
+    double ex = 0., ey = 0., ez = 0.;
+    int status = 0;
+    m_sensor->ElectricField(x0, y0, z0, ex, ey, ez, medium, status);
+    m_sensor->IsInArea(x0, y0, z0);
+    std::vector<double> currents(m_sensor->GetNumberOfElectrodes(), 0.);
+    if (m_useSignal && !currents.empty()) {
+      m_sensor->ComputeInducedCurrents(1., x0, y0, z0, 0., 0., 0.,
+                                       currents.data());
+    }
+    // Set up the collision tables of the medium, such that they can be
+    // read concurrently. Tables of other media (or for higher energies)
+    // are set up between generations, when requested by the electrons.
+    double emax = 0.;
+    for (const auto& item : stackOld) emax = std::max(emax, item.energy);
+    frozen.Freeze(medium, emax);
+    state.frozen = &frozen.media;
+  }
 
   while (true) {
     // Remove all inactive items from the stack.
@@ -547,595 +607,60 @@ bool AvalancheMicroscopic::TransportElectron(const double x0, const double y0,
     stackNew.clear();
     // If the list of electrons/holes is exhausted, we're done.
     if (stackOld.empty()) break;
-    // Loop over all electrons/holes in the avalanche.
-    for (auto it = stackOld.begin(), end = stackOld.end(); it != end; ++it) {
-      // Get an electron/hole from the stack.
-      double x = (*it).x;
-      double y = (*it).y;
-      double z = (*it).z;
-      double t = (*it).t;
-      double energy = (*it).energy;
-      int band = (*it).band;
-      double kx = (*it).kx;
-      double ky = (*it).ky;
-      double kz = (*it).kz;
-      bool hole = (*it).hole;
-
-      bool ok = true;
-
-      // Count number of collisions between updates.
-      unsigned int nCollTemp = 0;
-
-      // Get the local electric field and medium.
-      m_sensor->ElectricField(x, y, z, ex, ey, ez, medium, status);
-      // Sign change for electrons.
-      if (!hole) {
-        ex = -ex;
-        ey = -ey;
-        ez = -ez;
-      }
-
-      if (m_debug) {
-        const std::string eh = hole ? "hole " : "electron ";
-        std::cout << hdr << "\n    Drifting " << eh << it - stackOld.begin()
-                  << ".\n    Field [V/cm] at (" << x << ", " << y << ", " << z
-                  << "): " << ex << ", " << ey << ", " << ez
-                  << "\n    Status: " << status << "\n";
-        if (medium) std::cout << "    Medium: " << medium->GetName() << "\n";
-      }
-
-      if (status != 0) {
-        // Electron is not inside a drift medium.
-        Update(it, x, y, z, t, energy, kx, ky, kz, band);
-        (*it).status = StatusLeftDriftMedium;
-        AddToEndPoints(*it, hole);
-        if (m_debug) PrintStatus(hdr, "left the drift medium", x, y, z, hole);
-        continue;
-      }
-
-      // If switched on, get the local magnetic field.
-      if (m_useBfield) {
-        m_sensor->MagneticField(x, y, z, bx, by, bz, status);
-        const double scale = hole ? Tesla2Internal : -Tesla2Internal;
-        bx *= scale;
-        by *= scale;
-        bz *= scale;
-        // Make sure that neither E nor B are zero.
-        bmag = sqrt(bx * bx + by * by + bz * bz);
-        const double emag2 = ex * ex + ey * ey + ez * ez;
-        bOk = (bmag > Small && emag2 > Small);
-      }
-
-      // Trace the electron/hole.
-      while (1) {
-        bool isNullCollision = false;
-
-        // Make sure the electron energy exceeds the transport cut.
-        if (energy < m_deltaCut) {
-          Update(it, x, y, z, t, energy, kx, ky, kz, band);
-          (*it).status = StatusBelowTransportCut;
-          AddToEndPoints(*it, hole);
-          if (m_debug) {
-            std::cout << hdr << "Kinetic energy (" << energy
-                      << ") below transport cut.\n";
-          }
-          ok = false;
-          break;
-        }
-
-        // Fill the energy distribution histogram.
-        if (hole && m_histHoleEnergy) {
-          m_histHoleEnergy->Fill(energy);
-        } else if (!hole && m_histElectronEnergy) {
-          m_histElectronEnergy->Fill(energy);
-        }
-
-        // Check if the electrons is within the specified time window.
-        if (m_hasTimeWindow && (t < m_tMin || t > m_tMax)) {
-          Update(it, x, y, z, t, energy, kx, ky, kz, band);
-          (*it).status = StatusOutsideTimeWindow;
-          AddToEndPoints(*it, hole);
-          if (m_debug) PrintStatus(hdr, "left the time window", x, y, z, hole);
-          ok = false;
-          break;
-        }
-
-        if (medium->GetId() != id) {
-          // Medium has changed.
-          if (!medium->IsMicroscopic()) {
-            // Electron/hole has left the microscopic drift medium.
-            Update(it, x, y, z, t, energy, kx, ky, kz, band);
-            (*it).status = StatusLeftDriftMedium;
-            AddToEndPoints(*it, hole);
-            ok = false;
-            if (m_debug) {
-              std::cout << hdr << "\n    Medium at " << x << ", " << y << ", "
-                        << z << " does not have cross-section data.\n";
-            }
-            break;
-          }
-          id = medium->GetId();
-          useBandStructure =
-              (medium->IsSemiconductor() && m_useBandStructureDefault);
-          // Update the null-collision rate.
-          fLim = medium->GetElectronNullCollisionRate(band);
-          if (fLim <= 0.) {
-            std::cerr << hdr << "Got null-collision rate <= 0.\n";
-            return false;
-          }
-          fInv = 1. / fLim;
-        }
-
-        double vx = 0., vy = 0., vz = 0.;
-        if (m_useBfield && bOk) {
-          // Calculate the cyclotron frequency.
-          wb = OmegaCyclotronOverB * bmag;
-          // Rotate the direction vector into the local coordinate system.
-          ComputeRotationMatrix(bx, by, bz, bmag, ex, ey, ez);
-          RotateGlobal2Local(kx, ky, kz);
-          // Calculate the electric field in the rotated system.
-          RotateGlobal2Local(ex, ey, ez);
-          // Calculate the velocity vector in the local frame.
-          const double v = c1 * sqrt(energy);
-          vx = v * kx;
-          vy = v * ky;
-          vz = v * kz;
-          a1 = vx * ex;
-          a2 = c2 * ex * ex;
-          a3 = ez / bmag - vy;
-          a4 = (ez / wb);
-        } else if (useBandStructure) {
-          energy = medium->GetElectronEnergy(kx, ky, kz, vx, vy, vz, band);
-        } else {
-          // No band structure, no magnetic field.
-          // Calculate the velocity vector.
-          const double v = c1 * sqrt(energy);
-          vx = v * kx;
-          vy = v * ky;
-          vz = v * kz;
-
-          a1 = vx * ex + vy * ey + vz * ez;
-          a2 = c2 * (ex * ex + ey * ey + ez * ez);
-        }
-
-        if (m_userHandleStep) {
-          m_userHandleStep(x, y, z, t, energy, kx, ky, kz, hole);
-        }
-
-        // Determine the timestep.
-        double dt = 0.;
-        while (1) {
-          // Sample the flight time.
-          const double r = RndmUniformPos();
-          dt += -log(r) * fInv;
-          // Calculate the energy after the proposed step.
-          if (m_useBfield && bOk) {
-            cwt = cos(wb * dt);
-            swt = sin(wb * dt);
-            newEnergy = std::max(energy + (a1 + a2 * dt) * dt +
-                                     a4 * (a3 * (1. - cwt) + vz * swt),
-                                 Small);
-          } else if (useBandStructure) {
-            const double cdt = dt * SpeedOfLight;
-            newEnergy = std::max(medium->GetElectronEnergy(
-                                     kx + ex * cdt, ky + ey * cdt,
-                                     kz + ez * cdt, newVx, newVy, newVz, band),
-                                 Small);
-          } else {
-            newEnergy = std::max(energy + (a1 + a2 * dt) * dt, Small);
-          }
-          // Get the real collision rate at the updated energy.
-          double fReal = medium->GetElectronCollisionRate(newEnergy, band);
-          if (fReal <= 0.) {
-            std::cerr << hdr << "Got collision rate <= 0 at " << newEnergy
-                      << " eV (band " << band << ").\n";
-            return false;
-          }
-          if (fReal > fLim) {
-            // Real collision rate is higher than null-collision rate.
-            dt += log(r) * fInv;
-            // Increase the null collision rate and try again.
-            std::cerr << hdr << "Increasing null-collision rate by 5%.\n";
-            if (useBandStructure) std::cerr << "    Band " << band << "\n";
-            fLim *= 1.05;
-            fInv = 1. / fLim;
-            continue;
-          }
-          // Check for real or null collision.
-          if (RndmUniform() <= fReal * fInv) break;
-          if (m_useNullCollisionSteps) {
-            isNullCollision = true;
-            break;
-          }
-        }
-        if (!ok) break;
-
-        // Increase the collision counter.
-        ++nCollTemp;
-
-        // Update the directions (at instant before collision)
-        // and calculate the proposed new position.
-        if (m_useBfield && bOk) {
-          // Calculate the new velocity.
-          newVx = vx + 2. * c2 * ex * dt;
-          newVy = vz * swt - a3 * cwt + ez / bmag;
-          newVz = vz * cwt + a3 * swt;
-          // Normalise and rotate back to the lab frame.
-          const double v = sqrt(newVx * newVx + newVy * newVy + newVz * newVz);
-          newKx = newVx / v;
-          newKy = newVy / v;
-          newKz = newVz / v;
-          RotateLocal2Global(newKx, newKy, newKz);
-          // Calculate the step in coordinate space.
-          vx += c2 * ex * dt;
-          ky = (vz * (1. - cwt) - a3 * swt) / (wb * dt) + ez / bmag;
-          kz = (vz * swt + a3 * (1. - cwt)) / (wb * dt);
-          vy = ky;
-          vz = kz;
-          // Rotate back to the lab frame.
-          RotateLocal2Global(vx, vy, vz);
-        } else if (useBandStructure) {
-          // Update the wave-vector.
-          newKx = kx + ex * dt * SpeedOfLight;
-          newKy = ky + ey * dt * SpeedOfLight;
-          newKz = kz + ez * dt * SpeedOfLight;
-          // Average velocity over the step.
-          vx = 0.5 * (vx + newVx);
-          vy = 0.5 * (vy + newVy);
-          vz = 0.5 * (vz + newVz);
-        } else {
-          // Update the direction.
-          a1 = sqrt(energy / newEnergy);
-          a2 = 0.5 * c1 * dt / sqrt(newEnergy);
-          newKx = kx * a1 + ex * a2;
-          newKy = ky * a1 + ey * a2;
-          newKz = kz * a1 + ez * a2;
-
-          // Calculate the step in coordinate space.
-          a1 = c1 * sqrt(energy);
-          a2 = dt * c2;
-          vx = kx * a1 + ex * a2;
-          vy = ky * a1 + ey * a2;
-          vz = kz * a1 + ez * a2;
-        }
-
-        double x1 = x + vx * dt;
-        double y1 = y + vy * dt;
-        double z1 = z + vz * dt;
-        double t1 = t + dt;
-        // Get the electric field and medium at the proposed new position.
-        m_sensor->ElectricField(x1, y1, z1, ex, ey, ez, medium, status);
-        if (!hole) {
-          ex = -ex;
-          ey = -ey;
-          ez = -ez;
-        }
-
-        // Check if the electron is still inside a drift medium/the drift area.
-        if (status != 0 || !m_sensor->IsInArea(x1, y1, z1)) {
-          // Try to terminate the drift line close to the boundary (endpoint
-          // outside the drift medium/drift area) using iterative bisection.
-          Terminate(x, y, z, t, x1, y1, z1, t1);
-          if (m_useSignal) {
-            const int q = hole ? 1 : -1;
-            m_sensor->AddSignal(q, t, t1 - t, 0.5 * (x + x1), 0.5 * (y + y1),
-                                0.5 * (z + z1), vx, vy, vz);
-          }
-          Update(it, x1, y1, z1, t1, energy, newKx, newKy, newKz, band);
-          if (status != 0) {
-            (*it).status = StatusLeftDriftMedium;
-            if (m_debug)
-              PrintStatus(hdr, "left the drift medium", x1, y1, z1, hole);
-          } else {
-            (*it).status = StatusLeftDriftArea;
-            if (m_debug)
-              PrintStatus(hdr, "left the drift area", x1, y1, z1, hole);
-          }
-          AddToEndPoints(*it, hole);
-          ok = false;
-          break;
-        }
-
-        // Check if the electron/hole has crossed a wire.
-        double xc = x, yc = y, zc = z;
-        if (m_sensor->IsWireCrossed(x, y, z, x1, y1, z1, xc, yc, zc)) {
-          // If switched on, calculated the induced signal over this step.
-          if (m_useSignal) {
-            const double dx = xc - x;
-            const double dy = yc - y;
-            const double dz = zc - z;
-            dt = sqrt(dx * dx + dy * dy + dz * dz) /
-                 sqrt(vx * vx + vy * vy + vz * vz);
-            const int q = hole ? 1 : -1;
-            m_sensor->AddSignal(q, t, dt, 0.5 * (x + xc), 0.5 * (y + yc),
-                                0.5 * (z + zc), vx, vy, vz);
-          }
-          Update(it, xc, yc, zc, t + dt, energy, newKx, newKy, newKz, band);
-          (*it).status = StatusLeftDriftMedium;
-          AddToEndPoints(*it, hole);
-          ok = false;
-          if (m_debug) PrintStatus(hdr, "hit a wire", x, y, z, hole);
-          break;
-        }
-
-        // If switched on, calculate the induced signal.
-        if (m_useSignal) {
-          const int q = hole ? 1 : -1;
-          m_sensor->AddSignal(q, t, dt, 0.5 * (x + x1), 0.5 * (y + y1),
-                              0.5 * (z + z1), vx, vy, vz);
-        }
-
-        // Update the coordinates.
-        x = x1;
-        y = y1;
-        z = z1;
-        t = t1;
-
-        // If switched on, get the magnetic field at the new location.
-        if (m_useBfield) {
-          m_sensor->MagneticField(x, y, z, bx, by, bz, status);
-          const double scale = hole ? Tesla2Internal : -Tesla2Internal;
-          bx *= scale;
-          by *= scale;
-          bz *= scale;
-          // Make sure that neither E nor B are zero.
-          bmag = sqrt(bx * bx + by * by + bz * bz);
-          const double emag2 = ex * ex + ey * ey + ez * ez;
-          bOk = (bmag > Small && emag2 > Small);
-        }
-
-        if (isNullCollision) {
-          energy = newEnergy;
-          kx = newKx;
-          ky = newKy;
-          kz = newKz;
-          continue;
-        }
-
-        // Get the collision type and parameters.
-        int cstype = 0;
-        int level = 0;
-        int ndxc = 0;
-        medium->GetElectronCollision(newEnergy, cstype, level, energy, newKx,
-                                     newKy, newKz, secondaries, ndxc, band);
-        // If activated, histogram the distance with respect to the
-        // last collision.
-        if (m_histDistance && !m_distanceHistogramType.empty()) {
-          for (const auto& htype : m_distanceHistogramType) {
-            if (htype != cstype) continue;
-            if (m_debug) {
-              std::cout << m_className << "::TransportElectron: Collision type "
-                        << cstype << ". Fill distance histogram.\n";
-              getchar();
-            }
-            switch (m_distanceOption) {
-              case 'x':
-                m_histDistance->Fill((*it).xLast - x);
-                break;
-              case 'y':
-                m_histDistance->Fill((*it).yLast - y);
-                break;
-              case 'z':
-                m_histDistance->Fill((*it).zLast - z);
-                break;
-              case 'r':
-                const double r2 = pow((*it).xLast - x, 2) +
-                                  pow((*it).yLast - y, 2) +
-                                  pow((*it).zLast - z, 2);
-                m_histDistance->Fill(sqrt(r2));
-                break;
-            }
-            (*it).xLast = x;
-            (*it).yLast = y;
-            (*it).zLast = z;
-            break;
-          }
-        }
-
-        if (m_userHandleCollision) {
-          m_userHandleCollision(x, y, z, t, cstype, level, medium, newEnergy,
-                                energy, kx, ky, kz, newKx, newKy, newKz);
-        }
-        switch (cstype) {
-          // Elastic collision
-          case ElectronCollisionTypeElastic:
-            break;
-          // Ionising collision
-          case ElectronCollisionTypeIonisation:
-            if (m_usePlotting && m_plotIonisations) {
-              m_viewer->AddIonisationMarker(x, y, z);
-            }
-            if (m_userHandleIonisation) {
-              m_userHandleIonisation(x, y, z, t, cstype, level, medium);
-            }
-            for (const auto& secondary : secondaries) {
-              if (secondary.first == IonProdTypeElectron) {
-                const double esec = std::max(secondary.second, Small);
-                if (m_histSecondary) m_histSecondary->Fill(esec);
-                // Increment the electron counter.
-                ++m_nElectrons;
-                if (!aval) continue;
-                // Add the secondary electron to the stack.
-                if (useBandStructure) {
-                  double kxs = 0., kys = 0., kzs = 0.;
-                  int bs = -1;
-                  medium->GetElectronMomentum(esec, kxs, kys, kzs, bs);
-                  AddToStack(x, y, z, t, esec, kxs, kys, kzs, bs, false,
-                             stackNew);
-                } else {
-                  AddToStack(x, y, z, t, esec, false, stackNew);
-                }
-              } else if (secondary.first == IonProdTypeHole) {
-                const double esec = std::max(secondary.second, Small);
-                // Increment the hole counter.
-                ++m_nHoles;
-                if (!aval) continue;
-                // Add the secondary hole to the stack.
-                if (useBandStructure) {
-                  double kxs = 0., kys = 0., kzs = 0.;
-                  int bs = -1;
-                  medium->GetElectronMomentum(esec, kxs, kys, kzs, bs);
-                  AddToStack(x, y, z, t, esec, kxs, kys, kzs, bs, true,
-                             stackNew);
-                } else {
-                  AddToStack(x, y, z, t, esec, true, stackNew);
-                }
-              } else if (secondary.first == IonProdTypeIon) {
-                ++m_nIons;
-              }
-            }
-            secondaries.clear();
-            if (m_debug) PrintStatus(hdr, "ionised", x, y, z, hole);
-            break;
-          // Attachment
-          case ElectronCollisionTypeAttachment:
-            if (m_usePlotting && m_plotAttachments) {
-              m_viewer->AddAttachmentMarker(x, y, z);
-            }
-            if (m_userHandleAttachment) {
-              m_userHandleAttachment(x, y, z, t, cstype, level, medium);
-            }
-            // TODO: check kx or newKx!
-            Update(it, x, y, z, t, energy, newKx, newKy, newKz, band);
-            (*it).status = StatusAttached;
-            if (hole) {
-              m_endpointsHoles.push_back(*it);
-              --m_nHoles;
-            } else {
-              m_endpointsElectrons.push_back(*it);
-              --m_nElectrons;
-            }
-            ok = false;
-            break;
-          // Inelastic collision
-          case ElectronCollisionTypeInelastic:
-            if (m_userHandleInelastic) {
-              m_userHandleInelastic(x, y, z, t, cstype, level, medium);
-            }
-            break;
-          // Excitation
-          case ElectronCollisionTypeExcitation:
-            if (m_usePlotting && m_plotExcitations) {
-              m_viewer->AddExcitationMarker(x, y, z);
-            }
-            if (m_userHandleInelastic) {
-              m_userHandleInelastic(x, y, z, t, cstype, level, medium);
-            }
-            if (ndxc <= 0) break;
-            // Get the electrons/photons produced in the deexcitation cascade.
-            stackPhotons.clear();
-            for (int j = ndxc; j--;) {
-              double tdx = 0., sdx = 0., edx = 0.;
-              int typedx = 0;
-              if (!medium->GetDeexcitationProduct(j, tdx, sdx, typedx, edx)) {
-                std::cerr << hdr << "Cannot retrieve deexcitation product " << j
-                          << "/" << ndxc << ".\n";
-                break;
-              }
-
-              if (typedx == DxcProdTypeElectron) {
-                // Penning ionisation
-                double xp = x, yp = y, zp = z;
-                if (sdx > Small) {
-                  // Randomise the point of creation.
-                  double dxp = 0., dyp = 0., dzp = 0.;
-                  RndmDirection(dxp, dyp, dzp);
-                  xp += sdx * dxp;
-                  yp += sdx * dyp;
-                  zp += sdx * dzp;
-                }
-                // Get the electric field and medium at this location.
-                Medium* med = nullptr;
-                double fx = 0., fy = 0., fz = 0.;
-                m_sensor->ElectricField(xp, yp, zp, fx, fy, fz, med, status);
-                // Check if this location is inside a drift medium/area.
-                if (status != 0 || !m_sensor->IsInArea(xp, yp, zp)) continue;
-                // Increment the electron and ion counters.
-                ++m_nElectrons;
-                ++m_nIons;
-                // Make sure we haven't jumped across a wire.
-                if (m_sensor->IsWireCrossed(x, y, z, xp, yp, zp, xc, yc, zc)) {
-                  continue;
-                }
-                if (!aval) continue;
-                // Add the Penning electron to the list.
-                AddToStack(xp, yp, zp, t + tdx, std::max(edx, Small), false,
-                           stackNew);
-              } else if (typedx == DxcProdTypePhoton && m_usePhotons &&
-                         edx > m_gammaCut) {
-                // Radiative de-excitation
-                stackPhotons.emplace_back(std::make_pair(t + tdx, edx));
-              }
-            }
-
-            // Transport the photons (if any)
-            if (aval) {
-              for (const auto& ph : stackPhotons) {
-                TransportPhoton(x, y, z, ph.first, ph.second, stackNew);
-              }
-            }
-            break;
-          // Super-elastic collision
-          case ElectronCollisionTypeSuperelastic:
-            break;
-          // Virtual/null collision
-          case ElectronCollisionTypeVirtual:
-            break;
-          // Acoustic phonon scattering (intravalley)
-          case ElectronCollisionTypeAcousticPhonon:
-            break;
-          // Optical phonon scattering (intravalley)
-          case ElectronCollisionTypeOpticalPhonon:
-            break;
-          // Intervalley scattering (phonon assisted)
-          case ElectronCollisionTypeIntervalleyG:
-          case ElectronCollisionTypeIntervalleyF:
-          case ElectronCollisionTypeInterbandXL:
-          case ElectronCollisionTypeInterbandXG:
-          case ElectronCollisionTypeInterbandLG:
-            break;
-          // Coulomb scattering
-          case ElectronCollisionTypeImpurity:
-            break;
-          default:
-            std::cerr << hdr << "Unknown collision type.\n";
-            ok = false;
-            break;
-        }
-
-        // Continue with the next electron/hole?
-        if (!ok || nCollTemp > m_nCollSkip ||
-            cstype == ElectronCollisionTypeIonisation ||
-            (m_plotExcitations && cstype == ElectronCollisionTypeExcitation) ||
-            (m_plotAttachments && cstype == ElectronCollisionTypeAttachment)) {
-          break;
+    if (!parallel) {
+      // Loop over all electrons/holes in the avalanche.
+      for (auto& item : stackOld) {
+        if (!TransportItem(item, aval, state)) {
+          Merge(state, stackNew);
+          return false;
         }
-        kx = newKx;
-        ky = newKy;
-        kz = newKz;
       }
-
-      if (!ok) continue;
-
-      if (!useBandStructure) {
-        // Normalise the direction vector.
-        const double k = sqrt(kx * kx + ky * ky + kz * kz);
-        kx /= k;
-        ky /= k;
-        kz /= k;
+      Merge(state, stackNew);
+      continue;
+    }
+    // Distribute the electrons/holes over the threads. Each thread has
+    // its own transport state, which is reset before each electron/hole
+    // such that the results do not depend on the order of the items.
+    const size_t nItems = stackOld.size();
+    state.nullScale = m_nullScale;
+    states.assign(m_pool->GetNumberOfThreads(), state);
+    std::vector<TransportSegment> segments(nItems);
+    std::atomic<bool> ok(true);
+    m_pool->ParallelFor(nItems, [&](const size_t i,
+                                    const unsigned int thread) {
+      TransportState& s = states[thread];
+      s.medium = state.medium;
+      s.id = state.id;
+      s.fLim = state.fLim;
+      s.fInv = state.fInv;
+      s.rot = state.rot;
+      if (s.nullScaleChanged) {
+        s.nullScale = state.nullScale;
+        s.nullScaleChanged = false;
       }
-      // Update the stack.
-      Update(it, x, y, z, t, energy, kx, ky, kz, band);
-      // Add a new point to the drift line (if enabled).
-      if (m_useDriftLines) {
-        point newPoint;
-        newPoint.x = x;
-        newPoint.y = y;
-        newPoint.z = z;
-        newPoint.t = t;
-        (*it).driftLine.push_back(std::move(newPoint));
+      segments[i].thread = thread;
+      segments[i].begin = GetSizes(s);
+      RandomEngineXoshiro engine(seed, generation, i);
+      ScopedThreadRandomEngine scope(engine);
+      if (!TransportItem(stackOld[i], aval, s)) ok = false;
+      segments[i].end = GetSizes(s);
+    });
+    // Collect the results in stack order.
+    for (const auto& segment : segments) {
+      Merge(states[segment.thread], segment, stackNew);
+    }
+    std::map<Medium*, double> requests;
+    for (auto& s : states) {
+      Finish(s);
+      for (const auto& r : s.requests) {
+        requests[r.first] = std::max(requests[r.first], r.second);
       }
     }
+    if (!ok) return false;
+    // Freeze (or extend) the tables needed by the electrons/holes which
+    // have been stopped.
+    for (const auto& r : requests) frozen.Freeze(r.first, r.second);
+    ++generation;
   }
 
   // Calculate the induced charge.
@@ -1186,10 +711,872 @@ bool AvalancheMicroscopic::TransportElectron(const double x0, const double y0,
   return true;
 }
 
+bool AvalancheMicroscopic::TransportItem(Electron& item, const bool aval,
+                                         TransportState& state) {
+  const std::string hdr = m_className + "::TransportElectron: ";
+
+  // Numerical prefactors in equation of motion
+  const double c1 = SpeedOfLight * sqrt(2. / ElectronMass);
+  const double c2 = c1 * c1 / 4.;
+
+  // Electric and magnetic field
+  double ex = 0., ey = 0., ez = 0.;
+  double bx = 0., by = 0., bz = 0., bmag = 0.;
+  int status = 0;
+  // Cyclotron frequency
+  double cwt = 1., swt = 0.;
+  double wb = 0.;
+  // Flag indicating if magnetic field is usable
+  bool bOk = true;
+
+  // Direction, velocity and energy after a step
+  double newKx = 0., newKy = 0., newKz = 0.;
+  double newVx = 0., newVy = 0., newVz = 0.;
+  double newEnergy = 0.;
+
+  // Numerical factors
+  double a1 = 0., a2 = 0., a3 = 0., a4 = 0.;
+
+  std::vector<std::pair<double, double> > stackPhotons;
+
+  // Get an electron/hole from the stack.
+  double x = item.x;
+  double y = item.y;
+  double z = item.z;
+  double t = item.t;
+  double energy = item.energy;
+  int band = item.band;
+  double kx = item.kx;
+  double ky = item.ky;
+  double kz = item.kz;
+  bool hole = item.hole;
+
+  bool ok = true;
+
+  // Count number of collisions between updates.
+  unsigned int nCollTemp = 0;
+  // Stop (and continue in the next generation) after this step?
+  bool stop = false;
+
+  // Get the local electric field and medium.
+  Medium*& medium = state.medium;
+  m_sensor->ElectricField(x, y, z, ex, ey, ez, medium, status);
+  // Sign change for electrons.
+  if (!hole) {
+    ex = -ex;
+    ey = -ey;
+    ez = -ez;
+  }
+
+  if (m_debug) {
+    const std::string eh = hole ? "hole" : "electron";
+    std::cout << hdr << "\n    Drifting " << eh << ".\n    Field [V/cm] at ("
+              << x << ", " << y << ", " << z << "): " << ex << ", " << ey
+              << ", " << ez << "\n    Status: " << status << "\n";
+    if (medium) std::cout << "    Medium: " << medium->GetName() << "\n";
+  }
+
+  if (status != 0) {
+    // Electron is not inside a drift medium.
+    Update(item, x, y, z, t, energy, kx, ky, kz, band);
+    item.status = StatusLeftDriftMedium;
+    AddToEndPoints(item, hole, state);
+    if (m_debug) PrintStatus(hdr, "left the drift medium", x, y, z, hole);
+    return true;
+  }
+
+  // If switched on, get the local magnetic field.
+  if (m_useBfield) {
+    m_sensor->MagneticField(x, y, z, bx, by, bz, status);
+    const double scale = hole ? Tesla2Internal : -Tesla2Internal;
+    bx *= scale;
+    by *= scale;
+    bz *= scale;
+    // Make sure that neither E nor B are zero.
+    bmag = sqrt(bx * bx + by * by + bz * bz);
+    const double emag2 = ex * ex + ey * ey + ez * ez;
+    bOk = (bmag > Small && emag2 > Small);
+  }
+
+  // Trace the electron/hole.
+  while (1) {
+    bool isNullCollision = false;
+
+    // In parallel mode, wait for the next generation if the collision
+    // tables of the medium are not frozen or do not cover the energy.
+    if (state.frozen && medium->IsMicroscopic() &&
+        (stop || !CheckTables(medium, energy, state))) {
+      Update(item, x, y, z, t, energy, kx, ky, kz, band);
+      return true;
+    }
+
+    // Make sure the electron energy exceeds the transport cut.
+    if (energy < m_deltaCut) {
+      Update(item, x, y, z, t, energy, kx, ky, kz, band);
+      item.status = StatusBelowTransportCut;
+      AddToEndPoints(item, hole, state);
+      if (m_debug) {
+        std::cout << hdr << "Kinetic energy (" << energy
+                  << ") below transport cut.\n";
+      }
+      ok = false;
+      break;
+    }
+
+    // Fill the energy distribution histogram.
+    if (hole && m_histHoleEnergy) {
+      OptionalLock lock(state.mutex);
+      m_histHoleEnergy->Fill(energy);
+    } else if (!hole && m_histElectronEnergy) {
+      OptionalLock lock(state.mutex);
+      m_histElectronEnergy->Fill(energy);
+    }
+
+    // Check if the electrons is within the specified time window.
+    if (m_hasTimeWindow && (t < m_tMin || t > m_tMax)) {
+      Update(item, x, y, z, t, energy, kx, ky, kz, band);
+      item.status = StatusOutsideTimeWindow;
+      AddToEndPoints(item, hole, state);
+      if (m_debug) PrintStatus(hdr, "left the time window", x, y, z, hole);
+      ok = false;
+      break;
+    }
+
+    if (medium->GetId() != state.id) {
+      // Medium has changed.
+      if (!medium->IsMicroscopic()) {
+        // Electron/hole has left the microscopic drift medium.
+        Update(item, x, y, z, t, energy, kx, ky, kz, band);
+        item.status = StatusLeftDriftMedium;
+        AddToEndPoints(item, hole, state);
+        ok = false;
+        if (m_debug) {
+          std::cout << hdr << "\n    Medium at " << x << ", " << y << ", " << z
+                    << " does not have cross-section data.\n";
+        }
+        break;
+      }
+      state.id = medium->GetId();
+      state.useBandStructure =
+          (medium->IsSemiconductor() && m_useBandStructureDefault);
+    }
+    const bool useBandStructure = state.useBandStructure;
+
+    double vx = 0., vy = 0., vz = 0.;
+    if (m_useBfield && bOk) {
+      // Calculate the cyclotron frequency.
+      wb = OmegaCyclotronOverB * bmag;
+      // Rotate the direction vector into the local coordinate system.
+      ComputeRotationMatrix(bx, by, bz, bmag, ex, ey, ez, state.rot);
+      RotateGlobal2Local(kx, ky, kz, state.rot);
+      // Calculate the electric field in the rotated system.
+      RotateGlobal2Local(ex, ey, ez, state.rot);
+      // Calculate the velocity vector in the local frame.
+      const double v = c1 * sqrt(energy);
+      vx = v * kx;
+      vy = v * ky;
+      vz = v * kz;
+      a1 = vx * ex;
+      a2 = c2 * ex * ex;
+      a3 = ez / bmag - vy;
+      a4 = (ez / wb);
+    } else if (useBandStructure) {
+      OptionalLock lock(state.mediumMutex);
+      energy = medium->GetElectronEnergy(kx, ky, kz, vx, vy, vz, band);
+    } else {
+      // No band structure, no magnetic field.
+      // Calculate the velocity vector.
+      const double v = c1 * sqrt(energy);
+      vx = v * kx;
+      vy = v * ky;
+      vz = v * kz;
+
+      a1 = vx * ex + vy * ey + vz * ez;
+      a2 = c2 * (ex * ex + ey * ey + ez * ez);
+    }
+
+    if (m_userHandleStep) {
+      OptionalLock lock(state.mutex);
+      m_userHandleStep(x, y, z, t, energy, kx, ky, kz, hole);
+    }
+
+    // Calculate the energy after a given flight time.
+    auto energyAfter = [&](const double tau) {
+      if (m_useBfield && bOk) {
+        cwt = cos(wb * tau);
+        swt = sin(wb * tau);
+        return std::max(energy + (a1 + a2 * tau) * tau +
+                            a4 * (a3 * (1. - cwt) + vz * swt),
+                        Small);
+      } else if (useBandStructure) {
+        const double cdt = tau * SpeedOfLight;
+        OptionalLock lock(state.mediumMutex);
+        return std::max(
+            medium->GetElectronEnergy(kx + ex * cdt, ky + ey * cdt,
+                                      kz + ez * cdt, newVx, newVy, newVz, band),
+            Small);
+      }
+      return std::max(energy + (a1 + a2 * tau) * tau, Small);
+    };
+    // Find the time (between t0 and t1) at which the energy reaches eb.
+    auto crossingTime = [&](const double eb, double t0, double t1) {
+      if (useBandStructure || (m_useBfield && bOk)) {
+        // Bisection.
+        for (unsigned int i = 0; i < 30; ++i) {
+          const double tm = 0.5 * (t0 + t1);
+          if (energyAfter(tm) < eb) {
+            t0 = tm;
+          } else {
+            t1 = tm;
+          }
+        }
+        return t0;
+      }
+      // Positive root of energy + (a1 + a2 * t) * t = eb.
+      const double de = eb - energy;
+      const double root = 2. * de / (a1 + sqrt(a1 * a1 + 4. * a2 * de));
+      return std::min(std::max(root, t0), t1);
+    };
+
+    // Scale a null-collision rate by the correction factor (if any)
+    // of its energy range.
+    const auto scaled = [&](const double f, const double emax) -> double {
+      if (state.nullScale.empty()) return f;
+      const auto it = state.nullScale.find(NullCollisionRange(
+          medium->GetId(), medium->GetRevision(), band, emax));
+      return it == state.nullScale.end() ? f : f * it->second;
+    };
+
+    // Get the null-collision rate for the present energy range.
+    // Without magnetic field, the energy along the path is largest at one
+    // of the end points, so the rate is an upper bound as long as the
+    // energy at the proposed collisions stays below eLim.
+    double eLim = std::numeric_limits<double>::max();
+    {
+      OptionalLock lock(state.mediumMutex);
+      if (m_useBfield && bOk) {
+        state.fLim = medium->GetElectronNullCollisionRate(band);
+      } else {
+        state.fLim = medium->GetElectronNullCollisionRate(energy, band, eLim);
+      }
+    }
+    if (state.fLim <= 0.) {
+      std::cerr << hdr << "Got null-collision rate <= 0.\n";
+      return false;
+    }
+    state.fLim = scaled(state.fLim, eLim);
+    state.fInv = 1. / state.fLim;
+
+    // Determine the timestep.
+    double dt = 0.;
+    while (1) {
+      // Sample the flight time.
+      const double r = RndmUniformPos();
+      dt += -log(r) * state.fInv;
+      // Calculate the energy after the proposed step.
+      newEnergy = energyAfter(dt);
+      if (newEnergy >= eLim && eLim <= state.eMax) {
+        // The electron has left the energy range of the null-collision rate.
+        // Find the time at which it reached eLim and continue from there
+        // with the rate for the energy range of the proposed step.
+        dt = crossingTime(eLim, dt + log(r) * state.fInv, dt);
+        {
+          OptionalLock lock(state.mediumMutex);
+          state.fLim =
+              medium->GetElectronNullCollisionRate(newEnergy, band, eLim);
+        }
+        if (state.fLim <= 0.) {
+          std::cerr << hdr << "Got null-collision rate <= 0.\n";
+          return false;
+        }
+        state.fLim = scaled(state.fLim, eLim);
+        state.fInv = 1. / state.fLim;
+        continue;
+      }
+      if (newEnergy > state.eMax) {
+        // The electron has left the energy range of the frozen tables.
+        // Stop at the time at which it reached eMax (like at a null
+        // collision) and continue once the tables have been extended.
+        state.requests.emplace_back(medium, newEnergy);
+        dt = crossingTime(state.eMax, dt + log(r) * state.fInv, dt);
+        newEnergy = energyAfter(dt);
+        ++state.nNullCollisions;
+        isNullCollision = true;
+        stop = true;
+        break;
+      }
+      // Get the real collision rate at the updated energy.
+      double fReal = 0.;
+      {
+        OptionalLock lock(state.mediumMutex);
+        fReal = medium->GetElectronCollisionRate(newEnergy, band);
+      }
+      if (fReal <= 0.) {
+        std::cerr << hdr << "Got collision rate <= 0 at " << newEnergy
+                  << " eV (band " << band << ").\n";
+        return false;
+      }
+      if (fReal > state.fLim) {
+        // Real collision rate is higher than null-collision rate.
+        dt += log(r) * state.fInv;
+        // Increase the null collision rate (for all subsequent steps in
+        // this energy range) and try again.
+        const NullCollisionRange range(medium->GetId(), medium->GetRevision(),
+                                       band, eLim);
+        double& scale = state.nullScale.emplace(range, 1.).first->second;
+        scale *= 1.05;
+        state.nullScaleChanged = true;
+        state.fLim *= 1.05;
+        state.fInv = 1. / state.fLim;
+        OptionalLock lock(state.mutex);
+        // Drop the factors found with earlier tables of this medium.
+        for (auto it = m_nullScale.begin(); it != m_nullScale.end();) {
+          if (std::get<0>(it->first) == std::get<0>(range) &&
+              std::get<1>(it->first) != std::get<1>(range)) {
+            it = m_nullScale.erase(it);
+          } else {
+            ++it;
+          }
+        }
+        const auto ret = m_nullScale.emplace(range, scale);
+        if (!ret.second) {
+          ret.first->second = std::max(ret.first->second, scale);
+        }
+        if (!ret.second && !m_debug) continue;
+        std::cerr << hdr << "Increasing null-collision rate by 5%";
+        if (eLim < std::numeric_limits<double>::max()) {
+          std::cerr << " below " << eLim << " eV";
+        }
+        std::cerr << ".\n";
+        if (useBandStructure) std::cerr << "    Band " << band << "\n";
+        continue;
+      }
+      // Check for real or null collision.
+      if (RndmUniform() <= fReal * state.fInv) {
+        ++state.nRealCollisions;
+        break;
+      }
+      ++state.nNullCollisions;
+      if (m_useNullCollisionSteps) {
+        isNullCollision = true;
+        break;
+      }
+    }
+    if (!ok) break;
+
+    // Increase the collision counter.
+    ++nCollTemp;
+
+    // Update the directions (at instant before collision)
+    // and calculate the proposed new position.
+    if (m_useBfield && bOk) {
+      // Calculate the new velocity.
+      newVx = vx + 2. * c2 * ex * dt;
+      newVy = vz * swt - a3 * cwt + ez / bmag;
+      newVz = vz * cwt + a3 * swt;
+      // Normalise and rotate back to the lab frame.
+      const double v = sqrt(newVx * newVx + newVy * newVy + newVz * newVz);
+      newKx = newVx / v;
+      newKy = newVy / v;
+      newKz = newVz / v;
+      RotateLocal2Global(newKx, newKy, newKz, state.rot);
+      // Calculate the step in coordinate space.
+      vx += c2 * ex * dt;
+      ky = (vz * (1. - cwt) - a3 * swt) / (wb * dt) + ez / bmag;
+      kz = (vz * swt + a3 * (1. - cwt)) / (wb * dt);
+      vy = ky;
+      vz = kz;
+      // Rotate back to the lab frame.
+      RotateLocal2Global(vx, vy, vz, state.rot);
+    } else if (useBandStructure) {
+      // Update the wave-vector.
+      newKx = kx + ex * dt * SpeedOfLight;
+      newKy = ky + ey * dt * SpeedOfLight;
+      newKz = kz + ez * dt * SpeedOfLight;
+      // Average velocity over the step.
+      vx = 0.5 * (vx + newVx);
+      vy = 0.5 * (vy + newVy);
+      vz = 0.5 * (vz + newVz);
+    } else {
+      // Update the direction.
+      a1 = sqrt(energy / newEnergy);
+      a2 = 0.5 * c1 * dt / sqrt(newEnergy);
+      newKx = kx * a1 + ex * a2;
+      newKy = ky * a1 + ey * a2;
+      newKz = kz * a1 + ez * a2;
+
+      // Calculate the step in coordinate space.
+      a1 = c1 * sqrt(energy);
+      a2 = dt * c2;
+      vx = kx * a1 + ex * a2;
+      vy = ky * a1 + ey * a2;
+      vz = kz * a1 + ez * a2;
+    }
+
+    double x1 = x + vx * dt;
+    double y1 = y + vy * dt;
+    double z1 = z + vz * dt;
+    double t1 = t + dt;
+    // Get the electric field and medium at the proposed new position.
+    m_sensor->ElectricField(x1, y1, z1, ex, ey, ez, medium, status);
+    if (!hole) {
+      ex = -ex;
+      ey = -ey;
+      ez = -ez;
+    }
+
+    // Check if the electron is still inside a drift medium/the drift area.
+    if (status != 0 || !m_sensor->IsInArea(x1, y1, z1)) {
+      // Try to terminate the drift line close to the boundary (endpoint
+      // outside the drift medium/drift area) using iterative bisection.
+      Terminate(x, y, z, t, x1, y1, z1, t1);
+      if (m_useSignal) {
+        const int q = hole ? 1 : -1;
+        AddSignal(state, q, t, t1 - t, 0.5 * (x + x1), 0.5 * (y + y1),
+                  0.5 * (z + z1), vx, vy, vz);
+      }
+      Update(item, x1, y1, z1, t1, energy, newKx, newKy, newKz, band);
+      if (status != 0) {
+        item.status = StatusLeftDriftMedium;
+        if (m_debug)
+          PrintStatus(hdr, "left the drift medium", x1, y1, z1, hole);
+      } else {
+        item.status = StatusLeftDriftArea;
+        if (m_debug) PrintStatus(hdr, "left the drift area", x1, y1, z1, hole);
+      }
+      AddToEndPoints(item, hole, state);
+      ok = false;
+      break;
+    }
+
+    // Check if the electron/hole has crossed a wire.
+    double xc = x, yc = y, zc = z;
+    if (m_sensor->IsWireCrossed(x, y, z, x1, y1, z1, xc, yc, zc)) {
+      // If switched on, calculated the induced signal over this step.
+      if (m_useSignal) {
+        const double dx = xc - x;
+        const double dy = yc - y;
+        const double dz = zc - z;
+        dt = sqrt(dx * dx + dy * dy + dz * dz) /
+             sqrt(vx * vx + vy * vy + vz * vz);
+        const int q = hole ? 1 : -1;
+        AddSignal(state, q, t, dt, 0.5 * (x + xc), 0.5 * (y + yc),
+                  0.5 * (z + zc), vx, vy, vz);
+      }
+      Update(item, xc, yc, zc, t + dt, energy, newKx, newKy, newKz, band);
+      item.status = StatusLeftDriftMedium;
+      AddToEndPoints(item, hole, state);
+      ok = false;
+      if (m_debug) PrintStatus(hdr, "hit a wire", x, y, z, hole);
+      break;
+    }
+
+    // If switched on, calculate the induced signal.
+    if (m_useSignal) {
+      const int q = hole ? 1 : -1;
+      AddSignal(state, q, t, dt, 0.5 * (x + x1), 0.5 * (y + y1),
+                0.5 * (z + z1), vx, vy, vz);
+    }
+
+    // Update the coordinates.
+    x = x1;
+    y = y1;
+    z = z1;
+    t = t1;
+
+    // If switched on, get the magnetic field at the new location.
+    if (m_useBfield) {
+      m_sensor->MagneticField(x, y, z, bx, by, bz, status);
+      const double scale = hole ? Tesla2Internal : -Tesla2Internal;
+      bx *= scale;
+      by *= scale;
+      bz *= scale;
+      // Make sure that neither E nor B are zero.
+      bmag = sqrt(bx * bx + by * by + bz * bz);
+      const double emag2 = ex * ex + ey * ey + ez * ez;
+      bOk = (bmag > Small && emag2 > Small);
+    }
+
+    if (isNullCollision) {
+      energy = newEnergy;
+      kx = newKx;
+      ky = newKy;
+      kz = newKz;
+      continue;
+    }
+
+    // Get the collision type and parameters.
+    int cstype = 0;
+    int level = 0;
+    int ndxc = 0;
+    auto& secondaries = state.secondaries;
+    auto& dxcProducts = state.dxcProducts;
+    dxcProducts.clear();
+    {
+      // Media with frozen tables can sample collisions concurrently
+      // (and keep the deexcitation products of each thread separately).
+      OptionalLock lock(state.mediumMutex);
+      medium->GetElectronCollision(newEnergy, cstype, level, energy, newKx,
+                                   newKy, newKz, secondaries, ndxc, band);
+      // Retrieve the electrons/photons produced in the deexcitation cascade
+      // (if any).
+      for (int j = ndxc; j--;) {
+        DeexcitationProduct dxc;
+        if (!medium->GetDeexcitationProduct(j, dxc.t, dxc.s, dxc.type,
+                                            dxc.energy)) {
+          std::cerr << hdr << "Cannot retrieve deexcitation product " << j
+                    << "/" << ndxc << ".\n";
+          break;
+        }
+        dxcProducts.push_back(std::move(dxc));
+      }
+    }
+    // If activated, histogram the distance with respect to the
+    // last collision.
+    if (m_histDistance && !m_distanceHistogramType.empty()) {
+      for (const auto& htype : m_distanceHistogramType) {
+        if (htype != cstype) continue;
+        if (m_debug) {
+          std::cout << m_className << "::TransportElectron: Collision type "
+                    << cstype << ". Fill distance histogram.\n";
+          getchar();
+        }
+        OptionalLock lock(state.mutex);
+        switch (m_distanceOption) {
+          case 'x':
+            m_histDistance->Fill(item.xLast - x);
+            break;
+          case 'y':
+            m_histDistance->Fill(item.yLast - y);
+            break;
+          case 'z':
+            m_histDistance->Fill(item.zLast - z);
+            break;
+          case 'r':
+            const double r2 = pow(item.xLast - x, 2) + pow(item.yLast - y, 2) +
+                              pow(item.zLast - z, 2);
+            m_histDistance->Fill(sqrt(r2));
+            break;
+        }
+        item.xLast = x;
+        item.yLast = y;
+        item.zLast = z;
+        break;
+      }
+    }
+
+    if (m_userHandleCollision) {
+      OptionalLock lock(state.mutex);
+      m_userHandleCollision(x, y, z, t, cstype, level, medium, newEnergy,
+                            energy, kx, ky, kz, newKx, newKy, newKz);
+    }
+    switch (cstype) {
+      // Elastic collision
+      case ElectronCollisionTypeElastic:
+        break;
+      // Ionising collision
+      case ElectronCollisionTypeIonisation:
+        if (m_usePlotting && m_plotIonisations) {
+          OptionalLock lock(state.mutex);
+          m_viewer->AddIonisationMarker(x, y, z);
+        }
+        if (m_userHandleIonisation) {
+          OptionalLock lock(state.mutex);
+          m_userHandleIonisation(x, y, z, t, cstype, level, medium);
+        }
+        for (const auto& secondary : secondaries) {
+          if (secondary.first == IonProdTypeElectron) {
+            const double esec = std::max(secondary.second, Small);
+            if (m_histSecondary) {
+              OptionalLock lock(state.mutex);
+              m_histSecondary->Fill(esec);
+            }
+            // Increment the electron counter.
+            ++state.nElectrons;
+            if (!aval) continue;
+            // Add the secondary electron to the stack.
+            if (useBandStructure) {
+              double kxs = 0., kys = 0., kzs = 0.;
+              int bs = -1;
+              OptionalLock lock(state.mediumMutex);
+              medium->GetElectronMomentum(esec, kxs, kys, kzs, bs);
+              AddToStack(x, y, z, t, esec, kxs, kys, kzs, bs, false,
+                         state.stack);
+            } else {
+              AddToStack(x, y, z, t, esec, false, state.stack);
+            }
+          } else if (secondary.first == IonProdTypeHole) {
+            const double esec = std::max(secondary.second, Small);
+            // Increment the hole counter.
+            ++state.nHoles;
+            if (!aval) continue;
+            // Add the secondary hole to the stack.
+            if (useBandStructure) {
+              double kxs = 0., kys = 0., kzs = 0.;
+              int bs = -1;
+              OptionalLock lock(state.mediumMutex);
+              medium->GetElectronMomentum(esec, kxs, kys, kzs, bs);
+              AddToStack(x, y, z, t, esec, kxs, kys, kzs, bs, true,
+                         state.stack);
+            } else {
+              AddToStack(x, y, z, t, esec, true, state.stack);
+            }
+          } else if (secondary.first == IonProdTypeIon) {
+            ++state.nIons;
+          }
+        }
+        secondaries.clear();
+        if (m_debug) PrintStatus(hdr, "ionised", x, y, z, hole);
+        break;
+      // Attachment
+      case ElectronCollisionTypeAttachment:
+        if (m_usePlotting && m_plotAttachments) {
+          OptionalLock lock(state.mutex);
+          m_viewer->AddAttachmentMarker(x, y, z);
+        }
+        if (m_userHandleAttachment) {
+          OptionalLock lock(state.mutex);
+          m_userHandleAttachment(x, y, z, t, cstype, level, medium);
+        }
+        // TODO: check kx or newKx!
+        Update(item, x, y, z, t, energy, newKx, newKy, newKz, band);
+        item.status = StatusAttached;
+        if (hole) {
+          state.endpointsHoles.push_back(item);
+          --state.nHoles;
+        } else {
+          state.endpointsElectrons.push_back(item);
+          --state.nElectrons;
+        }
+        ok = false;
+        break;
+      // Inelastic collision
+      case ElectronCollisionTypeInelastic:
+        if (m_userHandleInelastic) {
+          OptionalLock lock(state.mutex);
+          m_userHandleInelastic(x, y, z, t, cstype, level, medium);
+        }
+        break;
+      // Excitation
+      case ElectronCollisionTypeExcitation:
+        if (m_usePlotting && m_plotExcitations) {
+          OptionalLock lock(state.mutex);
+          m_viewer->AddExcitationMarker(x, y, z);
+        }
+        if (m_userHandleInelastic) {
+          OptionalLock lock(state.mutex);
+          m_userHandleInelastic(x, y, z, t, cstype, level, medium);
+        }
+        if (ndxc <= 0) break;
+        // Process the electrons/photons produced in the deexcitation cascade.
+        stackPhotons.clear();
+        for (const auto& dxc : dxcProducts) {
+          if (dxc.type == DxcProdTypeElectron) {
+            // Penning ionisation
+            double xp = x, yp = y, zp = z;
+            if (dxc.s > Small) {
+              // Randomise the point of creation.
+              double dxp = 0., dyp = 0., dzp = 0.;
+              RndmDirection(dxp, dyp, dzp);
+              xp += dxc.s * dxp;
+              yp += dxc.s * dyp;
+              zp += dxc.s * dzp;
+            }
+            // Get the electric field and medium at this location.
+            Medium* med = nullptr;
+            double fx = 0., fy = 0., fz = 0.;
+            m_sensor->ElectricField(xp, yp, zp, fx, fy, fz, med, status);
+            // Check if this location is inside a drift medium/area.
+            if (status != 0 || !m_sensor->IsInArea(xp, yp, zp)) continue;
+            // Increment the electron and ion counters.
+            ++state.nElectrons;
+            ++state.nIons;
+            // Make sure we haven't jumped across a wire.
+            if (m_sensor->IsWireCrossed(x, y, z, xp, yp, zp, xc, yc, zc)) {
+              continue;
+            }
+            if (!aval) continue;
+            // Add the Penning electron to the list.
+            AddToStack(xp, yp, zp, t + dxc.t, std::max(dxc.energy, Small),
+                       false, state.stack);
+          } else if (dxc.type == DxcProdTypePhoton && m_usePhotons &&
+                     dxc.energy > m_gammaCut) {
+            // Radiative de-excitation
+            stackPhotons.emplace_back(std::make_pair(t + dxc.t, dxc.energy));
+          }
+        }
+
+        // Transport the photons (if any)
+        if (aval && !stackPhotons.empty()) {
+          OptionalLock lock(state.mutex);
+          for (const auto& ph : stackPhotons) {
+            TransportPhoton(x, y, z, ph.first, ph.second, state);
+          }
+        }
+        break;
+      // Super-elastic collision
+      case ElectronCollisionTypeSuperelastic:
+        break;
+      // Virtual/null collision
+      case ElectronCollisionTypeVirtual:
+        break;
+      // Acoustic phonon scattering (intravalley)
+      case ElectronCollisionTypeAcousticPhonon:
+        break;
+      // Optical phonon scattering (intravalley)
+      case ElectronCollisionTypeOpticalPhonon:
+        break;
+      // Intervalley scattering (phonon assisted)
+      case ElectronCollisionTypeIntervalleyG:
+      case ElectronCollisionTypeIntervalleyF:
+      case ElectronCollisionTypeInterbandXL:
+      case ElectronCollisionTypeInterbandXG:
+      case ElectronCollisionTypeInterbandLG:
+        break;
+      // Coulomb scattering
+      case ElectronCollisionTypeImpurity:
+        break;
+      default:
+        std::cerr << hdr << "Unknown collision type.\n";
+        ok = false;
+        break;
+    }
+
+    // Continue with the next electron/hole?
+    if (!ok || nCollTemp > m_nCollSkip ||
+        cstype == ElectronCollisionTypeIonisation ||
+        (m_plotExcitations && cstype == ElectronCollisionTypeExcitation) ||
+        (m_plotAttachments && cstype == ElectronCollisionTypeAttachment)) {
+      break;
+    }
+    kx = newKx;
+    ky = newKy;
+    kz = newKz;
+  }
+
+  if (!ok) return true;
+
+  if (!state.useBandStructure) {
+    // Normalise the direction vector.
+    const double k = sqrt(kx * kx + ky * ky + kz * kz);
+    kx /= k;
+    ky /= k;
+    kz /= k;
+  }
+  // Update the stack.
+  Update(item, x, y, z, t, energy, kx, ky, kz, band);
+  // Add a new point to the drift line (if enabled).
+  if (m_useDriftLines) {
+    point newPoint;
+    newPoint.x = x;
+    newPoint.y = y;
+    newPoint.z = z;
+    newPoint.t = t;
+    item.driftLine.push_back(std::move(newPoint));
+  }
+  return true;
+}
+
+bool AvalancheMicroscopic::CheckTables(Medium* medium, const double energy,
+                                       TransportState& state) {
+  if (medium != state.tableMedium) {
+    const auto it = state.frozen->find(medium);
+    if (it == state.frozen->end()) {
+      state.requests.emplace_back(medium, energy);
+      return false;
+    }
+    // Media which cannot be used concurrently are used under the lock.
+    const bool concurrent = it->second >= 0.;
+    state.tableMedium = medium;
+    state.eMax = concurrent ? it->second : std::numeric_limits<double>::max();
+    state.mediumMutex = concurrent ? nullptr : state.mutex;
+  }
+  if (energy <= state.eMax) return true;
+  state.requests.emplace_back(medium, energy);
+  return false;
+}
+
+std::array<size_t, 5> AvalancheMicroscopic::GetSizes(
+    const TransportState& state) {
+  return {{state.stack.size(), state.endpointsElectrons.size(),
+           state.endpointsHoles.size(), state.photons.size(),
+           state.signals.size()}};
+}
+
+void AvalancheMicroscopic::Merge(TransportState& state,
+                                 const TransportSegment& segment,
+                                 std::vector<Electron>& stack) {
+  const auto& b = segment.begin;
+  const auto& e = segment.end;
+  stack.insert(stack.end(),
+               std::make_move_iterator(state.stack.begin() + b[0]),
+               std::make_move_iterator(state.stack.begin() + e[0]));
+  m_endpointsElectrons.insert(
+      m_endpointsElectrons.end(),
+      std::make_move_iterator(state.endpointsElectrons.begin() + b[1]),
+      std::make_move_iterator(state.endpointsElectrons.begin() + e[1]));
+  m_endpointsHoles.insert(
+      m_endpointsHoles.end(),
+      std::make_move_iterator(state.endpointsHoles.begin() + b[2]),
+      std::make_move_iterator(state.endpointsHoles.begin() + e[2]));
+  m_photons.insert(m_photons.end(), state.photons.begin() + b[3],
+                   state.photons.begin() + e[3]);
+  // Add the buffered signals.
+  const size_t nEntries = m_sensor->GetNumberOfElectrodes() + 3;
+  for (size_t k = b[4]; k + nEntries <= e[4]; k += nEntries) {
+    const double* entry = &state.signals[k];
+    m_sensor->AddSignal(entry[0], entry[1], entry[2], entry + 3);
+  }
+}
+
+void AvalancheMicroscopic::Merge(TransportState& state,
+                                 std::vector<Electron>& stack) {
+  TransportSegment segment;
+  segment.begin.fill(0);
+  segment.end = GetSizes(state);
+  Merge(state, segment, stack);
+  Finish(state);
+}
+
+void AvalancheMicroscopic::Finish(TransportState& state) {
+  state.stack.clear();
+  state.endpointsElectrons.clear();
+  state.endpointsHoles.clear();
+  state.photons.clear();
+  state.signals.clear();
+  m_nElectrons += state.nElectrons;
+  m_nHoles += state.nHoles;
+  m_nIons += state.nIons;
+  state.nElectrons = state.nHoles = state.nIons = 0;
+  m_nNullCollisions += state.nNullCollisions;
+  m_nRealCollisions += state.nRealCollisions;
+  state.nNullCollisions = state.nRealCollisions = 0;
+}
+
+void AvalancheMicroscopic::AddSignal(TransportState& state, const double q,
+                                     const double t, const double dt,
+                                     const double x, const double y,
+                                     const double z, const double vx,
+                                     const double vy, const double vz) const {
+  if (!state.bufferSignals) {
+    m_sensor->AddSignal(q, t, dt, x, y, z, vx, vy, vz);
+    return;
+  }
+  const size_t nElectrodes = m_sensor->GetNumberOfElectrodes();
+  if (nElectrodes == 0) return;
+  const size_t k = state.signals.size();
+  state.signals.resize(k + 3 + nElectrodes);
+  state.signals[k] = q;
+  state.signals[k + 1] = t;
+  state.signals[k + 2] = dt;
+  m_sensor->ComputeInducedCurrents(q, x, y, z, vx, vy, vz,
+                                   &state.signals[k + 3]);
+}
+
 void AvalancheMicroscopic::TransportPhoton(const double x0, const double y0,
                                            const double z0, const double t0,
                                            const double e0,
-                                           std::vector<Electron>& stack) {
+                                           TransportState& state) {
   // Make sure that the sensor is defined.
   if (!m_sensor) {
     std::cerr << m_className << "::TransportPhoton: Sensor is not defined.\n";
@@ -1276,7 +1663,7 @@ void AvalancheMicroscopic::TransportPhoton(const double x0, const double y0,
     newPhoton.z1 = z;
     newPhoton.energy = e0;
     newPhoton.status = StatusLeftDriftMedium;
-    m_photons.push_back(std::move(newPhoton));
+    state.photons.push_back(std::move(newPhoton));
     return;
   }
 
@@ -1290,12 +1677,12 @@ void AvalancheMicroscopic::TransportPhoton(const double x0, const double y0,
 
   if (type == PhotonCollisionTypeIonisation) {
     // Add the secondary electron (random direction) to the stack.
-    if (m_sizeCut == 0 || stack.size() < m_sizeCut) {
-      AddToStack(x, y, z, t, std::max(esec, Small), false, stack);
+    if (m_sizeCut == 0 || state.stack.size() < m_sizeCut) {
+      AddToStack(x, y, z, t, std::max(esec, Small), false, state.stack);
     }
     // Increment the electron and ion counters.
-    ++m_nElectrons;
-    ++m_nIons;
+    ++state.nElectrons;
+    ++state.nIons;
   } else if (type == PhotonCollisionTypeExcitation) {
     double tdx = 0.;
     double sdx = 0.;
@@ -1306,10 +1693,11 @@ void AvalancheMicroscopic::TransportPhoton(const double x0, const double y0,
       if (!medium->GetDeexcitationProduct(j, tdx, sdx, typedx, esec)) continue;
       if (typedx == DxcProdTypeElectron) {
         // Ionisation.
-        AddToStack(x, y, z, t + tdx, std::max(esec, Small), false, stack);
+        AddToStack(x, y, z, t + tdx, std::max(esec, Small), false,
+                   state.stack);
         // Increment the electron and ion counters.
-        ++m_nElectrons;
-        ++m_nIons;
+        ++state.nElectrons;
+        ++state.nIons;
       } else if (typedx == DxcProdTypePhoton && m_usePhotons &&
                  esec > m_gammaCut) {
         // Radiative de-excitation
@@ -1320,7 +1708,7 @@ void AvalancheMicroscopic::TransportPhoton(const double x0, const double y0,
     // Transport the photons (if any).
     const int nSizePhotons = tPhotons.size();
     for (int k = nSizePhotons; k--;) {
-      TransportPhoton(x, y, z, tPhotons[k], ePhotons[k], stack);
+      TransportPhoton(x, y, z, tPhotons[k], ePhotons[k], state);
     }
   }
 
@@ -1333,12 +1721,12 @@ void AvalancheMicroscopic::TransportPhoton(const double x0, const double y0,
   newPhoton.z1 = z;
   newPhoton.energy = e0;
   newPhoton.status = -2;
-  m_photons.push_back(std::move(newPhoton));
+  state.photons.push_back(std::move(newPhoton));
 }
 
 void AvalancheMicroscopic::ComputeRotationMatrix(
     const double bx, const double by, const double bz, const double bmag,
-    const double ex, const double ey, const double ez) {
+    const double ex, const double ey, const double ez, RotationMatrix& rot) {
   // Adopting the Magboltz convention, the stepping is performed
   // in a coordinate system with the B field along the x axis
   // and the electric field at an angle btheta in the x-z plane.
@@ -1347,71 +1735,72 @@ void AvalancheMicroscopic::ComputeRotationMatrix(
   const double bt = by * by + bz * bz;
   if (bt < Small) {
     // B field is already along axis.
-    m_rb11 = m_rb22 = m_rb33 = 1.;
-    m_rb12 = m_rb13 = m_rb21 = m_rb23 = m_rb31 = m_rb32 = 0.;
+    rot.rb11 = rot.rb22 = rot.rb33 = 1.;
+    rot.rb12 = rot.rb13 = rot.rb21 = rot.rb23 = rot.rb31 = rot.rb32 = 0.;
   } else {
     const double btInv = 1. / bt;
-    m_rb11 = bx / bmag;
-    m_rb12 = by / bmag;
-    m_rb21 = -m_rb12;
-    m_rb13 = bz / bmag;
-    m_rb31 = -m_rb13;
-    m_rb22 = (m_rb11 * by * by + bz * bz) * btInv;
-    m_rb33 = (m_rb11 * bz * bz + by * by) * btInv;
-    m_rb23 = m_rb32 = (m_rb11 - 1.) * by * bz * btInv;
+    rot.rb11 = bx / bmag;
+    rot.rb12 = by / bmag;
+    rot.rb21 = -rot.rb12;
+    rot.rb13 = bz / bmag;
+    rot.rb31 = -rot.rb13;
+    rot.rb22 = (rot.rb11 * by * by + bz * bz) * btInv;
+    rot.rb33 = (rot.rb11 * bz * bz + by * by) * btInv;
+    rot.rb23 = rot.rb32 = (rot.rb11 - 1.) * by * bz * btInv;
   }
   // Calculate the second rotation matrix (rotation around x axis).
-  const double fy = m_rb21 * ex + m_rb22 * ey + m_rb23 * ez;
-  const double fz = m_rb31 * ex + m_rb32 * ey + m_rb33 * ez;
+  const double fy = rot.rb21 * ex + rot.rb22 * ey + rot.rb23 * ez;
+  const double fz = rot.rb31 * ex + rot.rb32 * ey + rot.rb33 * ez;
   const double ft = sqrt(fy * fy + fz * fz);
   if (ft < Small) {
     // E and B field are parallel.
-    m_rx22 = m_rx33 = 1.;
-    m_rx23 = m_rx32 = 0.;
+    rot.rx22 = rot.rx33 = 1.;
+    rot.rx23 = rot.rx32 = 0.;
   } else {
-    m_rx22 = m_rx33 = fz / ft;
-    m_rx23 = -fy / ft;
-    m_rx32 = -m_rx23;
+    rot.rx22 = rot.rx33 = fz / ft;
+    rot.rx23 = -fy / ft;
+    rot.rx32 = -rot.rx23;
   }
 }
 
 void AvalancheMicroscopic::RotateGlobal2Local(double& dx, double& dy,
-                                              double& dz) const {
-  const double dx1 = m_rb11 * dx + m_rb12 * dy + m_rb13 * dz;
-  const double dy1 = m_rb21 * dx + m_rb22 * dy + m_rb23 * dz;
-  const double dz1 = m_rb31 * dx + m_rb32 * dy + m_rb33 * dz;
+                                              double& dz,
+                                              const RotationMatrix& rot) {
+  const double dx1 = rot.rb11 * dx + rot.rb12 * dy + rot.rb13 * dz;
+  const double dy1 = rot.rb21 * dx + rot.rb22 * dy + rot.rb23 * dz;
+  const double dz1 = rot.rb31 * dx + rot.rb32 * dy + rot.rb33 * dz;
 
   dx = dx1;
-  dy = m_rx22 * dy1 + m_rx23 * dz1;
-  dz = m_rx32 * dy1 + m_rx33 * dz1;
+  dy = rot.rx22 * dy1 + rot.rx23 * dz1;
+  dz = rot.rx32 * dy1 + rot.rx33 * dz1;
 }
 
 void AvalancheMicroscopic::RotateLocal2Global(double& dx, double& dy,
-                                              double& dz) const {
+                                              double& dz,
+                                              const RotationMatrix& rot) {
   const double dx1 = dx;
-  const double dy1 = m_rx22 * dy + m_rx32 * dz;
-  const double dz1 = m_rx23 * dy + m_rx33 * dz;
+  const double dy1 = rot.rx22 * dy + rot.rx32 * dz;
+  const double dz1 = rot.rx23 * dy + rot.rx33 * dz;
 
-  dx = m_rb11 * dx1 + m_rb21 * dy1 + m_rb31 * dz1;
-  dy = m_rb12 * dx1 + m_rb22 * dy1 + m_rb32 * dz1;
-  dz = m_rb13 * dx1 + m_rb23 * dy1 + m_rb33 * dz1;
+  dx = rot.rb11 * dx1 + rot.rb21 * dy1 + rot.rb31 * dz1;
+  dy = rot.rb12 * dx1 + rot.rb22 * dy1 + rot.rb32 * dz1;
+  dz = rot.rb13 * dx1 + rot.rb23 * dy1 + rot.rb33 * dz1;
 }
 
-void AvalancheMicroscopic::Update(std::vector<Electron>::iterator it,
-                                  const double x, const double y,
-                                  const double z, const double t,
-                                  const double energy, const double kx,
-                                  const double ky, const double kz,
-                                  const int band) {
-  (*it).x = x;
-  (*it).y = y;
-  (*it).z = z;
-  (*it).t = t;
-  (*it).energy = energy;
-  (*it).kx = kx;
-  (*it).ky = ky;
-  (*it).kz = kz;
-  (*it).band = band;
+void AvalancheMicroscopic::Update(Electron& item, const double x,
+                                  const double y, const double z,
+                                  const double t, const double energy,
+                                  const double kx, const double ky,
+                                  const double kz, const int band) {
+  item.x = x;
+  item.y = y;
+  item.z = z;
+  item.t = t;
+  item.energy = energy;
+  item.kx = kx;
+  item.ky = ky;
+  item.kz = kz;
+  item.band = band;
 }
 
 void AvalancheMicroscopic::AddToStack(const double x, const double y,
@@ -7,6 +7,63 @@
 #include "GarfieldConstants.hh"
 #include "Numerics.hh"
 
+namespace {
+
+// Number of wires processed together in the vectorisable field kernels.
+constexpr unsigned int WireBlock = 64;
+
+// Real and imaginary part of 1 / (sin(a + iy) sin(b + iy)) and the ratio
+// |sin(a + iy)|^2 / |sin(b + iy)|^2, given sin and cos of a and b.
+inline void InvSinProduct(const double sa, const double ca, const double sb,
+                          const double cb, const double y, double& fr,
+                          double& fi, double& ratio) {
+  // sin(x + iy) = sin x cosh y + i cos x sinh y.
+  const double sh = sinh(y);
+  const double sh2 = sh * sh;
+  const double ch2 = 1. + sh2;
+  const double da = sh2 + sa * sa;
+  const double db = sh2 + sb * sb;
+  const double f = 1. / (da * db);
+  fr = (sa * sb * ch2 - ca * cb * sh2) * f;
+  fi = -sh * sqrt(ch2) * (sa * cb + ca * sb) * f;
+  ratio = da / db;
+}
+
+// Term zterm2 / zterm1 of the C-type cells (see FieldC2X) for
+// zeta = zr + i zi, in real arithmetic, and the squared modulus of zterm1.
+inline void TermC(const double zr, const double zi, const double p1,
+                  const double p2, double& wr, double& wi, double& n1) {
+  const double s = sin(zr);
+  const double c = cos(zr);
+  const double sh = sinh(zi);
+  const double ch = sqrt(1. + sh * sh);
+  // sin(zeta), cos(zeta) and zcof = 4 sin^2(zeta) - 2.
+  const double sr = s * ch, si = c * sh;
+  const double cr = c * ch, ci = -s * sh;
+  const double fr = 4. * (sr * sr - si * si) - 2.;
+  const double fi = 8. * sr * si;
+  // zterm1 = (zunew + zu) sin(zeta).
+  double ur = -p1 - fr * p2;
+  double ui = -fi * p2;
+  double nr = 1. - p2 - (fr * ur - fi * ui);
+  double ni = -(fr * ui + fi * ur);
+  const double ar = nr + ur, ai = ni + ui;
+  const double t1r = ar * sr - ai * si;
+  const double t1i = ar * si + ai * sr;
+  // zterm2 = (zunew - zu) cos(zeta).
+  ur = -3. * p1 - 5. * p2 * fr;
+  ui = -5. * p2 * fi;
+  nr = 1. - 5. * p2 - (fr * ur - fi * ui);
+  ni = -(fr * ui + fi * ur);
+  const double br = nr - ur, bi = ni - ui;
+  const double t2r = br * cr - bi * ci;
+  const double t2i = br * ci + bi * cr;
+  n1 = t1r * t1r + t1i * t1i;
+  wr = (t2r * t1r + t2i * t1i) / n1;
+  wi = (t2i * t1r - t2r * t1i) / n1;
+}
+}
+
 namespace Garfield {
 
 ComponentAnalyticField::ComponentAnalyticField() : ComponentBase() {
@@ -17,7 +74,7 @@ ComponentAnalyticField::ComponentAnalyticField() : ComponentBase() {
 bool ComponentAnalyticField::GetVoltageRange(double& pmin, double& pmax) {
   // Make sure the cell is prepared.
   if (!m_cellset) {
-    if (!Prepare()) {
+    if (!PrepareOnce()) {
       std::cerr << m_className << "::GetVoltageRange:\n    Unable to return "
                 << "voltage range (could not set up the cell).\n";
       return false;
@@ -611,6 +668,20 @@ void ComponentAnalyticField::AddCharge(const double x, const double y,
   m_ch3d.push_back(std::move(charge));
 }
 
+bool ComponentAnalyticField::GetCharge(const unsigned int i, double& x,
+                                       double& y, double& z,
+                                       double& q) const {
+  if (i >= m_ch3d.size()) {
+    std::cerr << m_className << "::GetCharge: Index out of range.\n";
+    return false;
+  }
+  x = m_ch3d[i].x;
+  y = m_ch3d[i].y;
+  z = m_ch3d[i].z;
+  q = m_ch3d[i].e * FourPiEpsilon0;
+  return true;
+}
+
 void ComponentAnalyticField::ClearCharges() {
   m_ch3d.clear();
   m_nTermBessel = 10;
@@ -707,6 +778,69 @@ bool ComponentAnalyticField::GetTube(double& r, double& voltage, int& nEdges,
   return true;
 }
 
+void ComponentAnalyticField::ElectricFieldBatch(
+    const size_t n, const double* x, const double* y, const double* z,
+    double* ex, double* ey, double* ez, double* v, Medium** m, int* status) {
+  // Make sure the charges have been calculated (once for the whole batch).
+  if (!PrepareOnce()) {
+    for (size_t i = 0; i < n; ++i) {
+      ex[i] = ey[i] = ez[i] = 0.;
+      if (v) v[i] = 0.;
+      m[i] = nullptr;
+      status[i] = -11;
+    }
+    return;
+  }
+  // Cells with periodicities or special potentials are done point by point.
+  if (m_cellType != A00 || n < 2) {
+    ComponentBase::ElectricFieldBatch(n, x, y, z, ex, ey, ez, v, m, status);
+    return;
+  }
+  const bool opt = v != nullptr;
+  // Collect the points outside planes and wires.
+  std::vector<size_t> index;
+  index.reserve(n);
+  for (size_t i = 0; i < n; ++i) {
+    ex[i] = ey[i] = ez[i] = 0.;
+    m[i] = nullptr;
+    double volt = 0.;
+    status[i] = Locate(x[i], y[i], volt);
+    if (opt) v[i] = volt;
+    if (status[i] == 0) index.push_back(i);
+  }
+  const size_t nPoints = index.size();
+  std::vector<double> px(nPoints), py(nPoints);
+  std::vector<double> fx(nPoints, 0.), fy(nPoints, 0.), fv(nPoints, m_v0);
+  for (size_t k = 0; k < nPoints; ++k) {
+    px[k] = x[index[k]];
+    py[k] = y[index[k]];
+  }
+  FieldA00(nPoints, px.data(), py.data(), fx.data(), fy.data(), fv.data(),
+           opt);
+  for (size_t k = 0; k < nPoints; ++k) {
+    const size_t i = index[k];
+    // Correct for the equipotential planes.
+    ex[i] = fx[k] - m_corvta;
+    ey[i] = fy[k] - m_corvtb;
+    if (opt) v[i] = fv[k] + m_corvta * px[k] + m_corvtb * py[k] + m_corvtc;
+    // Add three dimensional point charges.
+    if (!m_ch3d.empty()) {
+      double ex3d = 0., ey3d = 0., ez3d = 0., volt3d = 0.;
+      Field3dA00(x[i], y[i], z[i], ex3d, ey3d, ez3d, volt3d);
+      ex[i] += ex3d;
+      ey[i] += ey3d;
+      ez[i] += ez3d;
+      if (opt) v[i] += volt3d;
+    }
+    m[i] = GetMedium(x[i], y[i], z[i]);
+    if (!m[i]) {
+      status[i] = -6;
+    } else if (!m[i]->IsDriftable()) {
+      status[i] = -5;
+    }
+  }
+}
+
 int ComponentAnalyticField::Field(const double xin, const double yin,
                                   const double zin, double& ex, double& ey,
                                   double& ez, double& volt, const bool opt) {
@@ -732,9 +866,7 @@ int ComponentAnalyticField::Field(const double xin, const double yin,
   ex = ey = ez = volt = 0.;
 
   // Make sure the charges have been calculated.
-  if (!m_cellset) {
-    if (!Prepare()) return -11;
-  }
+  if (!PrepareOnce()) return -11;
 
   double xpos = xin, ypos = yin;
 
@@ -758,44 +890,9 @@ int ComponentAnalyticField::Field(const double xin, const double yin,
   if (m_pery && m_ynplan[2] && ypos <= m_coplan[2]) ypos += m_sy;
   if (m_pery && m_ynplan[3] && ypos >= m_coplan[3]) ypos -= m_sy;
 
-  // In case (XPOS,YPOS) is located behind a plane there is no field.
-  if (m_tube) {
-    if (!InTube(xpos, ypos, m_cotube, m_ntube)) {
-      volt = m_vttube;
-      return -4;
-    }
-  } else {
-    if (m_ynplan[0] && xpos < m_coplan[0]) {
-      volt = m_vtplan[0];
-      return -4;
-    }
-    if (m_ynplan[1] && xpos > m_coplan[1]) {
-      volt = m_vtplan[1];
-      return -4;
-    }
-    if (m_ynplan[2] && ypos < m_coplan[2]) {
-      volt = m_vtplan[2];
-      return -4;
-    }
-    if (m_ynplan[3] && ypos > m_coplan[3]) {
-      volt = m_vtplan[3];
-      return -4;
-    }
-  }
-
-  // If (xpos, ypos) is within a wire, there is no field either.
-  for (int i = m_nWires; i--;) {
-    double dx = xpos - m_w[i].x;
-    double dy = ypos - m_w[i].y;
-    // Correct for periodicities.
-    if (m_perx) dx -= m_sx * int(round(dx / m_sx));
-    if (m_pery) dy -= m_sy * int(round(dy / m_sy));
-    // Check the actual position.
-    if (dx * dx + dy * dy < 0.25 * m_w[i].d * m_w[i].d) {
-      volt = m_w[i].v;
-      return i + 1;
-    }
-  }
+  // There is no field behind a plane or inside a wire.
+  const int location = Locate(xpos, ypos, volt);
+  if (location != 0) return location;
 
   // Call the appropriate potential calculation function.
   switch (m_cellType) {
@@ -914,6 +1011,49 @@ int ComponentAnalyticField::Field(const double xin, const double yin,
   return 0;
 }
 
+int ComponentAnalyticField::Locate(const double xpos, const double ypos,
+                                   double& volt) const {
+  // In case (XPOS,YPOS) is located behind a plane there is no field.
+  if (m_tube) {
+    if (!InTube(xpos, ypos, m_cotube, m_ntube)) {
+      volt = m_vttube;
+      return -4;
+    }
+  } else {
+    if (m_ynplan[0] && xpos < m_coplan[0]) {
+      volt = m_vtplan[0];
+      return -4;
+    }
+    if (m_ynplan[1] && xpos > m_coplan[1]) {
+      volt = m_vtplan[1];
+      return -4;
+    }
+    if (m_ynplan[2] && ypos < m_coplan[2]) {
+      volt = m_vtplan[2];
+      return -4;
+    }
+    if (m_ynplan[3] && ypos > m_coplan[3]) {
+      volt = m_vtplan[3];
+      return -4;
+    }
+  }
+
+  // If (xpos, ypos) is within a wire, there is no field either.
+  for (int i = m_nWires; i--;) {
+    double dx = xpos - m_w[i].x;
+    double dy = ypos - m_w[i].y;
+    // Correct for periodicities.
+    if (m_perx) dx -= m_sx * int(round(dx / m_sx));
+    if (m_pery) dy -= m_sy * int(round(dy / m_sy));
+    // Check the actual position.
+    if (dx * dx + dy * dy < 0.25 * m_w[i].d * m_w[i].d) {
+      volt = m_w[i].v;
+      return i + 1;
+    }
+  }
+  return 0;
+}
+
 void ComponentAnalyticField::CellInit() {
   m_cellset = false;
   m_sigset = false;
@@ -951,6 +1091,9 @@ void ComponentAnalyticField::CellInit() {
   // Wires.
   m_nWires = 0;
   m_w.clear();
+  m_wx.clear();
+  m_wy.clear();
+  m_we.clear();
 
   // Force calculation parameters
   weight.clear();
@@ -1017,6 +1160,19 @@ void ComponentAnalyticField::CellInit() {
   down[2] = 1.;
 }
 
+bool ComponentAnalyticField::PrepareOnce() {
+  if (m_cellset) return true;
+  std::lock_guard<std::mutex> lock(m_prepareMutex);
+  return m_cellset || Prepare();
+}
+
+bool ComponentAnalyticField::PrepareSignalsOnce() {
+  // PrepareSignals sets up the cell as well (under the same lock).
+  if (m_sigset) return true;
+  std::lock_guard<std::mutex> lock(m_prepareMutex);
+  return m_sigset || PrepareSignals();
+}
+
 bool ComponentAnalyticField::Prepare() {
   // Check that the cell makes sense.
   if (!CellCheck()) {
@@ -1055,6 +1211,17 @@ bool ComponentAnalyticField::Prepare() {
     return false;
   }
 
+  // Copy the wire coordinates and charges for the field kernels.
+  const unsigned int nWires = m_w.size();
+  m_wx.resize(nWires);
+  m_wy.resize(nWires);
+  m_we.resize(nWires);
+  for (unsigned int i = 0; i < nWires; ++i) {
+    m_wx[i] = m_w[i].x;
+    m_wy[i] = m_w[i].y;
+    m_we[i] = m_w[i].e;
+  }
+
   m_cellset = true;
   return true;
 }
@@ -3025,42 +3192,147 @@ void ComponentAnalyticField::FieldA00(const double xpos, const double ypos,
   ex = ey = 0.;
   volt = m_v0;
 
-  double xxmirr = 0., yymirr = 0.;
-  // Loop over all wires.
-  for (const auto& wire : m_w) {
-    const double xx = xpos - wire.x;
-    const double yy = ypos - wire.y;
-    double r2 = xx * xx + yy * yy;
+  // The wires are processed in blocks. Each term is computed in a separate,
+  // branch-free loop over contiguous arrays, which the compiler can
+  // vectorise; the logarithms for the potential are taken at the end.
+  const double* wx = m_wx.data();
+  const double* wy = m_wy.data();
+  const double* we = m_we.data();
+  const unsigned int nWires = m_wx.size();
+  const double x2 = xpos - 2. * m_coplax;
+  const double y2 = ypos - 2. * m_coplay;
+  double fx[WireBlock], fy[WireBlock], r2[WireBlock];
+  for (unsigned int i0 = 0; i0 < nWires; i0 += WireBlock) {
+    const unsigned int n = std::min(WireBlock, nWires - i0);
+    const double* bx = wx + i0;
+    const double* by = wy + i0;
     // Calculate the field in case there are no planes.
-    double exhelp = xx / r2;
-    double eyhelp = yy / r2;
+    for (unsigned int j = 0; j < n; ++j) {
+      const double xx = xpos - bx[j];
+      const double yy = ypos - by[j];
+      r2[j] = xx * xx + yy * yy;
+      fx[j] = xx / r2[j];
+      fy[j] = yy / r2[j];
+    }
     // Take care of a plane at constant x.
     if (m_ynplax) {
-      xxmirr = wire.x + (xpos - 2. * m_coplax);
-      const double r2plan = xxmirr * xxmirr + yy * yy;
-      exhelp -= xxmirr / r2plan;
-      eyhelp -= yy / r2plan;
-      r2 /= r2plan;
+      for (unsigned int j = 0; j < n; ++j) {
+        const double xxmirr = bx[j] + x2;
+        const double yy = ypos - by[j];
+        const double r2plan = xxmirr * xxmirr + yy * yy;
+        fx[j] -= xxmirr / r2plan;
+        fy[j] -= yy / r2plan;
+        r2[j] /= r2plan;
+      }
     }
     // Take care of a plane at constant y.
     if (m_ynplay) {
-      yymirr = wire.y + (ypos - 2. * m_coplay);
-      const double r2plan = xx * xx + yymirr * yymirr;
-      exhelp -= xx / r2plan;
-      eyhelp -= yymirr / r2plan;
-      r2 /= r2plan;
+      for (unsigned int j = 0; j < n; ++j) {
+        const double xx = xpos - bx[j];
+        const double yymirr = by[j] + y2;
+        const double r2plan = xx * xx + yymirr * yymirr;
+        fx[j] -= xx / r2plan;
+        fy[j] -= yymirr / r2plan;
+        r2[j] /= r2plan;
+      }
     }
     // Take care of pairs of planes.
     if (m_ynplax && m_ynplay) {
-      const double r2plan = xxmirr * xxmirr + yymirr * yymirr;
-      exhelp += xxmirr / r2plan;
-      eyhelp += yymirr / r2plan;
-      r2 *= r2plan;
+      for (unsigned int j = 0; j < n; ++j) {
+        const double xxmirr = bx[j] + x2;
+        const double yymirr = by[j] + y2;
+        const double r2plan = xxmirr * xxmirr + yymirr * yymirr;
+        fx[j] += xxmirr / r2plan;
+        fy[j] += yymirr / r2plan;
+        r2[j] *= r2plan;
+      }
     }
     // Calculate the electric field and potential.
-    if (opt) volt -= 0.5 * wire.e * log(r2);
-    ex += wire.e * exhelp;
-    ey += wire.e * eyhelp;
+    const double* be = we + i0;
+    for (unsigned int j = 0; j < n; ++j) {
+      ex += be[j] * fx[j];
+      ey += be[j] * fy[j];
+    }
+    if (!opt) continue;
+    for (unsigned int j = 0; j < n; ++j) volt -= 0.5 * be[j] * log(r2[j]);
+  }
+}
+
+void ComponentAnalyticField::FieldA00(const size_t n, const double* xpos,
+                                      const double* ypos, double* ex,
+                                      double* ey, double* volt,
+                                      const bool opt) const {
+  // Same as FieldA00 for a single point, with the points (in blocks) in
+  // the innermost loops, such that they can be vectorised.
+  const unsigned int nWires = m_wx.size();
+  const bool planeX = m_ynplax;
+  const bool planeY = m_ynplay;
+  const double x2 = -2. * m_coplax;
+  const double y2 = -2. * m_coplay;
+  double fx[WireBlock], fy[WireBlock], r2[WireBlock];
+  double sx[WireBlock], sy[WireBlock], sv[WireBlock];
+  for (size_t k0 = 0; k0 < n; k0 += WireBlock) {
+    const unsigned int nk = std::min(size_t(WireBlock), n - k0);
+    const double* px = xpos + k0;
+    const double* py = ypos + k0;
+    for (unsigned int k = 0; k < nk; ++k) sx[k] = sy[k] = sv[k] = 0.;
+    for (unsigned int j = 0; j < nWires; ++j) {
+      const double wx = m_wx[j];
+      const double wy = m_wy[j];
+      // Calculate the field in case there are no planes.
+      for (unsigned int k = 0; k < nk; ++k) {
+        const double xx = px[k] - wx;
+        const double yy = py[k] - wy;
+        r2[k] = xx * xx + yy * yy;
+        fx[k] = xx / r2[k];
+        fy[k] = yy / r2[k];
+      }
+      // Take care of a plane at constant x.
+      if (planeX) {
+        for (unsigned int k = 0; k < nk; ++k) {
+          const double xxmirr = wx + px[k] + x2;
+          const double yy = py[k] - wy;
+          const double r2plan = xxmirr * xxmirr + yy * yy;
+          fx[k] -= xxmirr / r2plan;
+          fy[k] -= yy / r2plan;
+          r2[k] /= r2plan;
+        }
+      }
+      // Take care of a plane at constant y.
+      if (planeY) {
+        for (unsigned int k = 0; k < nk; ++k) {
+          const double xx = px[k] - wx;
+          const double yymirr = wy + py[k] + y2;
+          const double r2plan = xx * xx + yymirr * yymirr;
+          fx[k] -= xx / r2plan;
+          fy[k] -= yymirr / r2plan;
+          r2[k] /= r2plan;
+        }
+      }
+      // Take care of pairs of planes.
+      if (planeX && planeY) {
+        for (unsigned int k = 0; k < nk; ++k) {
+          const double xxmirr = wx + px[k] + x2;
+          const double yymirr = wy + py[k] + y2;
+          const double r2plan = xxmirr * xxmirr + yymirr * yymirr;
+          fx[k] += xxmirr / r2plan;
+          fy[k] += yymirr / r2plan;
+          r2[k] *= r2plan;
+        }
+      }
+      const double we = m_we[j];
+      for (unsigned int k = 0; k < nk; ++k) {
+        sx[k] += we * fx[k];
+        sy[k] += we * fy[k];
+      }
+      if (!opt) continue;
+      for (unsigned int k = 0; k < nk; ++k) sv[k] -= 0.5 * we * log(r2[k]);
+    }
+    for (unsigned int k = 0; k < nk; ++k) {
+      ex[k0 + k] += sx[k];
+      ey[k0 + k] += sy[k];
+      volt[k0 + k] += sv[k];
+    }
   }
 }
 
@@ -3075,56 +3347,59 @@ void ComponentAnalyticField::FieldB1X(const double xpos, const double ypos,
   //               ECOMPL     : EX + I*EY                   ; I**2=-1
   //-----------------------------------------------------------------------
 
-  const std::complex<double> icons = std::complex<double>(0., 1.);
-
-  std::complex<double> ecompl;
-
-  double r2 = 0.;
-
   // Initialise the electric field and potential.
   ex = ey = 0.;
   volt = m_v0;
 
+  // The field of a row of charges is cot(z), evaluated in real arithmetic:
+  // cot(x + iy) = (sin x cos x - i sinh y cosh y) / (sinh^2 y + sin^2 x).
+  const double* wx = m_wx.data();
+  const double* wy = m_wy.data();
+  const double* we = m_we.data();
+  const unsigned int nWires = m_wx.size();
   const double tx = Pi / m_sx;
   // Loop over all wires.
-  for (const auto& wire : m_w) {
-    const double xx = tx * (xpos - wire.x);
-    const double yy = tx * (ypos - wire.y);
+  for (unsigned int i = 0; i < nWires; ++i) {
+    const double xx = tx * (xpos - wx[i]);
+    const double yy = tx * (ypos - wy[i]);
+    const double sinxx = sin(xx);
+    const double cosxx = cos(xx);
+    double fx = 0., fy = 0., r2 = 0.;
     // Calculate the field in case there are no equipotential planes.
     if (yy > 20.) {
-      ecompl = -icons;
+      fy = 1.;
+      r2 = -yy + CLog2;
     } else if (yy < -20.) {
-      ecompl = icons;
+      fy = -1.;
+      r2 = yy + CLog2;
     } else {
-      const std::complex<double> zz(xx, yy);
-      const auto expzz = exp(2. * icons * zz);
-      ecompl = icons * (expzz + 1.) / (expzz - 1.);
-    }
-
-    if (opt) {
-      if (fabs(yy) > 20.) r2 = -fabs(yy) + CLog2;
-      if (fabs(yy) <= 20.) r2 = -0.5 * log(pow(sinh(yy), 2) + pow(sin(xx), 2));
+      const double sinhy = sinh(yy);
+      const double s2 = sinhy * sinhy + sinxx * sinxx;
+      fx = sinxx * cosxx / s2;
+      fy = sinhy * sqrt(1. + sinhy * sinhy) / s2;
+      if (opt) r2 = -0.5 * log(s2);
     }
     // Take care of a plane at constant y.
     if (m_ynplay) {
-      const double yymirr = tx * (ypos + wire.y - 2. * m_coplay);
+      const double yymirr = tx * (ypos + wy[i] - 2. * m_coplay);
       if (yymirr > 20.) {
-        ecompl += icons;
+        fy -= 1.;
+        r2 += yymirr - CLog2;
       } else if (yymirr < -20.) {
-        ecompl += -icons;
+        fy += 1.;
+        r2 += -yymirr - CLog2;
       } else {
-        const std::complex<double> zzmirr(xx, yymirr);
-        const auto expzzmirr = exp(2. * icons * zzmirr);
-        ecompl += -icons * (expzzmirr + 1.) / (expzzmirr - 1.);
+        const double sinhy = sinh(yymirr);
+        const double s2 = sinhy * sinhy + sinxx * sinxx;
+        fx -= sinxx * cosxx / s2;
+        fy -= sinhy * sqrt(1. + sinhy * sinhy) / s2;
+        if (opt) r2 += 0.5 * log(s2);
       }
-      if (opt && fabs(yymirr) > 20.) r2 += fabs(yymirr) - CLog2;
-      if (opt && fabs(yymirr) <= 20.)
-        r2 += 0.5 * log(pow(sinh(yymirr), 2) + pow(sin(xx), 2));
     }
     // Calculate the electric field and potential.
-    ex += wire.e * real(ecompl);
-    ey -= wire.e * imag(ecompl);
-    if (opt) volt += wire.e * r2;
+    ex += we[i] * fx;
+    ey += we[i] * fy;
+    if (opt) volt += we[i] * r2;
   }
   ex *= tx;
   ey *= tx;
@@ -3141,53 +3416,59 @@ void ComponentAnalyticField::FieldB1Y(const double xpos, const double ypos,
   //               ECOMPL     : EX + I*EY                   ; I**2=-1
   //-----------------------------------------------------------------------
 
-  std::complex<double> ecompl;
-
-  double r2 = 0.;
-
   // Initialise the electric field and potential.
   ex = ey = 0.;
   volt = m_v0;
 
+  // The field of a row of charges is coth(z), evaluated in real arithmetic:
+  // coth(x + iy) = (sinh x cosh x - i sin y cos y) / (sinh^2 x + sin^2 y).
+  const double* wx = m_wx.data();
+  const double* wy = m_wy.data();
+  const double* we = m_we.data();
+  const unsigned int nWires = m_wx.size();
   const double ty = Pi / m_sy;
   // Loop over all wires.
-  for (const auto& wire : m_w) {
-    const double xx = ty * (xpos - wire.x);
-    const double yy = ty * (ypos - wire.y);
+  for (unsigned int i = 0; i < nWires; ++i) {
+    const double xx = ty * (xpos - wx[i]);
+    const double yy = ty * (ypos - wy[i]);
+    const double sinyy = sin(yy);
+    const double cosyy = cos(yy);
+    double fx = 0., fy = 0., r2 = 0.;
     // Calculate the field in case there are no equipotential planes.
     if (xx > 20.) {
-      ecompl = 1.;
+      fx = 1.;
+      r2 = -xx + CLog2;
     } else if (xx < -20.) {
-      ecompl = -1.;
+      fx = -1.;
+      r2 = xx + CLog2;
     } else {
-      const std::complex<double> zz(xx, yy);
-      const auto expzz = exp(2. * zz);
-      ecompl = (expzz + 1.) / (expzz - 1.);
-    }
-    if (opt) {
-      if (fabs(xx) > 20.) r2 = -fabs(xx) + CLog2;
-      if (fabs(xx) <= 20.) r2 = -0.5 * log(pow(sinh(xx), 2) + pow(sin(yy), 2));
+      const double sinhx = sinh(xx);
+      const double s2 = sinhx * sinhx + sinyy * sinyy;
+      fx = sinhx * sqrt(1. + sinhx * sinhx) / s2;
+      fy = sinyy * cosyy / s2;
+      if (opt) r2 = -0.5 * log(s2);
     }
     // Take care of a plane at constant x.
     if (m_ynplax) {
-      const double xxmirr = ty * (xpos + wire.x - 2. * m_coplax);
+      const double xxmirr = ty * (xpos + wx[i] - 2. * m_coplax);
       if (xxmirr > 20.) {
-        ecompl -= 1.;
+        fx -= 1.;
+        r2 += xxmirr - CLog2;
       } else if (xxmirr < -20.) {
-        ecompl += 1.;
+        fx += 1.;
+        r2 += -xxmirr - CLog2;
       } else {
-        const std::complex<double> zzmirr(xxmirr, yy);
-        const auto expzzmirr = exp(2. * zzmirr);
-        ecompl -= (expzzmirr + 1.) / (expzzmirr - 1.);
+        const double sinhx = sinh(xxmirr);
+        const double s2 = sinhx * sinhx + sinyy * sinyy;
+        fx -= sinhx * sqrt(1. + sinhx * sinhx) / s2;
+        fy -= sinyy * cosyy / s2;
+        if (opt) r2 += 0.5 * log(s2);
       }
-      if (opt && fabs(xxmirr) > 20.) r2 += fabs(xxmirr) - CLog2;
-      if (opt && fabs(xxmirr) <= 20.)
-        r2 += 0.5 * log(pow(sinh(xxmirr), 2) + pow(sin(yy), 2));
     }
     // Calculate the electric field and potential.
-    ex += wire.e * real(ecompl);
-    ey -= wire.e * imag(ecompl);
-    if (opt) volt += wire.e * r2;
+    ex += we[i] * fx;
+    ey += we[i] * fy;
+    if (opt) volt += we[i] * r2;
   }
   ex *= ty;
   ey *= ty;
@@ -3209,48 +3490,45 @@ void ComponentAnalyticField::FieldB2X(const double xpos, const double ypos,
   ex = ey = 0.;
   volt = m_v0;
 
+  // The field is evaluated in real arithmetic (see InvSinProduct);
+  // the direct term and the mirror term share sin and cos of xx, xxneg.
+  const double* wx = m_wx.data();
+  const double* wy = m_wy.data();
+  const double* we = m_we.data();
+  const double* b2 = m_b2sin.data();
+  const unsigned int nWires = m_wx.size();
   const double tx = HalfPi / m_sx;
   // Loop over all wires.
-  for (unsigned int i = 0; i < m_nWires; ++i) {
-    const double xx = tx * (xpos - m_w[i].x);
-    const double yy = tx * (ypos - m_w[i].y);
-    const double xxneg = tx * (xpos - m_w[i].x - 2 * m_coplax);
+  for (unsigned int i = 0; i < nWires; ++i) {
+    const double xx = tx * (xpos - wx[i]);
+    const double yy = tx * (ypos - wy[i]);
+    const double xxneg = tx * (xpos - wx[i] - 2 * m_coplax);
+    const double sa = sin(xx);
+    const double ca = cos(xx);
+    const double sb = sin(xxneg);
+    const double cb = cos(xxneg);
     // Calculate the field in case there are no equipotential planes.
-    std::complex<double> ecompl(0., 0.);
-    double r2 = 1.;
+    double fx = 0., fy = 0., r2 = 1.;
     if (fabs(yy) <= 20.) {
-      const std::complex<double> zz(xx, yy);
-      const std::complex<double> zzneg(xxneg, yy);
-      ecompl = -m_b2sin[i] / (sin(zz) * sin(zzneg));
-      if (opt) {
-        const double sinhy = sinh(yy);
-        const double sinxx = sin(xx);
-        const double sinxxneg = sin(xxneg);
-        r2 = (sinhy * sinhy + sinxx * sinxx) /
-             (sinhy * sinhy + sinxxneg * sinxxneg);
-      }
+      InvSinProduct(sa, ca, sb, cb, yy, fx, fy, r2);
+      fx = -fx;
+      fy = -fy;
     }
     // Take care of a planes at constant y.
     if (m_ynplay) {
-      const double yymirr = tx * (ypos + m_w[i].y - 2 * m_coplay);
+      const double yymirr = tx * (ypos + wy[i] - 2 * m_coplay);
       if (fabs(yymirr) <= 20.) {
-        const std::complex<double> zzmirr(xx, yymirr);
-        const std::complex<double> zznmirr(xxneg, yymirr);
-        ecompl += m_b2sin[i] / (sin(zzmirr) * sin(zznmirr));
-        if (opt) {
-          const double sinhy = sinh(yymirr);
-          const double sinxx = sin(xx);
-          const double sinxxneg = sin(xxneg);
-          const double r2plan = (sinhy * sinhy + sinxx * sinxx) /
-                                (sinhy * sinhy + sinxxneg * sinxxneg);
-          r2 /= r2plan;
-        }
+        double gx = 0., gy = 0., r2plan = 1.;
+        InvSinProduct(sa, ca, sb, cb, yymirr, gx, gy, r2plan);
+        fx += gx;
+        fy += gy;
+        r2 /= r2plan;
       }
     }
     // Calculate the electric field and potential.
-    ex += m_w[i].e * real(ecompl);
-    ey -= m_w[i].e * imag(ecompl);
-    if (opt) volt -= 0.5 * m_w[i].e * log(r2);
+    ex += we[i] * b2[i] * fx;
+    ey -= we[i] * b2[i] * fy;
+    if (opt) volt -= 0.5 * we[i] * log(r2);
   }
   ex *= tx;
   ey *= tx;
@@ -3268,55 +3546,47 @@ void ComponentAnalyticField::FieldB2Y(const double xpos, const double ypos,
   //   (Cray vectorisable)
   //-----------------------------------------------------------------------
 
-  const std::complex<double> icons(0., 1.);
-
   // Initialise the electric field and potential.
   ex = ey = 0.;
   volt = m_v0;
 
+  // As in FieldB2X, with i * (xx + i yy) = -yy + i xx.
+  const double* wx = m_wx.data();
+  const double* wy = m_wy.data();
+  const double* we = m_we.data();
+  const double* b2 = m_b2sin.data();
+  const unsigned int nWires = m_wx.size();
   const double ty = HalfPi / m_sy;
   // Loop over all wires.
-  for (unsigned int i = 0; i < m_nWires; ++i) {
-    const double xx = ty * (xpos - m_w[i].x);
-    const double yy = ty * (ypos - m_w[i].y);
-    const double yyneg = ty * (ypos + m_w[i].y - 2 * m_coplay);
+  for (unsigned int i = 0; i < nWires; ++i) {
+    const double xx = ty * (xpos - wx[i]);
+    const double yy = ty * (ypos - wy[i]);
+    const double yyneg = ty * (ypos + wy[i] - 2 * m_coplay);
+    const double sa = -sin(yy);
+    const double ca = cos(yy);
+    const double sb = -sin(yyneg);
+    const double cb = cos(yyneg);
     // Calculate the field in case there are no equipotential planes.
-    std::complex<double> ecompl(0., 0.);
-    double r2 = 1.;
+    double fx = 0., fy = 0., r2 = 1.;
     if (fabs(xx) <= 20.) {
-      const std::complex<double> zz(xx, yy);
-      const std::complex<double> zzneg(xx, yyneg);
-      ecompl = icons * m_b2sin[i] / (sin(icons * zz) * sin(icons * zzneg));
-      if (opt) {
-        const double sinhx = sinh(xx);
-        const double sinyy = sin(yy);
-        const double sinyyneg = sin(yyneg);
-        r2 = (sinhx * sinhx + sinyy * sinyy) /
-             (sinhx * sinhx + sinyyneg * sinyyneg);
-      }
+      InvSinProduct(sa, ca, sb, cb, xx, fy, fx, r2);
+      fx = -fx;
     }
     // Take care of a plane at constant x.
     if (m_ynplax) {
-      const double xxmirr = ty * (xpos + m_w[i].x - 2 * m_coplax);
+      const double xxmirr = ty * (xpos + wx[i] - 2 * m_coplax);
       if (fabs(xxmirr) <= 20.) {
-        const std::complex<double> zzmirr(xxmirr, yy);
-        const std::complex<double> zznmirr(xxmirr, yyneg);
-        ecompl -=
-            icons * m_b2sin[i] / (sin(icons * zzmirr) * sin(icons * zznmirr));
-        if (opt) {
-          const double sinhx = sinh(xxmirr);
-          const double sinyy = sin(yy);
-          const double sinyyneg = sin(yyneg);
-          const double r2plan = (sinhx * sinhx + sinyy * sinyy) /
-                                (sinhx * sinhx + sinyyneg * sinyyneg);
-          r2 /= r2plan;
-        }
+        double gx = 0., gy = 0., r2plan = 1.;
+        InvSinProduct(sa, ca, sb, cb, xxmirr, gy, gx, r2plan);
+        fx += gx;
+        fy -= gy;
+        r2 /= r2plan;
       }
     }
     // Calculate the electric field and potential.
-    ex += m_w[i].e * real(ecompl);
-    ey -= m_w[i].e * imag(ecompl);
-    if (opt) volt -= 0.5 * m_w[i].e * log(r2);
+    ex += we[i] * b2[i] * fx;
+    ey -= we[i] * b2[i] * fy;
+    if (opt) volt -= 0.5 * we[i] * log(r2);
   }
   ex *= ty;
   ey *= ty;
@@ -3355,67 +3625,63 @@ void ComponentAnalyticField::FieldC2X(const double xpos, const double ypos,
   //   VARIABLES : see the writeup
   //-----------------------------------------------------------------------
 
-  const std::complex<double> icons(0., 1.);
-
-  std::complex<double> zsin, zcof, zu, zunew;
-  std::complex<double> zterm1, zterm2, zeta;
+  // The terms are evaluated in real arithmetic (see TermC).
+  const double* wx = m_wx.data();
+  const double* wy = m_wy.data();
+  const double* we = m_we.data();
+  const unsigned int nWires = m_wx.size();
+  const double mr = real(m_zmult);
+  const double mi = imag(m_zmult);
 
   // Initial values.
-  std::complex<double> wsum1 = 0.;
-  std::complex<double> wsum2 = 0.;
+  double s1r = 0., s1i = 0.;
+  double s2r = 0., s2i = 0.;
   volt = 0.;
 
   // Wire loop.
-  for (const auto& wire : m_w) {
+  for (unsigned int i = 0; i < nWires; ++i) {
+    double wr = 0., wi = 0., n1 = 1.;
     // Compute the direct contribution.
-    zeta = m_zmult * std::complex<double>(xpos - wire.x, ypos - wire.y);
-    if (imag(zeta) > 15.) {
-      wsum1 -= wire.e * icons;
-      if (opt) volt -= wire.e * (fabs(imag(zeta)) - CLog2);
-    } else if (imag(zeta) < -15.) {
-      wsum1 += wire.e * icons;
-      if (opt) volt -= wire.e * (fabs(imag(zeta)) - CLog2);
+    double dx = xpos - wx[i];
+    const double dy = ypos - wy[i];
+    double zi = mr * dy + mi * dx;
+    if (zi > 15.) {
+      s1i -= we[i];
+      if (opt) volt -= we[i] * (fabs(zi) - CLog2);
+    } else if (zi < -15.) {
+      s1i += we[i];
+      if (opt) volt -= we[i] * (fabs(zi) - CLog2);
     } else {
-      zsin = sin(zeta);
-      zcof = 4. * zsin * zsin - 2.;
-      zu = -m_p1 - zcof * m_p2;
-      zunew = 1. - zcof * zu - m_p2;
-      zterm1 = (zunew + zu) * zsin;
-      zu = -3. * m_p1 - zcof * 5. * m_p2;
-      zunew = 1. - zcof * zu - 5. * m_p2;
-      zterm2 = (zunew - zu) * cos(zeta);
-      wsum1 += wire.e * (zterm2 / zterm1);
-      if (opt) volt -= wire.e * log(abs(zterm1));
+      TermC(mr * dx - mi * dy, zi, m_p1, m_p2, wr, wi, n1);
+      s1r += we[i] * wr;
+      s1i += we[i] * wi;
+      if (opt) volt -= 0.5 * we[i] * log(n1);
     }
     // Find the plane nearest to the wire.
-    double cx = m_coplax - m_sx * int(round((m_coplax - wire.x) / m_sx));
+    double cx = m_coplax - m_sx * int(round((m_coplax - wx[i]) / m_sx));
     // Mirror contribution.
-    zeta =
-        m_zmult * std::complex<double>(2. * cx - xpos - wire.x, ypos - wire.y);
-    if (imag(zeta) > 15.) {
-      wsum2 -= wire.e * icons;
-      if (opt) volt += wire.e * (fabs(imag(zeta)) - CLog2);
-    } else if (imag(zeta) < -15.) {
-      wsum2 += wire.e * icons;
-      if (opt) volt += wire.e * (fabs(imag(zeta)) - CLog2);
+    dx = 2. * cx - xpos - wx[i];
+    zi = mr * dy + mi * dx;
+    if (zi > 15.) {
+      s2i -= we[i];
+      if (opt) volt += we[i] * (fabs(zi) - CLog2);
+    } else if (zi < -15.) {
+      s2i += we[i];
+      if (opt) volt += we[i] * (fabs(zi) - CLog2);
     } else {
-      zsin = sin(zeta);
-      zcof = 4. * zsin * zsin - 2.;
-      zu = -m_p1 - zcof * m_p2;
-      zunew = 1. - zcof * zu - m_p2;
-      zterm1 = (zunew + zu) * zsin;
-      zu = -3. * m_p1 - zcof * 5. * m_p2;
-      zunew = 1. - zcof * zu - 5. * m_p2;
-      zterm2 = (zunew - zu) * cos(zeta);
-      wsum2 += wire.e * (zterm2 / zterm1);
-      if (opt) volt += wire.e * log(abs(zterm1));
+      TermC(mr * dx - mi * dy, zi, m_p1, m_p2, wr, wi, n1);
+      s2r += we[i] * wr;
+      s2i += we[i] * wi;
+      if (opt) volt += 0.5 * we[i] * log(n1);
     }
     // Correct the voltage, if needed (MODE).
     if (opt && m_mode == 0) {
-      volt -= TwoPi * wire.e * (xpos - cx) * (wire.x - cx) / (m_sx * m_sy);
+      volt -= TwoPi * we[i] * (xpos - cx) * (wx[i] - cx) / (m_sx * m_sy);
     }
   }
   // Convert the two contributions to a real field.
+  const std::complex<double> wsum1(s1r, s1i);
+  const std::complex<double> wsum2(s2r, s2i);
   ex = real(m_zmult * (wsum1 + wsum2));
   ey = -imag(m_zmult * (wsum1 - wsum2));
   // Constant correction terms.
@@ -3431,67 +3697,63 @@ void ComponentAnalyticField::FieldC2Y(const double xpos, const double ypos,
   //   VARIABLES : see the writeup
   //-----------------------------------------------------------------------
 
-  const std::complex<double> icons(0., 1.);
-
-  std::complex<double> zsin, zcof, zu, zunew;
-  std::complex<double> zterm1, zterm2, zeta;
+  // The terms are evaluated in real arithmetic (see TermC).
+  const double* wx = m_wx.data();
+  const double* wy = m_wy.data();
+  const double* we = m_we.data();
+  const unsigned int nWires = m_wx.size();
+  const double mr = real(m_zmult);
+  const double mi = imag(m_zmult);
 
   // Initial values.
   volt = 0.;
-  std::complex<double> wsum1 = 0.;
-  std::complex<double> wsum2 = 0.;
+  double s1r = 0., s1i = 0.;
+  double s2r = 0., s2i = 0.;
 
   // Wire loop.
-  for (const auto& wire : m_w) {
+  for (unsigned int i = 0; i < nWires; ++i) {
+    double wr = 0., wi = 0., n1 = 1.;
     // Compute the direct contribution.
-    zeta = m_zmult * std::complex<double>(xpos - wire.x, ypos - wire.y);
-    if (imag(zeta) > 15.) {
-      wsum1 -= wire.e * icons;
-      if (opt) volt -= wire.e * (fabs(imag(zeta)) - CLog2);
-    } else if (imag(zeta) < -15.) {
-      wsum1 += wire.e * icons;
-      if (opt) volt -= wire.e * (fabs(imag(zeta)) - CLog2);
+    const double dx = xpos - wx[i];
+    double dy = ypos - wy[i];
+    double zi = mr * dy + mi * dx;
+    if (zi > 15.) {
+      s1i -= we[i];
+      if (opt) volt -= we[i] * (fabs(zi) - CLog2);
+    } else if (zi < -15.) {
+      s1i += we[i];
+      if (opt) volt -= we[i] * (fabs(zi) - CLog2);
     } else {
-      zsin = sin(zeta);
-      zcof = 4. * zsin * zsin - 2.;
-      zu = -m_p1 - zcof * m_p2;
-      zunew = 1. - zcof * zu - m_p2;
-      zterm1 = (zunew + zu) * zsin;
-      zu = -3. * m_p1 - zcof * 5. * m_p2;
-      zunew = 1. - zcof * zu - 5. * m_p2;
-      zterm2 = (zunew - zu) * cos(zeta);
-      wsum1 += wire.e * (zterm2 / zterm1);
-      if (opt) volt -= wire.e * log(abs(zterm1));
+      TermC(mr * dx - mi * dy, zi, m_p1, m_p2, wr, wi, n1);
+      s1r += we[i] * wr;
+      s1i += we[i] * wi;
+      if (opt) volt -= 0.5 * we[i] * log(n1);
     }
     // Find the plane nearest to the wire.
-    const double cy = m_coplay - m_sy * int(round((m_coplay - wire.y) / m_sy));
+    const double cy = m_coplay - m_sy * int(round((m_coplay - wy[i]) / m_sy));
     // Mirror contribution from the y plane.
-    zeta =
-        m_zmult * std::complex<double>(xpos - wire.x, 2 * cy - ypos - wire.y);
-    if (imag(zeta) > 15.) {
-      wsum2 -= wire.e * icons;
-      if (opt) volt += wire.e * (fabs(imag(zeta)) - CLog2);
-    } else if (imag(zeta) < -15.) {
-      wsum2 += wire.e * icons;
-      if (opt) volt += wire.e * (fabs(imag(zeta)) - CLog2);
+    dy = 2 * cy - ypos - wy[i];
+    zi = mr * dy + mi * dx;
+    if (zi > 15.) {
+      s2i -= we[i];
+      if (opt) volt += we[i] * (fabs(zi) - CLog2);
+    } else if (zi < -15.) {
+      s2i += we[i];
+      if (opt) volt += we[i] * (fabs(zi) - CLog2);
     } else {
-      zsin = sin(zeta);
-      zcof = 4. * zsin * zsin - 2.;
-      zu = -m_p1 - zcof * m_p2;
-      zunew = 1. - zcof * zu - m_p2;
-      zterm1 = (zunew + zu) * zsin;
-      zu = -3. * m_p1 - zcof * 5. * m_p2;
-      zunew = 1. - zcof * zu - 5. * m_p2;
-      zterm2 = (zunew - zu) * cos(zeta);
-      wsum2 += wire.e * (zterm2 / zterm1);
-      if (opt) volt += wire.e * log(abs(zterm1));
+      TermC(mr * dx - mi * dy, zi, m_p1, m_p2, wr, wi, n1);
+      s2r += we[i] * wr;
+      s2i += we[i] * wi;
+      if (opt) volt += 0.5 * we[i] * log(n1);
     }
     // Correct the voltage, if needed (MODE).
     if (opt && m_mode == 1) {
-      volt -= TwoPi * wire.e * (ypos - cy) * (wire.y - cy) / (m_sx * m_sy);
+      volt -= TwoPi * we[i] * (ypos - cy) * (wy[i] - cy) / (m_sx * m_sy);
     }
   }
   // Convert the two contributions to a real field.
+  const std::complex<double> wsum1(s1r, s1i);
+  const std::complex<double> wsum2(s2r, s2i);
   ex = real(m_zmult * (wsum1 - wsum2));
   ey = -imag(m_zmult * (wsum1 + wsum2));
   // Constant correction terms.
@@ -3631,22 +3893,40 @@ void ComponentAnalyticField::FieldD10(const double xpos, const double ypos,
   ex = ey = 0.;
   volt = m_v0;
 
-  // Set the complex position coordinates.
-  const std::complex<double> zpos = std::complex<double>(xpos, ypos);
-  // Loop over all wires.
-  for (const auto& wire : m_w) {
-    // Set the complex version of the wire-coordinate for simplicity.
-    const std::complex<double> zi(wire.x, wire.y);
-    // Compute the contribution to the potential, if needed.
-    if (opt) {
-      volt -= wire.e *
-              log(abs(m_cotube * (zpos - zi) / (m_cotube2 - zpos * conj(zi))));
+  // The field is 1 / conj(zpos - zi) + zi / (r^2 - conj(zpos) zi),
+  // written out in real arithmetic and evaluated in blocks of wires
+  // (see FieldA00).
+  const double* wx = m_wx.data();
+  const double* wy = m_wy.data();
+  const double* we = m_we.data();
+  const unsigned int nWires = m_wx.size();
+  const double logr = log(m_cotube);
+  double fx[WireBlock], fy[WireBlock], r2[WireBlock];
+  for (unsigned int i0 = 0; i0 < nWires; i0 += WireBlock) {
+    const unsigned int n = std::min(WireBlock, nWires - i0);
+    const double* bx = wx + i0;
+    const double* by = wy + i0;
+    for (unsigned int j = 0; j < n; ++j) {
+      const double dx = xpos - bx[j];
+      const double dy = ypos - by[j];
+      const double d2 = dx * dx + dy * dy;
+      // Denominator of the image term.
+      const double a = m_cotube2 - (xpos * bx[j] + ypos * by[j]);
+      const double b = xpos * by[j] - ypos * bx[j];
+      const double a2 = a * a + b * b;
+      fx[j] = dx / d2 + (bx[j] * a - by[j] * b) / a2;
+      fy[j] = dy / d2 + (bx[j] * b + by[j] * a) / a2;
+      r2[j] = d2 / a2;
+    }
+    const double* be = we + i0;
+    for (unsigned int j = 0; j < n; ++j) {
+      ex += be[j] * fx[j];
+      ey += be[j] * fy[j];
+    }
+    if (!opt) continue;
+    for (unsigned int j = 0; j < n; ++j) {
+      volt -= be[j] * (logr + 0.5 * log(r2[j]));
     }
-    // Compute the contribution to the electric field, always.
-    const std::complex<double> wi =
-        1. / conj(zpos - zi) + zi / (m_cotube2 - conj(zpos) * zi);
-    ex += wire.e * real(wi);
-    ey += wire.e * imag(wi);
   }
 }
 
@@ -1,9 +1,11 @@
 #include <math.h>
 #include <stdlib.h>
+#include <array>
 #include <fstream>
 #include <iostream>
 
 #include "ComponentAnsys121.hh"
+#include "TextFile.hh"
 
 namespace Garfield {
 
@@ -247,67 +249,60 @@ bool ComponentAnsys121::Initialise(std::string elist, std::string nlist,
             << " materials from file " << mplist << ".\n";
   if (m_debug) PrintMaterials();
 
-  // Open the element list
-  std::ifstream felist;
-  felist.open(elist.c_str(), std::ios::in);
-  if (felist.fail()) {
+  // Read the element list
+  TextFile felist(m_nReadThreads);
+  if (!felist.Read(elist)) {
     std::cerr << m_className << "::Initialise:\n";
     std::cerr << "    Could not open element file " << elist
               << " for reading.\n";
     std::cerr << "    The file perhaps does not exist.\n";
     return false;
   }
-  // Read the element list
+  const auto records = FindAnsysRecords(felist, {"LIST", "ELEM"});
+  const size_t nRecords = records.size();
+  // Parse the lines in parallel: element number, material and nodes.
+  std::vector<std::array<int, 10> > data(nRecords);
+  std::vector<char> errors(nRecords, 0);
+  felist.ParallelFor(nRecords, [&](const size_t begin, const size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+      std::array<int, 10>& d = data[i];
+      d.fill(-1);
+      const char* p = felist.GetLine(records[i]);
+      bool error = !TextFile::ReadInteger(p, d[0]) ||
+                   !TextFile::ReadInteger(p, d[1]) ||
+                   !TextFile::SkipTokens(p, 4);
+      for (unsigned int j = 2; j < 10 && !error; ++j) {
+        error = !TextFile::ReadInteger(p, d[j]);
+      }
+      errors[i] = error;
+    }
+  });
+
   elements.clear();
+  elements.reserve(nRecords);
   nElements = 0;
   Element newElement;
   int ndegenerate = 0;
   int nbackground = 0;
-  il = 0;
   int highestnode = 0;
-  while (felist.getline(line, size, '\n')) {
-    il++;
-    // Split the line in tokens
-    char* token = NULL;
-    // Split into tokens
-    token = strtok(line, " ");
-    // Skip blank lines and headers
-    if (!token || strcmp(token, " ") == 0 || strcmp(token, "\n") == 0 ||
-        int(token[0]) == 10 || int(token[0]) == 13 ||
-        strcmp(token, "LIST") == 0 || strcmp(token, "ELEM") == 0)
-      continue;
-    // Read the element
-    int ielem = ReadInteger(token, -1, readerror);
-    token = strtok(NULL, " ");
-    int imat = ReadInteger(token, -1, readerror);
-    token = strtok(NULL, " ");
-    token = strtok(NULL, " ");
-    token = strtok(NULL, " ");
-    token = strtok(NULL, " ");
-    token = strtok(NULL, " ");
-    if (!token) std::cerr << "No token available\n";
-    int in0 = ReadInteger(token, -1, readerror);
-    token = strtok(NULL, " ");
-    int in1 = ReadInteger(token, -1, readerror);
-    token = strtok(NULL, " ");
-    int in2 = ReadInteger(token, -1, readerror);
-    token = strtok(NULL, " ");
-    int in3 = ReadInteger(token, -1, readerror);
-    token = strtok(NULL, " ");
-    int in4 = ReadInteger(token, -1, readerror);
-    token = strtok(NULL, " ");
-    int in5 = ReadInteger(token, -1, readerror);
-    token = strtok(NULL, " ");
-    int in6 = ReadInteger(token, -1, readerror);
-    token = strtok(NULL, " ");
-    int in7 = ReadInteger(token, -1, readerror);
+  for (size_t i = 0; i < nRecords; ++i) {
+    il = records[i] + 1;
+    const int ielem = data[i][0];
+    const int imat = data[i][1];
+    const int in0 = data[i][2];
+    const int in1 = data[i][3];
+    const int in2 = data[i][4];
+    const int in3 = data[i][5];
+    const int in4 = data[i][6];
+    const int in5 = data[i][7];
+    const int in6 = data[i][8];
+    const int in7 = data[i][9];
 
     // Check synchronisation
-    if (readerror) {
+    if (errors[i]) {
       std::cerr << m_className << "::Initialise:\n";
       std::cerr << "    Error reading file " << elist << " (line " << il
                 << ").\n";
-      felist.close();
       ok = false;
       return false;
     } else if (ielem - 1 != nElements + nbackground) {
@@ -393,8 +388,6 @@ bool ComponentAnsys121::Initialise(std::string elist, std::string nlist,
     elements.push_back(newElement);
     ++nElements;
   }
-  // Close the file
-  felist.close();
   // Tell how many lines read
   std::cout << m_className << "::Initialise:\n";
   std::cout << "    Read " << nElements << " elements from file " << elist
@@ -427,72 +420,8 @@ bool ComponentAnsys121::Initialise(std::string elist, std::string nlist,
     std::cout << "    Unit scaling factor = " << funit << ".\n";
   }
 
-  // Open the node list
-  std::ifstream fnlist;
-  fnlist.open(nlist.c_str(), std::ios::in);
-  if (fnlist.fail()) {
-    std::cerr << m_className << "::Initialise:\n";
-    std::cerr << "    Could not open nodes file " << nlist << " for reading.\n";
-    std::cerr << "    The file perhaps does not exist.\n";
-    return false;
-  }
   // Read the node list
-  nodes.clear();
-  nNodes = 0;
-  Node newNode;
-  newNode.w.clear();
-  il = 0;
-  while (fnlist.getline(line, size, '\n')) {
-    il++;
-    // Split the line in tokens
-    char* token = NULL;
-    // Split into tokens
-    token = strtok(line, " ");
-    // Skip blank lines and headers
-    if (!token || strcmp(token, " ") == 0 || strcmp(token, "\n") == 0 ||
-        int(token[0]) == 10 || int(token[0]) == 13 ||
-        strcmp(token, "LIST") == 0 || strcmp(token, "NODE") == 0)
-      continue;
-    // Read the element
-    int inode = ReadInteger(token, -1, readerror);
-    token = strtok(NULL, " ");
-    double xnode = ReadDouble(token, -1, readerror);
-    token = strtok(NULL, " ");
-    double ynode = ReadDouble(token, -1, readerror);
-    token = strtok(NULL, " ");
-    double znode = ReadDouble(token, -1, readerror);
-    // Check syntax
-    if (readerror) {
-      std::cerr << m_className << "::Initialise:\n";
-      std::cerr << "    Error reading file " << nlist << " (line " << il
-                << ").\n";
-      fnlist.close();
-      ok = false;
-      return false;
-    }
-    // Check synchronisation
-    if (inode - 1 != nNodes) {
-      std::cerr << m_className << "::Initialise:\n";
-      std::cerr << "    Synchronisation lost on file " << nlist << " (line "
-                << il << ").\n";
-      std::cerr << "    Node: " << inode << " (expected " << nNodes
-                << "), (x,y,z) = (" << xnode << ", " << ynode << ", " << znode
-                << ")\n";
-      ok = false;
-    }
-
-    // Store the point coordinates
-    newNode.x = xnode * funit;
-    newNode.y = ynode * funit;
-    newNode.z = znode * funit;
-    nodes.push_back(newNode);
-    ++nNodes;
-  }
-  // Close the file
-  fnlist.close();
-  // Tell how many lines read
-  std::cout << m_className << "::Initialise:\n";
-  std::cout << "    Read " << nNodes << " nodes from file " << nlist << ".\n";
+  if (!ReadAnsysNodes(nlist, funit, ok)) return false;
   // Check number of nodes
   if (nNodes != highestnode) {
     std::cerr << m_className << "::Initialise:\n";
@@ -502,72 +431,14 @@ bool ComponentAnsys121::Initialise(std::string elist, std::string nlist,
     ok = false;
   }
 
-  // Open the voltage list
-  std::ifstream fprnsol;
-  fprnsol.open(prnsol.c_str(), std::ios::in);
-  if (fprnsol.fail()) {
-    std::cerr << m_className << "::Initialise:\n";
-    std::cerr << "    Could not open potential file " << prnsol
-              << " for reading.\n";
-    std::cerr << "    The file perhaps does not exist.\n";
-    return false;
-  }
   // Read the voltage list
-  il = 0;
+  std::vector<double> potentials(nNodes, 0.);
   int nread = 0;
-  readerror = false;
-  while (fprnsol.getline(line, size, '\n')) {
-    il++;
-    // Split the line in tokens
-    char* token = NULL;
-    token = strtok(line, " ");
-    // Skip blank lines and headers
-    if (!token || strcmp(token, " ") == 0 || strcmp(token, "\n") == 0 ||
-        int(token[0]) == 10 || int(token[0]) == 13 ||
-        strcmp(token, "PRINT") == 0 || strcmp(token, "*****") == 0 ||
-        strcmp(token, "LOAD") == 0 || strcmp(token, "TIME=") == 0 ||
-        strcmp(token, "MAXIMUM") == 0 || strcmp(token, "VALUE") == 0 ||
-        strcmp(token, "NODE") == 0)
-      continue;
-    // Read the element
-    int inode = ReadInteger(token, -1, readerror);
-    token = strtok(NULL, " ");
-    double volt = ReadDouble(token, -1, readerror);
-    // Check syntax
-    if (readerror) {
-      std::cerr << m_className << "::Initialise:\n";
-      std::cerr << "    Error reading file " << prnsol << " (line " << il
-                << ").\n";
-      fprnsol.close();
-      ok = false;
-      return false;
-    }
-    // Check node number and store if OK
-    if (inode < 1 || inode > nNodes) {
-      std::cerr << m_className << "::Initialise:\n";
-      std::cerr << "    Node number " << inode << " out of range\n";
-      std::cerr << "    on potential file " << prnsol << " (line " << il
-                << ").\n";
-      ok = false;
-    } else {
-      nodes[inode - 1].v = volt;
-      nread++;
-    }
-  }
-  // Close the file
-  fprnsol.close();
-  // Tell how many lines read
-  std::cout << m_className << "::Initialise:\n";
-  std::cout << "    Read " << nread << " potentials from file " << prnsol
-            << ".\n";
-  // Check number of nodes
-  if (nread != nNodes) {
-    std::cerr << m_className << "::Initialise:\n";
-    std::cerr << "    Number of nodes read (" << nread << ") on potential file "
-              << prnsol << " does not\n",
-        std::cerr << "    match the node list (" << nNodes << ").\n";
-    ok = false;
+  if (!ReadAnsysPotentials(prnsol, "Initialise", potentials, nread, ok)) {
+    return false;
   }
+  for (int i = 0; i < nNodes; ++i) nodes[i].v = potentials[i];
+
   // Set the ready flag
   if (ok) {
     m_ready = true;
@@ -579,13 +450,12 @@ bool ComponentAnsys121::Initialise(std::string elist, std::string nlist,
   }
 
   // Remove weighting fields (if any).
-  wfields.clear();
-  wfieldsOk.clear();
-  nWeightingFields = 0;
+  ClearWeightingFields();
 
   // Establish the ranges
   SetRange();
   UpdatePeriodicity();
+  PrepareElementSearch();
   return true;
 }
 
@@ -597,100 +467,19 @@ bool ComponentAnsys121::SetWeightingField(std::string prnsol,
     return false;
   }
 
-  // Open the voltage list.
-  std::ifstream fprnsol;
-  fprnsol.open(prnsol.c_str(), std::ios::in);
-  if (fprnsol.fail()) {
-    std::cerr << m_className << "::SetWeightingField:\n";
-    std::cerr << "    Could not open potential file " << prnsol
-              << " for reading.\n";
-    std::cerr << "    The file perhaps does not exist.\n";
-    return false;
-  }
-
-  // Check if a weighting field with the same label already exists.
-  int iw = nWeightingFields;
-  for (int i = nWeightingFields; i--;) {
-    if (wfields[i] == label) {
-      iw = i;
-      break;
-    }
-  }
-  if (iw == nWeightingFields) {
-    ++nWeightingFields;
-    wfields.resize(nWeightingFields);
-    wfieldsOk.resize(nWeightingFields);
-    for (int j = nNodes; j--;) {
-      nodes[j].w.resize(nWeightingFields);
-    }
-  } else {
-    std::cout << m_className << "::SetWeightingField:\n";
-    std::cout << "    Replacing existing weighting field " << label << ".\n";
-  }
-  wfields[iw] = label;
-  wfieldsOk[iw] = false;
-
-  // Buffer for reading
-  const int size = 100;
-  char line[size];
-
-  bool ok = true;
   // Read the voltage list.
-  int il = 0;
+  bool ok = true;
+  std::vector<double> potentials(nNodes, 0.);
   int nread = 0;
-  bool readerror = false;
-  while (fprnsol.getline(line, size, '\n')) {
-    il++;
-    // Split the line in tokens.
-    char* token = NULL;
-    token = strtok(line, " ");
-    // Skip blank lines and headers.
-    if (!token || strcmp(token, " ") == 0 || strcmp(token, "\n") == 0 ||
-        int(token[0]) == 10 || int(token[0]) == 13 ||
-        strcmp(token, "PRINT") == 0 || strcmp(token, "*****") == 0 ||
-        strcmp(token, "LOAD") == 0 || strcmp(token, "TIME=") == 0 ||
-        strcmp(token, "MAXIMUM") == 0 || strcmp(token, "VALUE") == 0 ||
-        strcmp(token, "NODE") == 0)
-      continue;
-    // Read the element.
-    int inode = ReadInteger(token, -1, readerror);
-    token = strtok(NULL, " ");
-    double volt = ReadDouble(token, -1, readerror);
-    // Check the syntax.
-    if (readerror) {
-      std::cerr << m_className << "::SetWeightingField:\n";
-      std::cerr << "    Error reading file " << prnsol << " (line " << il
-                << ").\n";
-      fprnsol.close();
-      return false;
-    }
-    // Check node number and store if OK.
-    if (inode < 1 || inode > nNodes) {
-      std::cerr << m_className << "::SetWeightingField:\n";
-      std::cerr << "    Node number " << inode << " out of range\n";
-      std::cerr << "    on potential file " << prnsol << " (line " << il
-                << ").\n";
-      ok = false;
-    } else {
-      nodes[inode - 1].w[iw] = volt;
-      nread++;
-    }
-  }
-  // Close the file.
-  fprnsol.close();
-  // Tell how many lines read.
-  std::cout << m_className << "::SetWeightingField:\n";
-  std::cout << "    Read " << nread << " potentials from file " << prnsol
-            << ".\n";
-  // Check the number of nodes.
-  if (nread != nNodes) {
-    std::cerr << m_className << "::SetWeightingField:\n";
-    std::cerr << "    Number of nodes read (" << nread << ") "
-              << "    on potential file " << prnsol << "\n";
-    std::cerr << "    does not match the node list (" << nNodes << ").\n";
-    ok = false;
+  if (!ReadAnsysPotentials(prnsol, "SetWeightingField", potentials, nread,
+                           ok)) {
+    return false;
   }
 
+  // Add the weighting field (or replace the one with the same label).
+  const int iw = AddWeightingField(label);
+  SetWeightingPotentials(iw, potentials);
+
   // Set the ready flag.
   wfieldsOk[iw] = ok;
   if (!ok) {
@@ -852,30 +641,19 @@ void ComponentAnsys121::ElectricField(const double xin, const double yin,
   }
 }
 
-void ComponentAnsys121::WeightingField(const double xin, const double yin,
-                                       const double zin, double& wx, double& wy,
-                                       double& wz, const std::string& label) {
+void ComponentAnsys121::WeightingFieldFromHandle(const double xin,
+                                                 const double yin,
+                                                 const double zin, double& wx,
+                                                 double& wy, double& wz,
+                                                 const int iw) {
   // Initial values
   wx = wy = wz = 0;
 
   // Do not proceed if not properly initialised.
   if (!m_ready) return;
 
-  // Look for the label.
-  int iw = 0;
-  bool found = false;
-  for (int i = nWeightingFields; i--;) {
-    if (wfields[i] == label) {
-      iw = i;
-      found = true;
-      break;
-    }
-  }
-
-  // Do not proceed if the requested weighting field does not exist.
-  if (!found) return;
-  // Check if the weighting field is properly initialised.
-  if (!wfieldsOk[iw]) return;
+  // Check if the weighting field exists and is properly initialised.
+  if (iw < 0 || iw >= nWeightingFields || !wfieldsOk[iw]) return;
 
   // Copy the coordinates.
   double x = xin, y = yin, z = zin;
@@ -897,73 +675,73 @@ void ComponentAnsys121::WeightingField(const double xin, const double yin,
   if (m_debug) {
     PrintElement("WeightingField", x, y, z, t1, t2, t3, t4, element, 8, iw);
   }
-  const Node& n0 = nodes[element.emap[0]];
-  const Node& n1 = nodes[element.emap[1]];
-  const Node& n2 = nodes[element.emap[2]];
-  const Node& n3 = nodes[element.emap[3]];
-  const Node& n4 = nodes[element.emap[4]];
-  const Node& n5 = nodes[element.emap[5]];
+  const double w0 = m_wpot[iw][element.emap[0]];
+  const double w1 = m_wpot[iw][element.emap[1]];
+  const double w2 = m_wpot[iw][element.emap[2]];
+  const double w3 = m_wpot[iw][element.emap[3]];
+  const double w4 = m_wpot[iw][element.emap[4]];
+  const double w5 = m_wpot[iw][element.emap[5]];
   // Calculate quadrilateral field, which can degenerate to a triangular field
   const double invdet = 1. / det;
   if (elements[imap].degenerate) {
-    wx = -(n0.w[iw] * (4 * t1 - 1) * jac[0][1] +
-           n1.w[iw] * (4 * t2 - 1) * jac[1][1] +
-           n2.w[iw] * (4 * t3 - 1) * jac[2][1] +
-           n3.w[iw] * (4 * t2 * jac[0][1] + 4 * t1 * jac[1][1]) +
-           n4.w[iw] * (4 * t3 * jac[0][1] + 4 * t1 * jac[2][1]) +
-           n5.w[iw] * (4 * t3 * jac[1][1] + 4 * t2 * jac[2][1])) *
+    wx = -(w0 * (4 * t1 - 1) * jac[0][1] +
+           w1 * (4 * t2 - 1) * jac[1][1] +
+           w2 * (4 * t3 - 1) * jac[2][1] +
+           w3 * (4 * t2 * jac[0][1] + 4 * t1 * jac[1][1]) +
+           w4 * (4 * t3 * jac[0][1] + 4 * t1 * jac[2][1]) +
+           w5 * (4 * t3 * jac[1][1] + 4 * t2 * jac[2][1])) *
          invdet;
-    wy = -(n0.w[iw] * (4 * t1 - 1) * jac[0][2] +
-           n1.w[iw] * (4 * t2 - 1) * jac[1][2] +
-           n2.w[iw] * (4 * t3 - 1) * jac[2][2] +
-           n3.w[iw] * (4 * t2 * jac[0][2] + 4 * t1 * jac[1][2]) +
-           n4.w[iw] * (4 * t3 * jac[0][2] + 4 * t1 * jac[2][2]) +
-           n5.w[iw] * (4 * t3 * jac[1][2] + 4 * t2 * jac[2][2])) *
+    wy = -(w0 * (4 * t1 - 1) * jac[0][2] +
+           w1 * (4 * t2 - 1) * jac[1][2] +
+           w2 * (4 * t3 - 1) * jac[2][2] +
+           w3 * (4 * t2 * jac[0][2] + 4 * t1 * jac[1][2]) +
+           w4 * (4 * t3 * jac[0][2] + 4 * t1 * jac[2][2]) +
+           w5 * (4 * t3 * jac[1][2] + 4 * t2 * jac[2][2])) *
          invdet;
   } else {
-    const Node& n6 = nodes[element.emap[6]];
-    const Node& n7 = nodes[element.emap[7]];
-    wx = -(n0.w[iw] * ((1 - t2) * (2 * t1 + t2) * jac[0][0] +
-                       (1 - t1) * (t1 + 2 * t2) * jac[1][0]) *
+    const double w6 = m_wpot[iw][element.emap[6]];
+    const double w7 = m_wpot[iw][element.emap[7]];
+    wx = -(w0 * ((1 - t2) * (2 * t1 + t2) * jac[0][0] +
+                 (1 - t1) * (t1 + 2 * t2) * jac[1][0]) *
                0.25 +
-           n1.w[iw] * ((1 - t2) * (2 * t1 - t2) * jac[0][0] -
-                       (1 + t1) * (t1 - 2 * t2) * jac[1][0]) *
+           w1 * ((1 - t2) * (2 * t1 - t2) * jac[0][0] -
+                 (1 + t1) * (t1 - 2 * t2) * jac[1][0]) *
                0.25 +
-           n2.w[iw] * ((1 + t2) * (2 * t1 + t2) * jac[0][0] +
-                       (1 + t1) * (t1 + 2 * t2) * jac[1][0]) *
+           w2 * ((1 + t2) * (2 * t1 + t2) * jac[0][0] +
+                 (1 + t1) * (t1 + 2 * t2) * jac[1][0]) *
                0.25 +
-           n3.w[iw] * ((1 + t2) * (2 * t1 - t2) * jac[0][0] -
-                       (1 - t1) * (t1 - 2 * t2) * jac[1][0]) *
+           w3 * ((1 + t2) * (2 * t1 - t2) * jac[0][0] -
+                 (1 - t1) * (t1 - 2 * t2) * jac[1][0]) *
                0.25 +
-           n4.w[iw] * (t1 * (t2 - 1) * jac[0][0] +
-                       (t1 - 1) * (t1 + 1) * jac[1][0] * 0.5) +
-           n5.w[iw] * ((1 - t2) * (1 + t2) * jac[0][0] * 0.5 -
-                       (1 + t1) * t2 * jac[1][0]) +
-           n6.w[iw] * (-t1 * (1 + t2) * jac[0][0] +
-                       (1 - t1) * (1 + t1) * jac[1][0] * 0.5) +
-           n7.w[iw] * ((t2 - 1) * (1 + t2) * jac[0][0] * 0.5 +
-                       (t1 - 1) * t2 * jac[1][0])) *
+           w4 * (t1 * (t2 - 1) * jac[0][0] +
+                 (t1 - 1) * (t1 + 1) * jac[1][0] * 0.5) +
+           w5 * ((1 - t2) * (1 + t2) * jac[0][0] * 0.5 -
+                 (1 + t1) * t2 * jac[1][0]) +
+           w6 * (-t1 * (1 + t2) * jac[0][0] +
+                 (1 - t1) * (1 + t1) * jac[1][0] * 0.5) +
+           w7 * ((t2 - 1) * (1 + t2) * jac[0][0] * 0.5 +
+                 (t1 - 1) * t2 * jac[1][0])) *
          invdet;
-    wy = -(n0.w[iw] * ((1 - t2) * (2 * t1 + t2) * jac[0][1] +
-                       (1 - t1) * (t1 + 2 * t2) * jac[1][1]) *
+    wy = -(w0 * ((1 - t2) * (2 * t1 + t2) * jac[0][1] +
+                 (1 - t1) * (t1 + 2 * t2) * jac[1][1]) *
                0.25 +
-           n1.w[iw] * ((1 - t2) * (2 * t1 - t2) * jac[0][1] -
-                       (1 + t1) * (t1 - 2 * t2) * jac[1][1]) *
+           w1 * ((1 - t2) * (2 * t1 - t2) * jac[0][1] -
+                 (1 + t1) * (t1 - 2 * t2) * jac[1][1]) *
                0.25 +
-           n2.w[iw] * ((1 + t2) * (2 * t1 + t2) * jac[0][1] +
-                       (1 + t1) * (t1 + 2 * t2) * jac[1][1]) *
+           w2 * ((1 + t2) * (2 * t1 + t2) * jac[0][1] +
+                 (1 + t1) * (t1 + 2 * t2) * jac[1][1]) *
                0.25 +
-           n3.w[iw] * ((1 + t2) * (2 * t1 - t2) * jac[0][1] -
-                       (1 - t1) * (t1 - 2 * t2) * jac[1][1]) *
+           w3 * ((1 + t2) * (2 * t1 - t2) * jac[0][1] -
+                 (1 - t1) * (t1 - 2 * t2) * jac[1][1]) *
                0.25 +
-           n4.w[iw] * (t1 * (t2 - 1) * jac[0][1] +
-                       (t1 - 1) * (t1 + 1) * jac[1][1] * 0.5) +
-           n5.w[iw] * ((1 - t2) * (1 + t2) * jac[0][1] * 0.5 -
-                       (1 + t1) * t2 * jac[1][1]) +
-           n6.w[iw] * (-t1 * (1 + t2) * jac[0][1] +
-                       (1 - t1) * (1 + t1) * jac[1][1] * 0.5) +
-           n7.w[iw] * ((t2 - 1) * (t2 + 1) * jac[0][1] * 0.5 +
-                       (t1 - 1) * t2 * jac[1][1])) *
+           w4 * (t1 * (t2 - 1) * jac[0][1] +
+                 (t1 - 1) * (t1 + 1) * jac[1][1] * 0.5) +
+           w5 * ((1 - t2) * (1 + t2) * jac[0][1] * 0.5 -
+                 (1 + t1) * t2 * jac[1][1]) +
+           w6 * (-t1 * (1 + t2) * jac[0][1] +
+                 (1 - t1) * (1 + t1) * jac[1][1] * 0.5) +
+           w7 * ((t2 - 1) * (t2 + 1) * jac[0][1] * 0.5 +
+                 (t1 - 1) * t2 * jac[1][1])) *
          invdet;
   }
 
@@ -971,27 +749,15 @@ void ComponentAnsys121::WeightingField(const double xin, const double yin,
   UnmapFields(wx, wy, wz, x, y, z, xmirr, ymirr, zmirr, rcoordinate, rotation);
 }
 
-double ComponentAnsys121::WeightingPotential(const double xin, const double yin,
-                                             const double zin,
-                                             const std::string& label) {
+double ComponentAnsys121::WeightingPotentialFromHandle(const double xin,
+                                                       const double yin,
+                                                       const double zin,
+                                                       const int iw) {
   // Do not proceed if not properly initialised.
   if (!m_ready) return 0.;
 
-  // Look for the label.
-  int iw = 0;
-  bool found = false;
-  for (int i = nWeightingFields; i--;) {
-    if (wfields[i] == label) {
-      iw = i;
-      found = true;
-      break;
-    }
-  }
-
-  // Do not proceed if the requested weighting field does not exist.
-  if (!found) return 0.;
-  // Check if the weighting field is properly initialised.
-  if (!wfieldsOk[iw]) return 0.;
+  // Check if the weighting field exists and is properly initialised.
+  if (iw < 0 || iw >= nWeightingFields || !wfieldsOk[iw]) return 0.;
 
   // Copy the coordinates.
   double x = xin, y = yin, z = zin;
@@ -1014,28 +780,28 @@ double ComponentAnsys121::WeightingPotential(const double xin, const double yin,
     PrintElement("WeightingPotential", x, y, z, t1, t2, t3, t4, element, 8, iw);
   }
   // Calculate quadrilateral field, which can degenerate to a triangular field
-  const Node& n0 = nodes[element.emap[0]];
-  const Node& n1 = nodes[element.emap[1]];
-  const Node& n2 = nodes[element.emap[2]];
-  const Node& n3 = nodes[element.emap[3]];
-  const Node& n4 = nodes[element.emap[4]];
-  const Node& n5 = nodes[element.emap[5]];
+  const double w0 = m_wpot[iw][element.emap[0]];
+  const double w1 = m_wpot[iw][element.emap[1]];
+  const double w2 = m_wpot[iw][element.emap[2]];
+  const double w3 = m_wpot[iw][element.emap[3]];
+  const double w4 = m_wpot[iw][element.emap[4]];
+  const double w5 = m_wpot[iw][element.emap[5]];
   if (element.degenerate) {
-    return n0.w[iw] * t1 * (2 * t1 - 1) + n1.w[iw] * t2 * (2 * t2 - 1) +
-           n2.w[iw] * t3 * (2 * t3 - 1) + 4 * n3.w[iw] * t1 * t2 +
-           4 * n4.w[iw] * t1 * t3 + 4 * n5.w[iw] * t2 * t3;
-  }
-
-  const Node& n6 = nodes[element.emap[6]];
-  const Node& n7 = nodes[element.emap[7]];
-  return -n0.w[iw] * (1 - t1) * (1 - t2) * (1 + t1 + t2) * 0.25 -
-         n1.w[iw] * (1 + t1) * (1 - t2) * (1 - t1 + t2) * 0.25 -
-         n2.w[iw] * (1 + t1) * (1 + t2) * (1 - t1 - t2) * 0.25 -
-         n3.w[iw] * (1 - t1) * (1 + t2) * (1 + t1 - t2) * 0.25 +
-         n4.w[iw] * (1 - t1) * (1 + t1) * (1 - t2) * 0.5 +
-         n5.w[iw] * (1 + t1) * (1 + t2) * (1 - t2) * 0.5 +
-         n6.w[iw] * (1 - t1) * (1 + t1) * (1 + t2) * 0.5 +
-         n7.w[iw] * (1 - t1) * (1 + t2) * (1 - t2) * 0.5;
+    return w0 * t1 * (2 * t1 - 1) + w1 * t2 * (2 * t2 - 1) +
+           w2 * t3 * (2 * t3 - 1) + 4 * w3 * t1 * t2 +
+           4 * w4 * t1 * t3 + 4 * w5 * t2 * t3;
+  }
+
+  const double w6 = m_wpot[iw][element.emap[6]];
+  const double w7 = m_wpot[iw][element.emap[7]];
+  return -w0 * (1 - t1) * (1 - t2) * (1 + t1 + t2) * 0.25 -
+         w1 * (1 + t1) * (1 - t2) * (1 - t1 + t2) * 0.25 -
+         w2 * (1 + t1) * (1 + t2) * (1 - t1 - t2) * 0.25 -
+         w3 * (1 - t1) * (1 + t2) * (1 + t1 - t2) * 0.25 +
+         w4 * (1 - t1) * (1 + t1) * (1 - t2) * 0.5 +
+         w5 * (1 + t1) * (1 + t2) * (1 - t2) * 0.5 +
+         w6 * (1 - t1) * (1 + t1) * (1 + t2) * 0.5 +
+         w7 * (1 - t1) * (1 + t2) * (1 - t2) * 0.5;
 }
 
 Medium* ComponentAnsys121::GetMedium(const double xin, const double yin,
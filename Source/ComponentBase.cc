@@ -1,6 +1,23 @@
 #include "ComponentBase.hh"
+#include <algorithm>
 #include <iostream>
 
+namespace {
+
+/// Make a context the active one of the calling thread, while in scope.
+class ContextGuard {
+ public:
+  ContextGuard(Garfield::FieldQueryContext& context)
+      : m_previous(&Garfield::FieldQueryContext::Current()) {
+    Garfield::SetThreadFieldQueryContext(&context);
+  }
+  ~ContextGuard() { Garfield::SetThreadFieldQueryContext(m_previous); }
+
+ private:
+  Garfield::FieldQueryContext* m_previous;
+};
+}
+
 namespace Garfield {
 
 ComponentBase::ComponentBase() {}
@@ -21,6 +38,44 @@ Medium* ComponentBase::GetMedium(const double x, const double y,
   return m_geometry->GetMedium(x, y, z);
 }
 
+void ComponentBase::ElectricField(FieldQueryContext& context, const double x,
+                                  const double y, const double z, double& ex,
+                                  double& ey, double& ez, double& v,
+                                  Medium*& m, int& status) {
+  ContextGuard guard(context);
+  ElectricField(x, y, z, ex, ey, ez, v, m, status);
+}
+
+void ComponentBase::ElectricField(FieldQueryContext& context, const double x,
+                                  const double y, const double z, double& ex,
+                                  double& ey, double& ez, Medium*& m,
+                                  int& status) {
+  ContextGuard guard(context);
+  ElectricField(x, y, z, ex, ey, ez, m, status);
+}
+
+Medium* ComponentBase::GetMedium(FieldQueryContext& context, const double x,
+                                 const double y, const double z) {
+  ContextGuard guard(context);
+  return GetMedium(x, y, z);
+}
+
+void ComponentBase::ElectricFieldBatch(const size_t n, const double* x,
+                                       const double* y, const double* z,
+                                       double* ex, double* ey, double* ez,
+                                       double* v, Medium** m, int* status) {
+  if (v) {
+    for (size_t i = 0; i < n; ++i) {
+      ElectricField(x[i], y[i], z[i], ex[i], ey[i], ez[i], v[i], m[i],
+                    status[i]);
+    }
+    return;
+  }
+  for (size_t i = 0; i < n; ++i) {
+    ElectricField(x[i], y[i], z[i], ex[i], ey[i], ez[i], m[i], status[i]);
+  }
+}
+
 void ComponentBase::Clear() {
   m_geometry = nullptr;
   Reset();
@@ -45,6 +100,46 @@ double ComponentBase::WeightingPotential(const double /*x*/, const double /*y*/,
   return 0.;
 }
 
+int ComponentBase::GetWeightingFieldHandle(const std::string& label) {
+  return m_handleLabels.Find(label);
+}
+
+void ComponentBase::WeightingFieldFromHandle(const double x, const double y,
+                                             const double z, double& wx,
+                                             double& wy, double& wz,
+                                             const int handle) {
+  const std::string* label = m_handleLabels.Get(handle);
+  if (!label) {
+    wx = wy = wz = 0.;
+    return;
+  }
+  WeightingField(x, y, z, wx, wy, wz, *label);
+}
+
+double ComponentBase::WeightingPotentialFromHandle(const double x,
+                                                   const double y,
+                                                   const double z,
+                                                   const int handle) {
+  const std::string* label = m_handleLabels.Get(handle);
+  return label ? WeightingPotential(x, y, z, *label) : 0.;
+}
+
+int ComponentBase::HandleLabels::Find(const std::string& label) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  const auto it = std::find(m_labels.begin(), m_labels.end(), label);
+  if (it != m_labels.end()) return it - m_labels.begin();
+  m_labels.push_back(label);
+  return m_labels.size() - 1;
+}
+
+const std::string* ComponentBase::HandleLabels::Get(const int handle) const {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  if (handle < 0 || handle >= static_cast<int>(m_labels.size())) {
+    return nullptr;
+  }
+  return &m_labels[handle];
+}
+
 void ComponentBase::MagneticField(const double x, const double y,
                                   const double z, double& bx, double& by,
                                   double& bz, int& status) {
@@ -494,6 +494,7 @@ bool ComponentCST::Initialise(std::string elist, std::string nlist,
   // Establish the ranges
   SetRange();
   UpdatePeriodicity();
+  PrepareElementSearch();
   return true;
 }
 
@@ -755,6 +756,7 @@ bool ComponentCST::Initialise(std::string dataFile, std::string unit) {
 
   SetRange();
   UpdatePeriodicity();
+  PrepareElementSearch();
   return true;
 }
 
@@ -1003,6 +1005,26 @@ void ComponentCST::ElectricField(const double xin, const double yin,
   ElectricFieldBinary(xin, yin, zin, ex, ey, ez, volt, m, status, true);
 }
 
+void ComponentCST::WeightingFieldFromHandle(const double x, const double y,
+                                            const double z, double& wx,
+                                            double& wy, double& wz,
+                                            const int iw) {
+  // The weighting potentials are stored per label.
+  if (iw < 0 || iw >= (int)wfields.size()) {
+    wx = wy = wz = 0.;
+    return;
+  }
+  WeightingField(x, y, z, wx, wy, wz, wfields[iw]);
+}
+
+double ComponentCST::WeightingPotentialFromHandle(const double x,
+                                                  const double y,
+                                                  const double z,
+                                                  const int iw) {
+  if (iw < 0 || iw >= (int)wfields.size()) return 0.;
+  return WeightingPotential(x, y, z, wfields[iw]);
+}
+
 void ComponentCST::WeightingField(const double xin, const double yin,
                                   const double zin, double& wx, double& wy,
                                   double& wz, const std::string& label) {
@@ -1291,6 +1313,46 @@ void ComponentCST::UpdatePeriodicity() {
   UpdatePeriodicityCommon();
 }
 
+void ComponentCST::WriteSnapshotData(std::vector<char>& buffer) const {
+  const uint32_t n[3] = {m_nx, m_ny, m_nz};
+  Append(buffer, n, sizeof(n));
+  AppendVector(buffer, m_xlines);
+  AppendVector(buffer, m_ylines);
+  AppendVector(buffer, m_zlines);
+  AppendVector(buffer, m_potential);
+  AppendVector(buffer, m_elementMaterial);
+  const uint64_t nW = m_weightingFields.size();
+  Append(buffer, &nW, sizeof(nW));
+  for (const auto& wfield : m_weightingFields) {
+    const std::vector<char> label(wfield.first.begin(), wfield.first.end());
+    AppendVector(buffer, label);
+    AppendVector(buffer, wfield.second);
+  }
+}
+
+bool ComponentCST::ReadSnapshotData(SnapshotReader& in) {
+  uint32_t n[3];
+  uint64_t nW = 0;
+  if (!in.Read(n, sizeof(n)) || !in.ReadVector(m_xlines) ||
+      !in.ReadVector(m_ylines) || !in.ReadVector(m_zlines) ||
+      !in.ReadVector(m_potential) || !in.ReadVector(m_elementMaterial) ||
+      !in.Read(&nW, sizeof(nW))) {
+    return false;
+  }
+  m_nx = n[0];
+  m_ny = n[1];
+  m_nz = n[2];
+  m_weightingFields.clear();
+  for (uint64_t i = 0; i < nW; ++i) {
+    std::vector<char> label;
+    std::vector<float> values;
+    if (!in.ReadVector(label) || !in.ReadVector(values)) return false;
+    m_weightingFields[std::string(label.begin(), label.end())].swap(values);
+  }
+  return m_xlines.size() == m_nx && m_ylines.size() == m_ny &&
+         m_zlines.size() == m_nz;
+}
+
 void ComponentCST::GetAspectRatio(const unsigned int element, double& dmin,
                                   double& dmax) {
   if ((int)element >= nElements) {
@@ -0,0 +1,669 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+
+#include "ComponentAnalyticField.hh"
+#include "ComponentCache.hh"
+#include "Medium.hh"
+
+namespace {
+
+const char CacheMagic[8] = {'G', 'C', 'A', 'C', 'H', 'E', '0', '2'};
+
+void Corner(const unsigned int i, const double* x0, const double* dx,
+            double* x) {
+  for (unsigned int j = 0; j < 3; ++j) {
+    x[j] = (i >> j) & 1 ? x0[j] + dx[j] : x0[j];
+  }
+}
+
+// Trilinear interpolation of the corner values f at local coordinates u.
+void Trilinear(const double f[8][4], const double* u, double* out) {
+  out[0] = out[1] = out[2] = out[3] = 0.;
+  for (unsigned int i = 0; i < 8; ++i) {
+    double w = 1.;
+    for (unsigned int j = 0; j < 3; ++j) w *= (i >> j) & 1 ? u[j] : 1. - u[j];
+    for (unsigned int k = 0; k < 4; ++k) out[k] += w * f[i][k];
+  }
+}
+
+template <typename T>
+void Write(std::ostream& out, const T& value) {
+  out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template <typename T>
+bool Read(std::istream& in, T& value) {
+  in.read(reinterpret_cast<char*>(&value), sizeof(T));
+  return in.good();
+}
+
+// Distance between a point and an interval, taking into account
+// periodic copies of the point (if s > 0).
+double Distance(double x, const double xmin, const double xmax,
+                const double s) {
+  if (s > 0.) {
+    // Move the point to the copy closest to the centre of the interval.
+    const double xc = 0.5 * (xmin + xmax);
+    x -= s * std::round((x - xc) / s);
+  }
+  if (x < xmin) return xmin - x;
+  if (x > xmax) return x - xmax;
+  return 0.;
+}
+}
+
+namespace Garfield {
+
+ComponentCache::ComponentCache() : ComponentBase() {
+  m_className = "ComponentCache";
+}
+
+void ComponentCache::SetComponent(ComponentBase* c) {
+  if (!c) {
+    std::cerr << m_className << "::SetComponent: Null pointer.\n";
+    return;
+  }
+  if (c == this) {
+    std::cerr << m_className << "::SetComponent: Cannot cache itself.\n";
+    return;
+  }
+  m_component = c;
+  ClearCache();
+}
+
+void ComponentCache::SetArea(const double xmin, const double ymin,
+                             const double zmin, const double xmax,
+                             const double ymax, const double zmax) {
+  if (xmin >= xmax || ymin >= ymax || zmin >= zmax) {
+    std::cerr << m_className << "::SetArea: Invalid range.\n";
+    return;
+  }
+  m_xmin[0] = xmin;
+  m_xmin[1] = ymin;
+  m_xmin[2] = zmin;
+  m_xmax[0] = xmax;
+  m_xmax[1] = ymax;
+  m_xmax[2] = zmax;
+  m_hasArea = true;
+  ClearCache();
+}
+
+void ComponentCache::SetTolerance(const double tol) {
+  if (tol <= 0.) {
+    std::cerr << m_className << "::SetTolerance: Tolerance must be > 0.\n";
+    return;
+  }
+  m_tolerance = tol;
+  ClearCache();
+}
+
+void ComponentCache::SetRefinement(const unsigned int minDepth,
+                                   const unsigned int maxDepth) {
+  if (minDepth > maxDepth || maxDepth > 20) {
+    std::cerr << m_className << "::SetRefinement:\n"
+              << "    Depths must satisfy min <= max <= 20.\n";
+    return;
+  }
+  m_minDepth = minDepth;
+  m_maxDepth = maxDepth;
+  ClearCache();
+}
+
+void ComponentCache::ClearCache() {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_root.reset();
+  m_wires.clear();
+  m_charges.clear();
+  m_initialised = false;
+  m_nCells = 0;
+  m_nInterpolated = 0;
+  m_nExact = 0;
+}
+
+void ComponentCache::PrintStatistics() const {
+  std::cout << m_className << "::PrintStatistics:\n"
+            << "    Cells:                " << m_nCells << "\n";
+  if (!m_debug) {
+    std::cout << "    Queries are only counted in debug mode.\n";
+    return;
+  }
+  std::cout << "    Interpolated queries: " << m_nInterpolated << "\n"
+            << "    Exact queries:        " << m_nExact << "\n";
+}
+
+void ComponentCache::ElectricField(const double x, const double y,
+                                   const double z, double& ex, double& ey,
+                                   double& ez, Medium*& m, int& status) {
+  double v = 0.;
+  Evaluate(x, y, z, ex, ey, ez, v, m, status, false);
+}
+
+void ComponentCache::ElectricField(const double x, const double y,
+                                   const double z, double& ex, double& ey,
+                                   double& ez, double& v, Medium*& m,
+                                   int& status) {
+  Evaluate(x, y, z, ex, ey, ez, v, m, status, true);
+}
+
+void ComponentCache::Evaluate(const double x, const double y, const double z,
+                              double& ex, double& ey, double& ez, double& v,
+                              Medium*& m, int& status, const bool opt) {
+  ex = ey = ez = v = 0.;
+  m = nullptr;
+  if (!m_component) {
+    std::cerr << m_className << "::ElectricField: Component not defined.\n";
+    status = -10;
+    return;
+  }
+  if (!m_initialised.load(std::memory_order_acquire)) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_initialised.load(std::memory_order_relaxed)) {
+      Initialise();
+      m_initialised.store(true, std::memory_order_release);
+    }
+  }
+  const double p[3] = {x, y, z};
+  bool inside = m_root != nullptr;
+  for (unsigned int j = 0; j < 3 && inside; ++j) {
+    if (p[j] < m_xmin[j] || p[j] > m_xmax[j]) inside = false;
+  }
+  if (!inside) {
+    if (m_debug) ++m_nExact;
+    if (opt) {
+      m_component->ElectricField(x, y, z, ex, ey, ez, v, m, status);
+    } else {
+      m_component->ElectricField(x, y, z, ex, ey, ez, m, status);
+    }
+    return;
+  }
+
+  // Walk down the tree, sampling cells on the way if needed.
+  double x0[3] = {m_xmin[0], m_xmin[1], m_xmin[2]};
+  double dx[3] = {m_xmax[0] - m_xmin[0], m_xmax[1] - m_xmin[1],
+                  m_xmax[2] - m_xmin[2]};
+  Node* node = m_root.get();
+  unsigned int depth = 0;
+  while (true) {
+    int state = node->state.load(std::memory_order_acquire);
+    if (state == Empty) {
+      std::lock_guard<std::mutex> lock(StripeMutex(*node));
+      if (node->state.load(std::memory_order_relaxed) == Empty) {
+        Sample(*node, x0, dx, depth);
+      }
+      state = node->state.load(std::memory_order_relaxed);
+    }
+    if (state != Split) break;
+    unsigned int k = 0;
+    for (unsigned int j = 0; j < 3; ++j) {
+      dx[j] *= 0.5;
+      if (p[j] >= x0[j] + dx[j]) {
+        x0[j] += dx[j];
+        k |= 1u << j;
+      }
+    }
+    node = &node->children[k];
+    ++depth;
+  }
+
+  if (node->state.load(std::memory_order_relaxed) == Exact) {
+    if (m_debug) ++m_nExact;
+    if (opt) {
+      m_component->ElectricField(x, y, z, ex, ey, ez, v, m, status);
+    } else {
+      m_component->ElectricField(x, y, z, ex, ey, ez, m, status);
+    }
+    return;
+  }
+
+  // Trilinear interpolation.
+  double u[3];
+  for (unsigned int j = 0; j < 3; ++j) {
+    u[j] = std::min(std::max((p[j] - x0[j]) / dx[j], 0.), 1.);
+  }
+  double f[4];
+  Trilinear(node->f, u, f);
+  ex = f[0];
+  ey = f[1];
+  ez = f[2];
+  v = f[3];
+  m = node->medium;
+  status = 0;
+  if (m_debug) ++m_nInterpolated;
+}
+
+bool ComponentCache::GetComponentBox(double* bmin, double* bmax) const {
+  if (!m_component->GetBoundingBox(bmin[0], bmin[1], bmin[2], bmax[0],
+                                   bmax[1], bmax[2])) {
+    return false;
+  }
+  for (unsigned int j = 0; j < 3; ++j) {
+    if (!std::isfinite(bmin[j]) || !std::isfinite(bmax[j]) ||
+        bmin[j] >= bmax[j]) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void ComponentCache::Fingerprint(const double* xmin, const double* xmax,
+                                 double f[9][4]) const {
+  // Exact field at the corners and at the centre of the cache area.
+  const double dx[3] = {xmax[0] - xmin[0], xmax[1] - xmin[1],
+                        xmax[2] - xmin[2]};
+  for (unsigned int i = 0; i < 9; ++i) {
+    double x[3] = {xmin[0] + 0.5 * dx[0], xmin[1] + 0.5 * dx[1],
+                   xmin[2] + 0.5 * dx[2]};
+    if (i < 8) Corner(i, xmin, dx, x);
+    Medium* m = nullptr;
+    int status = 0;
+    m_component->ElectricField(x[0], x[1], x[2], f[i][0], f[i][1], f[i][2],
+                               f[i][3], m, status);
+    if (status != 0) f[i][0] = f[i][1] = f[i][2] = f[i][3] = 0.;
+  }
+}
+
+bool ComponentCache::Initialise() {
+  if (!m_hasArea && !GetComponentBox(m_xmin, m_xmax)) {
+    std::cerr << m_className << "::Initialise:\n"
+              << "    Cache area is not defined. Call SetArea.\n"
+              << "    The field will be computed without caching.\n";
+    return false;
+  }
+  double vmin = 0., vmax = 0.;
+  m_vScale = 0.;
+  if (m_component->GetVoltageRange(vmin, vmax)) m_vScale = vmax - vmin;
+  // Near wires and point charges the field cannot be interpolated.
+  m_wires.clear();
+  m_charges.clear();
+  m_period[0] = m_period[1] = 0.;
+  auto cmp = dynamic_cast<ComponentAnalyticField*>(m_component);
+  if (cmp) {
+    const unsigned int nWires = cmp->GetNumberOfWires();
+    for (unsigned int i = 0; i < nWires; ++i) {
+      double x = 0., y = 0., d = 0., v = 0., u = 0., q = 0.;
+      std::string label;
+      int ntrap = 0;
+      if (!cmp->GetWire(i, x, y, d, v, label, u, q, ntrap)) continue;
+      m_wires.push_back({x, y, 0.5 * d});
+    }
+    const unsigned int nCharges = cmp->GetNumberOfCharges();
+    for (unsigned int i = 0; i < nCharges; ++i) {
+      double x = 0., y = 0., z = 0., q = 0.;
+      if (cmp->GetCharge(i, x, y, z, q)) m_charges.push_back({x, y, z});
+    }
+    cmp->GetPeriodicityX(m_period[0]);
+    cmp->GetPeriodicityY(m_period[1]);
+  }
+  m_root.reset(new Node());
+  m_nCells = 1;
+  return true;
+}
+
+void ComponentCache::Sample(Node& node, const double* x0, const double* dx,
+                            const unsigned int depth) {
+  bool ok = depth >= m_minDepth;
+  bool active = false;
+  Medium* medium = nullptr;
+  if (ok) {
+    // Evaluate the field at the corners.
+    for (unsigned int i = 0; i < 8; ++i) {
+      double x[3];
+      Corner(i, x0, dx, x);
+      double* f = node.f[i];
+      Medium* m = nullptr;
+      int status = 0;
+      m_component->ElectricField(x[0], x[1], x[2], f[0], f[1], f[2], f[3], m,
+                                 status);
+      if (status != 0 || !m) {
+        ok = false;
+        continue;
+      }
+      active = true;
+      if (!medium) medium = m;
+      if (m != medium) ok = false;
+    }
+  }
+  // Wires and charges may sit between the sampling points.
+  if (ok && IsNearSingularity(x0, dx)) ok = false;
+  // Compare the interpolated and the exact field at the centre of the cell
+  // and at the centres of its faces.
+  const double tol2 = m_tolerance * m_tolerance;
+  for (unsigned int k = 0; k < 7 && ok; ++k) {
+    double u[3] = {0.5, 0.5, 0.5};
+    if (k > 0) u[(k - 1) / 2] = (k - 1) % 2;
+    const double x = x0[0] + u[0] * dx[0];
+    const double y = x0[1] + u[1] * dx[1];
+    const double z = x0[2] + u[2] * dx[2];
+    double ex = 0., ey = 0., ez = 0., v = 0.;
+    Medium* m = nullptr;
+    int status = 0;
+    m_component->ElectricField(x, y, z, ex, ey, ez, v, m, status);
+    if (status != 0 || m != medium) {
+      ok = false;
+      break;
+    }
+    double f[4];
+    Trilinear(node.f, u, f);
+    const double de2 = (f[0] - ex) * (f[0] - ex) + (f[1] - ey) * (f[1] - ey) +
+                       (f[2] - ez) * (f[2] - ez);
+    const double e2 = ex * ex + ey * ey + ez * ez;
+    if (de2 > tol2 * e2) ok = false;
+    if (m_vScale > 0. && fabs(f[3] - v) > m_tolerance * m_vScale) ok = false;
+  }
+  if (ok) {
+    node.medium = medium;
+    node.state.store(Interpolate, std::memory_order_release);
+  } else if (depth < m_minDepth || (active && depth < m_maxDepth)) {
+    node.children.reset(new Node[8]);
+    m_nCells += 8;
+    node.state.store(Split, std::memory_order_release);
+  } else {
+    // No corner in an active medium, or maximum depth reached.
+    node.state.store(Exact, std::memory_order_release);
+  }
+}
+
+bool ComponentCache::IsNearSingularity(const double* x0,
+                                       const double* dx) const {
+  // A wire or charge is considered close if it is within half a cell
+  // size of the cell.
+  const double rxy = 0.5 * std::max(dx[0], dx[1]);
+  for (const auto& w : m_wires) {
+    const double ux = Distance(w[0], x0[0], x0[0] + dx[0], m_period[0]);
+    const double uy = Distance(w[1], x0[1], x0[1] + dx[1], m_period[1]);
+    const double r = rxy + w[2];
+    if (ux * ux + uy * uy < r * r) return true;
+  }
+  const double r = 0.5 * std::max({dx[0], dx[1], dx[2]});
+  for (const auto& c : m_charges) {
+    const double ux = Distance(c[0], x0[0], x0[0] + dx[0], m_period[0]);
+    const double uy = Distance(c[1], x0[1], x0[1] + dx[1], m_period[1]);
+    const double uz = Distance(c[2], x0[2], x0[2] + dx[2], 0.);
+    if (ux * ux + uy * uy + uz * uz < r * r) return true;
+  }
+  return false;
+}
+
+bool ComponentCache::Save(const std::string& filename) {
+  std::lock_guard<std::mutex> lock(m_mutex);
+  if (!m_root) {
+    std::cerr << m_className << "::Save: Cache is empty.\n";
+    return false;
+  }
+  std::ofstream out(filename, std::ios::binary);
+  if (!out) {
+    std::cerr << m_className << "::Save: Could not open " << filename << ".\n";
+    return false;
+  }
+  out.write(CacheMagic, sizeof(CacheMagic));
+  // Type and bounding box of the cached component.
+  const std::string& type = m_component->GetClassName();
+  Write(out, static_cast<uint32_t>(type.size()));
+  out.write(type.data(), type.size());
+  double bmin[3] = {0., 0., 0.}, bmax[3] = {0., 0., 0.};
+  Write(out, static_cast<uint8_t>(GetComponentBox(bmin, bmax)));
+  for (unsigned int j = 0; j < 3; ++j) {
+    Write(out, bmin[j]);
+    Write(out, bmax[j]);
+  }
+  for (unsigned int j = 0; j < 3; ++j) {
+    Write(out, m_xmin[j]);
+    Write(out, m_xmax[j]);
+  }
+  Write(out, m_tolerance);
+  Write(out, static_cast<uint32_t>(m_minDepth));
+  Write(out, static_cast<uint32_t>(m_maxDepth));
+  double f[9][4];
+  Fingerprint(m_xmin, m_xmax, f);
+  out.write(reinterpret_cast<const char*>(f), sizeof(f));
+  WriteNode(out, *m_root);
+  if (!out) {
+    std::cerr << m_className << "::Save: Error writing " << filename << ".\n";
+    return false;
+  }
+  std::cout << m_className << "::Save: Wrote " << m_nCells << " cells to "
+            << filename << ".\n";
+  return true;
+}
+
+void ComponentCache::WriteNode(std::ostream& out, const Node& node) const {
+  const int state = node.state.load(std::memory_order_relaxed);
+  Write(out, static_cast<uint8_t>(state));
+  if (state == Interpolate) {
+    out.write(reinterpret_cast<const char*>(node.f), sizeof(node.f));
+  } else if (state == Split) {
+    for (unsigned int i = 0; i < 8; ++i) WriteNode(out, node.children[i]);
+  }
+}
+
+bool ComponentCache::Load(const std::string& filename) {
+  if (!m_component) {
+    std::cerr << m_className << "::Load: Component not defined.\n";
+    return false;
+  }
+  std::ifstream in(filename, std::ios::binary);
+  if (!in) {
+    std::cerr << m_className << "::Load: Could not open " << filename << ".\n";
+    return false;
+  }
+  char magic[sizeof(CacheMagic)];
+  in.read(magic, sizeof(magic));
+  if (!in || memcmp(magic, CacheMagic, sizeof(magic)) != 0) {
+    std::cerr << m_className << "::Load: " << filename
+              << " is not a field cache file.\n";
+    return false;
+  }
+  uint32_t nType = 0;
+  std::string type;
+  uint8_t hasBox = 0;
+  double bmin[3], bmax[3];
+  bool ok = Read(in, nType) && nType < 256;
+  if (ok) {
+    type.resize(nType);
+    in.read(&type[0], nType);
+    ok = in.good() && Read(in, hasBox);
+  }
+  for (unsigned int j = 0; j < 3; ++j) {
+    ok = ok && Read(in, bmin[j]) && Read(in, bmax[j]);
+  }
+  double xmin[3], xmax[3];
+  double tolerance = 0.;
+  uint32_t minDepth = 0, maxDepth = 0;
+  for (unsigned int j = 0; j < 3; ++j) {
+    ok = ok && Read(in, xmin[j]) && Read(in, xmax[j]) && xmin[j] < xmax[j];
+  }
+  ok = ok && Read(in, tolerance) && Read(in, minDepth) && Read(in, maxDepth);
+  double f[9][4];
+  if (ok) {
+    in.read(reinterpret_cast<char*>(f), sizeof(f));
+    ok = in.good();
+  }
+  if (!ok || tolerance <= 0. || minDepth > maxDepth || maxDepth > 20) {
+    std::cerr << m_className << "::Load: Invalid header in " << filename
+              << ".\n";
+    return false;
+  }
+  // Check that the file was made for this component and these settings.
+  if (type != m_component->GetClassName()) {
+    std::cerr << m_className << "::Load: " << filename << " was made for a "
+              << type << ", not a " << m_component->GetClassName() << ".\n";
+    return false;
+  }
+  double cmin[3] = {0., 0., 0.}, cmax[3] = {0., 0., 0.};
+  const bool hasComponentBox = GetComponentBox(cmin, cmax);
+  bool match = hasComponentBox == (hasBox != 0);
+  for (unsigned int j = 0; j < 3 && match && hasComponentBox; ++j) {
+    match = bmin[j] == cmin[j] && bmax[j] == cmax[j];
+  }
+  if (!match) {
+    std::cerr << m_className << "::Load: " << filename << " was made for a "
+              << "component with a different bounding box.\n";
+    return false;
+  }
+  // Area used if none is set explicitly.
+  if (!m_hasArea && hasComponentBox) {
+    std::copy(cmin, cmin + 3, m_xmin);
+    std::copy(cmax, cmax + 3, m_xmax);
+  }
+  if (m_hasArea || hasComponentBox) {
+    for (unsigned int j = 0; j < 3 && match; ++j) {
+      match = xmin[j] == m_xmin[j] && xmax[j] == m_xmax[j];
+    }
+  }
+  if (!match) {
+    std::cerr << m_className << "::Load: Cache area in " << filename
+              << " differs from the current one.\n";
+    return false;
+  }
+  double g[9][4];
+  Fingerprint(xmin, xmax, g);
+  for (unsigned int i = 0; i < 9 && match; ++i) {
+    double d2 = 0., e2 = 0.;
+    for (unsigned int k = 0; k < 3; ++k) {
+      d2 += (f[i][k] - g[i][k]) * (f[i][k] - g[i][k]);
+      e2 += g[i][k] * g[i][k];
+    }
+    const double dv = fabs(f[i][3] - g[i][3]);
+    match = d2 <= 1.e-12 * e2 && dv <= 1.e-6 * (1. + fabs(g[i][3]));
+  }
+  if (!match) {
+    std::cerr << m_className << "::Load: The field of the component differs "
+              << "from the one in " << filename << ".\n";
+    return false;
+  }
+  if (tolerance != m_tolerance || minDepth != m_minDepth ||
+      maxDepth != m_maxDepth) {
+    std::cerr << m_className << "::Load: Tolerance or refinement depth in "
+              << filename << " (" << tolerance << ", " << minDepth << ", "
+              << maxDepth << ") differ from the current settings.\n";
+    return false;
+  }
+
+  std::lock_guard<std::mutex> lock(m_mutex);
+  for (unsigned int j = 0; j < 3; ++j) {
+    m_xmin[j] = xmin[j];
+    m_xmax[j] = xmax[j];
+  }
+  m_hasArea = true;
+  m_nInterpolated = 0;
+  m_nExact = 0;
+  Initialise();
+  const double dx[3] = {xmax[0] - xmin[0], xmax[1] - xmin[1],
+                        xmax[2] - xmin[2]};
+  if (!ReadNode(in, *m_root, xmin, dx)) {
+    std::cerr << m_className << "::Load: Error reading " << filename << ".\n";
+    m_root.reset();
+    m_initialised = false;
+    m_hasArea = false;
+    return false;
+  }
+  m_initialised = true;
+  std::cout << m_className << "::Load: Read " << m_nCells << " cells from "
+            << filename << ".\n";
+  return true;
+}
+
+bool ComponentCache::ReadNode(std::istream& in, Node& node, const double* x0,
+                              const double* dx) {
+  uint8_t state = 0;
+  if (!Read(in, state) || state > Split) return false;
+  if (state == Interpolate) {
+    in.read(reinterpret_cast<char*>(node.f), sizeof(node.f));
+    if (!in) return false;
+    // Media cannot be stored; look them up again (and resample the cell
+    // if the medium at its centre is not an active one).
+    const double xc = x0[0] + 0.5 * dx[0];
+    const double yc = x0[1] + 0.5 * dx[1];
+    const double zc = x0[2] + 0.5 * dx[2];
+    node.medium = m_component->GetMedium(xc, yc, zc);
+    if (!node.medium || !node.medium->IsDriftable()) state = Empty;
+  } else if (state == Split) {
+    node.children.reset(new Node[8]);
+    m_nCells += 8;
+    const double h[3] = {0.5 * dx[0], 0.5 * dx[1], 0.5 * dx[2]};
+    for (unsigned int i = 0; i < 8; ++i) {
+      double x[3];
+      Corner(i, x0, h, x);
+      if (!ReadNode(in, node.children[i], x, h)) return false;
+    }
+  }
+  node.state.store(state, std::memory_order_relaxed);
+  return true;
+}
+
+bool ComponentCache::GetVoltageRange(double& vmin, double& vmax) {
+  if (!m_component) return false;
+  return m_component->GetVoltageRange(vmin, vmax);
+}
+
+void ComponentCache::WeightingField(const double x, const double y,
+                                    const double z, double& wx, double& wy,
+                                    double& wz, const std::string& label) {
+  wx = wy = wz = 0.;
+  if (m_component) m_component->WeightingField(x, y, z, wx, wy, wz, label);
+}
+
+double ComponentCache::WeightingPotential(const double x, const double y,
+                                          const double z,
+                                          const std::string& label) {
+  if (!m_component) return 0.;
+  return m_component->WeightingPotential(x, y, z, label);
+}
+
+void ComponentCache::MagneticField(const double x, const double y,
+                                   const double z, double& bx, double& by,
+                                   double& bz, int& status) {
+  if (!m_component) {
+    ComponentBase::MagneticField(x, y, z, bx, by, bz, status);
+    return;
+  }
+  m_component->MagneticField(x, y, z, bx, by, bz, status);
+}
+
+Medium* ComponentCache::GetMedium(const double x, const double y,
+                                  const double z) {
+  if (!m_component) return ComponentBase::GetMedium(x, y, z);
+  return m_component->GetMedium(x, y, z);
+}
+
+bool ComponentCache::IsReady() {
+  return m_component && m_component->IsReady();
+}
+
+bool ComponentCache::GetBoundingBox(double& xmin, double& ymin, double& zmin,
+                                    double& xmax, double& ymax, double& zmax) {
+  if (!m_component) return false;
+  return m_component->GetBoundingBox(xmin, ymin, zmin, xmax, ymax, zmax);
+}
+
+bool ComponentCache::IsWireCrossed(const double x0, const double y0,
+                                   const double z0, const double x1,
+                                   const double y1, const double z1,
+                                   double& xc, double& yc, double& zc) {
+  if (!m_component) return false;
+  return m_component->IsWireCrossed(x0, y0, z0, x1, y1, z1, xc, yc, zc);
+}
+
+bool ComponentCache::IsInTrapRadius(const double q0, const double x0,
+                                    const double y0, const double z0,
+                                    double& xw, double& yw, double& rw) {
+  if (!m_component) return false;
+  return m_component->IsInTrapRadius(q0, x0, y0, z0, xw, yw, rw);
+}
+
+void ComponentCache::Reset() {
+  m_component = nullptr;
+  m_hasArea = false;
+  ClearCache();
+}
+
+void ComponentCache::UpdatePeriodicity() {
+  if (m_debug) {
+    std::cerr << m_className << "::UpdatePeriodicity:\n"
+              << "    Periodicities are handled by the cached component.\n";
+  }
+}
+}
@@ -2,12 +2,64 @@
 
 #include <math.h>
 #include <stdlib.h>
+#include <algorithm>
 #include <fstream>
 #include <iostream>
+#include <limits>
 #include <map>
 #include <sstream>
 
 #include "ComponentComsol.hh"
+#include "TextFile.hh"
+
+namespace {
+
+const size_t NotFound = std::numeric_limits<size_t>::max();
+
+/// Find the first line (starting from a given index) satisfying a condition.
+size_t FindLine(const Garfield::TextFile& file, const size_t first,
+                const std::function<bool(const std::string&)>& match) {
+  const size_t n = file.GetNumberOfLines();
+  for (size_t i = first; i < n; ++i) {
+    if (match(file.GetLine(i))) return i;
+  }
+  return NotFound;
+}
+
+bool ReadNumber(const char*& p, double& x) {
+  return Garfield::TextFile::ReadDouble(p, x);
+}
+
+bool ReadNumber(const char*& p, int& x) {
+  return Garfield::TextFile::ReadInteger(p, x);
+}
+
+/// Read (in parallel) a table of numbers with one row per line, starting at
+/// a given line. Returns the index of the first row which could not be read.
+template <typename T>
+size_t ReadTable(const Garfield::TextFile& file, const size_t first,
+                 const size_t nRows, const unsigned int nCols,
+                 std::vector<T>& values) {
+  values.assign(nRows * nCols, T(0));
+  std::vector<char> errors(nRows, 0);
+  file.ParallelFor(nRows, [&](const size_t begin, const size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+      if (first + i >= file.GetNumberOfLines()) {
+        errors[i] = 1;
+        continue;
+      }
+      const char* p = file.GetLine(first + i);
+      for (unsigned int j = 0; j < nCols; ++j) {
+        if (ReadNumber(p, values[i * nCols + j])) continue;
+        errors[i] = 1;
+        break;
+      }
+    }
+  });
+  const auto it = std::find(errors.begin(), errors.end(), 1);
+  return it == errors.end() ? NotFound : it - errors.begin();
+}
+}
 
 namespace Garfield {
 
@@ -41,8 +93,6 @@ bool ComponentComsol::Initialise(std::string mesh, std::string mplist,
 
   double unit = 100.0;  // m
 
-  std::string line;
-
   // Open the materials file.
   materials.clear();
   std::ifstream fmplist;
@@ -81,34 +131,58 @@ bool ComponentComsol::Initialise(std::string mesh, std::string mplist,
   }
   fmplist.close();
 
+  auto printMissing = [this](const std::string& what,
+                             const std::string& filename) {
+    std::cerr << m_className << "::Initialise:\n"
+              << "    Could not find " << what << " in " << filename << ".\n";
+  };
+  auto printError = [this](const std::string& filename, const size_t il) {
+    std::cerr << m_className << "::Initialise:\n"
+              << "    Error reading file " << filename << " (line " << il
+              << ").\n";
+  };
+
   nodes.clear();
-  std::ifstream fmesh;
-  fmesh.open(mesh.c_str(), std::ios::in);
-  if (fmesh.fail()) {
+  TextFile fmesh(m_nReadThreads);
+  if (!fmesh.Read(mesh)) {
     std::cerr << m_className << "::Initialise:\n";
     std::cerr << "    Could not open nodes file " << mesh << " for reading.\n";
     return false;
   }
 
-  do {
-    std::getline(fmesh, line);
-  } while (!ends_with(line, "# number of mesh points"));
-  nNodes = readInt(line);
+  size_t il = FindLine(fmesh, 0, [](const std::string& s) {
+    return ends_with(s, "# number of mesh points");
+  });
+  if (il == NotFound) {
+    printMissing("the number of mesh points", mesh);
+    return false;
+  }
+  nNodes = readInt(fmesh.GetLine(il));
 
   std::cout << m_className << "::Initialise:\n";
   std::cout << "    Read " << nNodes << " nodes from file " << mesh << ".\n";
-  do {
-    std::getline(fmesh, line);
-  } while (line != "# Mesh point coordinates");
+  il = FindLine(fmesh, il, [](const std::string& s) {
+    return s == "# Mesh point coordinates";
+  });
+  if (il == NotFound) {
+    printMissing("the mesh point coordinates", mesh);
+    return false;
+  }
+  std::vector<double> coordinates;
+  size_t bad = ReadTable(fmesh, il + 1, nNodes, 3, coordinates);
+  if (bad != NotFound) {
+    printError(mesh, il + bad + 2);
+    return false;
+  }
+  il += nNodes + 1;
+  nodes.resize(nNodes);
   double minx = 1e100, miny = 1e100, minz = 1e100, maxx = -1e100, maxy = -1e100,
          maxz = -1e100;
   for (int i = 0; i < nNodes; ++i) {
-    Node newNode;
-    fmesh >> newNode.x >> newNode.y >> newNode.z;
-    newNode.x *= unit;
-    newNode.y *= unit;
-    newNode.z *= unit;
-    nodes.push_back(newNode);
+    Node& newNode = nodes[i];
+    newNode.x = coordinates[3 * i] * unit;
+    newNode.y = coordinates[3 * i + 1] * unit;
+    newNode.z = coordinates[3 * i + 2] * unit;
     minx = std::min(minx, newNode.x);
     maxx = std::max(maxx, newNode.x);
     miny = std::min(miny, newNode.y);
@@ -120,40 +194,61 @@ bool ComponentComsol::Initialise(std::string mesh, std::string mplist,
   std::cout << miny << " < y < " << maxy << "\n";
   std::cout << minz << " < z < " << maxz << "\n";
 
-  do {
-    std::getline(fmesh, line);
-  } while (line != "4 tet2 # type name");
-  do {
-    std::getline(fmesh, line);
-  } while (!ends_with(line, "# number of elements"));
-  nElements = readInt(line);
+  il = FindLine(fmesh, il, [](const std::string& s) {
+    return s == "4 tet2 # type name";
+  });
+  if (il != NotFound) {
+    il = FindLine(fmesh, il, [](const std::string& s) {
+      return ends_with(s, "# number of elements");
+    });
+  }
+  if (il == NotFound) {
+    printMissing("the number of tet2 elements", mesh);
+    return false;
+  }
+  nElements = readInt(fmesh.GetLine(il));
   elements.clear();
   std::cout << m_className << "::Initialise:\n";
   std::cout << "    Read " << nElements << " elements from file " << mesh
             << ".\n";
-  std::getline(fmesh, line);
+  // The element list starts after the next (comment) line.
+  std::vector<int> emap;
+  bad = ReadTable(fmesh, il + 2, nElements, 10, emap);
+  if (bad != NotFound) {
+    printError(mesh, il + bad + 3);
+    return false;
+  }
+  il += nElements + 2;
   // elements 6 & 7 are swapped due to differences in COMSOL and ANSYS
   // representation
   int perm[10] = {0, 1, 2, 3, 4, 5, 7, 6, 8, 9};
+  elements.resize(nElements);
   for (int i = 0; i < nElements; ++i) {
-    Element newElement;
+    Element& newElement = elements[i];
     newElement.degenerate = false;
     for (int j = 0; j < 10; ++j) {
-      fmesh >> newElement.emap[perm[j]];
+      newElement.emap[perm[j]] = emap[10 * i + j];
     }
-    elements.push_back(newElement);
   }
 
-  do {
-    std::getline(fmesh, line);
-  } while (line != "# Geometric entity indices");
+  il = FindLine(fmesh, il, [](const std::string& s) {
+    return s == "# Geometric entity indices";
+  });
+  if (il == NotFound) {
+    printMissing("the geometric entity indices", mesh);
+    return false;
+  }
+  std::vector<int> domains;
+  bad = ReadTable(fmesh, il + 1, nElements, 1, domains);
+  if (bad != NotFound) {
+    printError(mesh, il + bad + 2);
+    return false;
+  }
   for (int i = 0; i < nElements; ++i) {
-    int domain;
-    fmesh >> domain;
+    const int domain = domains[i];
     elements[i].matmap = domain2material.count(domain) ? domain2material[domain]
                                                        : m_nMaterials - 1;
   }
-  fmesh.close();
 
   std::map<Node, std::vector<int>, nodeCmp> nodeIdx;
   for (int i = 0; i < nNodes; ++i) {
@@ -161,21 +256,25 @@ bool ComponentComsol::Initialise(std::string mesh, std::string mplist,
   }
   std::cout << "Map size: " << nodeIdx.size() << std::endl;
 
-  std::ifstream ffield;
-  ffield.open(field.c_str(), std::ios::in);
-  if (ffield.fail()) {
+  TextFile ffield(m_nReadThreads);
+  if (!ffield.Read(field)) {
     std::cerr << m_className << "::Initialise:\n";
     std::cerr << "    Could not open field potentials file " << field
               << " for reading.\n";
     return false;
   }
-  do {
-    std::getline(ffield, line);
-  } while (line.substr(0, 81) !=
-           "% x                       y                        z               "
-           "         V (V)");
+  il = FindLine(ffield, 0, [](const std::string& s) {
+    return s.substr(0, 81) ==
+           "% x                       y                        z            "
+           "            V (V)";
+  });
+  if (il == NotFound) {
+    printMissing("the header", field);
+    return false;
+  }
+  ClearWeightingFields();
   {
-    std::istringstream sline(line);
+    std::istringstream sline(ffield.GetLine(il));
     std::string token;
     sline >> token;  // %
     sline >> token;  // x
@@ -186,23 +285,27 @@ bool ComponentComsol::Initialise(std::string mesh, std::string mplist,
     while (sline >> token) {
       std::cout << m_className << "::Initialise:\n";
       std::cout << "    Reading data for weighting field " << token << ".\n";
-      nWeightingFields++;
-      wfields.push_back(token);
-      wfieldsOk.push_back(true);
+      const int iw = AddWeightingField(token);
+      wfieldsOk[iw] = true;
       sline >> token;  // (V)
     }
   }
+  const unsigned int nColumns = 4 + nWeightingFields;
+  std::vector<double> values;
+  bad = ReadTable(ffield, il + 1, nNodes, nColumns, values);
+  if (bad != NotFound) {
+    printError(field, il + bad + 2);
+    return false;
+  }
+  std::vector<std::vector<double> > potentials(
+      nWeightingFields, std::vector<double>(nNodes, 0.));
   for (int i = 0; i < nNodes; ++i) {
+    const double* row = values.data() + i * nColumns;
     Node tmp;
-    ffield >> tmp.x >> tmp.y >> tmp.z >> tmp.v;
-    tmp.x *= unit;
-    tmp.y *= unit;
-    tmp.z *= unit;
-    for (int j = 0; j < nWeightingFields; ++j) {
-      double w;
-      ffield >> w;
-      tmp.w.push_back(w);
-    }
+    tmp.x = row[0] * unit;
+    tmp.y = row[1] * unit;
+    tmp.z = row[2] * unit;
+    tmp.v = row[3];
     int closest = -1;
     double closestDist = 1;
     const unsigned int nIdx = nodeIdx[tmp].size();
@@ -224,7 +327,12 @@ bool ComponentComsol::Initialise(std::string mesh, std::string mplist,
       return false;
     }
     nodes[closest].v = tmp.v;
-    nodes[closest].w = tmp.w;
+    for (int iw = 0; iw < nWeightingFields; ++iw) {
+      potentials[iw][closest] = row[4 + iw];
+    }
+  }
+  for (int iw = 0; iw < nWeightingFields; ++iw) {
+    SetWeightingPotentials(iw, potentials[iw]);
   }
 
   m_ready = true;
@@ -242,6 +350,7 @@ bool ComponentComsol::Initialise(std::string mesh, std::string mplist,
   // Establish the ranges.
   SetRange();
   UpdatePeriodicity();
+  PrepareElementSearch();
   return true;
 }
 
@@ -255,55 +364,46 @@ bool ComponentComsol::SetWeightingField(std::string field, std::string label) {
     return false;
   }
 
-  // Open the voltage list.
-  std::ifstream ffield;
-  ffield.open(field.c_str(), std::ios::in);
-  if (ffield.fail()) {
-    std::cerr << m_className << "::Initialise:\n";
+  // Read the voltage list.
+  TextFile ffield(m_nReadThreads);
+  if (!ffield.Read(field)) {
+    std::cerr << m_className << "::SetWeightingField:\n";
     std::cerr << "    Could not open field potentials file " << field
               << " for reading.\n";
     return false;
   }
-
-  // Check if a weighting field with the same label alm_ready exists.
-  int iw = nWeightingFields;
-  for (int i = nWeightingFields; i--;) {
-    if (wfields[i] == label) {
-      iw = i;
-      break;
-    }
+  const size_t il = FindLine(ffield, 0, [](const std::string& s) {
+    return s ==
+           "% x                       y                        z            "
+           "            V (V)";
+  });
+  if (il == NotFound) {
+    std::cerr << m_className << "::SetWeightingField:\n";
+    std::cerr << "    Could not find the header in " << field << ".\n";
+    return false;
   }
-  if (iw == nWeightingFields) {
-    ++nWeightingFields;
-    wfields.resize(nWeightingFields);
-    wfieldsOk.resize(nWeightingFields);
-    for (int j = 0; j < nNodes; ++j) {
-      nodes[j].w.resize(nWeightingFields);
-    }
-  } else {
-    std::cout << m_className << "::SetWeightingField:\n";
-    std::cout << "    Replacing existing weighting field " << label << ".\n";
+  std::vector<double> values;
+  const size_t bad = ReadTable(ffield, il + 1, nNodes, 4, values);
+  if (bad != NotFound) {
+    std::cerr << m_className << "::SetWeightingField:\n";
+    std::cerr << "    Error reading file " << field << " (line "
+              << il + bad + 2 << ").\n";
+    return false;
   }
-  wfields[iw] = label;
-  wfieldsOk[iw] = false;
+
   std::map<Node, std::vector<int>, nodeCmp> nodeIdx;
   for (int i = 0; i < nNodes; ++i) {
     nodeIdx[nodes[i]].push_back(i);
   }
   std::cout << "Map size: " << nodeIdx.size() << std::endl;
 
-  std::string line;
-  do {
-    std::getline(ffield, line);
-  } while (line !=
-           "% x                       y                        z               "
-           "         V (V)");
+  std::vector<double> potentials(nNodes, 0.);
   for (int i = 0; i < nNodes; ++i) {
     Node tmp;
-    ffield >> tmp.x >> tmp.y >> tmp.z >> tmp.v;
-    tmp.x *= unit;
-    tmp.y *= unit;
-    tmp.z *= unit;
+    tmp.x = values[4 * i] * unit;
+    tmp.y = values[4 * i + 1] * unit;
+    tmp.z = values[4 * i + 2] * unit;
+    tmp.v = values[4 * i + 3];
     int closest = -1;
     double closestDist = 1;
     const unsigned int nIdx = nodeIdx[tmp].size();
@@ -324,9 +424,13 @@ bool ComponentComsol::SetWeightingField(std::string field, std::string label) {
                 << tmp.x << " " << tmp.y << " " << tmp.z << "\n.";
       return false;
     }
-    nodes[closest].w[iw] = tmp.v;
+    potentials[closest] = tmp.v;
   }
 
+  // Add the weighting field (or replace the one with the same label).
+  const int iw = AddWeightingField(label);
+  SetWeightingPotentials(iw, potentials);
+  wfieldsOk[iw] = true;
   return true;
 }
 
@@ -441,30 +545,19 @@ void ComponentComsol::ElectricField(const double xin, const double yin,
   }
 }
 
-void ComponentComsol::WeightingField(const double xin, const double yin,
-                                     const double zin, double& wx, double& wy,
-                                     double& wz, const std::string& label) {
+void ComponentComsol::WeightingFieldFromHandle(const double xin,
+                                               const double yin,
+                                               const double zin, double& wx,
+                                               double& wy, double& wz,
+                                               const int iw) {
   // Initial values
   wx = wy = wz = 0;
 
   // Do not proceed if not properly initialised.
   if (!m_ready) return;
 
-  // Look for the label.
-  int iw = 0;
-  bool found = false;
-  for (int i = nWeightingFields; i--;) {
-    if (wfields[i] == label) {
-      iw = i;
-      found = true;
-      break;
-    }
-  }
-
-  // Do not proceed if the requested weighting field does not exist.
-  if (!found) return;
-  // Check if the weighting field is properly initialised.
-  if (!wfieldsOk[iw]) return;
+  // Check if the weighting field exists and is properly initialised.
+  if (iw < 0 || iw >= nWeightingFields || !wfieldsOk[iw]) return;
 
   // Copy the coordinates.
   double x = xin, y = yin, z = zin;
@@ -486,78 +579,66 @@ void ComponentComsol::WeightingField(const double xin, const double yin,
   if (m_debug) {
     PrintElement("WeightingField", x, y, z, t1, t2, t3, t4, element, 10, iw);
   }
-  const Node& n0 = nodes[element.emap[0]];
-  const Node& n1 = nodes[element.emap[1]];
-  const Node& n2 = nodes[element.emap[2]];
-  const Node& n3 = nodes[element.emap[3]];
-  const Node& n4 = nodes[element.emap[4]];
-  const Node& n5 = nodes[element.emap[5]];
-  const Node& n6 = nodes[element.emap[6]];
-  const Node& n7 = nodes[element.emap[7]];
-  const Node& n8 = nodes[element.emap[8]];
-  const Node& n9 = nodes[element.emap[9]];
+  const double w0 = m_wpot[iw][element.emap[0]];
+  const double w1 = m_wpot[iw][element.emap[1]];
+  const double w2 = m_wpot[iw][element.emap[2]];
+  const double w3 = m_wpot[iw][element.emap[3]];
+  const double w4 = m_wpot[iw][element.emap[4]];
+  const double w5 = m_wpot[iw][element.emap[5]];
+  const double w6 = m_wpot[iw][element.emap[6]];
+  const double w7 = m_wpot[iw][element.emap[7]];
+  const double w8 = m_wpot[iw][element.emap[8]];
+  const double w9 = m_wpot[iw][element.emap[9]];
   // Tetrahedral field
-  wx = -(n0.w[iw] * (4 * t1 - 1) * jac[0][1] +
-         n1.w[iw] * (4 * t2 - 1) * jac[1][1] +
-         n2.w[iw] * (4 * t3 - 1) * jac[2][1] +
-         n3.w[iw] * (4 * t4 - 1) * jac[3][1] +
-         n4.w[iw] * (4 * t2 * jac[0][1] + 4 * t1 * jac[1][1]) +
-         n5.w[iw] * (4 * t3 * jac[0][1] + 4 * t1 * jac[2][1]) +
-         n6.w[iw] * (4 * t4 * jac[0][1] + 4 * t1 * jac[3][1]) +
-         n7.w[iw] * (4 * t3 * jac[1][1] + 4 * t2 * jac[2][1]) +
-         n8.w[iw] * (4 * t4 * jac[1][1] + 4 * t2 * jac[3][1]) +
-         n9.w[iw] * (4 * t4 * jac[2][1] + 4 * t3 * jac[3][1])) /
+  wx = -(w0 * (4 * t1 - 1) * jac[0][1] +
+         w1 * (4 * t2 - 1) * jac[1][1] +
+         w2 * (4 * t3 - 1) * jac[2][1] +
+         w3 * (4 * t4 - 1) * jac[3][1] +
+         w4 * (4 * t2 * jac[0][1] + 4 * t1 * jac[1][1]) +
+         w5 * (4 * t3 * jac[0][1] + 4 * t1 * jac[2][1]) +
+         w6 * (4 * t4 * jac[0][1] + 4 * t1 * jac[3][1]) +
+         w7 * (4 * t3 * jac[1][1] + 4 * t2 * jac[2][1]) +
+         w8 * (4 * t4 * jac[1][1] + 4 * t2 * jac[3][1]) +
+         w9 * (4 * t4 * jac[2][1] + 4 * t3 * jac[3][1])) /
        det;
 
-  wy = -(n0.w[iw] * (4 * t1 - 1) * jac[0][2] +
-         n1.w[iw] * (4 * t2 - 1) * jac[1][2] +
-         n2.w[iw] * (4 * t3 - 1) * jac[2][2] +
-         n3.w[iw] * (4 * t4 - 1) * jac[3][2] +
-         n4.w[iw] * (4 * t2 * jac[0][2] + 4 * t1 * jac[1][2]) +
-         n5.w[iw] * (4 * t3 * jac[0][2] + 4 * t1 * jac[2][2]) +
-         n6.w[iw] * (4 * t4 * jac[0][2] + 4 * t1 * jac[3][2]) +
-         n7.w[iw] * (4 * t3 * jac[1][2] + 4 * t2 * jac[2][2]) +
-         n8.w[iw] * (4 * t4 * jac[1][2] + 4 * t2 * jac[3][2]) +
-         n9.w[iw] * (4 * t4 * jac[2][2] + 4 * t3 * jac[3][2])) /
+  wy = -(w0 * (4 * t1 - 1) * jac[0][2] +
+         w1 * (4 * t2 - 1) * jac[1][2] +
+         w2 * (4 * t3 - 1) * jac[2][2] +
+         w3 * (4 * t4 - 1) * jac[3][2] +
+         w4 * (4 * t2 * jac[0][2] + 4 * t1 * jac[1][2]) +
+         w5 * (4 * t3 * jac[0][2] + 4 * t1 * jac[2][2]) +
+         w6 * (4 * t4 * jac[0][2] + 4 * t1 * jac[3][2]) +
+         w7 * (4 * t3 * jac[1][2] + 4 * t2 * jac[2][2]) +
+         w8 * (4 * t4 * jac[1][2] + 4 * t2 * jac[3][2]) +
+         w9 * (4 * t4 * jac[2][2] + 4 * t3 * jac[3][2])) /
        det;
 
-  wz = -(n0.w[iw] * (4 * t1 - 1) * jac[0][3] +
-         n1.w[iw] * (4 * t2 - 1) * jac[1][3] +
-         n2.w[iw] * (4 * t3 - 1) * jac[2][3] +
-         n3.w[iw] * (4 * t4 - 1) * jac[3][3] +
-         n4.w[iw] * (4 * t2 * jac[0][3] + 4 * t1 * jac[1][3]) +
-         n5.w[iw] * (4 * t3 * jac[0][3] + 4 * t1 * jac[2][3]) +
-         n6.w[iw] * (4 * t4 * jac[0][3] + 4 * t1 * jac[3][3]) +
-         n7.w[iw] * (4 * t3 * jac[1][3] + 4 * t2 * jac[2][3]) +
-         n8.w[iw] * (4 * t4 * jac[1][3] + 4 * t2 * jac[3][3]) +
-         n9.w[iw] * (4 * t4 * jac[2][3] + 4 * t3 * jac[3][3])) /
+  wz = -(w0 * (4 * t1 - 1) * jac[0][3] +
+         w1 * (4 * t2 - 1) * jac[1][3] +
+         w2 * (4 * t3 - 1) * jac[2][3] +
+         w3 * (4 * t4 - 1) * jac[3][3] +
+         w4 * (4 * t2 * jac[0][3] + 4 * t1 * jac[1][3]) +
+         w5 * (4 * t3 * jac[0][3] + 4 * t1 * jac[2][3]) +
+         w6 * (4 * t4 * jac[0][3] + 4 * t1 * jac[3][3]) +
+         w7 * (4 * t3 * jac[1][3] + 4 * t2 * jac[2][3]) +
+         w8 * (4 * t4 * jac[1][3] + 4 * t2 * jac[3][3]) +
+         w9 * (4 * t4 * jac[2][3] + 4 * t3 * jac[3][3])) /
        det;
 
   // Transform field to global coordinates
   UnmapFields(wx, wy, wz, x, y, z, xmirr, ymirr, zmirr, rcoordinate, rotation);
 }
 
-double ComponentComsol::WeightingPotential(const double xin, const double yin,
-                                           const double zin,
-                                           const std::string& label) {
+double ComponentComsol::WeightingPotentialFromHandle(const double xin,
+                                                     const double yin,
+                                                     const double zin,
+                                                     const int iw) {
   // Do not proceed if not properly initialised.
   if (!m_ready) return 0.;
 
-  // Look for the label.
-  int iw = 0;
-  bool found = false;
-  for (int i = nWeightingFields; i--;) {
-    if (wfields[i] == label) {
-      iw = i;
-      found = true;
-      break;
-    }
-  }
-
-  // Do not proceed if the requested weighting field does not exist.
-  if (!found) return 0.;
-  // Check if the weighting field is properly initialised.
-  if (!wfieldsOk[iw]) return 0.;
+  // Check if the weighting field exists and is properly initialised.
+  if (iw < 0 || iw >= nWeightingFields || !wfieldsOk[iw]) return 0.;
 
   // Copy the coordinates.
   double x = xin, y = yin, z = zin;
@@ -579,22 +660,22 @@ double ComponentComsol::WeightingPotential(const double xin, const double yin,
     PrintElement("WeightingPotential", x, y, z, t1, t2, t3, t4, element, 10,
                  iw);
   }
-  const Node& n0 = nodes[element.emap[0]];
-  const Node& n1 = nodes[element.emap[1]];
-  const Node& n2 = nodes[element.emap[2]];
-  const Node& n3 = nodes[element.emap[3]];
-  const Node& n4 = nodes[element.emap[4]];
-  const Node& n5 = nodes[element.emap[5]];
-  const Node& n6 = nodes[element.emap[6]];
-  const Node& n7 = nodes[element.emap[7]];
-  const Node& n8 = nodes[element.emap[8]];
-  const Node& n9 = nodes[element.emap[9]];
+  const double w0 = m_wpot[iw][element.emap[0]];
+  const double w1 = m_wpot[iw][element.emap[1]];
+  const double w2 = m_wpot[iw][element.emap[2]];
+  const double w3 = m_wpot[iw][element.emap[3]];
+  const double w4 = m_wpot[iw][element.emap[4]];
+  const double w5 = m_wpot[iw][element.emap[5]];
+  const double w6 = m_wpot[iw][element.emap[6]];
+  const double w7 = m_wpot[iw][element.emap[7]];
+  const double w8 = m_wpot[iw][element.emap[8]];
+  const double w9 = m_wpot[iw][element.emap[9]];
   // Tetrahedral field
-  return n0.w[iw] * t1 * (2 * t1 - 1) + n1.w[iw] * t2 * (2 * t2 - 1) +
-         n2.w[iw] * t3 * (2 * t3 - 1) + n3.w[iw] * t4 * (2 * t4 - 1) +
-         4 * n4.w[iw] * t1 * t2 + 4 * n5.w[iw] * t1 * t3 +
-         4 * n6.w[iw] * t1 * t4 + 4 * n7.w[iw] * t2 * t3 +
-         4 * n8.w[iw] * t2 * t4 + 4 * n9.w[iw] * t3 * t4;
+  return w0 * t1 * (2 * t1 - 1) + w1 * t2 * (2 * t2 - 1) +
+         w2 * t3 * (2 * t3 - 1) + w3 * t4 * (2 * t4 - 1) +
+         4 * w4 * t1 * t2 + 4 * w5 * t1 * t3 +
+         4 * w6 * t1 * t4 + 4 * w7 * t2 * t3 +
+         4 * w8 * t2 * t4 + 4 * w9 * t3 * t4;
 }
 
 Medium* ComponentComsol::GetMedium(const double xin, const double yin,
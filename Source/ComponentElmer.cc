@@ -2,10 +2,13 @@
 
 #include <math.h>
 #include <stdlib.h>
+#include <algorithm>
+#include <array>
 #include <fstream>
 #include <iostream>
 
 #include "ComponentElmer.hh"
+#include "TextFile.hh"
 
 namespace {
 
@@ -21,6 +24,52 @@ void PrintErrorOpeningFile(const std::string& hdr, const std::string& filetype,
             << filename << " for reading.\n";
   std::cerr << "    The file perhaps does not exist.\n";
 }
+
+/// Read the potentials from an Elmer result file, which are preceded
+/// by a header (ending with "Perm:") and the permutation map.
+bool ReadPotentials(const std::string& filename, const std::string& hdr,
+                    const int nNodes, const unsigned int nThreads,
+                    std::vector<double>& v) {
+  Garfield::TextFile file(nThreads);
+  if (!file.Read(filename)) {
+    PrintErrorOpeningFile(hdr, "potentials", filename);
+    return false;
+  }
+  // Read past the header.
+  const size_t nLines = file.GetNumberOfLines();
+  size_t first = 0;
+  while (first < nLines &&
+         !Garfield::TextFile::FirstTokenIs(file.GetLine(first), "Perm:")) {
+    ++first;
+  }
+  // Should have stopped: if not, print error message.
+  if (first == nLines) {
+    std::cerr << hdr << "\n    Error reading past header of potentials file "
+              << filename << ".\n";
+    return false;
+  }
+  // Skip the permutation map (number of lines = nNodes).
+  first += 1 + nNodes;
+  const size_t n = std::max(nNodes, 0);
+  v.assign(n, 0.);
+  std::vector<char> errors(n, 0);
+  file.ParallelFor(n, [&](const size_t begin, const size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+      if (first + i >= nLines) {
+        errors[i] = 1;
+        continue;
+      }
+      const char* p = file.GetLine(first + i);
+      errors[i] = !Garfield::TextFile::ReadDouble(p, v[i]);
+    }
+  });
+  const auto it = std::find(errors.begin(), errors.end(), 1);
+  if (it != errors.end()) {
+    PrintErrorReadingFile(hdr, filename, first + (it - errors.begin()) + 1);
+    return false;
+  }
+  return true;
+}
 }
 
 namespace Garfield {
@@ -68,7 +117,6 @@ bool ComponentElmer::Initialise(const std::string& header,
   // Temporary variables for use in file reading
   char* token = NULL;
   bool readerror = false;
-  bool readstop = false;
   int il = 0;
 
   // Read the header to get the number of nodes and elements.
@@ -88,13 +136,6 @@ bool ComponentElmer::Initialise(const std::string& header,
   // Close the header file.
   fheader.close();
 
-  // Open the nodes list.
-  std::ifstream fnodes;
-  fnodes.open(nlist.c_str(), std::ios::in);
-  if (fnodes.fail()) {
-    PrintErrorOpeningFile(hdr, "nodes", nlist);
-  }
-
   // Check the value of the unit.
   double funit;
   if (strcmp(unit.c_str(), "mum") == 0 || strcmp(unit.c_str(), "micron") == 0 ||
@@ -117,86 +158,44 @@ bool ComponentElmer::Initialise(const std::string& header,
   if (m_debug) std::cout << hdr << " Unit scaling factor = " << funit << ".\n";
 
   // Read the nodes from the file.
-  for (il = 0; il < nNodes; il++) {
-    // Get a line from the nodes file.
-    fnodes.getline(line, size, '\n');
-
-    // Ignore the first two characters.
-    token = strtok(line, " ");
-    token = strtok(NULL, " ");
-
-    // Get the node coordinates.
-    token = strtok(NULL, " ");
-    double xnode = ReadDouble(token, -1, readerror);
-    token = strtok(NULL, " ");
-    double ynode = ReadDouble(token, -1, readerror);
-    token = strtok(NULL, " ");
-    double znode = ReadDouble(token, -1, readerror);
-    if (readerror) {
-      PrintErrorReadingFile(hdr, nlist, il);
-      fnodes.close();
-      return false;
-    }
-
-    // Set up and create a new node.
-    Node newNode;
-    newNode.w.clear();
-    newNode.x = xnode * funit;
-    newNode.y = ynode * funit;
-    newNode.z = znode * funit;
-    nodes.push_back(std::move(newNode));
-  }
-
-  // Close the nodes file.
-  fnodes.close();
-
-  // Open the potential file.
-  std::ifstream fvolt;
-  fvolt.open(volt.c_str(), std::ios::in);
-  if (fvolt.fail()) {
-    PrintErrorOpeningFile(hdr, "potentials", volt);
-  }
-
-  // Reset the line counter.
-  il = 1;
-
-  // Read past the header.
-  while (!readstop && fvolt.getline(line, size, '\n')) {
-    token = strtok(line, " ");
-    if (strcmp(token, "Perm:") == 0) readstop = true;
-    il++;
-  }
-
-  // Should have stopped: if not, print error message.
-  if (!readstop) {
-    std::cerr << hdr << "\n    Error reading past header of potentials file "
-              << volt << ".\n";
-    fvolt.close();
+  TextFile fnodes(m_nReadThreads);
+  if (!fnodes.Read(nlist)) {
+    PrintErrorOpeningFile(hdr, "nodes", nlist);
     return false;
   }
-
-  // Read past the permutation map (number of lines = nNodes).
-  for (int tl = 0; tl < nNodes; tl++) {
-    fvolt.getline(line, size, '\n');
-    il++;
+  nodes.clear();
+  nodes.resize(std::max(nNodes, 0));
+  std::vector<char> errors(nodes.size(), 0);
+  fnodes.ParallelFor(nodes.size(), [&](const size_t begin, const size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+      if (i >= fnodes.GetNumberOfLines()) {
+        errors[i] = 1;
+        continue;
+      }
+      // Ignore the first two tokens, then get the node coordinates.
+      const char* p = fnodes.GetLine(i);
+      Node& node = nodes[i];
+      errors[i] = !TextFile::SkipTokens(p, 2) ||
+                  !TextFile::ReadDouble(p, node.x) ||
+                  !TextFile::ReadDouble(p, node.y) ||
+                  !TextFile::ReadDouble(p, node.z);
+      node.x *= funit;
+      node.y *= funit;
+      node.z *= funit;
+    }
+  });
+  const auto itError = std::find(errors.begin(), errors.end(), 1);
+  if (itError != errors.end()) {
+    PrintErrorReadingFile(hdr, nlist, itError - errors.begin());
+    return false;
   }
 
   // Read the potentials.
-  for (int tl = 0; tl < nNodes; tl++) {
-    fvolt.getline(line, size, '\n');
-    token = strtok(line, " ");
-    double v = ReadDouble(token, -1, readerror);
-    if (readerror) {
-      PrintErrorReadingFile(hdr, volt, il);
-      fvolt.close();
-      return false;
-    }
-    // Place the voltage in its appropriate node.
-    nodes[tl].v = v;
+  std::vector<double> potentials;
+  if (!ReadPotentials(volt, hdr, nNodes, m_nReadThreads, potentials)) {
+    return false;
   }
-
-  // Close the potentials file.
-  fvolt.close();
+  for (int i = 0; i < nNodes; ++i) nodes[i].v = potentials[i];
 
   // Open the materials file.
   std::ifstream fmplist;
@@ -269,52 +268,59 @@ bool ComponentElmer::Initialise(const std::string& header,
   }
 
   // Open the elements file.
-  std::ifstream felems;
-  felems.open(elist.c_str(), std::ios::in);
-  if (felems.fail()) {
+  TextFile felems(m_nReadThreads);
+  if (!felems.Read(elist)) {
     PrintErrorOpeningFile(hdr, "elements", elist);
+    return false;
   }
 
+  // Parse the elements in parallel: material index and nodes.
+  // Note: Ordering of Elmer elements can be described in the
+  // ElmerSolver manual (appendix D. at the time of this comment)
+  // If the order read below is compared to the shape functions used
+  // eg. in ElectricField, the order is wrong, but note at the
+  // end of this function the order of elements 5,6,7 will change to
+  // 7,5,6 when actually recorded in newElement.emap to correct for this
+  const size_t nRecords = std::max(nElements, 0);
+  std::vector<std::array<int, 11> > data(nRecords);
+  errors.assign(nRecords, 0);
+  felems.ParallelFor(nRecords, [&](const size_t begin, const size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+      std::array<int, 11>& d = data[i];
+      d.fill(-1);
+      if (i >= felems.GetNumberOfLines()) {
+        errors[i] = 1;
+        continue;
+      }
+      const char* p = felems.GetLine(i);
+      bool error = !TextFile::SkipTokens(p, 1) ||
+                   !TextFile::ReadInteger(p, d[0]) ||
+                   !TextFile::SkipTokens(p, 1);
+      for (unsigned int j = 1; j < 11 && !error; ++j) {
+        error = !TextFile::ReadInteger(p, d[j]);
+      }
+      errors[i] = error;
+    }
+  });
+
   // Read the elements and their material indices.
   elements.clear();
+  elements.reserve(nRecords);
   int highestnode = 0;
   Element newElement;
   for (il = 0; il < nElements; il++) {
-    // Get a line
-    felems.getline(line, size, '\n');
-
-    // Split into tokens.
-    token = strtok(line, " ");
-    // Read the 2nd-order element
-    // Note: Ordering of Elmer elements can be described in the
-    // ElmerSolver manual (appendix D. at the time of this comment)
-    // If the order read below is compared to the shape functions used
-    // eg. in ElectricField, the order is wrong, but note at the
-    // end of this function the order of elements 5,6,7 will change to
-    // 7,5,6 when actually recorded in newElement.emap to correct for this
-    token = strtok(NULL, " ");
-    int imat = ReadInteger(token, -1, readerror) - 1;
-    token = strtok(NULL, " ");
-    token = strtok(NULL, " ");
-    int in0 = ReadInteger(token, -1, readerror);
-    token = strtok(NULL, " ");
-    int in1 = ReadInteger(token, -1, readerror);
-    token = strtok(NULL, " ");
-    int in2 = ReadInteger(token, -1, readerror);
-    token = strtok(NULL, " ");
-    int in3 = ReadInteger(token, -1, readerror);
-    token = strtok(NULL, " ");
-    int in4 = ReadInteger(token, -1, readerror);
-    token = strtok(NULL, " ");
-    int in5 = ReadInteger(token, -1, readerror);
-    token = strtok(NULL, " ");
-    int in6 = ReadInteger(token, -1, readerror);
-    token = strtok(NULL, " ");
-    int in7 = ReadInteger(token, -1, readerror);
-    token = strtok(NULL, " ");
-    int in8 = ReadInteger(token, -1, readerror);
-    token = strtok(NULL, " ");
-    int in9 = ReadInteger(token, -1, readerror);
+    const std::array<int, 11>& d = data[il];
+    const int imat = d[0] - 1;
+    const int in0 = d[1];
+    const int in1 = d[2];
+    const int in2 = d[3];
+    const int in3 = d[4];
+    const int in4 = d[5];
+    const int in5 = d[6];
+    const int in6 = d[7];
+    const int in7 = d[8];
+    const int in8 = d[9];
+    const int in9 = d[10];
 
     if (m_debug && il < 10) {
       std::cout << "    Read nodes " << in0 << ", " << in1 << ", " << in2
@@ -323,9 +329,8 @@ bool ComponentElmer::Initialise(const std::string& header,
     }
 
     // Check synchronisation.
-    if (readerror) {
+    if (errors[il]) {
       PrintErrorReadingFile(hdr, elist, il);
-      felems.close();
       ok = false;
       return false;
     }
@@ -405,9 +410,6 @@ bool ComponentElmer::Initialise(const std::string& header,
     elements.push_back(newElement);
   }
 
-  // Close the elements file.
-  felems.close();
-
   // Set the ready flag.
   if (ok) {
     m_ready = true;
@@ -420,13 +422,12 @@ bool ComponentElmer::Initialise(const std::string& header,
   std::cout << hdr << " Finished.\n";
 
   // Remove weighting fields (if any).
-  wfields.clear();
-  wfieldsOk.clear();
-  nWeightingFields = 0;
+  ClearWeightingFields();
 
   // Establish the ranges.
   SetRange();
   UpdatePeriodicity();
+  PrepareElementSearch();
   return true;
 }
 
@@ -441,84 +442,15 @@ bool ComponentElmer::SetWeightingField(std::string wvolt, std::string label) {
   // Keep track of the success.
   bool ok = true;
 
-  // Open the voltage list.
-  std::ifstream fwvolt;
-  fwvolt.open(wvolt.c_str(), std::ios::in);
-  if (fwvolt.fail()) {
-    PrintErrorOpeningFile(hdr, "potential", wvolt);
-    return false;
-  }
-
-  // Check if a weighting field with the same label already exists.
-  int iw = nWeightingFields;
-  for (int i = nWeightingFields; i--;) {
-    if (wfields[i] == label) {
-      iw = i;
-      break;
-    }
-  }
-  if (iw == nWeightingFields) {
-    ++nWeightingFields;
-    wfields.resize(nWeightingFields);
-    wfieldsOk.resize(nWeightingFields);
-    for (int j = nNodes; j--;) {
-      nodes[j].w.resize(nWeightingFields);
-    }
-  } else {
-    std::cout << hdr << "\n    Replacing existing weighting field " << label
-              << ".\n";
-  }
-  wfields[iw] = label;
-  wfieldsOk[iw] = false;
-
-  // Temporary variables for use in file reading
-  const int size = 100;
-  char line[size];
-  char* token = NULL;
-  bool readerror = false;
-  bool readstop = false;
-  int il = 1;
-
-  // Read past the header.
-  while (!readstop && fwvolt.getline(line, size, '\n')) {
-    token = strtok(line, " ");
-    if (strcmp(token, "Perm:") == 0) readstop = true;
-    il++;
-  }
-
-  // Should have stopped: if not, print error message.
-  if (!readstop) {
-    std::cerr << hdr << "\n    Error reading past header of potentials file "
-              << wvolt << ".\n";
-    fwvolt.close();
-    ok = false;
-    return false;
-  }
-
-  // Read past the permutation map (number of lines = nNodes).
-  for (int tl = 0; tl < nNodes; tl++) {
-    fwvolt.getline(line, size, '\n');
-    il++;
-  }
-
   // Read the potentials.
-  for (int tl = 0; tl < nNodes; tl++) {
-    double v;
-    fwvolt.getline(line, size, '\n');
-    token = strtok(line, " ");
-    v = ReadDouble(token, -1, readerror);
-    if (readerror) {
-      PrintErrorReadingFile(hdr, wvolt, il);
-      fwvolt.close();
-      ok = false;
-      return false;
-    }
-    // Place the weighting potential at its appropriate node and index.
-    nodes[tl].w[iw] = v;
+  std::vector<double> potentials;
+  if (!ReadPotentials(wvolt, hdr, nNodes, m_nReadThreads, potentials)) {
+    return false;
   }
 
-  // Close the potentials file.
-  fwvolt.close();
+  // Add the weighting field (or replace the one with the same label).
+  const int iw = AddWeightingField(label);
+  SetWeightingPotentials(iw, potentials);
   std::cout << hdr << "\n    Read potentials from file " << wvolt << ".\n";
 
   // Set the ready flag.
@@ -643,30 +575,19 @@ void ComponentElmer::ElectricField(const double xin, const double yin,
   if (mat.driftmedium && m && m->IsDriftable()) status = 0;
 }
 
-void ComponentElmer::WeightingField(const double xin, const double yin,
-                                    const double zin, double& wx, double& wy,
-                                    double& wz, const std::string& label) {
+void ComponentElmer::WeightingFieldFromHandle(const double xin,
+                                              const double yin,
+                                              const double zin, double& wx,
+                                              double& wy, double& wz,
+                                              const int iw) {
   // Initial values
   wx = wy = wz = 0;
 
   // Do not proceed if not properly initialised.
   if (!m_ready) return;
 
-  // Look for the label.
-  int iw = 0;
-  bool found = false;
-  for (int i = nWeightingFields; i--;) {
-    if (wfields[i] == label) {
-      iw = i;
-      found = true;
-      break;
-    }
-  }
-
-  // Do not proceed if the requested weighting field does not exist.
-  if (!found) return;
-  // Check if the weighting field is properly initialised.
-  if (!wfieldsOk[iw]) return;
+  // Check if the weighting field exists and is properly initialised.
+  if (iw < 0 || iw >= nWeightingFields || !wfieldsOk[iw]) return;
 
   // Copy the coordinates.
   double x = xin, y = yin, z = zin;
@@ -688,16 +609,16 @@ void ComponentElmer::WeightingField(const double xin, const double yin,
   if (m_debug) {
     PrintElement("WeightingField", x, y, z, t1, t2, t3, t4, element, 10, iw);
   }
-  const Node& n0 = nodes[element.emap[0]];
-  const Node& n1 = nodes[element.emap[1]];
-  const Node& n2 = nodes[element.emap[2]];
-  const Node& n3 = nodes[element.emap[3]];
-  const Node& n4 = nodes[element.emap[4]];
-  const Node& n5 = nodes[element.emap[5]];
-  const Node& n6 = nodes[element.emap[6]];
-  const Node& n7 = nodes[element.emap[7]];
-  const Node& n8 = nodes[element.emap[8]];
-  const Node& n9 = nodes[element.emap[9]];
+  const double w0 = m_wpot[iw][element.emap[0]];
+  const double w1 = m_wpot[iw][element.emap[1]];
+  const double w2 = m_wpot[iw][element.emap[2]];
+  const double w3 = m_wpot[iw][element.emap[3]];
+  const double w4 = m_wpot[iw][element.emap[4]];
+  const double w5 = m_wpot[iw][element.emap[5]];
+  const double w6 = m_wpot[iw][element.emap[6]];
+  const double w7 = m_wpot[iw][element.emap[7]];
+  const double w8 = m_wpot[iw][element.emap[8]];
+  const double w9 = m_wpot[iw][element.emap[9]];
   // Shorthands.
   const double fourt1 = 4 * t1;
   const double fourt2 = 4 * t2;
@@ -705,65 +626,53 @@ void ComponentElmer::WeightingField(const double xin, const double yin,
   const double fourt4 = 4 * t4;
   const double invdet = 1. / det;
   // Tetrahedral field
-  wx = -(n0.w[iw] * (fourt1 - 1) * jac[0][1] +
-         n1.w[iw] * (fourt2 - 1) * jac[1][1] +
-         n2.w[iw] * (fourt3 - 1) * jac[2][1] +
-         n3.w[iw] * (fourt4 - 1) * jac[3][1] +
-         n4.w[iw] * (fourt2 * jac[0][1] + fourt1 * jac[1][1]) +
-         n5.w[iw] * (fourt3 * jac[0][1] + fourt1 * jac[2][1]) +
-         n6.w[iw] * (fourt4 * jac[0][1] + fourt1 * jac[3][1]) +
-         n7.w[iw] * (fourt3 * jac[1][1] + fourt2 * jac[2][1]) +
-         n8.w[iw] * (fourt4 * jac[1][1] + fourt2 * jac[3][1]) +
-         n9.w[iw] * (fourt4 * jac[2][1] + fourt3 * jac[3][1])) *
+  wx = -(w0 * (fourt1 - 1) * jac[0][1] +
+         w1 * (fourt2 - 1) * jac[1][1] +
+         w2 * (fourt3 - 1) * jac[2][1] +
+         w3 * (fourt4 - 1) * jac[3][1] +
+         w4 * (fourt2 * jac[0][1] + fourt1 * jac[1][1]) +
+         w5 * (fourt3 * jac[0][1] + fourt1 * jac[2][1]) +
+         w6 * (fourt4 * jac[0][1] + fourt1 * jac[3][1]) +
+         w7 * (fourt3 * jac[1][1] + fourt2 * jac[2][1]) +
+         w8 * (fourt4 * jac[1][1] + fourt2 * jac[3][1]) +
+         w9 * (fourt4 * jac[2][1] + fourt3 * jac[3][1])) *
        invdet;
-  wy = -(n0.w[iw] * (fourt1 - 1) * jac[0][2] +
-         n1.w[iw] * (fourt2 - 1) * jac[1][2] +
-         n2.w[iw] * (fourt3 - 1) * jac[2][2] +
-         n3.w[iw] * (fourt4 - 1) * jac[3][2] +
-         n4.w[iw] * (fourt2 * jac[0][2] + fourt1 * jac[1][2]) +
-         n5.w[iw] * (fourt3 * jac[0][2] + fourt1 * jac[2][2]) +
-         n6.w[iw] * (fourt4 * jac[0][2] + fourt1 * jac[3][2]) +
-         n7.w[iw] * (fourt3 * jac[1][2] + fourt2 * jac[2][2]) +
-         n8.w[iw] * (fourt4 * jac[1][2] + fourt2 * jac[3][2]) +
-         n9.w[iw] * (fourt4 * jac[2][2] + fourt3 * jac[3][2])) *
+  wy = -(w0 * (fourt1 - 1) * jac[0][2] +
+         w1 * (fourt2 - 1) * jac[1][2] +
+         w2 * (fourt3 - 1) * jac[2][2] +
+         w3 * (fourt4 - 1) * jac[3][2] +
+         w4 * (fourt2 * jac[0][2] + fourt1 * jac[1][2]) +
+         w5 * (fourt3 * jac[0][2] + fourt1 * jac[2][2]) +
+         w6 * (fourt4 * jac[0][2] + fourt1 * jac[3][2]) +
+         w7 * (fourt3 * jac[1][2] + fourt2 * jac[2][2]) +
+         w8 * (fourt4 * jac[1][2] + fourt2 * jac[3][2]) +
+         w9 * (fourt4 * jac[2][2] + fourt3 * jac[3][2])) *
        invdet;
-  wz = -(n0.w[iw] * (fourt1 - 1) * jac[0][3] +
-         n1.w[iw] * (fourt2 - 1) * jac[1][3] +
-         n2.w[iw] * (fourt3 - 1) * jac[2][3] +
-         n3.w[iw] * (fourt4 - 1) * jac[3][3] +
-         n4.w[iw] * (fourt2 * jac[0][3] + fourt1 * jac[1][3]) +
-         n5.w[iw] * (fourt3 * jac[0][3] + fourt1 * jac[2][3]) +
-         n6.w[iw] * (fourt4 * jac[0][3] + fourt1 * jac[3][3]) +
-         n7.w[iw] * (fourt3 * jac[1][3] + fourt2 * jac[2][3]) +
-         n8.w[iw] * (fourt4 * jac[1][3] + fourt2 * jac[3][3]) +
-         n9.w[iw] * (fourt4 * jac[2][3] + fourt3 * jac[3][3])) *
+  wz = -(w0 * (fourt1 - 1) * jac[0][3] +
+         w1 * (fourt2 - 1) * jac[1][3] +
+         w2 * (fourt3 - 1) * jac[2][3] +
+         w3 * (fourt4 - 1) * jac[3][3] +
+         w4 * (fourt2 * jac[0][3] + fourt1 * jac[1][3]) +
+         w5 * (fourt3 * jac[0][3] + fourt1 * jac[2][3]) +
+         w6 * (fourt4 * jac[0][3] + fourt1 * jac[3][3]) +
+         w7 * (fourt3 * jac[1][3] + fourt2 * jac[2][3]) +
+         w8 * (fourt4 * jac[1][3] + fourt2 * jac[3][3]) +
+         w9 * (fourt4 * jac[2][3] + fourt3 * jac[3][3])) *
        invdet;
 
   // Transform field to global coordinates
   UnmapFields(wx, wy, wz, x, y, z, xmirr, ymirr, zmirr, rcoordinate, rotation);
 }
 
-double ComponentElmer::WeightingPotential(const double xin, const double yin,
-                                          const double zin,
-                                          const std::string& label) {
+double ComponentElmer::WeightingPotentialFromHandle(const double xin,
+                                                    const double yin,
+                                                    const double zin,
+                                                    const int iw) {
   // Do not proceed if not properly initialised.
   if (!m_ready) return 0.;
 
-  // Look for the label.
-  int iw = 0;
-  bool found = false;
-  for (int i = nWeightingFields; i--;) {
-    if (wfields[i] == label) {
-      iw = i;
-      found = true;
-      break;
-    }
-  }
-
-  // Do not proceed if the requested weighting field does not exist.
-  if (!found) return 0.;
-  // Check if the weighting field is properly initialised.
-  if (!wfieldsOk[iw]) return 0.;
+  // Check if the weighting field exists and is properly initialised.
+  if (iw < 0 || iw >= nWeightingFields || !wfieldsOk[iw]) return 0.;
 
   // Copy the coordinates.
   double x = xin, y = yin, z = zin;
@@ -785,22 +694,22 @@ double ComponentElmer::WeightingPotential(const double xin, const double yin,
     PrintElement("WeightingPotential", x, y, z, t1, t2, t3, t4, element, 10,
                  iw);
   }
-  const Node& n0 = nodes[element.emap[0]];
-  const Node& n1 = nodes[element.emap[1]];
-  const Node& n2 = nodes[element.emap[2]];
-  const Node& n3 = nodes[element.emap[3]];
-  const Node& n4 = nodes[element.emap[4]];
-  const Node& n5 = nodes[element.emap[5]];
-  const Node& n6 = nodes[element.emap[6]];
-  const Node& n7 = nodes[element.emap[7]];
-  const Node& n8 = nodes[element.emap[8]];
-  const Node& n9 = nodes[element.emap[9]];
+  const double w0 = m_wpot[iw][element.emap[0]];
+  const double w1 = m_wpot[iw][element.emap[1]];
+  const double w2 = m_wpot[iw][element.emap[2]];
+  const double w3 = m_wpot[iw][element.emap[3]];
+  const double w4 = m_wpot[iw][element.emap[4]];
+  const double w5 = m_wpot[iw][element.emap[5]];
+  const double w6 = m_wpot[iw][element.emap[6]];
+  const double w7 = m_wpot[iw][element.emap[7]];
+  const double w8 = m_wpot[iw][element.emap[8]];
+  const double w9 = m_wpot[iw][element.emap[9]];
   // Tetrahedral field
-  return n0.w[iw] * t1 * (2 * t1 - 1) + n1.w[iw] * t2 * (2 * t2 - 1) +
-         n2.w[iw] * t3 * (2 * t3 - 1) + n3.w[iw] * t4 * (2 * t4 - 1) +
-         4 * n4.w[iw] * t1 * t2 + 4 * n5.w[iw] * t1 * t3 +
-         4 * n6.w[iw] * t1 * t4 + 4 * n7.w[iw] * t2 * t3 +
-         4 * n8.w[iw] * t2 * t4 + 4 * n9.w[iw] * t3 * t4;
+  return w0 * t1 * (2 * t1 - 1) + w1 * t2 * (2 * t2 - 1) +
+         w2 * t3 * (2 * t3 - 1) + w3 * t4 * (2 * t4 - 1) +
+         4 * w4 * t1 * t2 + 4 * w5 * t1 * t3 +
+         4 * w6 * t1 * t4 + 4 * w7 * t2 * t3 +
+         4 * w8 * t2 * t4 + 4 * w9 * t3 * t4;
 }
 
 Medium* ComponentElmer::GetMedium(const double xin, const double yin,
@@ -1,7 +1,11 @@
 #include <stdio.h>
 #include <algorithm>
+#include <array>
+#include <cmath>
 #include <fstream>
 #include <iostream>
+#include <limits>
+#include <memory>
 
 #include <math.h>
 #include <string>
@@ -9,6 +13,12 @@
 #include "ComponentFieldMap.hh"
 #include "FundamentalConstants.hh"
 
+namespace {
+
+const char SnapshotTag[8] = {'G', 'F', 'E', 'M', 'A', 'P', 'S', 'N'};
+const uint32_t SnapshotVersion = 4;
+}
+
 namespace Garfield {
 
 ComponentFieldMap::ComponentFieldMap() : ComponentBase() {
@@ -16,7 +26,6 @@ ComponentFieldMap::ComponentFieldMap() : ComponentBase() {
 }
 
 ComponentFieldMap::~ComponentFieldMap() {
-  if (m_tetTree) delete m_tetTree;
 }
 
 void ComponentFieldMap::PrintMaterials() {
@@ -124,6 +133,53 @@ Medium* ComponentFieldMap::GetMedium(const unsigned int imat) const {
   return materials[imat].medium;
 }
 
+void ComponentFieldMap::ElectricFieldBatch(const size_t n, const double* x,
+                                           const double* y, const double* z,
+                                           double* ex, double* ey, double* ez,
+                                           double* v, Medium** m,
+                                           int* status) {
+  if (n == 0) return;
+  // Set up the element search once, before the loop.
+  if (m_ready && !InitializeElementSearch("ElectricFieldBatch")) {
+    for (size_t i = 0; i < n; ++i) {
+      ex[i] = ey[i] = ez[i] = 0.;
+      if (v) v[i] = 0.;
+      m[i] = nullptr;
+      status[i] = -6;
+    }
+    return;
+  }
+  if (!m_ready || n < 3 || !m_isGridInitialized) {
+    ComponentBase::ElectricFieldBatch(n, x, y, z, ex, ey, ez, v, m, status);
+    return;
+  }
+  // Visit the points ordered by the grid cell which contains them (in
+  // field map coordinates). Points in the same cell share the list of
+  // candidate elements, and the element found for the previous point,
+  // which is used as the starting point of the search, is likely to
+  // contain the next point as well or to be close to it.
+  std::vector<std::pair<size_t, size_t> > order(n);
+  for (size_t i = 0; i < n; ++i) {
+    double xm = x[i], ym = y[i], zm = z[i];
+    bool xmirr, ymirr, zmirr;
+    double rcoordinate, rotation;
+    MapCoordinates(xm, ym, zm, xmirr, ymirr, zmirr, rcoordinate, rotation);
+    // Points outside the grid come last.
+    size_t cell = 0;
+    if (!m_grid.GetCell(xm, ym, zm, cell)) {
+      cell = std::numeric_limits<size_t>::max();
+    }
+    order[i] = std::make_pair(cell, i);
+  }
+  std::sort(order.begin(), order.end());
+  double volt = 0.;
+  for (const auto& entry : order) {
+    const size_t i = entry.second;
+    ElectricField(x[i], y[i], z[i], ex[i], ey[i], ez[i], v ? v[i] : volt,
+                  m[i], status[i]);
+  }
+}
+
 bool ComponentFieldMap::GetElement(const unsigned int i, double& vol,
                                    double& dmin, double& dmax) {
   if ((int)i >= nElements) {
@@ -142,26 +198,13 @@ int ComponentFieldMap::FindElement5(const double x, const double y,
                                     double& t3, double& t4, double jac[4][4],
                                     double& det) {
   // Check if bounding boxes of elements have been computed
-  if (!m_cacheElemBoundingBoxes) {
-    std::cout << m_className << "::FindElement5:\n"
-              << "    Caching the bounding boxes of all elements...";
-    CalculateElementBoundingBoxes();
-    std::cout << " done.\n";
-    m_cacheElemBoundingBoxes = true;
-  }
+  if (!InitializeElementSearch("FindElement5")) return -1;
 
-  // Tetra list in the block that contains the input 3D point.
-  std::vector<int> tetList;
-  if (m_useTetrahedralTree) {
-    if (!m_isTreeInitialized) {
-      if (!InitializeTetrahedralTree()) {
-        std::cerr << m_className << "::FindElement5:\n";
-        std::cerr << "    Tetrahedral tree initialization failed.\n";
-        return -1;
-      }
-    }
-    tetList = m_tetTree->GetTetListInBlock(Vec3(x, y, z));
-  }
+  // Elements overlapping the grid cell that contains the point.
+  ElementGrid::Range candidates{nullptr, nullptr};
+  if (m_useElementGrid) candidates = m_grid.GetElements(x, y, z);
+  // Element found in the previous call.
+  int& lastElement = LastElement();
   // Backup
   double jacbak[4][4], detbak = 1.;
   double t1bak = 0., t2bak = 0., t3bak = 0., t4bak = 0.;
@@ -170,31 +213,47 @@ int ComponentFieldMap::FindElement5(const double x, const double y,
   // Initial values.
   t1 = t2 = t3 = t4 = 0;
 
-  // Check previously used element
-  if (m_lastElement > -1 && !m_checkMultipleElement) {
-    const Element& element = elements[m_lastElement];
+  auto isInside = [&](const Element& element) {
     if (element.degenerate) {
-      if (Coordinates3(x, y, z, t1, t2, t3, t4, jac, det, element) == 0) {
-        if (t1 >= 0 && t1 <= +1 && t2 >= 0 && t2 <= +1 && t3 >= 0 && t3 <= +1) {
-          return m_lastElement;
-        }
+      if (Coordinates3(x, y, z, t1, t2, t3, t4, jac, det, element) != 0) {
+        return false;
       }
-    } else {
-      if (Coordinates5(x, y, z, t1, t2, t3, t4, jac, det, element) == 0) {
-        if (t1 >= -1 && t1 <= +1 && t2 >= -1 && t2 <= +1) return m_lastElement;
+      return t1 >= 0 && t1 <= +1 && t2 >= 0 && t2 <= +1 && t3 >= 0 && t3 <= +1;
+    }
+    if (Coordinates5(x, y, z, t1, t2, t3, t4, jac, det, element) != 0) {
+      return false;
+    }
+    return t1 >= -1 && t1 <= +1 && t2 >= -1 && t2 <= +1;
+  };
+
+  // Check previously used element
+  if (lastElement > -1 && !m_checkMultipleElement) {
+    if (isInside(elements[lastElement])) {
+      if (m_debug) ++m_nFoundInLast;
+      return lastElement;
+    }
+    // Try the elements on the way from there to the point.
+    if (m_useElementWalk) {
+      const int next = WalkToElement(x, y, z, lastElement);
+      if (next >= 0 && next != lastElement && isInside(elements[next])) {
+        if (m_debug) ++m_nFoundByWalk;
+        lastElement = next;
+        return next;
       }
     }
   }
+  if (m_debug) ++m_nGlobalSearches;
 
   // Verify the count of volumes that contain the point.
   int nfound = 0;
   int imap = -1;
 
   // Number of elements to scan.
-  // With tetra tree disabled, all elements are scanned.
-  const int numElemToSearch = m_useTetrahedralTree ? tetList.size() : nElements;
+  // With the element grid disabled, all elements are scanned.
+  const int numElemToSearch =
+      m_useElementGrid ? candidates.size() : nElements;
   for (int i = 0; i < numElemToSearch; ++i) {
-    const int idxToElemList = m_useTetrahedralTree ? tetList[i] : i;
+    const int idxToElemList = m_useElementGrid ? candidates.first[i] : i;
     const Element& element = elements[idxToElemList];
     if (x < element.xmin || x > element.xmax || y < element.ymin ||
         y > element.ymax || z < element.zmin || z > element.zmax)
@@ -207,7 +266,7 @@ int ComponentFieldMap::FindElement5(const double x, const double y,
       if (t1 < 0 || t1 > 1 || t2 < 0 || t2 > 1 || t3 < 0 || t3 > 1) continue;
       ++nfound;
       imap = idxToElemList;
-      m_lastElement = idxToElemList;
+      lastElement = idxToElemList;
       if (m_debug) {
         std::cout << m_className << "::FindElement5:\n";
         std::cout << "    Found matching degenerate element " << idxToElemList
@@ -234,7 +293,7 @@ int ComponentFieldMap::FindElement5(const double x, const double y,
       if (t1 < -1 || t1 > 1 || t2 < -1 || t2 > 1) continue;
       ++nfound;
       imap = idxToElemList;
-      m_lastElement = idxToElemList;
+      lastElement = idxToElemList;
       if (m_debug) {
         std::cout << m_className << "::FindElement5:\n";
         std::cout << "    Found matching non-degenerate element "
@@ -264,7 +323,7 @@ int ComponentFieldMap::FindElement5(const double x, const double y,
         std::cout << "    No element matching point (" << x << ", " << y
                   << ") found.\n";
       }
-      m_lastElement = -1;
+      lastElement = -1;
       return -1;
     }
     if (nfound > 1) {
@@ -282,7 +341,7 @@ int ComponentFieldMap::FindElement5(const double x, const double y,
       t3 = t3bak;
       t4 = t4bak;
       imap = imapbak;
-      m_lastElement = imap;
+      lastElement = imap;
       return imap;
     }
   }
@@ -300,13 +359,9 @@ int ComponentFieldMap::FindElement13(const double x, const double y,
                                      double& t3, double& t4, double jac[4][4],
                                      double& det) {
   // Check if bounding boxes of elements have been computed
-  if (!m_cacheElemBoundingBoxes) {
-    std::cout << m_className << "::FindElement13:\n"
-              << "    Caching the bounding boxes of all elements...";
-    CalculateElementBoundingBoxes();
-    std::cout << " done.\n";
-    m_cacheElemBoundingBoxes = true;
-  }
+  if (!InitializeElementSearch("FindElement13")) return -1;
+  // Element found in the previous call.
+  int& lastElement = LastElement();
 
   // Backup
   double jacbak[4][4];
@@ -317,39 +372,46 @@ int ComponentFieldMap::FindElement13(const double x, const double y,
   // Initial values.
   t1 = t2 = t3 = t4 = 0.;
 
-  // Check previously used element
-  if (m_lastElement > -1 && !m_checkMultipleElement) {
-    const Element& element = elements[m_lastElement];
-    if (Coordinates13(x, y, z, t1, t2, t3, t4, jac, det, element) == 0) {
-      if (t1 >= 0 && t1 <= +1 && t2 >= 0 && t2 <= +1 && t3 >= 0 && t3 <= +1 &&
-          t4 >= 0 && t4 <= +1) {
-        return m_lastElement;
-      }
+  auto isInside = [&](const Element& element) {
+    if (Coordinates13(x, y, z, t1, t2, t3, t4, jac, det, element) != 0) {
+      return false;
     }
-  }
+    return t1 >= 0 && t1 <= +1 && t2 >= 0 && t2 <= +1 && t3 >= 0 && t3 <= +1 &&
+           t4 >= 0 && t4 <= +1;
+  };
 
-  // Tetra list in the block that contains the input 3D point.
-  std::vector<int> tetList;
-  if (m_useTetrahedralTree) {
-    if (!m_isTreeInitialized) {
-      if (!InitializeTetrahedralTree()) {
-        std::cerr << m_className << "::FindElement13:\n";
-        std::cerr << "    Tetrahedral tree initialization failed.\n";
-        return -1;
+  // Check previously used element
+  if (lastElement > -1 && !m_checkMultipleElement) {
+    if (isInside(elements[lastElement])) {
+      if (m_debug) ++m_nFoundInLast;
+      return lastElement;
+    }
+    // Try the elements on the way from there to the point.
+    if (m_useElementWalk) {
+      const int next = WalkToElement(x, y, z, lastElement);
+      if (next >= 0 && next != lastElement && isInside(elements[next])) {
+        if (m_debug) ++m_nFoundByWalk;
+        lastElement = next;
+        return next;
       }
     }
-    tetList = m_tetTree->GetTetListInBlock(Vec3(x, y, z));
   }
+  if (m_debug) ++m_nGlobalSearches;
+
+  // Elements overlapping the grid cell that contains the point.
+  ElementGrid::Range candidates{nullptr, nullptr};
+  if (m_useElementGrid) candidates = m_grid.GetElements(x, y, z);
   // Number of elements to scan.
-  // With tetra tree disabled, all elements are scanned.
-  const int numElemToSearch = m_useTetrahedralTree ? tetList.size() : nElements;
+  // With the element grid disabled, all elements are scanned.
+  const int numElemToSearch =
+      m_useElementGrid ? candidates.size() : nElements;
   // Verify the count of volumes that contain the point.
   int nfound = 0;
   int imap = -1;
 
   // Scan all elements
   for (int i = 0; i < numElemToSearch; i++) {
-    const int idxToElemList = m_useTetrahedralTree ? tetList[i] : i;
+    const int idxToElemList = m_useElementGrid ? candidates.first[i] : i;
     const Element& element = elements[idxToElemList];
     if (x < element.xmin || x > element.xmax || y < element.ymin ||
         y > element.ymax || z < element.zmin || z > element.zmax)
@@ -363,7 +425,7 @@ int ComponentFieldMap::FindElement13(const double x, const double y,
     }
     ++nfound;
     imap = idxToElemList;
-    m_lastElement = idxToElemList;
+    lastElement = idxToElemList;
     if (m_debug) {
       std::cout << m_className << "::FindElement13:\n";
       std::cout << "    Found matching element " << i << ".\n";
@@ -391,7 +453,7 @@ int ComponentFieldMap::FindElement13(const double x, const double y,
         std::cout << "    No element matching point (" << x << ", " << y << ", "
                   << z << ") found.\n";
       }
-      m_lastElement = -1;
+      lastElement = -1;
       return -1;
     }
     if (nfound > 1) {
@@ -409,7 +471,7 @@ int ComponentFieldMap::FindElement13(const double x, const double y,
       t3 = t3bak;
       t4 = t4bak;
       imap = imapbak;
-      m_lastElement = imap;
+      lastElement = imap;
       return imap;
     }
   }
@@ -427,15 +489,16 @@ int ComponentFieldMap::FindElementCube(const double x, const double y,
                                        double& t3, TMatrixD*& jac,
                                        std::vector<TMatrixD*>& dN) {
   int imap = -1;
-  if (m_lastElement >= 0) {
-    const Element& element = elements[m_lastElement];
+  int& lastElement = LastElement();
+  if (lastElement >= 0) {
+    const Element& element = elements[lastElement];
     const Node& n3 = nodes[element.emap[3]];
     if (x >= n3.x && y >= n3.y && z >= n3.z) {
       const Node& n0 = nodes[element.emap[0]];
       const Node& n2 = nodes[element.emap[2]];
       const Node& n7 = nodes[element.emap[7]];
       if (x < n0.x && y < n2.y && z < n7.z) {
-        imap = m_lastElement;
+        imap = lastElement;
       }
     }
   }
@@ -2287,6 +2350,161 @@ double ComponentFieldMap::ReadDouble(char* token, double def, bool& error) {
   return atof(token);
 }
 
+std::vector<size_t> ComponentFieldMap::FindAnsysRecords(
+    const TextFile& file, const std::vector<std::string>& headers,
+    const unsigned int nLinesPerRecord) {
+  std::vector<size_t> records;
+  const size_t nLines = file.GetNumberOfLines();
+  for (size_t i = 0; i < nLines; ++i) {
+    const char* line = file.GetLine(i);
+    // Skip page feeds (followed by five header lines).
+    if (strcmp(line, "1") == 0) {
+      i += 5;
+      continue;
+    }
+    // Skip blank lines and headers.
+    if (TextFile::IsBlank(line)) continue;
+    bool header = false;
+    for (const auto& token : headers) {
+      if (!TextFile::FirstTokenIs(line, token.c_str())) continue;
+      header = true;
+      break;
+    }
+    if (header) continue;
+    records.push_back(i);
+    i += nLinesPerRecord - 1;
+  }
+  return records;
+}
+
+bool ComponentFieldMap::ReadAnsysNodes(const std::string& filename,
+                                       const double funit, bool& ok) {
+  TextFile file(m_nReadThreads);
+  if (!file.Read(filename)) {
+    std::cerr << m_className << "::Initialise:\n"
+              << "    Could not open nodes file " << filename
+              << " for reading.\n"
+              << "    The file perhaps does not exist.\n";
+    return false;
+  }
+  const auto records = FindAnsysRecords(file, {"LIST", "NODE"});
+  const size_t n = records.size();
+  nodes.clear();
+  nodes.resize(n);
+  std::vector<int> numbers(n, 0);
+  std::vector<char> errors(n, 0);
+  file.ParallelFor(n, [&](const size_t begin, const size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+      const char* p = file.GetLine(records[i]);
+      Node& node = nodes[i];
+      errors[i] = !TextFile::ReadInteger(p, numbers[i]) ||
+                  !TextFile::ReadDouble(p, node.x) ||
+                  !TextFile::ReadDouble(p, node.y) ||
+                  !TextFile::ReadDouble(p, node.z);
+    }
+  });
+  for (size_t i = 0; i < n; ++i) {
+    const unsigned long il = records[i] + 1;
+    // Check syntax
+    if (errors[i]) {
+      std::cerr << m_className << "::Initialise:\n"
+                << "    Error reading file " << filename << " (line " << il
+                << ").\n";
+      nodes.clear();
+      nNodes = 0;
+      return false;
+    }
+    // Check synchronisation
+    if (numbers[i] - 1 != static_cast<int>(i)) {
+      std::cerr << m_className << "::Initialise:\n"
+                << "    Synchronisation lost on file " << filename
+                << " (line " << il << ").\n"
+                << "    Node: " << numbers[i] << " (expected " << i
+                << "), (x,y,z) = (" << nodes[i].x << ", " << nodes[i].y
+                << ", " << nodes[i].z << ")\n";
+      ok = false;
+    }
+  }
+  // Store the point coordinates
+  file.ParallelFor(n, [&](const size_t begin, const size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+      nodes[i].x *= funit;
+      nodes[i].y *= funit;
+      nodes[i].z *= funit;
+    }
+  });
+  nNodes = n;
+  // Tell how many lines read
+  std::cout << m_className << "::Initialise:\n"
+            << "    Read " << nNodes << " nodes from file " << filename
+            << ".\n";
+  return true;
+}
+
+bool ComponentFieldMap::ReadAnsysPotentials(const std::string& filename,
+                                            const std::string& header,
+                                            std::vector<double>& v,
+                                            int& nRead, bool& ok) {
+  nRead = 0;
+  TextFile file(m_nReadThreads);
+  if (!file.Read(filename)) {
+    std::cerr << m_className << "::" << header << ":\n"
+              << "    Could not open potential file " << filename
+              << " for reading.\n"
+              << "    The file perhaps does not exist.\n";
+    return false;
+  }
+  const auto records = FindAnsysRecords(
+      file, {"PRINT", "*****", "LOAD", "TIME=", "MAXIMUM", "VALUE", "NODE"});
+  const size_t n = records.size();
+  std::vector<int> numbers(n, 0);
+  std::vector<double> values(n, 0.);
+  std::vector<char> errors(n, 0);
+  file.ParallelFor(n, [&](const size_t begin, const size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+      const char* p = file.GetLine(records[i]);
+      errors[i] = !TextFile::ReadInteger(p, numbers[i]) ||
+                  !TextFile::ReadDouble(p, values[i]);
+    }
+  });
+  const int nMax = v.size();
+  for (size_t i = 0; i < n; ++i) {
+    const unsigned long il = records[i] + 1;
+    // Check syntax
+    if (errors[i]) {
+      std::cerr << m_className << "::" << header << ":\n"
+                << "    Error reading file " << filename << " (line " << il
+                << ").\n";
+      return false;
+    }
+    // Check node number and store if OK
+    const int inode = numbers[i];
+    if (inode < 1 || inode > nMax) {
+      std::cerr << m_className << "::" << header << ":\n"
+                << "    Node number " << inode << " out of range\n"
+                << "    on potential file " << filename << " (line " << il
+                << ").\n";
+      ok = false;
+    } else {
+      v[inode - 1] = values[i];
+      ++nRead;
+    }
+  }
+  // Tell how many lines read
+  std::cout << m_className << "::" << header << ":\n"
+            << "    Read " << nRead << " potentials from file " << filename
+            << ".\n";
+  // Check number of nodes
+  if (nRead != nMax) {
+    std::cerr << m_className << "::" << header << ":\n"
+              << "    Number of nodes read (" << nRead
+              << ") on potential file " << filename << "\n"
+              << "    does not match the node list (" << nMax << ").\n";
+    ok = false;
+  }
+  return true;
+}
+
 void ComponentFieldMap::CalculateElementBoundingBoxes(void) {
   // Do not proceed if not properly initialised.
   if (!m_ready) {
@@ -2320,77 +2538,480 @@ void ComponentFieldMap::CalculateElementBoundingBoxes(void) {
   }
 }
 
-bool ComponentFieldMap::InitializeTetrahedralTree() {
+bool ComponentFieldMap::InitializeElementSearch(const std::string& header) {
+  if (m_cacheElemBoundingBoxes && (!m_useElementGrid || m_isGridInitialized) &&
+      (!m_useElementWalk || m_hasNeighbours)) {
+    return true;
+  }
+  // Several threads may try to set up the search structures at once.
+  std::lock_guard<std::mutex> lock(m_searchMutex);
+  if (!m_cacheElemBoundingBoxes) {
+    std::cout << m_className << "::" << header << ":\n"
+              << "    Caching the bounding boxes of all elements...";
+    CalculateElementBoundingBoxes();
+    std::cout << " done.\n";
+    m_cacheElemBoundingBoxes = true;
+  }
+  if (m_useElementGrid && !m_isGridInitialized) {
+    if (!InitializeElementGrid()) {
+      std::cerr << m_className << "::" << header << ":\n"
+                << "    Element grid initialization failed.\n";
+      return false;
+    }
+  }
+  if (m_useElementWalk && !m_hasNeighbours) {
+    InitializeNeighbours();
+    m_hasNeighbours = true;
+  }
+  return true;
+}
+
+void ComponentFieldMap::PrepareElementSearch() {
+  // Discard the search structures of a previous field map.
+  m_cacheElemBoundingBoxes = false;
+  m_grid.Clear();
+  m_isGridInitialized = false;
+  m_neighbours.clear();
+  m_hasNeighbours = false;
+  LastElement() = -1;
+  // Components with a regular mesh do not use the element list.
+  if (!m_ready || elements.empty()) return;
+  InitializeElementSearch("PrepareElementSearch");
+}
+
+bool ComponentFieldMap::InitializeElementGrid() {
   // Do not proceed if not properly initialised.
   if (!m_ready) {
-    PrintNotReady("InitializeTetrahedralTree");
+    PrintNotReady("InitializeElementGrid");
     return false;
   }
 
-  std::cout << m_className << "::InitializeTetrahedralTree:\n"
-            << "    About to initialize the tetrahedral tree.\n";
-
   // Cache the bounding boxes if it has not been done yet.
   if (!m_cacheElemBoundingBoxes) CalculateElementBoundingBoxes();
 
-  if (nodes.empty()) {
-    std::cerr << m_className << "::InitializeTetrahedralTree: Empty mesh.\n";
+  if (elements.empty()) {
+    std::cerr << m_className << "::InitializeElementGrid: Empty mesh.\n";
     return false;
   }
 
-  // Determine the bounding box
-  double xmin = nodes.front().x;
-  double ymin = nodes.front().y;
-  double zmin = nodes.front().z;
-  double xmax = xmin;
-  double ymax = ymin;
-  double zmax = zmin;
-  for (unsigned int i = 0; i < nodes.size(); i++) {
-    const Node& n = nodes[i];
-    xmin = std::min(xmin, n.x);
-    xmax = std::max(xmax, n.x);
-    ymin = std::min(ymin, n.y);
-    ymax = std::max(ymax, n.y);
-    zmin = std::min(zmin, n.z);
-    zmax = std::max(zmax, n.z);
+  std::vector<std::array<double, 6> > boxes;
+  boxes.reserve(elements.size());
+  for (const auto& e : elements) {
+    boxes.push_back({{e.xmin, e.ymin, e.zmin, e.xmax, e.ymax, e.zmax}});
   }
+  if (!m_grid.Build(boxes, m_is3d)) {
+    std::cerr << m_className << "::InitializeElementGrid:\n"
+              << "    Could not build the grid.\n";
+    return false;
+  }
+  if (m_debug) {
+    const auto& n = m_grid.GetNumberOfCells();
+    std::cout << m_className << "::InitializeElementGrid:\n"
+              << "    " << n[0] << " x " << n[1] << " x " << n[2]
+              << " cells, " << double(m_grid.GetNumberOfEntries()) / nElements
+              << " cells per element on average.\n";
+  }
+  m_isGridInitialized = true;
+  return true;
+}
 
-  std::cout << "    Bounding box:\n"
-            << std::scientific << "\tx: " << xmin << " -> " << xmax << "\n"
-            << std::scientific << "\ty: " << ymin << " -> " << ymax << "\n"
-            << std::scientific << "\tz: " << zmin << " -> " << zmax << "\n";
+void ComponentFieldMap::InitializeNeighbours() {
+  // Faces (or edges), identified by their sorted corner nodes,
+  // together with the index 4 * element + face.
+  typedef std::pair<std::array<int, 3>, int> Face;
+  std::vector<Face> faces;
+  faces.reserve(4 * elements.size());
+  for (int i = 0; i < nElements; ++i) {
+    const Element& element = elements[i];
+    const int* c = element.emap;
+    if (m_is3d) {
+      // Tetrahedra: face opposite to corner j.
+      for (int j = 0; j < 4; ++j) {
+        std::array<int, 3> f = {{c[(j + 1) % 4], c[(j + 2) % 4],
+                                 c[(j + 3) % 4]}};
+        std::sort(f.begin(), f.end());
+        faces.push_back(Face(f, 4 * i + j));
+      }
+    } else if (element.degenerate) {
+      // Triangles: edge opposite to corner j.
+      for (int j = 0; j < 3; ++j) {
+        const int a = c[(j + 1) % 3];
+        const int b = c[(j + 2) % 3];
+        const std::array<int, 3> f = {{std::min(a, b), std::max(a, b), -1}};
+        faces.push_back(Face(f, 4 * i + j));
+      }
+    } else {
+      // Quadrilaterals: edge from corner j to corner j + 1.
+      for (int j = 0; j < 4; ++j) {
+        const int a = c[j];
+        const int b = c[(j + 1) % 4];
+        const std::array<int, 3> f = {{std::min(a, b), std::max(a, b), -1}};
+        faces.push_back(Face(f, 4 * i + j));
+      }
+    }
+  }
+  std::sort(faces.begin(), faces.end());
+  m_neighbours.assign(4 * elements.size(), -1);
+  const size_t nFaces = faces.size();
+  for (size_t i = 0; i + 1 < nFaces; ++i) {
+    if (faces[i].first != faces[i + 1].first) continue;
+    m_neighbours[faces[i].second] = faces[i + 1].second / 4;
+    m_neighbours[faces[i + 1].second] = faces[i].second / 4;
+    ++i;
+  }
+}
+
+int ComponentFieldMap::WalkToElement(const double x, const double y,
+                                     const double z, int e) const {
+  // Maximum number of steps.
+  constexpr unsigned int nMaxSteps = 64;
+  // Tolerance on the linear local coordinates.
+  constexpr double tol = 1.e-6;
+  for (unsigned int k = 0; k < nMaxSteps; ++k) {
+    const Element& element = elements[e];
+    double t[4] = {0., 0., 0., 0.};
+    unsigned int n = 4;
+    if (m_is3d) {
+      Coordinates12(x, y, z, t[0], t[1], t[2], t[3], element);
+    } else if (element.degenerate) {
+      // Area coordinates of the linear triangle.
+      const Node& n0 = nodes[element.emap[0]];
+      const Node& n1 = nodes[element.emap[1]];
+      const Node& n2 = nodes[element.emap[2]];
+      const double d = (n1.x - n0.x) * (n2.y - n0.y) -
+                       (n2.x - n0.x) * (n1.y - n0.y);
+      t[1] = ((x - n0.x) * (n2.y - n0.y) - (n2.x - n0.x) * (y - n0.y)) / d;
+      t[2] = ((n1.x - n0.x) * (y - n0.y) - (x - n0.x) * (n1.y - n0.y)) / d;
+      t[0] = 1. - t[1] - t[2];
+      n = 3;
+    } else {
+      // Quadrilaterals: signed distance to the (straight) edges,
+      // in units of the element area.
+      const Node& n0 = nodes[element.emap[0]];
+      const Node& n1 = nodes[element.emap[1]];
+      const Node& n2 = nodes[element.emap[2]];
+      const Node& n3 = nodes[element.emap[3]];
+      const double a = 0.5 * ((n2.x - n0.x) * (n3.y - n1.y) -
+                              (n3.x - n1.x) * (n2.y - n0.y));
+      const Node* c[5] = {&n0, &n1, &n2, &n3, &n0};
+      for (unsigned int i = 0; i < 4; ++i) {
+        const Node& p = *c[i];
+        const Node& q = *c[i + 1];
+        t[i] = ((q.x - p.x) * (y - p.y) - (x - p.x) * (q.y - p.y)) / a;
+      }
+    }
+    int face = -1;
+    double tmin = -tol;
+    for (unsigned int i = 0; i < n; ++i) {
+      if (std::isnan(t[i])) return -1;
+      if (t[i] < tmin) {
+        tmin = t[i];
+        face = i;
+      }
+    }
+    if (face < 0) return e;
+    e = m_neighbours[4 * e + face];
+    if (e < 0) return -1;
+  }
+  return -1;
+}
+
+void ComponentFieldMap::PrintElementSearchStatistics() const {
+  const double n0 = m_nFoundInLast;
+  const double n1 = m_nFoundByWalk;
+  const double n2 = m_nGlobalSearches;
+  const double n = std::max(n0 + n1 + n2, 1.);
+  std::cout << m_className << "::PrintElementSearchStatistics:\n"
+            << "    Element searches:     " << n0 + n1 + n2 << "\n"
+            << "    Previous element:     " << n0 << " (" << 100. * n0 / n
+            << "%)\n"
+            << "    Found by walk:        " << n1 << " (" << 100. * n1 / n
+            << "%)\n"
+            << "    Search of the mesh:   " << n2 << " (" << 100. * n2 / n
+            << "%)\n";
+}
 
-  const double hx = 0.5 * (xmax - xmin);
-  const double hy = 0.5 * (ymax - ymin);
-  const double hz = 0.5 * (zmax - zmin);
-  m_tetTree = new TetrahedralTree(Vec3(xmin + hx, ymin + hy, zmin + hz),
-                                  Vec3(hx, hy, hz));
+void ComponentFieldMap::ResetElementSearchStatistics() {
+  m_nFoundInLast = 0;
+  m_nFoundByWalk = 0;
+  m_nGlobalSearches = 0;
+}
 
-  std::cout << "    Tree instantiated.\n";
+bool ComponentFieldMap::SaveSnapshot(const std::string& filename) {
+  if (!m_ready) {
+    PrintNotReady("SaveSnapshot");
+    return false;
+  }
+  // Make sure the bounding boxes (and the tree, if used) are included.
+  if (!InitializeElementSearch("SaveSnapshot")) return false;
+
+  std::vector<char> buffer;
+  Snapshot::AppendString(buffer, m_className);
+  const uint8_t flags[4] = {m_is3d, m_warning, m_useElementGrid,
+                            m_isGridInitialized};
+  Append(buffer, flags, sizeof(flags));
+  const int32_t counts[4] = {nElements, nNodes,
+                             static_cast<int32_t>(m_nMaterials),
+                             nWeightingFields};
+  Append(buffer, counts, sizeof(counts));
+  AppendVector(buffer, elements);
+
+  // Nodes: coordinates and potential.
+  AppendVector(buffer, nodes);
+
+  for (const auto& material : materials) {
+    Append(buffer, &material.eps, sizeof(double));
+    Append(buffer, &material.ohm, sizeof(double));
+    const uint8_t drift = material.driftmedium;
+    Append(buffer, &drift, sizeof(drift));
+  }
+  // Weighting fields: label, status and potentials at the nodes.
+  const size_t nW = std::max(nWeightingFields, 0);
+  for (size_t i = 0; i < nW; ++i) {
+    Snapshot::AppendString(buffer,
+                           i < wfields.size() ? wfields[i] : std::string());
+    const uint8_t ok = i < wfieldsOk.size() && wfieldsOk[i];
+    Append(buffer, &ok, sizeof(ok));
+    const NodeValues w = i < m_wpot.size() ? m_wpot[i] : NodeValues();
+    const uint8_t single = !w.f.empty();
+    Append(buffer, &single, sizeof(single));
+    if (single) {
+      AppendVector(buffer, w.f);
+    } else {
+      AppendVector(buffer, w.d);
+    }
+  }
 
-  // insert all mesh nodes in the tree
-  for (unsigned int i = 0; i < nodes.size(); i++) {
-    const Node& n = nodes[i];
-    m_tetTree->InsertMeshNode(Vec3(n.x, n.y, n.z), i);
+  // Ranges.
+  const uint8_t bb = hasBoundingBox;
+  Append(buffer, &bb, sizeof(bb));
+  for (const auto a : {&m_minBoundingBox, &m_maxBoundingBox, &m_mapmin,
+                       &m_mapmax, &m_mapamin, &m_mapamax, &m_mapna,
+                       &m_cells}) {
+    Append(buffer, a->data(), 3 * sizeof(double));
+  }
+  Append(buffer, &m_mapvmin, sizeof(double));
+  Append(buffer, &m_mapvmax, sizeof(double));
+  for (const auto b : m_setang) {
+    const uint8_t on = b;
+    Append(buffer, &on, sizeof(on));
   }
 
-  std::cout << m_className << "::InitializeTetrahedralTree:\n"
-            << "    Tetrahedral tree nodes initialized successfully.\n";
+  if (flags[3]) m_grid.Write(buffer);
+  // Neighbour lists for the walk (empty if not used).
+  AppendVector(buffer, m_neighbours);
+  WriteSnapshotData(buffer);
 
-  // insert all mesh elements (tetrahedrons) in the tree
-  for (unsigned int i = 0; i < elements.size(); i++) {
-    const Element& e = elements[i];
-    const double bb[6] = {e.xmin, e.ymin, e.zmin, e.xmax, e.ymax, e.zmax};
-    m_tetTree->InsertTetrahedron(bb, i);
+  std::string error;
+  if (!Snapshot::Write(filename, SnapshotTag, SnapshotVersion, sizeof(Element),
+                       buffer, error)) {
+    std::cerr << m_className << "::SaveSnapshot:\n    " << error << "\n";
+    return false;
   }
+  std::cout << m_className << "::SaveSnapshot:\n"
+            << "    Wrote " << nElements << " elements and " << nNodes
+            << " nodes to " << filename << ".\n";
+  return true;
+}
 
-  std::cerr << m_className << "::InitializeTetrahedralTree:\n";
-  std::cerr << "    Tetrahedral tree initialized successfully.\n";
+bool ComponentFieldMap::LoadSnapshot(const std::string& filename) {
+  std::shared_ptr<void> mapping;
+  SnapshotReader in;
+  std::string error;
+  if (!Snapshot::Open(filename, SnapshotTag, SnapshotVersion, sizeof(Element),
+                      mapping, in, error)) {
+    std::cerr << m_className << "::LoadSnapshot:\n    " << error << "\n";
+    return false;
+  }
+  std::string className;
+  if (!in.ReadString(className) || className != m_className) {
+    std::cerr << m_className << "::LoadSnapshot:\n"
+              << "    " << filename << " was written by " << className
+              << ".\n";
+    return false;
+  }
 
-  m_isTreeInitialized = true;
+  // Discard the current field map.
+  m_ready = false;
+  m_grid.Clear();
+  m_isGridInitialized = false;
+  m_neighbours.clear();
+  m_hasNeighbours = false;
+  m_cacheElemBoundingBoxes = false;
+
+  uint8_t flags[4];
+  int32_t counts[4];
+  // (Components with a regular mesh do not fill the element and node lists.)
+  bool ok = in.Read(flags, sizeof(flags)) && in.Read(counts, sizeof(counts)) &&
+            in.ReadVector(elements) && in.ReadVector(nodes);
+  // Check the counts before allocating anything based on them.
+  const size_t nLeft = ok ? in.end - in.p : 0;
+  ok = ok && counts[0] >= 0 && counts[1] >= 0 && counts[2] >= 0 &&
+       counts[3] >= 0 && size_t(counts[3]) <= nLeft &&
+       size_t(counts[2]) * (2 * sizeof(double) + 1) <= nLeft;
+  const size_t nW = ok ? std::max(counts[3], 0) : 0;
+  if (ok) {
+    m_is3d = flags[0];
+    m_warning = flags[1];
+    m_useElementGrid = flags[2];
+    nElements = counts[0];
+    nNodes = counts[1];
+    m_nMaterials = counts[2];
+    nWeightingFields = counts[3];
+    materials.resize(m_nMaterials);
+  }
+  for (unsigned int i = 0; ok && i < m_nMaterials; ++i) {
+    uint8_t drift = 0;
+    ok = in.Read(&materials[i].eps, sizeof(double)) &&
+         in.Read(&materials[i].ohm, sizeof(double)) &&
+         in.Read(&drift, sizeof(drift));
+    materials[i].driftmedium = drift;
+    materials[i].medium = nullptr;
+  }
+  wfields.assign(nW, "");
+  wfieldsOk.assign(nW, false);
+  m_wpot.assign(nW, NodeValues());
+  for (size_t i = 0; ok && i < nW; ++i) {
+    uint8_t wok = 0;
+    uint8_t single = 0;
+    NodeValues& w = m_wpot[i];
+    ok = in.ReadString(wfields[i]) && in.Read(&wok, sizeof(wok)) &&
+         in.Read(&single, sizeof(single)) &&
+         (single ? in.ReadVector(w.f) : in.ReadVector(w.d)) &&
+         (single ? w.f.size() : w.d.size()) == nodes.size();
+    wfieldsOk[i] = wok;
+  }
+  uint8_t bb = 0;
+  ok = ok && in.Read(&bb, sizeof(bb));
+  hasBoundingBox = bb;
+  for (const auto a : {&m_minBoundingBox, &m_maxBoundingBox, &m_mapmin,
+                       &m_mapmax, &m_mapamin, &m_mapamax, &m_mapna,
+                       &m_cells}) {
+    ok = ok && in.Read(a->data(), 3 * sizeof(double));
+  }
+  ok = ok && in.Read(&m_mapvmin, sizeof(double)) &&
+       in.Read(&m_mapvmax, sizeof(double));
+  for (size_t i = 0; ok && i < 3; ++i) {
+    uint8_t on = 0;
+    ok = in.Read(&on, sizeof(on));
+    m_setang[i] = on;
+  }
+  if (ok && flags[3]) {
+    ok = m_grid.Read(in.p, in.end, nElements);
+  }
+  ok = ok && in.ReadVector(m_neighbours) && ReadSnapshotData(in);
+  // Check the contents against the header, such that a corrupt file
+  // cannot lead to accesses out of range.
+  ok = ok && (elements.empty() || elements.size() == size_t(nElements)) &&
+       (nodes.empty() || nodes.size() == size_t(nNodes));
+  // Number of nodes per element (quadrilaterals in 2D, tetrahedra in 3D).
+  const unsigned int nNodesPerElement = m_is3d ? 10 : 8;
+  for (size_t i = 0; ok && i < elements.size(); ++i) {
+    const Element& element = elements[i];
+    for (unsigned int j = 0; j < nNodesPerElement; ++j) {
+      ok = ok && element.emap[j] >= 0 && element.emap[j] < nNodes;
+    }
+    ok = ok && element.matmap < m_nMaterials;
+  }
+  ok = ok && (m_neighbours.empty() ||
+              m_neighbours.size() == 4 * elements.size());
+  for (size_t i = 0; ok && i < m_neighbours.size(); ++i) {
+    ok = m_neighbours[i] >= -1 && m_neighbours[i] < nElements;
+  }
+  if (!ok) {
+    std::cerr << m_className << "::LoadSnapshot:\n"
+              << "    Error reading " << filename << ".\n";
+    elements.clear();
+    nodes.clear();
+    materials.clear();
+    ClearWeightingFields();
+    nElements = nNodes = -1;
+    m_nMaterials = 0;
+    m_grid.Clear();
+    m_neighbours.clear();
+    return false;
+  }
+  m_cacheElemBoundingBoxes = true;
+  m_isGridInitialized = m_grid.IsBuilt();
+  m_hasNeighbours = !m_neighbours.empty();
+  m_ready = true;
+  LastElement() = -1;
+  // Set up whatever is missing (e. g. if the walk was not used before).
+  if (!elements.empty()) InitializeElementSearch("LoadSnapshot");
+  std::cout << m_className << "::LoadSnapshot:\n"
+            << "    Read " << nElements << " elements and " << nNodes
+            << " nodes from " << filename << ".\n";
+  UpdatePeriodicity();
   return true;
 }
 
+void ComponentFieldMap::WeightingField(const double x, const double y,
+                                       const double z, double& wx, double& wy,
+                                       double& wz, const std::string& label) {
+  WeightingFieldFromHandle(x, y, z, wx, wy, wz, FindWeightingField(label));
+}
+
+double ComponentFieldMap::WeightingPotential(const double x, const double y,
+                                             const double z,
+                                             const std::string& label) {
+  return WeightingPotentialFromHandle(x, y, z, FindWeightingField(label));
+}
+
+void ComponentFieldMap::EnableSinglePrecisionWeightingFields(const bool on) {
+  m_singlePrecisionWeightingFields = on;
+  // Convert the weighting fields which have already been loaded.
+  for (auto& w : m_wpot) {
+    if (on && w.f.empty() && !w.d.empty()) {
+      w.f.assign(w.d.begin(), w.d.end());
+      std::vector<double>().swap(w.d);
+    } else if (!on && !w.f.empty()) {
+      w.d.assign(w.f.begin(), w.f.end());
+      std::vector<float>().swap(w.f);
+    }
+  }
+}
+
+int ComponentFieldMap::FindWeightingField(const std::string& label) const {
+  const int n = wfields.size();
+  for (int i = 0; i < n; ++i) {
+    if (wfields[i] == label) return i;
+  }
+  return -1;
+}
+
+int ComponentFieldMap::AddWeightingField(const std::string& label) {
+  const int iw = FindWeightingField(label);
+  if (iw >= 0) {
+    std::cout << m_className << "::SetWeightingField:\n"
+              << "    Replacing existing weighting field " << label << ".\n";
+    wfieldsOk[iw] = false;
+    return iw;
+  }
+  wfields.push_back(label);
+  wfieldsOk.push_back(false);
+  m_wpot.push_back(NodeValues());
+  return nWeightingFields++;
+}
+
+void ComponentFieldMap::SetWeightingPotentials(const int iw,
+                                               std::vector<double>& values) {
+  NodeValues& w = m_wpot[iw];
+  if (m_singlePrecisionWeightingFields) {
+    w.f.assign(values.begin(), values.end());
+    std::vector<double>().swap(w.d);
+  } else {
+    w.d.swap(values);
+    std::vector<float>().swap(w.f);
+  }
+}
+
+void ComponentFieldMap::ClearWeightingFields() {
+  wfields.clear();
+  wfieldsOk.clear();
+  m_wpot.clear();
+  nWeightingFields = 0;
+}
+
 void ComponentFieldMap::PrintElement(const std::string& header, const double x,
                                      const double y, const double z,
                                      const double t1, const double t2,
@@ -2405,7 +3026,7 @@ void ComponentFieldMap::PrintElement(const std::string& header, const double x,
   std::cout << " Node             x            y            z            V\n";
   for (unsigned int ii = 0; ii < n; ++ii) {
     const Node& node = nodes[element.emap[ii]];
-    const double v = iw < 0 ? node.v : node.w[iw];
+    const double v = iw < 0 ? node.v : m_wpot[iw][element.emap[ii]];
     printf("      %-5d %12g %12g %12g %12g\n", element.emap[ii], node.x, node.y,
            node.z, v);
   }
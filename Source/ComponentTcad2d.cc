@@ -1,4 +1,5 @@
 #include <algorithm>
+#include <array>
 #include <cmath>
 #include <fstream>
 #include <iostream>
@@ -6,8 +7,18 @@
 #include <string>
 
 #include "ComponentTcad2d.hh"
+#include "Snapshot.hh"
+#include "ThreadPool.hh"
 #include "Utilities.hh"
 
+namespace {
+
+const char SnapshotTag[8] = {'G', 'T', 'C', 'A', 'D', '2', 'D', 'S'};
+const uint32_t SnapshotVersion = 1;
+// Number of scalar quantities stored for each vertex.
+constexpr unsigned int nVertexValues = 13;
+}
+
 namespace Garfield {
 
 ComponentTcad2d::ComponentTcad2d() : ComponentBase() {
@@ -156,9 +167,10 @@ void ComponentTcad2d::ElectricField(const double xin, const double yin,
   // Assume this will work.
   status = 0;
   double w[nMaxVertices] = {0};
-  if (m_lastElement >= 0) {
+  int& lastElement = LastElement();
+  if (lastElement >= 0) {
     // Check if the point is still located in the previously found element.
-    const Element& last = m_elements[m_lastElement];
+    const Element& last = m_elements[lastElement];
     if (x >= last.xmin && x <= last.xmax && y >= last.ymin && y <= last.ymax) {
       if (CheckElement(x, y, last, w)) {
         const unsigned int nVertices = last.type + 1;
@@ -195,15 +207,14 @@ void ComponentTcad2d::ElectricField(const double xin, const double yin,
       if (ymirr) ey = -ey;
       m = m_regions[element.region].medium;
       if (!m_regions[element.region].drift || !m) status = -5;
-      m_lastElement = last.neighbours[i];
+      lastElement = last.neighbours[i];
       return;
     }
   }
 
   // The point is not in the previous element nor in the adjacent ones.
-  // We have to loop over all elements.
-  const unsigned int nElements = m_elements.size();
-  for (unsigned int i = 0; i < nElements; ++i) {
+  // Check the elements in the cell of the element grid containing the point.
+  for (const int i : m_grid.GetElements(x, y, 0.)) {
     const Element& element = m_elements[i];
     if (x < element.xmin || x > element.xmax || y < element.ymin ||
         y > element.ymax)
@@ -220,7 +231,7 @@ void ComponentTcad2d::ElectricField(const double xin, const double yin,
     if (ymirr) ey = -ey;
     m = m_regions[element.region].medium;
     if (!m_regions[element.region].drift || !m) status = -5;
-    m_lastElement = i;
+    lastElement = i;
     return;
   }
   // Point is outside the mesh.
@@ -261,9 +272,10 @@ void ComponentTcad2d::ElectronVelocity(const double xin, const double yin,
   // Assume this will work.
   status = 0;
   double w[nMaxVertices] = {0};
-  if (m_lastElement >= 0) {
+  int& lastElement = LastElement();
+  if (lastElement >= 0) {
     // Check if the point is still located in the previously found element.
-    const Element& last = m_elements[m_lastElement];
+    const Element& last = m_elements[lastElement];
     if (x >= last.xmin && x <= last.xmax && y >= last.ymin && y <= last.ymax) {
       if (CheckElement(x, y, last, w)) {
         const unsigned int nVertices = last.type + 1;
@@ -298,15 +310,14 @@ void ComponentTcad2d::ElectronVelocity(const double xin, const double yin,
       if (ymirr) vy = -vy;
       m = m_regions[element.region].medium;
       if (!m_regions[element.region].drift || !m) status = -5;
-      m_lastElement = last.neighbours[i];
+      lastElement = last.neighbours[i];
       return;
     }
   }
 
   // The point is not in the previous element nor in the adjacent ones.
-  // We have to loop over all elements.
-  const unsigned int nElements = m_elements.size();
-  for (unsigned int i = 0; i < nElements; ++i) {
+  // Check the elements in the cell of the element grid containing the point.
+  for (const int i : m_grid.GetElements(x, y, 0.)) {
     const Element& element = m_elements[i];
     if (x < element.xmin || x > element.xmax || y < element.ymin ||
         y > element.ymax)
@@ -322,7 +333,7 @@ void ComponentTcad2d::ElectronVelocity(const double xin, const double yin,
     if (ymirr) vy = -vy;
     m = m_regions[element.region].medium;
     if (!m_regions[element.region].drift || !m) status = -5;
-    m_lastElement = i;
+    lastElement = i;
     return;
   }
   // Point is outside the mesh.
@@ -365,9 +376,10 @@ void ComponentTcad2d::HoleVelocity(const double xin, const double yin,
   status = 0;
 
   double w[nMaxVertices] = {0};
-  if (m_lastElement >= 0) {
+  int& lastElement = LastElement();
+  if (lastElement >= 0) {
     // Check if the point is still located in the previously found element.
-    const Element& last = m_elements[m_lastElement];
+    const Element& last = m_elements[lastElement];
     if (x >= last.xmin && x <= last.xmax && y >= last.ymin && y <= last.ymax) {
       if (CheckElement(x, y, last, w)) {
         const unsigned int nVertices = last.type + 1;
@@ -402,15 +414,14 @@ void ComponentTcad2d::HoleVelocity(const double xin, const double yin,
       if (ymirr) vy = -vy;
       m = m_regions[element.region].medium;
       if (!m_regions[element.region].drift || !m) status = -5;
-      m_lastElement = last.neighbours[i];
+      lastElement = last.neighbours[i];
       return;
     }
   }
 
   // The point is not in the previous element nor in the adjacent ones.
-  // We have to loop over all elements.
-  const unsigned int nElements = m_elements.size();
-  for (unsigned int i = 0; i < nElements; ++i) {
+  // Check the elements in the cell of the element grid containing the point.
+  for (const int i : m_grid.GetElements(x, y, 0.)) {
     const Element& element = m_elements[i];
     if (x < element.xmin || x > element.xmax || y < element.ymin ||
         y > element.ymax)
@@ -426,7 +437,7 @@ void ComponentTcad2d::HoleVelocity(const double xin, const double yin,
     if (ymirr) vy = -vy;
     m = m_regions[element.region].medium;
     if (!m_regions[element.region].drift || !m) status = -5;
-    m_lastElement = i;
+    lastElement = i;
     return;
   }
 
@@ -459,9 +470,10 @@ Medium* ComponentTcad2d::GetMedium(const double xin, const double yin,
 
   // Shape functions
   double w[nMaxVertices] = {0};
-  if (m_lastElement >= 0) {
+  int& lastElement = LastElement();
+  if (lastElement >= 0) {
     // Check if the point is still located in the previously found element.
-    const Element& last = m_elements[m_lastElement];
+    const Element& last = m_elements[lastElement];
     if (x >= last.xmin && x <= last.xmax && y >= last.ymin && y <= last.ymax &&
         CheckElement(x, y, last, w)) {
       return m_regions[last.region].medium;
@@ -476,21 +488,20 @@ Medium* ComponentTcad2d::GetMedium(const double xin, const double yin,
           y > element.ymax)
         continue;
       if (!CheckElement(x, y, element, w)) continue;
-      m_lastElement = last.neighbours[i];
+      lastElement = last.neighbours[i];
       return m_regions[element.region].medium;
     }
   }
 
   // The point is not in the previous element nor in the adjacent ones.
-  // We have to loop over all elements.
-  const unsigned int nElements = m_elements.size();
-  for (unsigned int i = 0; i < nElements; ++i) {
+  // Check the elements in the cell of the element grid containing the point.
+  for (const int i : m_grid.GetElements(x, y, 0.)) {
     const Element& element = m_elements[i];
     if (x < element.xmin || x > element.xmax || y < element.ymin ||
         y > element.ymax)
       continue;
     if (!CheckElement(x, y, element, w)) continue;
-    m_lastElement = i;
+    lastElement = i;
     return m_regions[element.region].medium;
   }
 
@@ -519,9 +530,10 @@ bool ComponentTcad2d::GetElectronLifetime(const double xin, const double yin,
   if (m_hasRangeZ && (z < m_zMinBB || z > m_zMaxBB)) return false;
 
   double w[nMaxVertices] = {0};
-  if (m_lastElement >= 0) {
+  int& lastElement = LastElement();
+  if (lastElement >= 0) {
     // Check if the point is still located in the previously found element.
-    const Element& last = m_elements[m_lastElement];
+    const Element& last = m_elements[lastElement];
     if (x >= last.xmin && x <= last.xmax && y >= last.ymin && y <= last.ymax) {
       if (CheckElement(x, y, last, w)) {
         const unsigned int nVertices = last.type + 1;
@@ -546,15 +558,14 @@ bool ComponentTcad2d::GetElectronLifetime(const double xin, const double yin,
         const Vertex& vj = m_vertices[element.vertex[j]];
         tau += w[j] * vj.eTau;
       }
-      m_lastElement = last.neighbours[i];
+      lastElement = last.neighbours[i];
       return true;
     }
   }
 
   // The point is not in the previous element nor in the adjacent ones.
-  // We have to loop over all elements.
-  const unsigned int nElements = m_elements.size();
-  for (unsigned int i = 0; i < nElements; ++i) {
+  // Check the elements in the cell of the element grid containing the point.
+  for (const int i : m_grid.GetElements(x, y, 0.)) {
     const Element& element = m_elements[i];
     if (x < element.xmin || x > element.xmax || y < element.ymin ||
         y > element.ymax)
@@ -565,7 +576,7 @@ bool ComponentTcad2d::GetElectronLifetime(const double xin, const double yin,
       const Vertex& vj = m_vertices[element.vertex[j]];
       tau += w[j] * vj.eTau;
     }
-    m_lastElement = i;
+    lastElement = i;
     return true;
   }
 
@@ -597,9 +608,10 @@ bool ComponentTcad2d::GetHoleLifetime(const double xin, const double yin,
   if (m_hasRangeZ && (z < m_zMinBB || z > m_zMaxBB)) return false;
 
   double w[nMaxVertices] = {0};
-  if (m_lastElement >= 0) {
+  int& lastElement = LastElement();
+  if (lastElement >= 0) {
     // Check if the point is still located in the previously found element.
-    const Element& last = m_elements[m_lastElement];
+    const Element& last = m_elements[lastElement];
     if (x >= last.xmin && x <= last.xmax && y >= last.ymin && y <= last.ymax) {
       if (CheckElement(x, y, last, w)) {
         const unsigned int nVertices = last.type + 1;
@@ -624,15 +636,14 @@ bool ComponentTcad2d::GetHoleLifetime(const double xin, const double yin,
         const Vertex& vj = m_vertices[element.vertex[j]];
         tau += w[j] * vj.hTau;
       }
-      m_lastElement = last.neighbours[i];
+      lastElement = last.neighbours[i];
       return true;
     }
   }
 
   // The point is not in the previous element nor in the adjacent ones.
-  // We have to loop over all elements.
-  const unsigned int nElements = m_elements.size();
-  for (unsigned int i = 0; i < nElements; ++i) {
+  // Check the elements in the cell of the element grid containing the point.
+  for (const int i : m_grid.GetElements(x, y, 0.)) {
     const Element& element = m_elements[i];
     if (x < element.xmin || x > element.xmax || y < element.ymin ||
         y > element.ymax)
@@ -643,7 +654,7 @@ bool ComponentTcad2d::GetHoleLifetime(const double xin, const double yin,
       const Vertex& vj = m_vertices[element.vertex[j]];
       tau += w[j] * vj.hTau;
     }
-    m_lastElement = i;
+    lastElement = i;
     return true;
   }
 
@@ -680,9 +691,10 @@ bool ComponentTcad2d::GetMobility(const double xin, const double yin,
   }
 
   double w[nMaxVertices] = {0};
-  if (m_lastElement >= 0) {
+  int& lastElement = LastElement();
+  if (lastElement >= 0) {
     // Check if the point is still located in the previously found element.
-    const Element& last = m_elements[m_lastElement];
+    const Element& last = m_elements[lastElement];
     if (x >= last.xmin && x <= last.xmax && y >= last.ymin && y <= last.ymax) {
       if (CheckElement(x, y, last, w)) {
         const unsigned int nVertices = last.type + 1;
@@ -709,15 +721,14 @@ bool ComponentTcad2d::GetMobility(const double xin, const double yin,
         emob += w[j] * vj.emob;
         hmob += w[j] * vj.hmob;
       }
-      m_lastElement = last.neighbours[i];
+      lastElement = last.neighbours[i];
       return true;
     }
   }
 
   // The point is not in the previous element nor in the adjacent ones.
-  // We have to loop over all elements.
-  const unsigned int nElements = m_elements.size();
-  for (unsigned int i = 0; i < nElements; ++i) {
+  // Check the elements in the cell of the element grid containing the point.
+  for (const int i : m_grid.GetElements(x, y, 0.)) {
     const Element& element = m_elements[i];
     if (x < element.xmin || x > element.xmax || y < element.ymin ||
         y > element.ymax)
@@ -729,7 +740,7 @@ bool ComponentTcad2d::GetMobility(const double xin, const double yin,
       emob += w[j] * vj.emob;
       hmob += w[j] * vj.hmob;
     }
-    m_lastElement = i;
+    lastElement = i;
     return true;
   }
 
@@ -772,9 +783,10 @@ bool ComponentTcad2d::GetDonorOccupation(const double xin, const double yin,
   }
 
   double w[nMaxVertices] = {0};
-  if (m_lastElement >= 0) {
+  int& lastElement = LastElement();
+  if (lastElement >= 0) {
     // Check if the point is still located in the previously found element.
-    const Element& last = m_elements[m_lastElement];
+    const Element& last = m_elements[lastElement];
     if (x >= last.xmin && x <= last.xmax && y >= last.ymin && y <= last.ymax) {
       if (CheckElement(x, y, last, w)) {
         const unsigned int nVertices = last.type + 1;
@@ -799,15 +811,14 @@ bool ComponentTcad2d::GetDonorOccupation(const double xin, const double yin,
         const Vertex& vj = m_vertices[element.vertex[j]];
         f += w[j] * vj.donorOcc[donorNumber];
       }
-      m_lastElement = last.neighbours[i];
+      lastElement = last.neighbours[i];
       return true;
     }
   }
 
   // The point is not in the previous element nor in the adjacent ones.
-  // We have to loop over all elements.
-  const unsigned int nElements = m_elements.size();
-  for (unsigned int i = 0; i < nElements; ++i) {
+  // Check the elements in the cell of the element grid containing the point.
+  for (const int i : m_grid.GetElements(x, y, 0.)) {
     const Element& element = m_elements[i];
     if (x < element.xmin || x > element.xmax || y < element.ymin ||
         y > element.ymax)
@@ -818,7 +829,7 @@ bool ComponentTcad2d::GetDonorOccupation(const double xin, const double yin,
       const Vertex& vj = m_vertices[element.vertex[j]];
       f += w[j] * vj.donorOcc[donorNumber];
     }
-    m_lastElement = i;
+    lastElement = i;
     return true;
   }
 
@@ -861,9 +872,10 @@ bool ComponentTcad2d::GetAcceptorOccupation(const double xin, const double yin,
   }
 
   double w[nMaxVertices] = {0};
-  if (m_lastElement >= 0) {
+  int& lastElement = LastElement();
+  if (lastElement >= 0) {
     // Check if the point is still located in the previously found element.
-    const Element& last = m_elements[m_lastElement];
+    const Element& last = m_elements[lastElement];
     if (x >= last.xmin && x <= last.xmax && y >= last.ymin && y <= last.ymax) {
       if (CheckElement(x, y, last, w)) {
         const unsigned int nVertices = last.type + 1;
@@ -888,15 +900,14 @@ bool ComponentTcad2d::GetAcceptorOccupation(const double xin, const double yin,
         const Vertex& vj = m_vertices[element.vertex[j]];
         f += w[j] * vj.acceptorOcc[acceptorNumber];
       }
-      m_lastElement = last.neighbours[i];
+      lastElement = last.neighbours[i];
       return true;
     }
   }
 
   // The point is not in the previous element nor in the adjacent ones.
-  // We have to loop over all elements.
-  const unsigned int nElements = m_elements.size();
-  for (unsigned int i = 0; i < nElements; ++i) {
+  // Check the elements in the cell of the element grid containing the point.
+  for (const int i : m_grid.GetElements(x, y, 0.)) {
     const Element& element = m_elements[i];
     if (x < element.xmin || x > element.xmax || y < element.ymin ||
         y > element.ymax)
@@ -907,7 +918,7 @@ bool ComponentTcad2d::GetAcceptorOccupation(const double xin, const double yin,
       const Vertex& vj = m_vertices[element.vertex[j]];
       f += w[j] * vj.acceptorOcc[acceptorNumber];
     }
-    m_lastElement = i;
+    lastElement = i;
     return true;
   }
 
@@ -1131,8 +1142,10 @@ bool ComponentTcad2d::Initialise(const std::string& gridfilename,
 
   // Find adjacent elements.
   std::cout << m_className << "::Initialise:\n"
-            << "    Looking for neighbouring elements. Be patient...\n";
+            << "    Looking for neighbouring elements.\n";
   FindNeighbours();
+  // Set up the grid used for locating points in the mesh.
+  if (!BuildElementGrid()) ok = false;
 
   if (!ok) {
     m_ready = false;
@@ -1147,6 +1160,234 @@ bool ComponentTcad2d::Initialise(const std::string& gridfilename,
   return true;
 }
 
+bool ComponentTcad2d::SaveSnapshot(const std::string& filename) const {
+  if (!m_ready) {
+    std::cerr << m_className << "::SaveSnapshot:\n"
+              << "    Field map not available.\n";
+    return false;
+  }
+
+  std::vector<char> buffer;
+  Snapshot::AppendString(buffer, m_className);
+  const uint64_t nRegions = m_regions.size();
+  Snapshot::Append(buffer, &nRegions, sizeof(nRegions));
+  for (const auto& region : m_regions) {
+    Snapshot::AppendString(buffer, region.name);
+    const uint8_t drift = region.drift;
+    Snapshot::Append(buffer, &drift, sizeof(drift));
+  }
+  const uint8_t flags[9] = {m_hasPotential,        m_hasField,
+                            m_hasElectronMobility, m_hasHoleMobility,
+                            m_hasElectronVelocity, m_hasHoleVelocity,
+                            m_hasElectronLifetime, m_hasHoleLifetime,
+                            m_validTraps};
+  Snapshot::Append(buffer, flags, sizeof(flags));
+  Snapshot::AppendVector(buffer, m_donors);
+  Snapshot::AppendVector(buffer, m_acceptors);
+
+  // Vertices: coordinates and data, then the trap occupations.
+  const size_t nVertices = m_vertices.size();
+  std::vector<double> values;
+  values.reserve(nVertices * nVertexValues);
+  std::vector<uint32_t> nOcc;
+  nOcc.reserve(2 * nVertices);
+  std::vector<float> occ;
+  for (const auto& v : m_vertices) {
+    values.insert(values.end(), {v.x, v.y, v.p, v.ex, v.ey, v.emob, v.hmob,
+                                 v.eVx, v.eVy, v.hVx, v.hVy, v.eTau, v.hTau});
+    nOcc.insert(nOcc.end(), {static_cast<uint32_t>(v.donorOcc.size()),
+                             static_cast<uint32_t>(v.acceptorOcc.size())});
+    occ.insert(occ.end(), v.donorOcc.begin(), v.donorOcc.end());
+    occ.insert(occ.end(), v.acceptorOcc.begin(), v.acceptorOcc.end());
+  }
+  Snapshot::AppendVector(buffer, values);
+  Snapshot::AppendVector(buffer, nOcc);
+  Snapshot::AppendVector(buffer, occ);
+
+  // Elements: vertices, type and region, bounding box and neighbours.
+  const size_t nElements = m_elements.size();
+  std::vector<int> indices;
+  indices.reserve(nElements * (nMaxVertices + 2));
+  std::vector<double> boxes;
+  boxes.reserve(nElements * 4);
+  std::vector<uint32_t> offsets(1, 0);
+  offsets.reserve(nElements + 1);
+  std::vector<int> neighbours;
+  for (const auto& element : m_elements) {
+    indices.insert(indices.end(), element.vertex,
+                   element.vertex + nMaxVertices);
+    indices.insert(indices.end(), {element.type, element.region});
+    boxes.insert(boxes.end(),
+                 {element.xmin, element.ymin, element.xmax, element.ymax});
+    neighbours.insert(neighbours.end(), element.neighbours.begin(),
+                      element.neighbours.end());
+    offsets.push_back(neighbours.size());
+  }
+  Snapshot::AppendVector(buffer, indices);
+  Snapshot::AppendVector(buffer, boxes);
+  Snapshot::AppendVector(buffer, offsets);
+  Snapshot::AppendVector(buffer, neighbours);
+
+  const double ranges[6] = {m_pMin,   m_pMax,   m_xMinBB,
+                            m_yMinBB, m_xMaxBB, m_yMaxBB};
+  Snapshot::Append(buffer, ranges, sizeof(ranges));
+  m_grid.Write(buffer);
+
+  std::string error;
+  if (!Snapshot::Write(filename, SnapshotTag, SnapshotVersion, sizeof(Defect),
+                       buffer, error)) {
+    std::cerr << m_className << "::SaveSnapshot:\n    " << error << "\n";
+    return false;
+  }
+  std::cout << m_className << "::SaveSnapshot:\n"
+            << "    Wrote " << nElements << " elements and " << nVertices
+            << " vertices to " << filename << ".\n";
+  return true;
+}
+
+bool ComponentTcad2d::LoadSnapshot(const std::string& filename) {
+  std::shared_ptr<void> mapping;
+  Snapshot::Reader in;
+  std::string error;
+  if (!Snapshot::Open(filename, SnapshotTag, SnapshotVersion, sizeof(Defect),
+                      mapping, in, error)) {
+    std::cerr << m_className << "::LoadSnapshot:\n    " << error << "\n";
+    return false;
+  }
+  std::string className;
+  if (!in.ReadString(className) || className != m_className) {
+    std::cerr << m_className << "::LoadSnapshot:\n"
+              << "    " << filename << " was written by " << className
+              << ".\n";
+    return false;
+  }
+
+  // Discard the current field map.
+  m_ready = false;
+  Cleanup();
+
+  uint64_t nRegions = 0;
+  bool ok = in.Read(&nRegions, sizeof(nRegions)) &&
+            nRegions <= static_cast<uint64_t>(in.end - in.p);
+  if (ok) m_regions.resize(nRegions);
+  for (auto& region : m_regions) {
+    uint8_t drift = 0;
+    ok = ok && in.ReadString(region.name) && in.Read(&drift, sizeof(drift));
+    region.drift = drift;
+    region.medium = nullptr;
+  }
+  uint8_t flags[9] = {0};
+  ok = ok && in.Read(flags, sizeof(flags)) && in.ReadVector(m_donors) &&
+       in.ReadVector(m_acceptors);
+  m_hasPotential = flags[0];
+  m_hasField = flags[1];
+  m_hasElectronMobility = flags[2];
+  m_hasHoleMobility = flags[3];
+  m_hasElectronVelocity = flags[4];
+  m_hasHoleVelocity = flags[5];
+  m_hasElectronLifetime = flags[6];
+  m_hasHoleLifetime = flags[7];
+  m_validTraps = flags[8];
+
+  std::vector<double> values;
+  std::vector<uint32_t> nOcc;
+  std::vector<float> occ;
+  ok = ok && in.ReadVector(values) && in.ReadVector(nOcc) &&
+       in.ReadVector(occ);
+  const size_t nVertices = values.size() / nVertexValues;
+  ok = ok && values.size() == nVertices * nVertexValues &&
+       nOcc.size() == 2 * nVertices;
+  if (ok) m_vertices.resize(nVertices);
+  size_t k = 0;
+  for (size_t i = 0; ok && i < nVertices; ++i) {
+    Vertex& v = m_vertices[i];
+    const double* data = values.data() + i * nVertexValues;
+    v.x = data[0];
+    v.y = data[1];
+    v.p = data[2];
+    v.ex = data[3];
+    v.ey = data[4];
+    v.emob = data[5];
+    v.hmob = data[6];
+    v.eVx = data[7];
+    v.eVy = data[8];
+    v.hVx = data[9];
+    v.hVy = data[10];
+    v.eTau = data[11];
+    v.hTau = data[12];
+    const size_t nDonors = nOcc[2 * i];
+    const size_t nAcceptors = nOcc[2 * i + 1];
+    ok = occ.size() - k >= nDonors + nAcceptors;
+    if (!ok) break;
+    v.donorOcc.assign(occ.begin() + k, occ.begin() + k + nDonors);
+    k += nDonors;
+    v.acceptorOcc.assign(occ.begin() + k, occ.begin() + k + nAcceptors);
+    k += nAcceptors;
+  }
+
+  std::vector<int> indices;
+  std::vector<double> boxes;
+  std::vector<uint32_t> offsets;
+  std::vector<int> neighbours;
+  ok = ok && in.ReadVector(indices) && in.ReadVector(boxes) &&
+       in.ReadVector(offsets) && in.ReadVector(neighbours);
+  const size_t nElements = boxes.size() / 4;
+  ok = ok && nElements > 0 && boxes.size() == nElements * 4 &&
+       indices.size() == nElements * (nMaxVertices + 2) &&
+       offsets.size() == nElements + 1 && offsets.back() == neighbours.size();
+  if (ok) m_elements.resize(nElements);
+  for (size_t i = 0; ok && i < nElements; ++i) {
+    Element& element = m_elements[i];
+    const int* data = indices.data() + i * (nMaxVertices + 2);
+    std::copy(data, data + nMaxVertices, element.vertex);
+    element.type = data[nMaxVertices];
+    element.region = data[nMaxVertices + 1];
+    ok = element.type >= 1 && element.type <= 3 && element.region >= 0 &&
+         element.region < static_cast<int>(nRegions) &&
+         offsets[i] <= offsets[i + 1];
+    for (int j = 0; ok && j <= element.type; ++j) {
+      ok = element.vertex[j] >= 0 &&
+           element.vertex[j] < static_cast<int>(nVertices);
+    }
+    if (!ok) break;
+    const double* box = boxes.data() + i * 4;
+    element.xmin = box[0];
+    element.ymin = box[1];
+    element.xmax = box[2];
+    element.ymax = box[3];
+    element.neighbours.assign(neighbours.begin() + offsets[i],
+                              neighbours.begin() + offsets[i + 1]);
+    for (const int j : element.neighbours) {
+      ok = ok && j >= 0 && j < static_cast<int>(nElements);
+    }
+  }
+  double ranges[6];
+  ok = ok && in.Read(ranges, sizeof(ranges)) &&
+       m_grid.Read(in.p, in.end, nElements);
+  if (!ok) {
+    std::cerr << m_className << "::LoadSnapshot:\n"
+              << "    Error reading " << filename << ".\n";
+    Cleanup();
+    m_donors.clear();
+    m_acceptors.clear();
+    m_validTraps = false;
+    return false;
+  }
+  m_pMin = ranges[0];
+  m_pMax = ranges[1];
+  m_xMinBB = ranges[2];
+  m_yMinBB = ranges[3];
+  m_xMaxBB = ranges[4];
+  m_yMaxBB = ranges[5];
+  m_ready = true;
+  LastElement() = -1;
+  std::cout << m_className << "::LoadSnapshot:\n"
+            << "    Read " << nElements << " elements and " << nVertices
+            << " vertices from " << filename << ".\n";
+  UpdatePeriodicity();
+  return true;
+}
+
 bool ComponentTcad2d::GetBoundingBox(double& xmin, double& ymin, double& zmin,
                                      double& xmax, double& ymax, double& zmax) {
   if (!m_ready) return false;
@@ -2123,40 +2364,71 @@ bool ComponentTcad2d::LoadGrid(const std::string& gridfilename) {
 }
 
 void ComponentTcad2d::FindNeighbours() {
-  const unsigned int nElements = m_elements.size();
-  std::vector<std::vector<bool> > adjacent(nElements,
-                                           std::vector<bool>(nElements, false));
-
-  const double tol = 5.e-4;
-  for (unsigned int i = 0; i < nElements; ++i) {
-    const Element& ei = m_elements[i];
-    for (unsigned int j = 0; j < nElements; ++j) {
-      if (i == j || adjacent[i][j]) continue;
-      const Element& ej = m_elements[j];
-      if (ei.xmin > ej.xmax + tol || ei.xmax < ej.xmin - tol) continue;
-      if (ei.ymin > ej.ymax + tol || ei.ymax < ej.ymin - tol) continue;
-      for (unsigned int m = 0; m < nMaxVertices; ++m) {
-        if (ei.vertex[m] < 0) break;
-        for (unsigned int n = 0; n < nMaxVertices; ++n) {
-          if (ei.vertex[n] < 0) break;
-          if (ei.vertex[m] == ej.vertex[n]) {
-            adjacent[i][j] = adjacent[j][i] = true;
-            break;
-          }
-        }
-        if (adjacent[i][j]) break;
+  const size_t nElements = m_elements.size();
+  const size_t nVertices = m_vertices.size();
+  // Make a list of the elements attached to each vertex.
+  std::vector<unsigned int> first(nVertices + 1, 0);
+  for (const auto& element : m_elements) {
+    const unsigned int n = element.type + 1;
+    for (unsigned int j = 0; j < n; ++j) ++first[element.vertex[j] + 1];
+  }
+  for (size_t i = 0; i < nVertices; ++i) first[i + 1] += first[i];
+  std::vector<int> attached(first.back());
+  std::vector<unsigned int> next(first.begin(), first.end() - 1);
+  for (size_t i = 0; i < nElements; ++i) {
+    const Element& element = m_elements[i];
+    const unsigned int n = element.type + 1;
+    for (unsigned int j = 0; j < n; ++j) {
+      attached[next[element.vertex[j]]++] = i;
+    }
+  }
+
+  // Elements are neighbours if they share a vertex.
+  auto collect = [&](const size_t begin, const size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+      Element& element = m_elements[i];
+      std::vector<int>& neighbours = element.neighbours;
+      neighbours.clear();
+      const unsigned int n = element.type + 1;
+      for (unsigned int j = 0; j < n; ++j) {
+        const int v = element.vertex[j];
+        neighbours.insert(neighbours.end(), attached.begin() + first[v],
+                          attached.begin() + first[v + 1]);
       }
+      std::sort(neighbours.begin(), neighbours.end());
+      neighbours.erase(std::unique(neighbours.begin(), neighbours.end()),
+                       neighbours.end());
+      neighbours.erase(
+          std::find(neighbours.begin(), neighbours.end(), int(i)));
     }
+  };
+  // Split large meshes into blocks processed in parallel.
+  if (nElements < 100000) {
+    collect(0, nElements);
+    return;
   }
+  ThreadPool pool;
+  const size_t nBlocks = 4 * pool.GetNumberOfThreads();
+  const size_t blockSize = (nElements + nBlocks - 1) / nBlocks;
+  pool.ParallelFor(nBlocks, [&](const size_t k, unsigned int) {
+    const size_t begin = std::min(k * blockSize, nElements);
+    collect(begin, std::min(begin + blockSize, nElements));
+  });
+}
 
-  for (unsigned int i = 0; i < nElements; ++i) {
-    m_elements[i].neighbours.clear();
-    for (unsigned int j = 0; j < nElements; ++j) {
-      if (adjacent[i][j]) {
-        m_elements[i].neighbours.push_back(j);
-      }
-    }
+bool ComponentTcad2d::BuildElementGrid() {
+  std::vector<std::array<double, 6> > boxes;
+  boxes.reserve(m_elements.size());
+  for (const auto& element : m_elements) {
+    boxes.push_back(
+        {{element.xmin, element.ymin, 0., element.xmax, element.ymax, 0.}});
   }
+  if (!m_grid.Build(boxes, false)) {
+    std::cerr << m_className << "::BuildElementGrid:\n"
+              << "    Could not set up the grid for the element search.\n";
+    return false;
+  }
+  return true;
 }
 
 void ComponentTcad2d::Cleanup() {
@@ -2168,6 +2440,9 @@ void ComponentTcad2d::Cleanup() {
 
   // Regions
   m_regions.clear();
+
+  // Element search
+  m_grid.Clear();
 }
 
 bool ComponentTcad2d::CheckElement(const double x, const double y,
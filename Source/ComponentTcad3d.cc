@@ -1,4 +1,5 @@
 #include <algorithm>
+#include <array>
 #include <cmath>
 #include <fstream>
 #include <iostream>
@@ -7,8 +8,16 @@
 
 #include "ComponentTcad3d.hh"
 #include "GarfieldConstants.hh"
+#include "Snapshot.hh"
+#include "ThreadPool.hh"
 #include "Utilities.hh"
 
+namespace {
+
+const char SnapshotTag[8] = {'G', 'T', 'C', 'A', 'D', '3', 'D', 'S'};
+const uint32_t SnapshotVersion = 1;
+}
+
 namespace Garfield {
 
 ComponentTcad3d::ComponentTcad3d() : ComponentBase() {
@@ -48,9 +57,10 @@ void ComponentTcad3d::ElectricField(const double xin, const double yin,
   // Assume this will work.
   status = 0;
   double w[nMaxVertices] = {0};
-  if (m_lastElement >= 0) {
+  int& lastElement = LastElement();
+  if (lastElement >= 0) {
     // Check if the point is still located in the previously found element.
-    const Element& last = m_elements[m_lastElement];
+    const Element& last = m_elements[lastElement];
     if (x >= last.xmin && x <= last.xmax && y >= last.ymin && y <= last.ymax &&
         z >= last.zmin && z <= last.zmax) {
       if (CheckElement(x, y, z, last, w)) {
@@ -92,15 +102,14 @@ void ComponentTcad3d::ElectricField(const double xin, const double yin,
       if (zmirr) ez = -ez;
       m = m_regions[element.region].medium;
       if (!m_regions[element.region].drift || !m) status = -5;
-      m_lastElement = last.neighbours[i];
+      lastElement = last.neighbours[i];
       return;
     }
   }
 
   // The point is not in the previous element.
-  // We have to loop over all elements.
-  const unsigned int nElements = m_elements.size();
-  for (unsigned int i = 0; i < nElements; ++i) {
+  // Check the elements in the cell of the element grid containing the point.
+  for (const int i : m_grid.GetElements(x, y, z)) {
     const Element& element = m_elements[i];
     if (x < element.xmin || x > element.xmax || y < element.ymin ||
         y > element.ymax || z < element.zmin || z > element.zmax)
@@ -119,7 +128,7 @@ void ComponentTcad3d::ElectricField(const double xin, const double yin,
     if (zmirr) ez = -ez;
     m = m_regions[element.region].medium;
     if (!m_regions[element.region].drift || !m) status = -5;
-    m_lastElement = i;
+    lastElement = i;
     return;
   }
 
@@ -160,9 +169,10 @@ Medium* ComponentTcad3d::GetMedium(const double xin, const double yin,
   }
 
   double w[nMaxVertices] = {0};
-  if (m_lastElement >= 0) {
+  int& lastElement = LastElement();
+  if (lastElement >= 0) {
     // Check if the point is still located in the previously found element.
-    const Element& last = m_elements[m_lastElement];
+    const Element& last = m_elements[lastElement];
     if (x >= last.xmin && x <= last.xmax && y >= last.ymin && y <= last.ymax &&
         z >= last.zmin && z <= last.zmax) {
       if (CheckElement(x, y, z, last, w)) {
@@ -179,21 +189,20 @@ Medium* ComponentTcad3d::GetMedium(const double xin, const double yin,
           y > element.ymax || z < element.zmin || z > element.zmax)
         continue;
       if (!CheckElement(x, y, z, element, w)) continue;
-      m_lastElement = last.neighbours[i];
+      lastElement = last.neighbours[i];
       return m_regions[element.region].medium;
     }
   }
 
   // The point is not in the previous element nor in the adjacent ones.
-  // We have to loop over all elements.
-  const unsigned int nElements = m_elements.size();
-  for (unsigned int i = 0; i < nElements; ++i) {
+  // Check the elements in the cell of the element grid containing the point.
+  for (const int i : m_grid.GetElements(x, y, z)) {
     const Element& element = m_elements[i];
     if (x < element.xmin || x > element.xmax || y < element.ymin ||
         y > element.ymax || z < element.zmin || z > element.zmax)
       continue;
     if (!CheckElement(x, y, z, element, w)) continue;
-    m_lastElement = i;
+    lastElement = i;
     return m_regions[element.region].medium;
   }
 
@@ -390,8 +399,10 @@ bool ComponentTcad3d::Initialise(const std::string& gridfilename,
 
   // Find adjacent elements.
   std::cout << m_className << "::Initialise:\n"
-            << "    Looking for neighbouring elements. Be patient...\n";
+            << "    Looking for neighbouring elements.\n";
   FindNeighbours();
+  // Set up the grid used for locating points in the mesh.
+  if (!BuildElementGrid()) ok = false;
 
   if (!ok) {
     m_ready = false;
@@ -406,42 +417,228 @@ bool ComponentTcad3d::Initialise(const std::string& gridfilename,
   return true;
 }
 
-void ComponentTcad3d::FindNeighbours() {
-  const unsigned int nElements = m_elements.size();
-  std::vector<std::vector<bool> > adjacent(nElements,
-                                           std::vector<bool>(nElements, false));
+bool ComponentTcad3d::SaveSnapshot(const std::string& filename) const {
+  if (!m_ready) {
+    std::cerr << m_className << "::SaveSnapshot:\n"
+              << "    Field map not available.\n";
+    return false;
+  }
 
-  const double tol = 5.e-4;
-  for (unsigned int i = 0; i < nElements; ++i) {
-    const Element& ei = m_elements[i];
-    for (unsigned int j = 0; j < nElements; ++j) {
-      if (i == j || adjacent[i][j]) continue;
-      const Element& ej = m_elements[j];
-      if (ei.xmin > ej.xmax + tol || ei.xmax < ej.xmin - tol) continue;
-      if (ei.ymin > ej.ymax + tol || ei.ymax < ej.ymin - tol) continue;
-      if (ei.zmin > ej.zmax + tol || ei.zmax < ej.zmin - tol) continue;
-      for (unsigned int m = 0; m < nMaxVertices; ++m) {
-        if (ei.vertex[m] < 0) break;
-        for (unsigned int n = 0; n < nMaxVertices; ++n) {
-          if (ei.vertex[n] < 0) break;
-          if (ei.vertex[m] == ej.vertex[n]) {
-            adjacent[i][j] = adjacent[j][i] = true;
-            break;
-          }
-        }
-        if (adjacent[i][j]) break;
-      }
+  std::vector<char> buffer;
+  Snapshot::AppendString(buffer, m_className);
+  const uint64_t nRegions = m_regions.size();
+  Snapshot::Append(buffer, &nRegions, sizeof(nRegions));
+  for (const auto& region : m_regions) {
+    Snapshot::AppendString(buffer, region.name);
+    const uint8_t drift = region.drift;
+    Snapshot::Append(buffer, &drift, sizeof(drift));
+  }
+  Snapshot::AppendVector(buffer, m_vertices);
+
+  // Elements: vertices, type and region, bounding box and neighbours.
+  const size_t nElements = m_elements.size();
+  std::vector<int> indices;
+  indices.reserve(nElements * (nMaxVertices + 2));
+  std::vector<double> boxes;
+  boxes.reserve(nElements * 6);
+  std::vector<uint32_t> offsets(1, 0);
+  offsets.reserve(nElements + 1);
+  std::vector<int> neighbours;
+  for (const auto& element : m_elements) {
+    indices.insert(indices.end(), element.vertex,
+                   element.vertex + nMaxVertices);
+    indices.insert(indices.end(), {element.type, element.region});
+    boxes.insert(boxes.end(), {element.xmin, element.ymin, element.zmin,
+                               element.xmax, element.ymax, element.zmax});
+    neighbours.insert(neighbours.end(), element.neighbours.begin(),
+                      element.neighbours.end());
+    offsets.push_back(neighbours.size());
+  }
+  Snapshot::AppendVector(buffer, indices);
+  Snapshot::AppendVector(buffer, boxes);
+  Snapshot::AppendVector(buffer, offsets);
+  Snapshot::AppendVector(buffer, neighbours);
+
+  const double ranges[8] = {m_pMin,   m_pMax,   m_xMinBB, m_yMinBB,
+                            m_zMinBB, m_xMaxBB, m_yMaxBB, m_zMaxBB};
+  Snapshot::Append(buffer, ranges, sizeof(ranges));
+  m_grid.Write(buffer);
+
+  std::string error;
+  if (!Snapshot::Write(filename, SnapshotTag, SnapshotVersion, sizeof(Vertex),
+                       buffer, error)) {
+    std::cerr << m_className << "::SaveSnapshot:\n    " << error << "\n";
+    return false;
+  }
+  std::cout << m_className << "::SaveSnapshot:\n"
+            << "    Wrote " << nElements << " elements and "
+            << m_vertices.size() << " vertices to " << filename << ".\n";
+  return true;
+}
+
+bool ComponentTcad3d::LoadSnapshot(const std::string& filename) {
+  std::shared_ptr<void> mapping;
+  Snapshot::Reader in;
+  std::string error;
+  if (!Snapshot::Open(filename, SnapshotTag, SnapshotVersion, sizeof(Vertex),
+                      mapping, in, error)) {
+    std::cerr << m_className << "::LoadSnapshot:\n    " << error << "\n";
+    return false;
+  }
+  std::string className;
+  if (!in.ReadString(className) || className != m_className) {
+    std::cerr << m_className << "::LoadSnapshot:\n"
+              << "    " << filename << " was written by " << className
+              << ".\n";
+    return false;
+  }
+
+  // Discard the current field map.
+  m_ready = false;
+  Cleanup();
+
+  uint64_t nRegions = 0;
+  bool ok = in.Read(&nRegions, sizeof(nRegions)) &&
+            nRegions <= static_cast<uint64_t>(in.end - in.p);
+  if (ok) m_regions.resize(nRegions);
+  for (auto& region : m_regions) {
+    uint8_t drift = 0;
+    ok = ok && in.ReadString(region.name) && in.Read(&drift, sizeof(drift));
+    region.drift = drift;
+    region.medium = nullptr;
+  }
+  std::vector<int> indices;
+  std::vector<double> boxes;
+  std::vector<uint32_t> offsets;
+  std::vector<int> neighbours;
+  ok = ok && in.ReadVector(m_vertices) && in.ReadVector(indices) &&
+       in.ReadVector(boxes) && in.ReadVector(offsets) &&
+       in.ReadVector(neighbours);
+  const size_t nElements = boxes.size() / 6;
+  const int nVertices = m_vertices.size();
+  ok = ok && nElements > 0 && boxes.size() == nElements * 6 &&
+       indices.size() == nElements * (nMaxVertices + 2) &&
+       offsets.size() == nElements + 1 && offsets.back() == neighbours.size();
+  if (ok) m_elements.resize(nElements);
+  for (size_t i = 0; ok && i < nElements; ++i) {
+    Element& element = m_elements[i];
+    const int* data = indices.data() + i * (nMaxVertices + 2);
+    std::copy(data, data + nMaxVertices, element.vertex);
+    element.type = data[nMaxVertices];
+    element.region = data[nMaxVertices + 1];
+    const unsigned int n = element.type == 2 ? 3 : 4;
+    for (unsigned int j = 0; j < n; ++j) {
+      ok = ok && element.vertex[j] >= 0 && element.vertex[j] < nVertices;
+    }
+    ok = ok && (element.type == 2 || element.type == 5) &&
+         element.region >= 0 && element.region < static_cast<int>(nRegions) &&
+         offsets[i] <= offsets[i + 1];
+    if (!ok) break;
+    const double* box = boxes.data() + i * 6;
+    element.xmin = box[0];
+    element.ymin = box[1];
+    element.zmin = box[2];
+    element.xmax = box[3];
+    element.ymax = box[4];
+    element.zmax = box[5];
+    element.neighbours.assign(neighbours.begin() + offsets[i],
+                              neighbours.begin() + offsets[i + 1]);
+    for (const int k : element.neighbours) {
+      ok = ok && k >= 0 && k < static_cast<int>(nElements);
+    }
+  }
+  double ranges[8];
+  ok = ok && in.Read(ranges, sizeof(ranges)) &&
+       m_grid.Read(in.p, in.end, nElements);
+  if (!ok) {
+    std::cerr << m_className << "::LoadSnapshot:\n"
+              << "    Error reading " << filename << ".\n";
+    Cleanup();
+    return false;
+  }
+  m_pMin = ranges[0];
+  m_pMax = ranges[1];
+  m_xMinBB = ranges[2];
+  m_yMinBB = ranges[3];
+  m_zMinBB = ranges[4];
+  m_xMaxBB = ranges[5];
+  m_yMaxBB = ranges[6];
+  m_zMaxBB = ranges[7];
+  m_ready = true;
+  LastElement() = -1;
+  std::cout << m_className << "::LoadSnapshot:\n"
+            << "    Read " << nElements << " elements and " << nVertices
+            << " vertices from " << filename << ".\n";
+  UpdatePeriodicity();
+  return true;
+}
+
+void ComponentTcad3d::FindNeighbours() {
+  const size_t nElements = m_elements.size();
+  const size_t nVertices = m_vertices.size();
+  // Make a list of the elements attached to each vertex.
+  std::vector<unsigned int> first(nVertices + 1, 0);
+  for (const auto& element : m_elements) {
+    const unsigned int n = element.type == 2 ? 3 : 4;
+    for (unsigned int j = 0; j < n; ++j) ++first[element.vertex[j] + 1];
+  }
+  for (size_t i = 0; i < nVertices; ++i) first[i + 1] += first[i];
+  std::vector<int> attached(first.back());
+  std::vector<unsigned int> next(first.begin(), first.end() - 1);
+  for (size_t i = 0; i < nElements; ++i) {
+    const Element& element = m_elements[i];
+    const unsigned int n = element.type == 2 ? 3 : 4;
+    for (unsigned int j = 0; j < n; ++j) {
+      attached[next[element.vertex[j]]++] = i;
     }
   }
 
-  for (unsigned int i = 0; i < nElements; ++i) {
-    m_elements[i].neighbours.clear();
-    for (unsigned int j = 0; j < nElements; ++j) {
-      if (adjacent[i][j]) {
-        m_elements[i].neighbours.push_back(j);
+  // Elements are neighbours if they share a vertex.
+  auto collect = [&](const size_t begin, const size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+      Element& element = m_elements[i];
+      std::vector<int>& neighbours = element.neighbours;
+      neighbours.clear();
+      const unsigned int n = element.type == 2 ? 3 : 4;
+      for (unsigned int j = 0; j < n; ++j) {
+        const int v = element.vertex[j];
+        neighbours.insert(neighbours.end(), attached.begin() + first[v],
+                          attached.begin() + first[v + 1]);
       }
+      std::sort(neighbours.begin(), neighbours.end());
+      neighbours.erase(std::unique(neighbours.begin(), neighbours.end()),
+                       neighbours.end());
+      neighbours.erase(
+          std::find(neighbours.begin(), neighbours.end(), int(i)));
     }
+  };
+  // Split large meshes into blocks processed in parallel.
+  if (nElements < 100000) {
+    collect(0, nElements);
+    return;
   }
+  ThreadPool pool;
+  const size_t nBlocks = 4 * pool.GetNumberOfThreads();
+  const size_t blockSize = (nElements + nBlocks - 1) / nBlocks;
+  pool.ParallelFor(nBlocks, [&](const size_t k, unsigned int) {
+    const size_t begin = std::min(k * blockSize, nElements);
+    collect(begin, std::min(begin + blockSize, nElements));
+  });
+}
+
+bool ComponentTcad3d::BuildElementGrid() {
+  std::vector<std::array<double, 6> > boxes;
+  boxes.reserve(m_elements.size());
+  for (const auto& element : m_elements) {
+    boxes.push_back({{element.xmin, element.ymin, element.zmin, element.xmax,
+                      element.ymax, element.zmax}});
+  }
+  if (!m_grid.Build(boxes, true)) {
+    std::cerr << m_className << "::BuildElementGrid:\n"
+              << "    Could not set up the grid for the element search.\n";
+    return false;
+  }
+  return true;
 }
 
 bool ComponentTcad3d::GetBoundingBox(double& xmin, double& ymin, double& zmin,
@@ -1406,6 +1603,8 @@ void ComponentTcad3d::Cleanup() {
   m_elements.clear();
   // Regions
   m_regions.clear();
+  // Element search
+  m_grid.Clear();
 }
 
 bool ComponentTcad3d::CheckTetrahedron(const double x, const double y,
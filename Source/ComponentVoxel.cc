@@ -1,5 +1,10 @@
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 #include <algorithm>
 #include <cmath>
+#include <cstring>
 #include <fstream>
 #include <iostream>
 #include <sstream>
@@ -8,8 +13,116 @@
 #include "ComponentVoxel.hh"
 #include "Utilities.hh"
 
+namespace {
+
+const char VoxelMagic[8] = {'G', 'V', 'O', 'X', 'E', 'L', '0', '1'};
+const uint32_t VoxelByteOrder = 0x01020304;
+
+/// Header of a binary field map file. The header is followed by the
+/// electric field, the regions and (optionally) the magnetic field,
+/// each starting at a multiple of Alignment bytes.
+struct VoxelHeader {
+  char magic[8];
+  uint32_t byteOrder;
+  uint32_t nx, ny, nz;
+  /// Bit 0: potential, bit 1: single precision, bit 2: magnetic field.
+  uint32_t flags;
+  double xmin, ymin, zmin, xmax, ymax, zmax;
+  double pmin, pmax;
+};
+
+constexpr size_t Alignment = 64;
+
+size_t Align(const size_t n) {
+  return (n + Alignment - 1) / Alignment * Alignment;
+}
+
+void Pad(std::ostream& out) {
+  const size_t n = static_cast<size_t>(out.tellp());
+  const std::vector<char> zeros(Align(n) - n, 0);
+  out.write(zeros.data(), zeros.size());
+}
+
+/// Map a file into memory (read-only, shared between processes).
+std::shared_ptr<void> MapFile(const std::string& filename, size_t& size) {
+  const int fd = open(filename.c_str(), O_RDONLY);
+  if (fd < 0) return nullptr;
+  struct stat st;
+  if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+    close(fd);
+    return nullptr;
+  }
+  size = st.st_size;
+  void* addr = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (addr == MAP_FAILED) return nullptr;
+  const size_t length = size;
+  return std::shared_ptr<void>(addr,
+                               [length](void* p) { munmap(p, length); });
+}
+
+/// Read a file into memory.
+std::shared_ptr<void> ReadFile(const std::string& filename, size_t& size) {
+  std::ifstream infile(filename, std::ios::binary | std::ios::ate);
+  if (!infile) return nullptr;
+  size = static_cast<size_t>(infile.tellg());
+  infile.seekg(0);
+  std::shared_ptr<void> buffer(new char[size],
+                               [](void* p) { delete[] static_cast<char*>(p); });
+  if (!infile.read(static_cast<char*>(buffer.get()), size)) return nullptr;
+  return buffer;
+}
+}
+
 namespace Garfield {
 
+ComponentVoxel::Grid& ComponentVoxel::Grid::operator=(const Grid& grid) {
+  values = grid.values;
+  valuesF = grid.valuesF;
+  mapping = grid.mapping;
+  // Point to the own copy of the values, if any.
+  data = values.empty() ? grid.data : values.data();
+  dataF = valuesF.empty() ? grid.dataF : valuesF.data();
+  return *this;
+}
+
+void ComponentVoxel::Grid::Allocate(const size_t n, const bool single) {
+  Clear();
+  if (single) {
+    valuesF.assign(4 * n, 0.f);
+    dataF = valuesF.data();
+  } else {
+    values.assign(4 * n, 0.);
+    data = values.data();
+  }
+}
+
+void ComponentVoxel::Grid::Clear() {
+  std::vector<double>().swap(values);
+  std::vector<float>().swap(valuesF);
+  data = nullptr;
+  dataF = nullptr;
+  mapping.reset();
+}
+
+void ComponentVoxel::Grid::Set(const size_t i, const double fx,
+                               const double fy, const double fz,
+                               const double v) {
+  if (!valuesF.empty()) {
+    float* p = &valuesF[4 * i];
+    p[0] = fx;
+    p[1] = fy;
+    p[2] = fz;
+    p[3] = v;
+  } else {
+    double* p = &values[4 * i];
+    p[0] = fx;
+    p[1] = fy;
+    p[2] = fz;
+    p[3] = v;
+  }
+}
+
 ComponentVoxel::ComponentVoxel() : ComponentBase() {
   m_className = "ComponentVoxel";
 }
@@ -36,7 +149,7 @@ void ComponentVoxel::ElectricField(const double x, const double y,
     return;
   }
 
-  if (region < 0 || region > (int)m_media.size()) {
+  if (region < 0 || region >= (int)m_media.size()) {
     m = nullptr;
     status = -5;
     return;
@@ -52,9 +165,54 @@ void ComponentVoxel::ElectricField(const double x, const double y,
   ElectricField(x, y, z, ex, ey, ez, v, m, status);
 }
 
+void ComponentVoxel::ElectricFieldBatch(const size_t n, const double* x,
+                                        const double* y, const double* z,
+                                        double* ex, double* ey, double* ez,
+                                        double* v, Medium** m, int* status) {
+  // Make sure the field map has been loaded.
+  if (!m_ready) {
+    std::cerr << m_className << "::ElectricFieldBatch:\n"
+              << "    Field map is not available for interpolation.\n";
+    for (size_t i = 0; i < n; ++i) {
+      ex[i] = ey[i] = ez[i] = 0.;
+      if (v) v[i] = 0.;
+      m[i] = nullptr;
+      status[i] = -10;
+    }
+    return;
+  }
+  const int nMedia = m_media.size();
+  double p = 0.;
+  for (size_t i = 0; i < n; ++i) {
+    m[i] = nullptr;
+    int region = -1;
+    if (!GetField(x[i], y[i], z[i], m_efields, ex[i], ey[i], ez[i],
+                  v ? v[i] : p, region)) {
+      status[i] = -11;
+      continue;
+    }
+    if (region < 0 || region >= nMedia || !m_media[region]) {
+      status[i] = -5;
+      continue;
+    }
+    m[i] = m_media[region];
+    status[i] = 0;
+  }
+}
+
 void ComponentVoxel::WeightingField(const double x, const double y,
                                     const double z, double& wx, double& wy,
-                                    double& wz, const std::string& /*label*/) {
+                                    double& wz, const std::string& label) {
+  const auto it = m_wfields.find(label);
+  if (it != m_wfields.end()) {
+    // Map of this electrode.
+    int region = -1;
+    double v = 0.;
+    if (!GetField(x, y, z, it->second, wx, wy, wz, v, region)) {
+      wx = wy = wz = 0.;
+    }
+    return;
+  }
   int status = 0;
   Medium* med = nullptr;
   double v = 0.;
@@ -66,7 +224,14 @@ void ComponentVoxel::WeightingField(const double x, const double y,
 
 double ComponentVoxel::WeightingPotential(const double x, const double y,
                                           const double z,
-                                          const std::string& /*label*/) {
+                                          const std::string& label) {
+  const auto it = m_wfields.find(label);
+  if (it != m_wfields.end()) {
+    int region = -1;
+    double wx = 0., wy = 0., wz = 0., v = 0.;
+    if (!GetField(x, y, z, it->second, wx, wy, wz, v, region)) return 0.;
+    return v;
+  }
   int status = 0;
   Medium* med = nullptr;
   double v = 0.;
@@ -114,8 +279,8 @@ Medium* ComponentVoxel::GetMedium(const double x, const double y,
   if (!GetElement(x, y, z, i, j, k, xMirrored, yMirrored, zMirrored)) {
     return nullptr;
   }
-  const int region = m_regions[i][j][k];
-  if (region < 0 || region > (int)m_media.size()) return nullptr;
+  const int region = m_regions[Index(i, j, k)];
+  if (region < 0 || region >= (int)m_media.size()) return nullptr;
   return m_media[region];
 }
 
@@ -162,7 +327,7 @@ bool ComponentVoxel::LoadElectricField(const std::string& filename,
                                        const double scaleX, const double scaleE,
                                        const double scaleP) {
   m_ready = false;
-  m_efields.clear();
+  m_efields.Clear();
   m_hasPotential = m_hasEfield = false;
   if (!m_hasMesh) {
     std::cerr << m_className << "::LoadElectricField:\n"
@@ -171,31 +336,25 @@ bool ComponentVoxel::LoadElectricField(const std::string& filename,
   }
 
   // Set up the grid.
-  m_efields.resize(m_nX);
-  m_regions.resize(m_nX);
-  for (unsigned int i = 0; i < m_nX; ++i) {
-    m_efields[i].resize(m_nY);
-    m_regions[i].resize(m_nY);
-    for (unsigned int j = 0; j < m_nY; ++j) {
-      m_efields[i][j].resize(m_nZ);
-      m_regions[i][j].resize(m_nZ);
-      for (unsigned int k = 0; k < m_nZ; ++k) {
-        m_efields[i][j][k].fx = 0.;
-        m_efields[i][j][k].fy = 0.;
-        m_efields[i][j][k].fz = 0.;
-        m_efields[i][j][k].v = 0.;
-        m_regions[i][j][k] = 0;
-      }
-    }
-  }
+  const size_t n = size_t(m_nX) * m_nY * m_nZ;
+  m_efields.Allocate(n, m_single);
+  m_regionMapping.reset();
+  m_regionValues.assign(n, 0);
+  m_regions = m_regionValues.data();
 
   m_pMin = m_pMax = 0.;
   if (withPotential) {
     m_pMin = 1.;
     m_pMax = -1.;
   }
-  return LoadData(filename, format, withPotential, withRegion, scaleX, scaleE,
-                  scaleP, 'e');
+  if (!LoadData(filename, format, withPotential, withRegion, scaleX, scaleE,
+                scaleP, m_efields, m_regionValues.data(), m_pMin, m_pMax)) {
+    return false;
+  }
+  m_hasEfield = true;
+  m_ready = true;
+  if (withPotential) m_hasPotential = true;
+  return true;
 }
 
 bool ComponentVoxel::LoadMagneticField(const std::string& filename,
@@ -210,27 +369,208 @@ bool ComponentVoxel::LoadMagneticField(const std::string& filename,
   }
 
   // Set up the grid.
-  m_bfields.resize(m_nX);
-  for (unsigned int i = 0; i < m_nX; ++i) {
-    m_bfields[i].resize(m_nY);
-    for (unsigned int j = 0; j < m_nY; ++j) {
-      m_bfields[i][j].resize(m_nZ);
-      for (unsigned int k = 0; k < m_nZ; ++k) {
-        m_bfields[i][j][k].fx = 0.;
-        m_bfields[i][j][k].fy = 0.;
-        m_bfields[i][j][k].fz = 0.;
-        m_bfields[i][j][k].v = 0.;
+  m_bfields.Allocate(size_t(m_nX) * m_nY * m_nZ, m_single);
+
+  double pmin = 0., pmax = 0.;
+  if (!LoadData(filename, format, false, false, scaleX, scaleB, 1., m_bfields,
+                nullptr, pmin, pmax)) {
+    return false;
+  }
+  m_hasBfield = true;
+  return true;
+}
+
+bool ComponentVoxel::LoadWeightingField(const std::string& filename,
+                                        const std::string& format,
+                                        const bool withPotential,
+                                        const std::string& label,
+                                        const double scaleX,
+                                        const double scaleE,
+                                        const double scaleP) {
+  if (!m_hasMesh) {
+    std::cerr << m_className << "::LoadWeightingField:\n"
+              << "    Mesh is not set. Call SetMesh first.\n";
+    return false;
+  }
+
+  // Set up the grid.
+  Grid& grid = m_wfields[label];
+  grid.Allocate(size_t(m_nX) * m_nY * m_nZ, m_single);
+
+  double pmin = 1., pmax = -1.;
+  if (!LoadData(filename, format, withPotential, false, scaleX, scaleE, scaleP,
+                grid, nullptr, pmin, pmax)) {
+    m_wfields.erase(label);
+    return false;
+  }
+  return true;
+}
+
+bool ComponentVoxel::SaveBinary(const std::string& filename) const {
+  if (!m_ready) {
+    std::cerr << m_className << "::SaveBinary: Field map not available.\n";
+    return false;
+  }
+  std::ofstream outfile(filename, std::ios::binary);
+  if (!outfile) {
+    std::cerr << m_className << "::SaveBinary:\n"
+              << "    Could not open file " << filename << ".\n";
+    return false;
+  }
+  // Use the precision of the electric field.
+  const bool single = m_efields.dataF != nullptr;
+  VoxelHeader header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, VoxelMagic, sizeof(VoxelMagic));
+  header.byteOrder = VoxelByteOrder;
+  header.nx = m_nX;
+  header.ny = m_nY;
+  header.nz = m_nZ;
+  header.flags = (m_hasPotential ? 1 : 0) | (single ? 2 : 0) |
+                 (m_hasBfield ? 4 : 0);
+  header.xmin = m_xMin;
+  header.ymin = m_yMin;
+  header.zmin = m_zMin;
+  header.xmax = m_xMax;
+  header.ymax = m_yMax;
+  header.zmax = m_zMax;
+  header.pmin = m_pMin;
+  header.pmax = m_pMax;
+  outfile.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+  const size_t n = size_t(m_nX) * m_nY * m_nZ;
+  auto writeGrid = [&outfile, n, single](const Grid& grid) {
+    Pad(outfile);
+    double f[4];
+    for (size_t i = 0; i < n; ++i) {
+      grid.Get(i, f);
+      if (single) {
+        const float g[4] = {float(f[0]), float(f[1]), float(f[2]),
+                            float(f[3])};
+        outfile.write(reinterpret_cast<const char*>(g), sizeof(g));
+      } else {
+        outfile.write(reinterpret_cast<const char*>(f), sizeof(f));
       }
     }
+  };
+  writeGrid(m_efields);
+  Pad(outfile);
+  outfile.write(reinterpret_cast<const char*>(m_regions), n * sizeof(int32_t));
+  if (m_hasBfield) writeGrid(m_bfields);
+  if (!outfile) {
+    std::cerr << m_className << "::SaveBinary:\n"
+              << "    Error writing file " << filename << ".\n";
+    return false;
+  }
+  return true;
+}
+
+bool ComponentVoxel::LoadBinary(const std::string& filename, const bool map) {
+  return ReadBinary(filename, map, m_efields, true);
+}
+
+bool ComponentVoxel::LoadWeightingFieldBinary(const std::string& filename,
+                                              const std::string& label,
+                                              const bool map) {
+  Grid& grid = m_wfields[label];
+  if (!ReadBinary(filename, map, grid, false)) {
+    m_wfields.erase(label);
+    return false;
+  }
+  return true;
+}
+
+bool ComponentVoxel::ReadBinary(const std::string& filename, const bool map,
+                                Grid& grid, const bool full) {
+  const std::string fcn = full ? "::LoadBinary" : "::LoadWeightingFieldBinary";
+  size_t size = 0;
+  std::shared_ptr<void> file =
+      map ? MapFile(filename, size) : ReadFile(filename, size);
+  if (!file) {
+    std::cerr << m_className << fcn << ":\n"
+              << "    Could not " << (map ? "map" : "read") << " file "
+              << filename << ".\n";
+    return false;
+  }
+  const char* base = static_cast<const char*>(file.get());
+  VoxelHeader header;
+  if (size < sizeof(header)) {
+    std::cerr << m_className << fcn << ": File " << filename
+              << " is too short.\n";
+    return false;
+  }
+  memcpy(&header, base, sizeof(header));
+  if (memcmp(header.magic, VoxelMagic, sizeof(VoxelMagic)) != 0 ||
+      header.byteOrder != VoxelByteOrder) {
+    std::cerr << m_className << fcn << ":\n"
+              << "    " << filename << " is not a binary voxel map"
+              << " (or was written on a machine with different byte order).\n";
+    return false;
+  }
+  const size_t n = size_t(header.nx) * header.ny * header.nz;
+  const bool single = (header.flags & 2) != 0;
+  const bool hasB = (header.flags & 4) != 0;
+  const size_t nBytes = 4 * n * (single ? sizeof(float) : sizeof(double));
+  const size_t offsetE = Align(sizeof(header));
+  const size_t offsetR = Align(offsetE + nBytes);
+  const size_t offsetB = Align(offsetR + n * sizeof(int32_t));
+  const size_t nExpected =
+      hasB ? offsetB + nBytes : offsetR + n * sizeof(int32_t);
+  if (n == 0 || size < nExpected) {
+    std::cerr << m_className << fcn << ": File " << filename
+              << " is truncated.\n";
+    return false;
+  }
+  auto setGrid = [&file, base, single](Grid& g, const size_t offset) {
+    g.Clear();
+    g.mapping = file;
+    if (single) {
+      g.dataF = reinterpret_cast<const float*>(base + offset);
+    } else {
+      g.data = reinterpret_cast<const double*>(base + offset);
+    }
+  };
+
+  if (!full) {
+    if (!m_hasMesh || header.nx != m_nX || header.ny != m_nY ||
+        header.nz != m_nZ || header.xmin != m_xMin || header.xmax != m_xMax ||
+        header.ymin != m_yMin || header.ymax != m_yMax ||
+        header.zmin != m_zMin || header.zmax != m_zMax) {
+      std::cerr << m_className << fcn << ":\n"
+                << "    Mesh of " << filename << " does not match.\n";
+      return false;
+    }
+    setGrid(grid, offsetE);
+    return true;
   }
 
-  return LoadData(filename, format, false, false, scaleX, scaleB, 1., 'b');
+  // Set up the mesh (this also resets the component).
+  SetMesh(header.nx, header.ny, header.nz, header.xmin, header.xmax,
+          header.ymin, header.ymax, header.zmin, header.zmax);
+  if (!m_hasMesh) return false;
+  setGrid(grid, offsetE);
+  m_regions = reinterpret_cast<const int32_t*>(base + offsetR);
+  m_regionMapping = file;
+  if (hasB) {
+    setGrid(m_bfields, offsetB);
+    m_hasBfield = true;
+  }
+  m_hasPotential = (header.flags & 1) != 0;
+  m_pMin = header.pmin;
+  m_pMax = header.pmax;
+  m_hasEfield = true;
+  m_ready = true;
+  std::cout << m_className << fcn << ":\n"
+            << "    " << (map ? "Mapped " : "Read ") << n << " elements from "
+            << filename << ".\n";
+  return true;
 }
 
 bool ComponentVoxel::LoadData(const std::string& filename, std::string format,
                               const bool withPotential, const bool withRegion,
                               const double scaleX, const double scaleF,
-                              const double scaleP, const char field) {
+                              const double scaleP, Grid& grid,
+                              int32_t* regions, double& pmin, double& pmax) {
   if (!m_hasMesh) {
     std::cerr << m_className << "::LoadData: Mesh has not been set.\n";
     return false;
@@ -238,9 +578,7 @@ bool ComponentVoxel::LoadData(const std::string& filename, std::string format,
 
   unsigned int nValues = 0;
   // Keep track of which elements have been read.
-  std::vector<std::vector<std::vector<bool> > > isSet(
-      m_nX,
-      std::vector<std::vector<bool> >(m_nY, std::vector<bool>(m_nZ, false)));
+  std::vector<bool> isSet(size_t(m_nX) * m_nY * m_nZ, false);
 
   std::ifstream infile;
   infile.open(filename.c_str(), std::ios::in);
@@ -388,7 +726,7 @@ bool ComponentVoxel::LoadData(const std::string& filename, std::string format,
                 << ") out of range.\n";
       continue;
     }
-    if (isSet[i][j][k]) {
+    if (isSet[Index(i, j, k)]) {
       std::cerr << m_className << "::LoadData:\n"
                 << "    Error reading line " << nLines << ".\n"
                 << "    Mesh element (" << i << ", " << j << ", " << k
@@ -427,13 +765,13 @@ bool ComponentVoxel::LoadData(const std::string& filename, std::string format,
         break;
       }
       v *= scaleP;
-      if (m_pMin > m_pMax) {
+      if (pmin > pmax) {
         // First value.
-        m_pMin = v;
-        m_pMax = v;
+        pmin = v;
+        pmax = v;
       } else {
-        if (v < m_pMin) m_pMin = v;
-        if (v > m_pMax) m_pMax = v;
+        if (v < pmin) pmin = v;
+        if (v > pmax) pmax = v;
       }
     }
     if (withRegion) {
@@ -449,32 +787,16 @@ bool ComponentVoxel::LoadData(const std::string& filename, std::string format,
     if (fmt == 1 || fmt == 3) {
       // Two-dimensional field-map
       for (unsigned int kk = 0; kk < m_nZ; ++kk) {
-        if (field == 'e') {
-          m_efields[i][j][kk].fx = fx;
-          m_efields[i][j][kk].fy = fy;
-          m_efields[i][j][kk].fz = fz;
-          m_efields[i][j][kk].v = v;
-          m_regions[i][j][kk] = region;
-        } else if (field == 'b') {
-          m_bfields[i][j][kk].fx = fx;
-          m_bfields[i][j][kk].fy = fy;
-          m_bfields[i][j][kk].fz = fz;
-        }
-        isSet[i][j][kk] = true;
+        const size_t index = Index(i, j, kk);
+        grid.Set(index, fx, fy, fz, v);
+        if (regions) regions[index] = region;
+        isSet[index] = true;
       }
     } else {
-      if (field == 'e') {
-        m_efields[i][j][k].fx = fx;
-        m_efields[i][j][k].fy = fy;
-        m_efields[i][j][k].fz = fz;
-        m_efields[i][j][k].v = v;
-        m_regions[i][j][k] = region;
-      } else if (field == 'b') {
-        m_bfields[i][j][k].fx = fx;
-        m_bfields[i][j][k].fy = fy;
-        m_bfields[i][j][k].fz = fz;
-      }
-      isSet[i][j][k] = true;
+      const size_t index = Index(i, j, k);
+      grid.Set(index, fx, fy, fz, v);
+      if (regions) regions[index] = region;
+      isSet[index] = true;
     }
     ++nValues;
   }
@@ -487,13 +809,6 @@ bool ComponentVoxel::LoadData(const std::string& filename, std::string format,
     std::cerr << m_className << "::LoadData:\n"
               << "   Expected " << nExpected << " values.\n";
   }
-  if (field == 'e') {
-    m_hasEfield = true;
-    m_ready = true;
-    if (withPotential) m_hasPotential = true;
-  } else if (field == 'b') {
-    m_hasBfield = true;
-  }
   return true;
 }
 
@@ -542,21 +857,20 @@ bool ComponentVoxel::GetElectricFieldRange(double& exmin, double& exmax,
     return false;
   }
 
-  exmin = exmax = m_efields[0][0][0].fx;
-  eymin = eymax = m_efields[0][0][0].fy;
-  ezmin = ezmax = m_efields[0][0][0].fz;
-  for (unsigned int i = 0; i < m_nX; ++i) {
-    for (unsigned int j = 0; j < m_nY; ++j) {
-      for (unsigned int k = 0; k < m_nZ; ++k) {
-        const Element& element = m_efields[i][j][k];
-        if (element.fx < exmin) exmin = element.fx;
-        if (element.fx > exmax) exmax = element.fx;
-        if (element.fy < eymin) eymin = element.fy;
-        if (element.fy > eymax) eymax = element.fy;
-        if (element.fz < ezmin) ezmin = element.fz;
-        if (element.fz > ezmax) ezmax = element.fz;
-      }
-    }
+  double f[4];
+  m_efields.Get(0, f);
+  exmin = exmax = f[0];
+  eymin = eymax = f[1];
+  ezmin = ezmax = f[2];
+  const size_t n = size_t(m_nX) * m_nY * m_nZ;
+  for (size_t i = 0; i < n; ++i) {
+    m_efields.Get(i, f);
+    if (f[0] < exmin) exmin = f[0];
+    if (f[0] > exmax) exmax = f[0];
+    if (f[1] < eymin) eymin = f[1];
+    if (f[1] > eymax) eymax = f[1];
+    if (f[2] < ezmin) ezmin = f[2];
+    if (f[2] > ezmax) ezmax = f[2];
   }
   return true;
 }
@@ -600,10 +914,9 @@ Medium* ComponentVoxel::GetMedium(const unsigned int i) const {
   return m_media[i];
 }
 
-bool ComponentVoxel::GetField(
-    const double xi, const double yi, const double zi,
-    const std::vector<std::vector<std::vector<Element> > >& field, double& fx,
-    double& fy, double& fz, double& p, int& region) {
+bool ComponentVoxel::GetField(const double xi, const double yi,
+                              const double zi, const Grid& field, double& fx,
+                              double& fy, double& fz, double& p, int& region) {
   if (!m_hasMesh) {
     std::cerr << m_className << "::GetField: Mesh is not set.\n";
     return false;
@@ -634,7 +947,7 @@ bool ComponentVoxel::GetField(
   if (i >= m_nX) i = m_nX - 1;
   if (j >= m_nY) j = m_nY - 1;
   if (k >= m_nZ) k = m_nZ - 1;
-  region = m_regions[i][j][k];
+  region = m_regions ? m_regions[Index(i, j, k)] : 0;
 
   // Get the field and potential.
   if (m_interpolate) {
@@ -669,46 +982,40 @@ bool ComponentVoxel::GetField(
     if (i1 >= m_nX) i1 = perx ? 0 : m_nX - 1;
     if (j1 >= m_nY) j1 = pery ? 0 : m_nY - 1;
     if (k1 >= m_nZ) k1 = perz ? 0 : m_nZ - 1;
-    const Element& n000 = field[i0][j0][k0];
-    const Element& n100 = field[i1][j0][k0];
-    const Element& n010 = field[i0][j1][k0];
-    const Element& n110 = field[i1][j1][k0];
-    const Element& n001 = field[i0][j0][k1];
-    const Element& n101 = field[i1][j0][k1];
-    const Element& n011 = field[i0][j1][k1];
-    const Element& n111 = field[i1][j1][k1];
+    // Values at the eight nodes (bit 0/1/2: upper index in x/y/z).
+    double f[8][4];
+    field.Get(Index(i0, j0, k0), f[0]);
+    field.Get(Index(i1, j0, k0), f[1]);
+    field.Get(Index(i0, j1, k0), f[2]);
+    field.Get(Index(i1, j1, k0), f[3]);
+    field.Get(Index(i0, j0, k1), f[4]);
+    field.Get(Index(i1, j0, k1), f[5]);
+    field.Get(Index(i0, j1, k1), f[6]);
+    field.Get(Index(i1, j1, k1), f[7]);
 
     const double ux = 1. - vx;
     const double uy = 1. - vy;
     const double uz = 1. - vz;
-    fx = ((n000.fx * ux + n100.fx * vx) * uy +
-          (n010.fx * ux + n110.fx * vx) * vy) *
-             uz +
-         ((n001.fx * ux + n101.fx * vx) * uy +
-          (n011.fx * ux + n111.fx * vx) * vy) *
-             vz;
-    fy = ((n000.fy * ux + n100.fy * vx) * uy +
-          (n010.fy * ux + n110.fy * vx) * vy) *
-             uz +
-         ((n001.fy * ux + n101.fy * vx) * uy +
-          (n011.fy * ux + n111.fy * vx) * vy) *
-             vz;
-    fz = ((n000.fz * ux + n100.fz * vx) * uy +
-          (n010.fz * ux + n110.fz * vx) * vy) *
-             uz +
-         ((n001.fz * ux + n101.fz * vx) * uy +
-          (n011.fz * ux + n111.fz * vx) * vy) *
-             vz;
-    p = ((n000.v * ux + n100.v * vx) * uy + (n010.v * ux + n110.v * vx) * vy) *
-            uz +
-        ((n001.v * ux + n101.v * vx) * uy + (n011.v * ux + n111.v * vx) * vy) *
-            vz;
+    double r[4];
+    for (unsigned int c = 0; c < 4; ++c) {
+      r[c] = ((f[0][c] * ux + f[1][c] * vx) * uy +
+              (f[2][c] * ux + f[3][c] * vx) * vy) *
+                 uz +
+             ((f[4][c] * ux + f[5][c] * vx) * uy +
+              (f[6][c] * ux + f[7][c] * vx) * vy) *
+                 vz;
+    }
+    fx = r[0];
+    fy = r[1];
+    fz = r[2];
+    p = r[3];
   } else {
-    const Element& element = field[i][j][k];
-    fx = element.fx;
-    fy = element.fy;
-    fz = element.fz;
-    p = element.v;
+    double f[4];
+    field.Get(Index(i, j, k), f);
+    fx = f[0];
+    fy = f[1];
+    fz = f[2];
+    p = f[3];
   }
   if (xMirrored) fx = -fx;
   if (yMirrored) fy = -fy;
@@ -767,18 +1074,22 @@ bool ComponentVoxel::GetElement(const unsigned int i, const unsigned int j,
     std::cerr << m_className << "::GetElement: Index out of range.\n";
     return false;
   }
-  const Element& element = m_efields[i][j][k];
-  v = element.v;
-  ex = element.fx;
-  ey = element.fy;
-  ez = element.fz;
+  double f[4];
+  m_efields.Get(Index(i, j, k), f);
+  ex = f[0];
+  ey = f[1];
+  ez = f[2];
+  v = f[3];
   return true;
 }
 
 void ComponentVoxel::Reset() {
-  m_efields.clear();
-  m_bfields.clear();
-  m_regions.clear();
+  m_efields.Clear();
+  m_bfields.Clear();
+  m_wfields.clear();
+  m_regionValues.clear();
+  m_regions = nullptr;
+  m_regionMapping.reset();
   m_nX = m_nY = m_nZ = 0;
   m_xMin = m_yMin = m_zMin = 0.;
   m_xMax = m_yMax = m_zMax = 0.;
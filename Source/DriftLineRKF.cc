@@ -441,6 +441,19 @@ double DriftLineRKF::GetArrivalTimeSpread() {
 double DriftLineRKF::GetGain() {
   if (m_nPoints < 2) return 0.;
   if (m_status == StatusCalculationAbandoned) return 0.;
+  // Get the electric field at all points of the drift line at once.
+  std::vector<double> xs(m_nPoints), ys(m_nPoints), zs(m_nPoints);
+  for (unsigned int i = 0; i < m_nPoints; ++i) {
+    xs[i] = m_path[i].x;
+    ys[i] = m_path[i].y;
+    zs[i] = m_path[i].z;
+  }
+  std::vector<double> exs(m_nPoints), eys(m_nPoints), ezs(m_nPoints);
+  std::vector<Medium*> media(m_nPoints, nullptr);
+  std::vector<int> states(m_nPoints, 0);
+  m_sensor->ElectricFieldBatch(m_nPoints, xs.data(), ys.data(), zs.data(),
+                               exs.data(), eys.data(), ezs.data(), nullptr,
+                               media.data(), states.data());
   // First get a rough estimate of the result.
   double crude = 0.;
   double alphaPrev = 0.;
@@ -449,12 +462,12 @@ double DriftLineRKF::GetGain() {
     const double x = m_path[i].x;
     const double y = m_path[i].y;
     const double z = m_path[i].z;
-    double ex, ey, ez;
+    const double ex = exs[i], ey = eys[i], ez = ezs[i];
     double bx, by, bz;
     int status;
     m_sensor->MagneticField(x, y, z, bx, by, bz, status);
-    m_sensor->ElectricField(x, y, z, ex, ey, ez, m_medium, status);
-    if (status != 0) {
+    m_medium = media[i];
+    if (states[i] != 0) {
       std::cerr << m_className << "::GetGain:\n"
                 << "    Invalid drift line point " << i << ".\n";
       return 0.;
@@ -528,16 +541,17 @@ bool DriftLineRKF::GetVelocity(const double ex, const double ey,
   return false;
 }
 
-bool DriftLineRKF::GetDiffusion(const double ex, const double ey,
+bool DriftLineRKF::GetTransport(const double ex, const double ey,
                                 const double ez, const double bx,
-                                const double by, const double bz, double& dl,
-                                double& dt) const {
+                                const double by, const double bz,
+                                const unsigned int what,
+                                Medium::TransportCoefficients& c) const {
   if (m_particleType == ParticleTypeElectron) {
-    return m_medium->ElectronDiffusion(ex, ey, ez, bx, by, bz, dl, dt);
+    return m_medium->ElectronTransport(ex, ey, ez, bx, by, bz, c, what);
   } else if (m_particleType == ParticleTypeIon) {
-    return m_medium->IonDiffusion(ex, ey, ez, bx, by, bz, dl, dt);
+    return m_medium->IonTransport(ex, ey, ez, bx, by, bz, c, what);
   } else if (m_particleType == ParticleTypeHole) {
-    return m_medium->HoleDiffusion(ex, ey, ez, bx, by, bz, dl, dt);
+    return m_medium->HoleTransport(ex, ey, ez, bx, by, bz, c, what);
   }
   return false;
 }
@@ -859,27 +873,21 @@ double DriftLineRKF::IntegrateDiffusion(const double x, const double y,
               << "    Initial position not valid.\n";
     return 0.;
   }
-  // Determine drift velocity at initial position.
-  double vx0 = 0., vy0 = 0., vz0 = 0.;
-  if (!GetVelocity(ex, ey, ez, bx, by, bz, vx0, vy0, vz0)) {
+  // Determine drift velocity and diffusion at initial position.
+  constexpr unsigned int what = Medium::TransportCoefficients::Diffusion;
+  Medium::TransportCoefficients c;
+  if (!GetTransport(ex, ey, ez, bx, by, bz, what, c)) {
     std::cerr << m_className << "::IntegrateDiffusion:\n"
-              << "    Cannot retrieve drift velocity.\n";
+              << "    Cannot retrieve drift velocity and diffusion.\n";
     return 0.;
   }
-  double speed0 = sqrt(vx0 * vx0 + vy0 * vy0 + vz0 * vz0);
+  double speed0 = sqrt(c.vx * c.vx + c.vy * c.vy + c.vz * c.vz);
   if (speed0 < Small) {
     std::cerr << m_className << "::IntegrateDiffusion:\n"
               << "    Zero velocity at initial position.\n";
     return 0.;
   }
-  // Determine diffusion coefficients at initial position.
-  double dL0 = 0.;
-  double dT0 = 0.;
-  if (!GetDiffusion(ex, ey, ez, bx, by, bz, dL0, dT0)) {
-    std::cerr << m_className << "::IntegrateDiffusion:\n"
-              << "    Cannot retrieve diffusion coefficients.\n";
-    return 0.;
-  }
+  double dL0 = c.dl;
 
   // Start and end point coordinates of initial step.
   double x0 = x;
@@ -924,22 +932,13 @@ double DriftLineRKF::IntegrateDiffusion(const double x, const double y,
       std::cerr << m_className << "::IntegrateDiffusion: Invalid end point.\n";
       break;
     }
-    double vx1 = 0.;
-    double vy1 = 0.;
-    double vz1 = 0.;
-    if (!GetVelocity(ex, ey, ez, bx, by, bz, vx1, vy1, vz1)) {
-      std::cerr << m_className << "::IntegrateDiffusion:\n"
-                << "    Cannot retrieve drift velocity.\n";
-      break;
-    }
-    double speed1 = sqrt(vx1 * vx1 + vy1 * vy1 + vz1 * vz1);
-    double dL1 = 0.;
-    double dT1 = 0.;
-    if (!GetDiffusion(ex, ey, ez, bx, by, bz, dL1, dT1)) {
+    if (!GetTransport(ex, ey, ez, bx, by, bz, what, c)) {
       std::cerr << m_className << "::IntegrateDiffusion:\n"
-                << "    Cannot retrieve diffusion.\n";
+                << "    Cannot retrieve drift velocity and diffusion.\n";
       break;
     }
+    double speed1 = sqrt(c.vx * c.vx + c.vy * c.vy + c.vz * c.vz);
+    double dL1 = c.dl;
     // Determine drift velocity and diffusion at the mid point of the step.
     const double xm = 0.5 * (x0 + x1);
     const double ym = 0.5 * (y0 + y1);
@@ -950,22 +949,13 @@ double DriftLineRKF::IntegrateDiffusion(const double x, const double y,
       std::cerr << m_className << "::IntegrateDiffusion: Invalid mid point.\n";
       break;
     }
-    double vxm = 0.;
-    double vym = 0.;
-    double vzm = 0.;
-    if (!GetVelocity(ex, ey, ez, bx, by, bz, vxm, vym, vzm)) {
-      std::cerr << m_className << "::IntegrateDiffusion:\n"
-                << "    Cannot retrieve drift velocity.\n";
-      break;
-    }
-    double speedm = sqrt(vxm * vxm + vym * vym + vzm * vzm);
-    double dLm = 0.;
-    double dTm = 0.;
-    if (!GetDiffusion(ex, ey, ez, bx, by, bz, dLm, dTm)) {
+    if (!GetTransport(ex, ey, ez, bx, by, bz, what, c)) {
       std::cerr << m_className << "::IntegrateDiffusion:\n"
-                << "    Cannot retrieve diffusion.\n";
+                << "    Cannot retrieve drift velocity and diffusion.\n";
       break;
     }
+    double speedm = sqrt(c.vx * c.vx + c.vy * c.vy + c.vz * c.vz);
+    double dLm = c.dl;
     const double tolerance = 1.e-3;
     const double s0 = pow(dL0 / speed0, 2);
     const double s1 = pow(dL1 / speed1, 2);
@@ -983,7 +973,6 @@ double DriftLineRKF::IntegrateDiffusion(const double x, const double y,
       y0 = y1;
       z0 = z1;
       dL0 = dL1;
-      dT0 = dT1;
       speed0 = speed1;
       x1 = xe;
       y1 = ye;
@@ -994,7 +983,6 @@ double DriftLineRKF::IntegrateDiffusion(const double x, const double y,
       y1 = ym;
       z1 = zm;
       dL1 = dLm;
-      dT1 = dTm;
     }
   }
   return integral;
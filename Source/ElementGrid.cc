@@ -0,0 +1,250 @@
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <memory>
+
+#include "ElementGrid.hh"
+#include "ThreadPool.hh"
+
+namespace {
+
+// Below this number of elements, the grid is built by the calling thread.
+constexpr size_t MinParallel = 50000;
+// Maximum number of cells along one axis.
+constexpr unsigned int MaxCells = 1024;
+// Number of cells per element aimed at.
+constexpr double CellsPerElement = 4.;
+// Maximum average number of cells overlapped by an element.
+constexpr double MaxEntriesPerElement = 32.;
+
+void Append(std::vector<char>& buffer, const void* src, const size_t n) {
+  const char* p = static_cast<const char*>(src);
+  buffer.insert(buffer.end(), p, p + n);
+}
+
+bool Take(const char*& p, const char* end, void* dst, const size_t n) {
+  if (static_cast<size_t>(end - p) < n) return false;
+  memcpy(dst, p, n);
+  p += n;
+  return true;
+}
+}
+
+namespace Garfield {
+
+bool ElementGrid::Build(const std::vector<std::array<double, 6> >& boxes,
+                        const bool is3d, const unsigned int nThreads) {
+  Clear();
+  const size_t nBoxes = boxes.size();
+  if (nBoxes == 0 ||
+      nBoxes > static_cast<size_t>(std::numeric_limits<int>::max())) {
+    return false;
+  }
+
+  // Split the loops over elements and cells into blocks.
+  std::unique_ptr<ThreadPool> pool;
+  if (nBoxes >= MinParallel && nThreads != 1) {
+    pool.reset(new ThreadPool(nThreads));
+  }
+  const size_t nBlocks = pool ? 4 * pool->GetNumberOfThreads() : 1;
+  auto forBlocks = [&](const size_t n,
+                       const std::function<void(size_t, size_t, size_t)>& f) {
+    const size_t size = (n + nBlocks - 1) / nBlocks;
+    auto g = [&](const size_t b, unsigned int) {
+      const size_t begin = std::min(b * size, n);
+      f(b, begin, std::min(begin + size, n));
+    };
+    if (pool) {
+      pool->ParallelFor(nBlocks, g);
+    } else {
+      g(0, 0);
+    }
+  };
+
+  // Determine the extent of the grid.
+  for (unsigned int i = 0; i < 3; ++i) {
+    m_min[i] = boxes[0][i];
+    m_max[i] = boxes[0][i + 3];
+  }
+  for (const auto& box : boxes) {
+    for (unsigned int i = 0; i < 3; ++i) {
+      m_min[i] = std::min(m_min[i], box[i]);
+      m_max[i] = std::max(m_max[i], box[i + 3]);
+    }
+  }
+
+  // Start with a few cells per element and coarsen the grid
+  // if the elements overlap too many cells (e. g. in strongly refined meshes).
+  std::vector<uint64_t> partial(nBlocks, 0);
+  double target = CellsPerElement * nBoxes;
+  while (true) {
+    SetResolution(target, is3d);
+    forBlocks(nBoxes, [&](const size_t b, const size_t begin,
+                          const size_t end) {
+      uint64_t sum = 0;
+      unsigned int k0[3], k1[3];
+      for (size_t j = begin; j < end; ++j) {
+        GetCellRange(boxes[j], k0, k1);
+        sum += uint64_t(k1[0] - k0[0] + 1) * (k1[1] - k0[1] + 1) *
+               (k1[2] - k0[2] + 1);
+      }
+      partial[b] = sum;
+    });
+    uint64_t total = 0;
+    for (const auto sum : partial) total += sum;
+    if (total == nBoxes || (total <= MaxEntriesPerElement * nBoxes &&
+                            total < std::numeric_limits<uint32_t>::max())) {
+      break;
+    }
+    target /= 2.;
+  }
+
+  // Count the elements per cell, then fill the lists.
+  const size_t nCells = size_t(m_n[0]) * m_n[1] * m_n[2];
+  std::unique_ptr<std::atomic<uint32_t>[]> counts(
+      new std::atomic<uint32_t>[nCells]);
+  for (size_t i = 0; i < nCells; ++i) counts[i] = 0;
+  auto forCells = [&](const std::array<double, 6>& box,
+                      const std::function<void(size_t)>& f) {
+    unsigned int k0[3], k1[3];
+    GetCellRange(box, k0, k1);
+    for (unsigned int ix = k0[0]; ix <= k1[0]; ++ix) {
+      for (unsigned int iy = k0[1]; iy <= k1[1]; ++iy) {
+        const size_t row = (size_t(ix) * m_n[1] + iy) * m_n[2];
+        for (unsigned int iz = k0[2]; iz <= k1[2]; ++iz) f(row + iz);
+      }
+    }
+  };
+  forBlocks(nBoxes, [&](size_t, const size_t begin, const size_t end) {
+    for (size_t j = begin; j < end; ++j) {
+      forCells(boxes[j], [&](const size_t cell) {
+        counts[cell].fetch_add(1, std::memory_order_relaxed);
+      });
+    }
+  });
+  uint64_t nEntries = 0;
+  for (size_t i = 0; i < nCells; ++i) nEntries += counts[i];
+  if (nEntries > std::numeric_limits<uint32_t>::max()) {
+    Clear();
+    return false;
+  }
+  m_offsets.resize(nCells + 1);
+  m_offsets[0] = 0;
+  for (size_t i = 0; i < nCells; ++i) {
+    m_offsets[i + 1] = m_offsets[i] + counts[i];
+    counts[i] = m_offsets[i];
+  }
+  m_elements.resize(m_offsets.back());
+  forBlocks(nBoxes, [&](size_t, const size_t begin, const size_t end) {
+    for (size_t j = begin; j < end; ++j) {
+      forCells(boxes[j], [&](const size_t cell) {
+        m_elements[counts[cell].fetch_add(1, std::memory_order_relaxed)] = j;
+      });
+    }
+  });
+  // Keep the elements in each cell in ascending order, as in a linear scan.
+  if (pool) {
+    forBlocks(nCells, [&](size_t, const size_t begin, const size_t end) {
+      for (size_t i = begin; i < end; ++i) {
+        std::sort(m_elements.begin() + m_offsets[i],
+                  m_elements.begin() + m_offsets[i + 1]);
+      }
+    });
+  }
+  return true;
+}
+
+void ElementGrid::Clear() {
+  m_n = {{1, 1, 1}};
+  m_scale = {{0., 0., 0.}};
+  m_offsets.clear();
+  m_elements.clear();
+}
+
+void ElementGrid::SetResolution(const double target, const bool is3d) {
+  // Size of a (cubic) cell for the requested number of cells.
+  const unsigned int nDim = is3d ? 3 : 2;
+  double volume = 1.;
+  unsigned int nActive = 0;
+  for (unsigned int i = 0; i < nDim; ++i) {
+    const double d = m_max[i] - m_min[i];
+    if (d <= 0.) continue;
+    volume *= d;
+    ++nActive;
+  }
+  const double h =
+      nActive > 0 ? std::pow(volume / std::max(target, 1.), 1. / nActive) : 0.;
+  for (unsigned int i = 0; i < 3; ++i) {
+    const double d = m_max[i] - m_min[i];
+    m_n[i] = 1;
+    m_scale[i] = 0.;
+    if (i >= nDim || d <= 0. || h <= 0.) continue;
+    m_n[i] = std::max(1., std::min(std::ceil(d / h), double(MaxCells)));
+    m_scale[i] = m_n[i] / d;
+  }
+}
+
+void ElementGrid::GetCellRange(const std::array<double, 6>& box,
+                               unsigned int* k0, unsigned int* k1) const {
+  // Same arithmetic as in GetElements, so a point inside the box is
+  // always mapped to one of these cells.
+  for (unsigned int i = 0; i < 3; ++i) {
+    k0[i] = k1[i] = 0;
+    if (m_n[i] == 1) continue;
+    const double u0 = std::max((box[i] - m_min[i]) * m_scale[i], 0.);
+    const double u1 = std::max((box[i + 3] - m_min[i]) * m_scale[i], 0.);
+    k0[i] = std::min(static_cast<unsigned int>(u0), m_n[i] - 1);
+    k1[i] = std::min(static_cast<unsigned int>(u1), m_n[i] - 1);
+  }
+}
+
+void ElementGrid::Write(std::vector<char>& buffer) const {
+  Append(buffer, m_min.data(), 3 * sizeof(double));
+  Append(buffer, m_max.data(), 3 * sizeof(double));
+  Append(buffer, m_scale.data(), 3 * sizeof(double));
+  Append(buffer, m_n.data(), 3 * sizeof(unsigned int));
+  const uint64_t nEntries = m_elements.size();
+  Append(buffer, &nEntries, sizeof(nEntries));
+  Append(buffer, m_offsets.data(), m_offsets.size() * sizeof(uint32_t));
+  Append(buffer, m_elements.data(), nEntries * sizeof(int));
+}
+
+bool ElementGrid::Read(const char*& p, const char* end, const int nElements) {
+  Clear();
+  uint64_t nEntries = 0;
+  bool ok = Take(p, end, m_min.data(), 3 * sizeof(double)) &&
+            Take(p, end, m_max.data(), 3 * sizeof(double)) &&
+            Take(p, end, m_scale.data(), 3 * sizeof(double)) &&
+            Take(p, end, m_n.data(), 3 * sizeof(unsigned int)) &&
+            Take(p, end, &nEntries, sizeof(nEntries));
+  for (unsigned int i = 0; ok && i < 3; ++i) {
+    ok = m_n[i] > 0 && m_n[i] <= MaxCells;
+  }
+  if (!ok) {
+    Clear();
+    return false;
+  }
+  const size_t nCells = size_t(m_n[0]) * m_n[1] * m_n[2];
+  const size_t left = end - p;
+  if (left / sizeof(uint32_t) < nCells + 1 ||
+      (left - (nCells + 1) * sizeof(uint32_t)) / sizeof(int) < nEntries) {
+    Clear();
+    return false;
+  }
+  m_offsets.resize(nCells + 1);
+  m_elements.resize(nEntries);
+  Take(p, end, m_offsets.data(), m_offsets.size() * sizeof(uint32_t));
+  Take(p, end, m_elements.data(), nEntries * sizeof(int));
+  ok = m_offsets[0] == 0 && m_offsets.back() == nEntries;
+  for (size_t i = 0; ok && i < nCells; ++i) {
+    ok = m_offsets[i] <= m_offsets[i + 1];
+  }
+  for (size_t i = 0; ok && i < nEntries; ++i) {
+    ok = m_elements[i] >= 0 && m_elements[i] < nElements;
+  }
+  if (!ok) Clear();
+  return ok;
+}
+}
@@ -0,0 +1,129 @@
+#include <iostream>
+
+#include "EventLoop.hh"
+#include "Random.hh"
+#include "RandomEngineXoshiro.hh"
+#include "ThreadPool.hh"
+#include "TrackHeed.hh"
+
+namespace Garfield {
+
+void EventLoop::SetTrackStart(const double x0, const double y0,
+                              const double z0, const double t0,
+                              const double dx0, const double dy0,
+                              const double dz0) {
+  m_x0 = x0;
+  m_y0 = y0;
+  m_z0 = z0;
+  m_t0 = t0;
+  m_dx0 = dx0;
+  m_dy0 = dy0;
+  m_dz0 = dz0;
+}
+
+bool EventLoop::Run(const unsigned long nEvents) {
+  if (!m_sensorFactory) {
+    std::cerr << m_className << "::Run: Sensor factory is not defined.\n";
+    return false;
+  }
+  if (!m_trackFactory) {
+    std::cerr << m_className << "::Run: Track factory is not defined.\n";
+    return false;
+  }
+  if (!m_transportFactory) {
+    std::cerr << m_className << "::Run: Transport factory is not defined.\n";
+    return false;
+  }
+
+  ThreadPool pool(m_nThreads);
+  const unsigned int nThreads = pool.GetNumberOfThreads();
+  // Set up the objects used by each thread (the factories need not be
+  // thread-safe).
+  std::vector<Worker> workers(nThreads);
+  for (unsigned int i = 0; i < nThreads; ++i) {
+    Worker& worker = workers[i];
+    worker.sensor.reset(m_sensorFactory());
+    if (!worker.sensor) {
+      std::cerr << m_className << "::Run: Could not create sensor.\n";
+      return false;
+    }
+    worker.track.reset(m_trackFactory(worker.sensor.get()));
+    if (!worker.track) {
+      std::cerr << m_className << "::Run: Could not create track.\n";
+      return false;
+    }
+    worker.transport = m_transportFactory(worker.sensor.get());
+  }
+
+  const uint64_t seed =
+      m_hasSeed ? m_seed
+                : static_cast<uint64_t>(RndmUniform() * 9007199254740992.);
+  if (m_debug) {
+    std::cout << m_className << "::Run: Simulating " << nEvents
+              << " events on " << nThreads << " threads (seed " << seed
+              << ").\n";
+  }
+  std::mutex mutex;
+  pool.ParallelFor(nEvents, [&](const size_t i, const unsigned int thread) {
+    Event event;
+    ProcessEvent(i, thread, seed, workers[thread], event);
+    if (!m_sink) return;
+    std::lock_guard<std::mutex> lock(mutex);
+    m_sink(event);
+  });
+  return true;
+}
+
+void EventLoop::ProcessEvent(const unsigned long index,
+                             const unsigned int thread, const uint64_t seed,
+                             Worker& worker, Event& event) {
+  // Use the random number stream of this event.
+  RandomEngineXoshiro engine(seed, index);
+  ScopedThreadRandomEngine scope(engine);
+
+  Sensor* sensor = worker.sensor.get();
+  Track* track = worker.track.get();
+  sensor->ClearSignal();
+
+  // Starting point and direction of the track.
+  double x0 = m_x0, y0 = m_y0, z0 = m_z0, t0 = m_t0;
+  double dx0 = m_dx0, dy0 = m_dy0, dz0 = m_dz0;
+  if (m_trackGenerator) m_trackGenerator(index, x0, y0, z0, t0, dx0, dy0, dz0);
+
+  event.index = index;
+  event.thread = thread;
+  event.nClusters = 0;
+  event.nElectrons = 0;
+  event.energy = 0.;
+  event.sensor = sensor;
+
+  if (track->NewTrack(x0, y0, z0, t0, dx0, dy0, dz0)) {
+    TrackHeed* heed = dynamic_cast<TrackHeed*>(track);
+    double xc = 0., yc = 0., zc = 0., tc = 0., ec = 0., extra = 0.;
+    int nc = 0;
+    while (track->GetCluster(xc, yc, zc, tc, nc, ec, extra)) {
+      ++event.nClusters;
+      event.energy += ec;
+      if (nc <= 0) continue;
+      event.nElectrons += nc;
+      if (!worker.transport) continue;
+      if (!heed) {
+        // Electrons at rest, at the location of the cluster.
+        for (int j = 0; j < nc; ++j) {
+          worker.transport(xc, yc, zc, tc, 0., 0., 0., 0.);
+        }
+        continue;
+      }
+      for (int j = 0; j < nc; ++j) {
+        double x = 0., y = 0., z = 0., t = 0., e = 0.;
+        double dx = 0., dy = 0., dz = 0.;
+        heed->GetElectron(j, x, y, z, t, e, dx, dy, dz);
+        worker.transport(x, y, z, t, e, dx, dy, dz);
+      }
+    }
+  } else {
+    std::cerr << m_className << "::ProcessEvent: Could not create track "
+              << "for event " << index << ".\n";
+  }
+}
+}
@@ -0,0 +1,54 @@
+#include <mutex>
+
+#include "FieldQueryContext.hh"
+
+namespace {
+
+// Slots handed out so far and slots which have been released.
+// Created on first use, such that they outlive the static objects owning
+// a slot.
+struct SlotRegistry {
+  std::mutex mutex;
+  unsigned int nSlots = 0;
+  std::vector<unsigned int> freeSlots;
+};
+
+SlotRegistry& Registry() {
+  static SlotRegistry registry;
+  return registry;
+}
+
+thread_local Garfield::FieldQueryContext defaultContext;
+}
+
+namespace Garfield {
+
+thread_local FieldQueryContext* FieldQueryContext::m_threadContext = nullptr;
+
+FieldQueryContext& FieldQueryContext::Default() {
+  // Later lookups only need to read the pointer.
+  m_threadContext = &defaultContext;
+  return defaultContext;
+}
+
+unsigned int FieldQueryContext::Acquire() {
+  SlotRegistry& r = Registry();
+  std::lock_guard<std::mutex> lock(r.mutex);
+  if (r.freeSlots.empty()) return r.nSlots++;
+  const unsigned int slot = r.freeSlots.back();
+  r.freeSlots.pop_back();
+  return slot;
+}
+
+void FieldQueryContext::Release(const unsigned int slot) {
+  // Hints left in the contexts by the previous owner are validated
+  // by the next owner of the slot before they are used.
+  SlotRegistry& r = Registry();
+  std::lock_guard<std::mutex> lock(r.mutex);
+  r.freeSlots.push_back(slot);
+}
+
+void SetThreadFieldQueryContext(FieldQueryContext* context) {
+  FieldQueryContext::m_threadContext = context;
+}
+}
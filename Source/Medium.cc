@@ -1,6 +1,7 @@
 #include <cmath>
 #include <iomanip>
 #include <iostream>
+#include <limits>
 #include <utility>
 
 #include "FundamentalConstants.hh"
@@ -162,44 +163,53 @@ bool Medium::Velocity(const double ex, const double ey, const double ez,
     const std::vector<std::vector<std::vector<double> > >& velE,
     const std::vector<std::vector<std::vector<double> > >& velB,
     const std::vector<std::vector<std::vector<double> > >& velX,
-    const double q, double& vx, double& vy, double& vz) const {
+    const CompiledTables& compiled, const double q, double& vx, double& vy,
+    double& vz) const {
 
   vx = vy = vz = 0.;
   // Make sure there is at least a table of velocities along E.
   if (velE.empty()) return false;
 
+  Field f(ex, ey, ez, bx, by, bz);
+  if (!SetField(f)) return false;
+  return Velocity(f, velE, velB, velX, compiled, q, vx, vy, vz);
+}
+
+bool Medium::SetField(Field& f) const {
   // Compute the magnitude of the electric field.
-  const double e = sqrt(ex * ex + ey * ey + ez * ez);
-  const double e0 = ScaleElectricField(e);
-  if (e < Small || e0 < Small) return false;
+  f.e = sqrt(f.ex * f.ex + f.ey * f.ey + f.ez * f.ez);
+  const double e0 = ScaleElectricField(f.e);
+  if (f.e < Small || e0 < Small) return false;
 
   // Compute the magnitude of the magnetic field.
-  const double b = sqrt(bx * bx + by * by + bz * bz);
+  f.b = sqrt(f.bx * f.bx + f.by * f.by + f.bz * f.bz);
+  f.p.e = e0;
+  f.p.b = f.b;
   // Compute the angle between B field and E field.
-  const double ebang = GetAngle(ex, ey, ez, bx, by, bz, e, b);
+  f.p.a = m_tab2d ? GetAngle(f.ex, f.ey, f.ez, f.bx, f.by, f.bz, f.e, f.b)
+                  : 0.;
+  return true;
+}
 
+bool Medium::Velocity(Field& f,
+    const std::vector<std::vector<std::vector<double> > >& velE,
+    const std::vector<std::vector<std::vector<double> > >& velB,
+    const std::vector<std::vector<std::vector<double> > >& velX,
+    const CompiledTables& compiled, const double q, double& vx, double& vy,
+    double& vz) const {
+
+  const double ex = f.ex, ey = f.ey, ez = f.ez;
+  const double bx = f.bx, by = f.by, bz = f.bz;
+  const double e = f.e;
   // Calculate the velocity along E.
   double ve = 0.;
-  if (!Interpolate(e0, b, ebang, velE, ve, m_intpVel, m_extrVel)) {
+  if (!Interpolate(f.p, velE, compiled.velE, ve, m_intpVel, m_extrVel)) {
     std::cerr << m_className << "::Velocity: Interpolation along E failed.\n";
     return false;
   }
-  if (b < Small) {
-    // No magnetic field.
-    const double mu = q * ve / e;
-    vx = mu * ex;
-    vy = mu * ey;
-    vz = mu * ez;
-    return true;
-  } else if (velX.empty() || velB.empty()) {
-    // Magnetic field, velocities along ExB, Bt not available.
-    const double mu = q * ve / e;
-    const double mu2 = mu * mu;
-    const double eb = bx * ex + by * ey + bz * ez;
-    const double f = mu / (1. + mu2 * b * b);
-    vx = f * (ex + mu * (ey * bz - ez * by) + mu2 * bx * eb);
-    vy = f * (ey + mu * (ez * bx - ex * bz) + mu2 * by * eb);
-    vz = f * (ez + mu * (ex * by - ey * bx) + mu2 * bz * eb);
+  if (f.b < Small || velX.empty() || velB.empty()) {
+    // No magnetic field or velocities along ExB, Bt not available.
+    Langevin(f, q * ve / e, vx, vy, vz);
     return true;
   }
 
@@ -245,12 +255,12 @@ bool Medium::Velocity(const double ex, const double ey, const double ez,
 
   // Calculate the velocities in all directions.
   double vexb = 0.;
-  if (!Interpolate(e0, b, ebang, velX, vexb, m_intpVel, m_extrVel)) {
+  if (!Interpolate(f.p, velX, compiled.velX, vexb, m_intpVel, m_extrVel)) {
     std::cerr << m_className << "::Velocity: Interpolation along ExB failed.\n";
     return false;
   }
   double vbt = 0.;
-  if (!Interpolate(e0, b, ebang, velB, vbt, m_intpVel, m_extrVel)) {
+  if (!Interpolate(f.p, velB, compiled.velB, vbt, m_intpVel, m_extrVel)) {
     std::cerr << m_className << "::Velocity: Interpolation along Bt failed.\n";
     return false;
   }
@@ -266,48 +276,72 @@ bool Medium::Velocity(const double ex, const double ey, const double ez,
   return true;
 }
 
+void Medium::Langevin(const Field& f, const double mu, double& vx, double& vy,
+                      double& vz) const {
+  if (f.b < Small) {
+    vx = mu * f.ex;
+    vy = mu * f.ey;
+    vz = mu * f.ez;
+    return;
+  }
+  const double ex = f.ex, ey = f.ey, ez = f.ez;
+  const double bx = f.bx, by = f.by, bz = f.bz;
+  const double mu2 = mu * mu;
+  const double eb = bx * ex + by * ey + bz * ez;
+  const double g = mu / (1. + mu2 * f.b * f.b);
+  vx = g * (ex + mu * (ey * bz - ez * by) + mu2 * bx * eb);
+  vy = g * (ey + mu * (ez * bx - ex * bz) + mu2 * by * eb);
+  vz = g * (ez + mu * (ex * by - ey * bx) + mu2 * bz * eb);
+}
+
 bool Medium::Diffusion(const double ex, const double ey, const double ez,
                        const double bx, const double by, const double bz,
                        const std::vector<std::vector<std::vector<double> > >& difL,
                        const std::vector<std::vector<std::vector<double> > >& difT,
+                       const CompiledTables& compiled,
                        double& dl, double& dt) const { 
 
   dl = dt = 0.;
-  // Compute the magnitude of the electric field.
-  const double e = sqrt(ex * ex + ey * ey + ez * ez);
-  const double e0 = ScaleElectricField(e);
-  if (e < Small || e0 < Small) return true;
+  Field f(ex, ey, ez, bx, by, bz);
+  if (!SetField(f)) return true;
+  Diffusion(f, difL, difT, compiled, dl, dt);
+  return true;
+}
 
-  // Compute the magnitude of the magnetic field.
-  const double b = m_tab2d ? sqrt(bx * bx + by * by + bz * bz) : 0.;
-  // Compute the angle between B field and E field.
-  const double ebang = m_tab2d ? GetAngle(ex, ey, ez, bx, by, bz, e, b) : 0.;
+void Medium::Diffusion(Field& f,
+    const std::vector<std::vector<std::vector<double> > >& difL,
+    const std::vector<std::vector<std::vector<double> > >& difT,
+    const CompiledTables& compiled, double& dl, double& dt) const {
 
+  dl = dt = 0.;
   // Interpolate.
   if (!difL.empty()) {
-    if (!Interpolate(e0, b, ebang, difL, dl, m_intpDif, m_extrDif)) dl = 0.;
+    if (!Interpolate(f.p, difL, compiled.difL, dl, m_intpDif, m_extrDif)) {
+      dl = 0.;
+    }
   }
   if (!difT.empty()) {
-    if (!Interpolate(e0, b, ebang, difT, dt, m_intpDif, m_extrDif)) dt = 0.;
+    if (!Interpolate(f.p, difT, compiled.difT, dt, m_intpDif, m_extrDif)) {
+      dt = 0.;
+    }
   }
 
   // If no data available, calculate
   // the diffusion coefficients using the Einstein relation
   if (difL.empty() || difT.empty()) {
-    const double d = sqrt(2. * BoltzmannConstant * m_temperature / e);
+    const double d = sqrt(2. * BoltzmannConstant * m_temperature / f.e);
     if (difL.empty()) dl = d;
     if (difT.empty()) dt = d;
   }
   // Verify values and apply scaling.
   dl = ScaleDiffusion(std::max(dl, 0.));
   dt = ScaleDiffusion(std::max(dt, 0.));
-  return true;
 }
 
 bool Medium::Diffusion(const double ex, const double ey, const double ez,
   const double bx, const double by, const double bz,
   const std::vector<std::vector<std::vector<std::vector<double> > > >& diff,
-  double cov[3][3]) const {
+  const CompiledTables& compiled, double cov[3][3]) const {
 
   // Initialise the tensor.
   cov[0][0] = cov[0][1] = cov[0][2] = 0.;
@@ -316,20 +350,16 @@ bool Medium::Diffusion(const double ex, const double ey, const double ez,
 
   if (diff.empty()) return false;
 
-  // Compute the magnitude of the electric field.
-  const double e = sqrt(ex * ex + ey * ey + ez * ez);
-  const double e0 = ScaleElectricField(e);
-  if (e < Small || e0 < Small) return true;
-
-  // Compute the magnitude of the magnetic field.
-  const double b = m_tab2d ? sqrt(bx * bx + by * by + bz * bz) : 0.;
-  // Compute the angle between B field and E field.
-  const double ebang = m_tab2d ? GetAngle(ex, ey, ez, bx, by, bz, e, b) : 0.;
+  Field f(ex, ey, ez, bx, by, bz);
+  if (!SetField(f)) return true;
 
   for (int j = 0; j < 6; ++j) {
     // Interpolate.
     double y = 0.;
-    if (!Interpolate(e0, b, ebang, diff[j], y, m_intpDif, m_extrDif)) y = 0.;
+    if (!Interpolate(f.p, diff[j], compiled.difM[j], y, m_intpDif,
+                     m_extrDif)) {
+      y = 0.;
+    }
     // Apply scaling.
     y = ScaleDiffusionTensor(y);
     if (j < 3) {
@@ -348,6 +378,7 @@ bool Medium::Diffusion(const double ex, const double ey, const double ez,
 bool Medium::Alpha(const double ex, const double ey, const double ez,
                    const double bx, const double by, const double bz,
                    const std::vector<std::vector<std::vector<double> > >& tab,
+                   const TransportTable& compiled,
                    unsigned int intp, const unsigned int thr, 
                    const std::pair<unsigned int, unsigned int>& extr, 
                    double& alpha) const {
@@ -355,33 +386,30 @@ bool Medium::Alpha(const double ex, const double ey, const double ez,
   alpha = 0.;
   if (tab.empty()) return false;
 
-  // Compute the magnitude of the electric field.
-  const double e = sqrt(ex * ex + ey * ey + ez * ez);
-  const double e0 = ScaleElectricField(e);
-  if (e < Small || e0 < Small) return true;
+  Field f(ex, ey, ez, bx, by, bz);
+  if (!SetField(f)) return true;
+  alpha = Alpha(f, tab, compiled, intp, thr, extr);
+  return true;
+}
 
-  // Compute the magnitude of the magnetic field.
-  const double b = m_tab2d ? sqrt(bx * bx + by * by + bz * bz) : 0.;
-  // Compute the angle between B field and E field.
-  const double ebang = m_tab2d ? GetAngle(ex, ey, ez, bx, by, bz, e, b) : 0.;
+double Medium::Alpha(Field& f,
+    const std::vector<std::vector<std::vector<double> > >& tab,
+    const TransportTable& compiled, unsigned int intp, const unsigned int thr,
+    const std::pair<unsigned int, unsigned int>& extr) const {
 
   // Interpolate.
-  if (e0 < m_eFields[thr]) intp = 1;
-  if (!Interpolate(e0, b, ebang, tab, alpha, intp, extr)) alpha = -30.;
-  if (alpha < -20.) {
-    alpha = 0.;
-  } else {
-    alpha = exp(alpha);
-  }
-  return true;
+  if (f.p.e < m_eFields[thr]) intp = 1;
+  double alpha = 0.;
+  if (!Interpolate(f.p, tab, compiled, alpha, intp, extr)) alpha = -30.;
+  return alpha < -20. ? 0. : exp(alpha);
 }
 
 bool Medium::ElectronVelocity(const double ex, const double ey, const double ez,
                               const double bx, const double by, const double bz,
                               double& vx, double& vy, double& vz) {
 
-  return Velocity(ex, ey, ez, bx, by, bz, m_eVelE, m_eVelB, m_eVelX, -1., 
-                  vx, vy, vz);
+  return Velocity(ex, ey, ez, bx, by, bz, m_eVelE, m_eVelB, m_eVelX, 
+                  m_eTables, -1., vx, vy, vz);
 }
 
 bool Medium::ElectronDiffusion(const double ex, const double ey,
@@ -389,7 +417,8 @@ bool Medium::ElectronDiffusion(const double ex, const double ey,
                                const double by, const double bz, double& dl,
                                double& dt) {
 
-  return Diffusion(ex, ey, ez, bx, by, bz, m_eDifL, m_eDifT, dl, dt);
+  return Diffusion(ex, ey, ez, bx, by, bz, m_eDifL, m_eDifT, m_eTables, 
+                   dl, dt);
 }
 
 bool Medium::ElectronDiffusion(const double ex, const double ey,
@@ -397,15 +426,15 @@ bool Medium::ElectronDiffusion(const double ex, const double ey,
                                const double by, const double bz,
                                double cov[3][3]) {
 
-  return Diffusion(ex, ey, ez, bx, by, bz, m_eDifM, cov);
+  return Diffusion(ex, ey, ez, bx, by, bz, m_eDifM, m_eTables, cov);
 }
 
 bool Medium::ElectronTownsend(const double ex, const double ey, const double ez,
                               const double bx, const double by, const double bz,
                               double& alpha) {
 
-  if (!Alpha(ex, ey, ez, bx, by, bz, m_eAlp, m_intpAlp, m_eThrAlp, m_extrAlp, 
-             alpha)) {
+  if (!Alpha(ex, ey, ez, bx, by, bz, m_eAlp, m_eTables.alp, m_intpAlp, 
+             m_eThrAlp, m_extrAlp, alpha)) {
     return false;
   } 
   // Apply scaling.
@@ -417,8 +446,8 @@ bool Medium::ElectronAttachment(const double ex, const double ey,
                                 const double ez, const double bx,
                                 const double by, const double bz, double& eta) {
 
-  if (!Alpha(ex, ey, ez, bx, by, bz, m_eAtt, m_intpAtt, m_eThrAtt, m_extrAtt, 
-             eta)) {
+  if (!Alpha(ex, ey, ez, bx, by, bz, m_eAtt, m_eTables.att, m_intpAtt, 
+             m_eThrAtt, m_extrAtt, eta)) {
     return false;
   } 
   // Apply scaling.
@@ -433,21 +462,95 @@ bool Medium::ElectronLorentzAngle(const double ex, const double ey,
   lor = 0.;
   if (m_eLor.empty()) return false;
 
-  // Compute the magnitude of the electric field.
-  const double e = sqrt(ex * ex + ey * ey + ez * ez);
-  const double e0 = ScaleElectricField(e);
-  if (e < Small || e0 < Small) return true;
-
-  // Compute the magnitude of the magnetic field.
-  const double b = m_tab2d ? sqrt(bx * bx + by * by + bz * bz) : 0.;
-  // Compute the angle between B field and E field.
-  const double ebang = m_tab2d ? GetAngle(ex, ey, ez, bx, by, bz, e, b) : 0.;
+  Field f(ex, ey, ez, bx, by, bz);
+  if (!SetField(f)) return true;
+  lor = LorentzAngle(f);
+  return true;
+}
 
+double Medium::LorentzAngle(Field& f) const {
   // Interpolate.
-  if (!Interpolate(e0, b, ebang, m_eLor, lor, m_intpLor, m_extrLor)) lor = 0.;
+  double lor = 0.;
+  if (!Interpolate(f.p, m_eLor, m_eTables.lor, lor, m_intpLor, m_extrLor)) {
+    lor = 0.;
+  }
   // Apply scaling.
-  lor = ScaleLorentzAngle(lor);
-  return true;
+  return ScaleLorentzAngle(lor);
+}
+
+bool Medium::ElectronTransport(const double ex, const double ey,
+                               const double ez, const double bx,
+                               const double by, const double bz,
+                               TransportCoefficients& c,
+                               const unsigned int what) {
+  c = TransportCoefficients();
+  bool ok = ElectronVelocity(ex, ey, ez, bx, by, bz, c.vx, c.vy, c.vz);
+  if (what & TransportCoefficients::Diffusion) {
+    if (!ElectronDiffusion(ex, ey, ez, bx, by, bz, c.dl, c.dt)) ok = false;
+  }
+  if (what & TransportCoefficients::Townsend) {
+    ElectronTownsend(ex, ey, ez, bx, by, bz, c.alpha);
+  }
+  if (what & TransportCoefficients::Attachment) {
+    ElectronAttachment(ex, ey, ez, bx, by, bz, c.eta);
+  }
+  if (what & TransportCoefficients::LorentzAngle) {
+    ElectronLorentzAngle(ex, ey, ez, bx, by, bz, c.lor);
+  }
+  return ok;
+}
+
+bool Medium::Transport(const double ex, const double ey, const double ez,
+                       const double bx, const double by, const double bz,
+                       const int type, TransportCoefficients& c,
+                       const unsigned int what) const {
+  c = TransportCoefficients();
+  if (type == 2) {
+    // Ions
+    if (m_iMob.empty()) return false;
+    Field f(ex, ey, ez, bx, by, bz);
+    if (!SetField(f)) return true;
+    IonDrift(f, c.vx, c.vy, c.vz);
+    if (what & TransportCoefficients::Diffusion) {
+      Diffusion(f, m_iDifL, m_iDifT, m_iTables, c.dl, c.dt);
+    }
+    if ((what & TransportCoefficients::Townsend) && !m_iDis.empty()) {
+      c.alpha = ScaleDissociation(Alpha(f, m_iDis, m_iTables.dis, m_intpDis,
+                                        m_iThrDis, m_extrDis));
+    }
+    return true;
+  }
+  const bool electron = type < 0;
+  const auto& velE = electron ? m_eVelE : m_hVelE;
+  if (velE.empty()) return false;
+  Field f(ex, ey, ez, bx, by, bz);
+  if (!SetField(f)) return false;
+  const CompiledTables& compiled = electron ? m_eTables : m_hTables;
+  const double q = electron ? -1. : 1.;
+  const bool ok = Velocity(f, velE, electron ? m_eVelB : m_hVelB,
+                           electron ? m_eVelX : m_hVelX, compiled, q, c.vx,
+                           c.vy, c.vz);
+  if (what & TransportCoefficients::Diffusion) {
+    Diffusion(f, electron ? m_eDifL : m_hDifL, electron ? m_eDifT : m_hDifT,
+              compiled, c.dl, c.dt);
+  }
+  const auto& alp = electron ? m_eAlp : m_hAlp;
+  if ((what & TransportCoefficients::Townsend) && !alp.empty()) {
+    c.alpha = ScaleTownsend(Alpha(f, alp, compiled.alp, m_intpAlp,
+                                  electron ? m_eThrAlp : m_hThrAlp,
+                                  m_extrAlp));
+  }
+  const auto& att = electron ? m_eAtt : m_hAtt;
+  if ((what & TransportCoefficients::Attachment) && !att.empty()) {
+    c.eta = ScaleAttachment(Alpha(f, att, compiled.att, m_intpAtt,
+                                  electron ? m_eThrAtt : m_hThrAtt,
+                                  m_extrAtt));
+  }
+  if ((what & TransportCoefficients::LorentzAngle) && electron &&
+      !m_eLor.empty()) {
+    c.lor = LorentzAngle(f);
+  }
+  return ok;
 }
 
 double Medium::GetElectronEnergy(const double px, const double py,
@@ -477,6 +580,12 @@ double Medium::GetElectronNullCollisionRate(const int /*band*/) {
   return 0.;
 }
 
+double Medium::GetElectronNullCollisionRate(const double /*e*/,
+                                            const int band, double& emax) {
+  emax = std::numeric_limits<double>::max();
+  return GetElectronNullCollisionRate(band);
+}
+
 double Medium::GetElectronCollisionRate(const double /*e*/,
                                         const int /*band*/) {
   if (m_debug) PrintNotImplemented(m_className, "GetElectronCollisionRate");
@@ -505,33 +614,38 @@ bool Medium::GetDeexcitationProduct(const unsigned int /*i*/, double& t,
   return false;
 }
 
+double Medium::FreezeMicroscopicTables(const double /*emax*/) {
+  return -1.;
+}
+
 bool Medium::HoleVelocity(const double ex, const double ey, const double ez,
                           const double bx, const double by, const double bz,
                           double& vx, double& vy, double& vz) {
 
-  return Velocity(ex, ey, ez, bx, by, bz, m_hVelE, m_hVelB, m_hVelX, +1., 
-                  vx, vy, vz);
+  return Velocity(ex, ey, ez, bx, by, bz, m_hVelE, m_hVelB, m_hVelX, 
+                  m_hTables, +1., vx, vy, vz);
 }
 
 bool Medium::HoleDiffusion(const double ex, const double ey, const double ez,
                            const double bx, const double by, const double bz,
                            double& dl, double& dt) {
-  return Diffusion(ex, ey, ez, bx, by, bz, m_hDifL, m_hDifT, dl, dt);
+  return Diffusion(ex, ey, ez, bx, by, bz, m_hDifL, m_hDifT, m_hTables, 
+                   dl, dt);
 }
 
 bool Medium::HoleDiffusion(const double ex, const double ey, const double ez,
                            const double bx, const double by, const double bz,
                            double cov[3][3]) {
 
-  return Diffusion(ex, ey, ez, bx, by, bz, m_hDifM, cov);
+  return Diffusion(ex, ey, ez, bx, by, bz, m_hDifM, m_hTables, cov);
 }
 
 bool Medium::HoleTownsend(const double ex, const double ey, const double ez,
                           const double bx, const double by, const double bz,
                           double& alpha) {
 
-  if (!Alpha(ex, ey, ez, bx, by, bz, m_hAlp, m_intpAlp, m_hThrAlp, m_extrAlp, 
-             alpha)) {
+  if (!Alpha(ex, ey, ez, bx, by, bz, m_hAlp, m_hTables.alp, m_intpAlp, 
+             m_hThrAlp, m_extrAlp, alpha)) {
     return false;
   } 
   // Apply scaling.
@@ -543,8 +657,8 @@ bool Medium::HoleAttachment(const double ex, const double ey, const double ez,
                             const double bx, const double by, const double bz,
                             double& eta) {
 
-  if (!Alpha(ex, ey, ez, bx, by, bz, m_hAtt, m_intpAtt, m_hThrAtt, m_extrAtt, 
-             eta)) {
+  if (!Alpha(ex, ey, ez, bx, by, bz, m_hAtt, m_hTables.att, m_intpAtt, 
+             m_hThrAtt, m_extrAtt, eta)) {
     return false;
   } 
   // Apply scaling.
@@ -552,54 +666,57 @@ bool Medium::HoleAttachment(const double ex, const double ey, const double ez,
   return true;
 }
 
+bool Medium::HoleTransport(const double ex, const double ey, const double ez,
+                           const double bx, const double by, const double bz,
+                           TransportCoefficients& c, const unsigned int what) {
+  c = TransportCoefficients();
+  bool ok = HoleVelocity(ex, ey, ez, bx, by, bz, c.vx, c.vy, c.vz);
+  if (what & TransportCoefficients::Diffusion) {
+    if (!HoleDiffusion(ex, ey, ez, bx, by, bz, c.dl, c.dt)) ok = false;
+  }
+  if (what & TransportCoefficients::Townsend) {
+    HoleTownsend(ex, ey, ez, bx, by, bz, c.alpha);
+  }
+  if (what & TransportCoefficients::Attachment) {
+    HoleAttachment(ex, ey, ez, bx, by, bz, c.eta);
+  }
+  return ok;
+}
+
 bool Medium::IonVelocity(const double ex, const double ey, const double ez,
                          const double bx, const double by, const double bz,
                          double& vx, double& vy, double& vz) {
   vx = vy = vz = 0.;
   if (m_iMob.empty()) return false;
-  // Compute the magnitude of the electric field.
-  const double e = sqrt(ex * ex + ey * ey + ez * ez);
-  const double e0 = ScaleElectricField(e);
-  if (e < Small || e0 < Small) return true;
-  // Compute the magnitude of the electric field.
-  const double b = sqrt(bx * bx + by * by + bz * bz);
+  Field f(ex, ey, ez, bx, by, bz);
+  if (!SetField(f)) return true;
+  IonDrift(f, vx, vy, vz);
+  return true;
+}
 
-  // Compute the angle between B field and E field.
-  const double ebang = m_tab2d ? GetAngle(ex, ey, ez, bx, by, bz, e, b) : 0.;
+void Medium::IonDrift(Field& f, double& vx, double& vy, double& vz) const {
   double mu = 0.;
-  if (!Interpolate(e0, b, ebang, m_iMob, mu, m_intpMob, m_extrMob)) mu = 0.;
-
-  constexpr double q = 1.;
-  mu *= q;
-  if (b < Small) {
-    vx = mu * ex;
-    vy = mu * ey;
-    vz = mu * ez;
-  } else {
-    const double eb = bx * ex + by * ey + bz * ez;
-    const double mu2 = mu * mu;
-    const double f = mu / (1. + mu2 * b * b);
-    vx = f * (ex + mu * (ey * bz - ez * by) + mu2 * bx * eb);
-    vy = f * (ey + mu * (ez * bx - ex * bz) + mu2 * by * eb);
-    vz = f * (ez + mu * (ex * by - ey * bx) + mu2 * bz * eb);
+  if (!Interpolate(f.p, m_iMob, m_iTables.mob, mu, m_intpMob, m_extrMob)) {
+    mu = 0.;
   }
-
-  return true;
+  constexpr double q = 1.;
+  Langevin(f, q * mu, vx, vy, vz);
 }
 
 bool Medium::IonDiffusion(const double ex, const double ey, const double ez,
                           const double bx, const double by, const double bz,
                           double& dl, double& dt) {
 
-  return Diffusion(ex, ey, ez, bx, by, bz, m_iDifL, m_iDifT, dl, dt);
+  return Diffusion(ex, ey, ez, bx, by, bz, m_iDifL, m_iDifT, m_iTables, 
+                   dl, dt);
 }
 
 bool Medium::IonDissociation(const double ex, const double ey, const double ez,
                              const double bx, const double by, const double bz,
                              double& diss) {
 
-  if (!Alpha(ex, ey, ez, bx, by, bz, m_iDis, m_intpDis, m_iThrDis, m_extrDis, 
-             diss)) {
+  if (!Alpha(ex, ey, ez, bx, by, bz, m_iDis, m_iTables.dis, m_intpDis, 
+             m_iThrDis, m_extrDis, diss)) {
     return false;
   } 
   // Apply scaling.
@@ -607,6 +724,20 @@ bool Medium::IonDissociation(const double ex, const double ey, const double ez,
   return true;
 }
 
+bool Medium::IonTransport(const double ex, const double ey, const double ez,
+                          const double bx, const double by, const double bz,
+                          TransportCoefficients& c, const unsigned int what) {
+  c = TransportCoefficients();
+  bool ok = IonVelocity(ex, ey, ez, bx, by, bz, c.vx, c.vy, c.vz);
+  if (what & TransportCoefficients::Diffusion) {
+    if (!IonDiffusion(ex, ey, ez, bx, by, bz, c.dl, c.dt)) ok = false;
+  }
+  if (what & TransportCoefficients::Townsend) {
+    IonDissociation(ex, ey, ez, bx, by, bz, c.alpha);
+  }
+  return ok;
+}
+
 bool Medium::GetOpticalDataRange(double& emin, double& emax,
                                  const unsigned int i) {
   if (i >= m_nComponents) {
@@ -845,6 +976,7 @@ void Medium::SetFieldGrid(const std::vector<double>& efields,
   m_eFields = efields;
   m_bFields = bfields;
   m_bAngles = angles;
+  CompileTables();
 }
 
 void Medium::GetFieldGrid(std::vector<double>& efields,
@@ -872,7 +1004,64 @@ bool Medium::GetEntry(const unsigned int i, const unsigned int j,
   return true;
 }
 
+void Medium::CompileTables() {
+  // All tables are defined on the same grid.
+  auto grid = std::make_shared<TransportTable::Grid>();
+  if (!grid->Set(m_eFields, m_bFields, m_bAngles, m_tab2d)) grid.reset();
+  const auto compile = [&grid](
+      const std::vector<std::vector<std::vector<double> > >& tab,
+      TransportTable& compiled, const unsigned int intp, const double eLin) {
+    if (tab.empty() || !grid) {
+      compiled.Clear();
+      return;
+    }
+    compiled.Build(tab, grid, intp, eLin);
+  };
+  // Below the threshold, the Townsend, attachment and dissociation
+  // coefficients are interpolated linearly.
+  const auto threshold = [this](const unsigned int thr) {
+    return thr < m_eFields.size() ? m_eFields[thr] : 0.;
+  };
+  // Electrons
+  compile(m_eVelE, m_eTables.velE, m_intpVel, 0.);
+  compile(m_eVelX, m_eTables.velX, m_intpVel, 0.);
+  compile(m_eVelB, m_eTables.velB, m_intpVel, 0.);
+  compile(m_eDifL, m_eTables.difL, m_intpDif, 0.);
+  compile(m_eDifT, m_eTables.difT, m_intpDif, 0.);
+  for (size_t j = 0; j < 6; ++j) {
+    if (j < m_eDifM.size()) {
+      compile(m_eDifM[j], m_eTables.difM[j], m_intpDif, 0.);
+    } else {
+      m_eTables.difM[j].Clear();
+    }
+  }
+  compile(m_eAlp, m_eTables.alp, m_intpAlp, threshold(m_eThrAlp));
+  compile(m_eAtt, m_eTables.att, m_intpAtt, threshold(m_eThrAtt));
+  compile(m_eLor, m_eTables.lor, m_intpLor, 0.);
+  // Holes
+  compile(m_hVelE, m_hTables.velE, m_intpVel, 0.);
+  compile(m_hVelX, m_hTables.velX, m_intpVel, 0.);
+  compile(m_hVelB, m_hTables.velB, m_intpVel, 0.);
+  compile(m_hDifL, m_hTables.difL, m_intpDif, 0.);
+  compile(m_hDifT, m_hTables.difT, m_intpDif, 0.);
+  for (size_t j = 0; j < 6; ++j) {
+    if (j < m_hDifM.size()) {
+      compile(m_hDifM[j], m_hTables.difM[j], m_intpDif, 0.);
+    } else {
+      m_hTables.difM[j].Clear();
+    }
+  }
+  compile(m_hAlp, m_hTables.alp, m_intpAlp, threshold(m_hThrAlp));
+  compile(m_hAtt, m_hTables.att, m_intpAtt, threshold(m_hThrAtt));
+  // Ions
+  compile(m_iMob, m_iTables.mob, m_intpMob, 0.);
+  compile(m_iDifL, m_iTables.difL, m_intpDif, 0.);
+  compile(m_iDifT, m_iTables.difT, m_intpDif, 0.);
+  compile(m_iDis, m_iTables.dis, m_intpDis, threshold(m_iThrDis));
+}
+
 void Medium::ResetTables() {
+  ++m_revision;
   ResetElectronVelocity();
   ResetElectronDiffusion();
   ResetElectronTownsend();
@@ -1002,6 +1191,8 @@ bool Medium::SetIonMobility(const unsigned int ie, const unsigned int ib,
   }
 
   m_iMob[ia][ib][ie] = mu;
+  // The compiled table is out of date.
+  m_iTables.mob.Clear();
   if (m_debug) {
     std::cout << m_className << "::SetIonMobility:\n    Ion mobility at E = "
               << m_eFields[ie] << " V/cm, B = " 
@@ -1041,6 +1232,7 @@ bool Medium::SetIonMobility(const std::vector<double>& efields,
       }
     }
   }
+  CompileTables();
   return true;
 }
 
@@ -1138,27 +1330,39 @@ unsigned int Medium::SetThreshold(
 }
 
 void Medium::SetInterpolationMethodVelocity(const unsigned int intrp) {
-  if (intrp > 0) m_intpVel = intrp;
+  if (intrp == 0) return;
+  m_intpVel = intrp;
+  CompileTables();
 }
 
 void Medium::SetInterpolationMethodDiffusion(const unsigned int intrp) {
-  if (intrp > 0) m_intpDif = intrp;
+  if (intrp == 0) return;
+  m_intpDif = intrp;
+  CompileTables();
 }
 
 void Medium::SetInterpolationMethodTownsend(const unsigned int intrp) {
-  if (intrp > 0) m_intpAlp = intrp;
+  if (intrp == 0) return;
+  m_intpAlp = intrp;
+  CompileTables();
 }
 
 void Medium::SetInterpolationMethodAttachment(const unsigned int intrp) {
-  if (intrp > 0) m_intpAtt = intrp;
+  if (intrp == 0) return;
+  m_intpAtt = intrp;
+  CompileTables();
 }
 
 void Medium::SetInterpolationMethodIonMobility(const unsigned int intrp) {
-  if (intrp > 0) m_intpMob = intrp;
+  if (intrp == 0) return;
+  m_intpMob = intrp;
+  CompileTables();
 }
 
 void Medium::SetInterpolationMethodIonDissociation(const unsigned int intrp) {
-  if (intrp > 0) m_intpDis = intrp;
+  if (intrp == 0) return;
+  m_intpDis = intrp;
+  CompileTables();
 }
 
 double Medium::GetAngle(const double ex, const double ey, const double ez,
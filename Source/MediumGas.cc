@@ -568,6 +568,7 @@ bool MediumGas::LoadGasFile(const std::string& filename) {
   if (ionDiffL > 0.) Init(nE, nB, nA, m_iDifL, ionDiffL);
   if (ionDiffT > 0.) Init(nE, nB, nA, m_iDifT, ionDiffT);
 
+  CompileTables();
   if (m_debug) std::cout << m_className << "::LoadGasFile: Done.\n";
 
   return true;
@@ -1580,6 +1581,7 @@ bool MediumGas::MergeGasFile(const std::string& filename,
   // Update the Townsend and attachment threshold indices.
   SetThreshold(m_eAlp);
   SetThreshold(m_eAtt);
+  CompileTables();
   return true;
 }
 
@@ -2531,6 +2533,7 @@ bool MediumGas::AdjustTownsendCoefficient() {
   }
   // Update the threshold index.
   SetThreshold(m_eAlp);
+  CompileTables();
   return true;
 }
 
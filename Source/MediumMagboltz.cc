@@ -1,11 +1,23 @@
 #include <algorithm>
+#include <cerrno>
+#include <chrono>
 #include <cmath>
+#include <csignal>
 #include <cstdio>
+#include <deque>
 #include <fstream>
 #include <iomanip>
 #include <iostream>
+#include <limits>
 #include <map>
 #include <numeric>
+#include <sstream>
+#include <thread>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/wait.h>
+#include <unistd.h>
 
 #include <TMath.h>
 
@@ -15,6 +27,7 @@
 #include "MediumMagboltz.hh"
 #include "OpticalData.hh"
 #include "Random.hh"
+#include "ThreadPool.hh"
 
 namespace {
 
@@ -165,7 +178,7 @@ void MediumMagboltz::EnableDeexcitation() {
   m_usePenning = false;
   m_useDeexcitation = true;
   m_isChanged = true;
-  m_dxcProducts.clear();
+  DxcProducts().clear();
 }
 
 void MediumMagboltz::EnableRadiationTrapping() {
@@ -474,6 +487,35 @@ double MediumMagboltz::GetElectronNullCollisionRate(const int band) {
   return m_cfNull;
 }
 
+double MediumMagboltz::GetElectronNullCollisionRate(const double e,
+                                                    const int band,
+                                                    double& emax) {
+  // If necessary, update the collision rates table.
+  if (m_isChanged) {
+    if (!Mixer()) {
+      PrintErrorMixer(m_className + "::GetElectronNullCollisionRate");
+      return 0.;
+    }
+    m_isChanged = false;
+  }
+
+  if (m_debug && band > 0) {
+    std::cerr << m_className << "::GetElectronNullCollisionRate: Band > 0.\n";
+  }
+
+  const double width = nBinsNullBand * m_eStep;
+  const unsigned int nBands = m_cfNullBands.size();
+  unsigned int k = e > 0. ? std::min(e / width, double(nBands)) : 0;
+  if (k < nBands && (k + 1) * width <= e) ++k;
+  if (k >= nBands) {
+    // Above the linear binning, use the overall null-collision rate.
+    emax = std::numeric_limits<double>::max();
+    return m_cfNull;
+  }
+  emax = (k + 1) * width;
+  return m_cfNullBands[k];
+}
+
 double MediumMagboltz::GetElectronCollisionRate(const double e,
                                                 const int band) {
   // Check if the electron energy is within the currently set range.
@@ -481,7 +523,7 @@ double MediumMagboltz::GetElectronCollisionRate(const double e,
     std::cerr << m_className << "::GetElectronCollisionRate: Invalid energy.\n";
     return m_cfTot[0];
   }
-  if (e > m_eFinal && m_useAutoAdjust) {
+  if (e > m_eFinal && m_useAutoAdjust && !m_frozen) {
     std::cerr << m_className << "::GetElectronCollisionRate:\n    Rate at " << e
               << " eV is not included in the current table.\n    "
               << "Increasing energy range to " << 1.05 * e << " eV.\n";
@@ -569,7 +611,7 @@ bool MediumMagboltz::GetElectronCollision(
     return false;
   }
   // Check if the electron energy is within the currently set range.
-  if (e > m_eFinal && m_useAutoAdjust) {
+  if (e > m_eFinal && m_useAutoAdjust && !m_frozen) {
     std::cerr << m_className << "::GetElectronCollision:\n    Provided energy ("
               << e << " eV) exceeds current energy range.\n"
               << "    Increasing energy range to " << 1.05 * e << " eV.\n";
@@ -599,36 +641,28 @@ bool MediumMagboltz::GetElectronCollision(
     const int iE = std::min(std::max(int(e / m_eStep), 0), iemax);
 
     // Sample the scattering process.
-    const double r = RndmUniform();
-    if (r <= m_cf[iE][0]) {
-      level = 0;
-    } else if (r >= m_cf[iE][m_nTerms - 1]) {
-      level = m_nTerms - 1;
-    } else {
-      const auto begin = m_cf[iE].cbegin();
-      level = std::lower_bound(begin, begin + m_nTerms, r) - begin;
-    }
+    const double u = RndmUniform() * m_nTerms;
+    const unsigned int i = std::min(static_cast<unsigned int>(u), m_nTerms - 1);
+    const CollisionEntry& c = m_alias[iE * m_nTerms + i];
+    const unsigned int j = u - i < c.threshold ? 0 : 1;
+    level = c.level[j];
     // Get the angular distribution parameters.
-    angCut = m_scatCut[iE][level];
-    angPar = m_scatPar[iE][level];
+    angCut = c.cut[j];
+    angPar = c.par[j];
   } else {
     // Logarithmic binning
     // Get the energy interval.
     const int iE = std::min(std::max(int(log(e / m_eHigh) / m_lnStep), 0),
                             nEnergyStepsLog - 1);
     // Sample the scattering process.
-    const double r = RndmUniform();
-    if (r <= m_cfLog[iE][0]) {
-      level = 0;
-    } else if (r >= m_cfLog[iE][m_nTerms - 1]) {
-      level = m_nTerms - 1;
-    } else {
-      const auto begin = m_cfLog[iE].cbegin();
-      level = std::lower_bound(begin, begin + m_nTerms, r) - begin;
-    }
+    const double u = RndmUniform() * m_nTerms;
+    const unsigned int i = std::min(static_cast<unsigned int>(u), m_nTerms - 1);
+    const CollisionEntry& c = m_aliasLog[iE * m_nTerms + i];
+    const unsigned int j = u - i < c.threshold ? 0 : 1;
+    level = c.level[j];
     // Get the angular distribution parameters.
-    angCut = m_scatCutLog[iE][level];
-    angPar = m_scatParLog[iE][level];
+    angCut = c.cut[j];
+    angPar = c.par[j];
   }
 
   // Extract the collision type.
@@ -688,9 +722,10 @@ bool MediumMagboltz::GetElectronCollision(
     if (m_useDeexcitation && m_iDeexcitation[level] >= 0) {
       int fLevel = 0;
       ComputeDeexcitationInternal(m_iDeexcitation[level], fLevel);
-      ndxc = m_dxcProducts.size();
+      ndxc = DxcProducts().size();
     } else if (m_usePenning) {
-      m_dxcProducts.clear();
+      auto& products = DxcProducts();
+      products.clear();
       // Simplified treatment of Penning ionisation.
       // If the energy threshold of this level exceeds the
       // ionisation potential of one of the gases,
@@ -712,7 +747,7 @@ bool MediumMagboltz::GetElectronCollision(
         }
         newDxcProd.energy = esec;
         newDxcProd.type = DxcProdTypeElectron;
-        m_dxcProducts.push_back(std::move(newDxcProd));
+        products.push_back(std::move(newDxcProd));
         ndxc = 1;
         ++m_nPenning;
       }
@@ -787,22 +822,69 @@ bool MediumMagboltz::GetElectronCollision(
 bool MediumMagboltz::GetDeexcitationProduct(const unsigned int i, double& t,
                                             double& s, int& type,
                                             double& energy) const {
-  if (i >= m_dxcProducts.size() || !(m_useDeexcitation || m_usePenning)) {
+  const auto& products = DxcProducts();
+  if (i >= products.size() || !(m_useDeexcitation || m_usePenning)) {
     return false;
   }
-  t = m_dxcProducts[i].t;
-  s = m_dxcProducts[i].s;
-  type = m_dxcProducts[i].type;
-  energy = m_dxcProducts[i].energy;
+  t = products[i].t;
+  s = products[i].s;
+  type = products[i].type;
+  energy = products[i].energy;
   return true;
 }
 
+std::vector<MediumMagboltz::dxcProd>& MediumMagboltz::DxcProducts() const {
+  static thread_local const MediumMagboltz* owner = nullptr;
+  static thread_local std::vector<dxcProd> products;
+  if (owner != this) {
+    // Products of another medium.
+    owner = this;
+    products.clear();
+  }
+  return products;
+}
+
+double MediumMagboltz::FreezeMicroscopicTables(const double emax) {
+  m_frozen = false;
+  if (emax > m_eFinal && m_useAutoAdjust) {
+    std::cerr << m_className << "::FreezeMicroscopicTables:\n"
+              << "    Increasing energy range to " << 1.05 * emax << " eV.\n";
+    SetMaxElectronEnergy(1.05 * emax);
+  }
+  if (m_isChanged) {
+    if (!Mixer()) {
+      PrintErrorMixer(m_className + "::FreezeMicroscopicTables");
+      return 0.;
+    }
+    m_isChanged = false;
+  }
+  // Make sure the photon table covers the lines of the de-excitation
+  // cascade, which have a width of at most dxc.width.
+  if (m_useDeexcitation && m_useAutoAdjust) {
+    double eGamma = 0.;
+    for (const auto& dxc : m_deexcitations) {
+      eGamma = std::max(eGamma, dxc.energy + dxc.width);
+    }
+    if (eGamma > m_eFinalGamma) {
+      SetMaxPhotonEnergy(1.05 * eGamma);
+      if (!Mixer()) {
+        PrintErrorMixer(m_className + "::FreezeMicroscopicTables");
+        m_isChanged = true;
+        return 0.;
+      }
+      m_isChanged = false;
+    }
+  }
+  m_frozen = true;
+  return m_useAutoAdjust ? m_eFinal : std::numeric_limits<double>::max();
+}
+
 double MediumMagboltz::GetPhotonCollisionRate(const double e) {
   if (e <= 0.) {
     std::cerr << m_className << "::GetPhotonCollisionRate: Invalid  energy.\n";
     return m_cfTotGamma[0];
   }
-  if (e > m_eFinalGamma && m_useAutoAdjust) {
+  if (e > m_eFinalGamma && m_useAutoAdjust && !m_frozen) {
     std::cerr << m_className << "::GetPhotonCollisionRate:\n    Rate at " << e
               << " eV is not included in the current table.\n"
               << "    Increasing energy range to " << 1.05 * e << " eV.\n";
@@ -841,7 +923,7 @@ bool MediumMagboltz::GetPhotonCollision(const double e, int& type, int& level,
     std::cerr << m_className << "::GetPhotonCollision: Invalid energy.\n";
     return false;
   }
-  if (e > m_eFinalGamma && m_useAutoAdjust) {
+  if (e > m_eFinalGamma && m_useAutoAdjust && !m_frozen) {
     std::cerr << m_className << "::GetPhotonCollision:\n    Provided energy ("
               << e << " eV) exceeds current energy range.\n"
               << "    Increasing energy range to " << 1.05 * e << " eV.\n";
@@ -886,7 +968,7 @@ bool MediumMagboltz::GetPhotonCollision(const double e, int& type, int& level,
           int fLevel = 0;
           ComputeDeexcitationInternal(iLine[i], fLevel);
           type = PhotonCollisionTypeExcitation;
-          nsec = m_dxcProducts.size();
+          nsec = DxcProducts().size();
           return true;
         }
       }
@@ -928,8 +1010,8 @@ bool MediumMagboltz::GetPhotonCollision(const double e, int& type, int& level,
 }
 
 void MediumMagboltz::ResetCollisionCounters() {
-  m_nCollisions.fill(0);
-  m_nCollisionsDetailed.assign(m_nTerms, 0);
+  for (auto& n : m_nCollisions) n = 0;
+  for (auto& n : m_nCollisionsDetailed) n = 0;
   m_nPenning = 0;
   m_nPhotonCollisions.fill(0);
 }
@@ -1668,6 +1750,7 @@ bool MediumMagboltz::Mixer(const bool verbose) {
               << m_minIonPot << " eV (" << minIonPotGas << ")\n";
   }
 
+  m_alias.resize(Magboltz::nEnergySteps * m_nTerms);
   for (unsigned int iE = 0; iE < Magboltz::nEnergySteps; ++iE) {
     // Calculate the total collision frequency.
     for (unsigned int k = 0; k < m_nTerms; ++k) {
@@ -1684,6 +1767,8 @@ bool MediumMagboltz::Mixer(const bool verbose) {
     if (m_cfTot[iE] > 0.) {
       for (unsigned int k = 0; k < m_nTerms; ++k) m_cf[iE][k] /= m_cfTot[iE];
     }
+    BuildAliasTable(m_cf[iE], m_scatCut[iE], m_scatPar[iE],
+                    &m_alias[iE * m_nTerms]);
     for (unsigned int k = 1; k < m_nTerms; ++k) {
       m_cf[iE][k] += m_cf[iE][k - 1];
     }
@@ -1698,6 +1783,7 @@ bool MediumMagboltz::Mixer(const bool verbose) {
 
   if (m_eFinal > m_eHigh) {
     const double rLog = pow(m_eFinal / m_eHigh, 1. / nEnergyStepsLog);
+    m_aliasLog.resize(nEnergyStepsLog * m_nTerms);
     for (int iE = 0; iE < nEnergyStepsLog; ++iE) {
       // Calculate the total collision frequency.
       for (unsigned int k = 0; k < m_nTerms; ++k) {
@@ -1710,6 +1796,8 @@ bool MediumMagboltz::Mixer(const bool verbose) {
           m_cfLog[iE][k] /= m_cfTotLog[iE];
         }
       }
+      BuildAliasTable(m_cfLog[iE], m_scatCutLog[iE], m_scatParLog[iE],
+                      &m_aliasLog[iE * m_nTerms]);
       for (unsigned int k = 1; k < m_nTerms; ++k) {
         m_cfLog[iE][k] += m_cfLog[iE][k - 1];
       }
@@ -1721,6 +1809,19 @@ bool MediumMagboltz::Mixer(const bool verbose) {
     }
   }
 
+  // Determine the max. collision frequency below the upper edge of
+  // each energy band (including the first bin of the next band).
+  constexpr unsigned int nBands = Magboltz::nEnergySteps / nBinsNullBand;
+  m_cfNullBands.assign(nBands, 0.);
+  double cfMax = 0.;
+  unsigned int ie = 0;
+  for (unsigned int k = 0; k < nBands; ++k) {
+    const unsigned int last =
+        std::min((k + 1) * nBinsNullBand, Magboltz::nEnergySteps - 1);
+    for (; ie <= last; ++ie) cfMax = std::max(cfMax, m_cfTot[ie]);
+    m_cfNullBands[k] = cfMax;
+  }
+
   // Determine the null collision frequency.
   m_cfNull = 0.;
   for (unsigned int j = 0; j < Magboltz::nEnergySteps; ++j) {
@@ -1734,8 +1835,9 @@ bool MediumMagboltz::Mixer(const bool verbose) {
   }
 
   // Reset the collision counters.
-  m_nCollisionsDetailed.assign(m_nTerms, 0);
-  m_nCollisions.fill(0);
+  m_nCollisionsDetailed = std::vector<Counter>(m_nTerms);
+  for (auto& n : m_nCollisionsDetailed) n = 0;
+  for (auto& n : m_nCollisions) n = 0;
 
   if (m_debug || verbose) {
     std::cout << m_className << "::Mixer:\n"
@@ -1785,9 +1887,60 @@ bool MediumMagboltz::Mixer(const bool verbose) {
   // Set the Green-Sawada splitting function parameters.
   SetupGreenSawada();
 
+  ++m_revision;
   return true;
 }
 
+void MediumMagboltz::BuildAliasTable(const std::vector<double>& p,
+                                     const std::vector<double>& cut,
+                                     const std::vector<double>& par,
+                                     CollisionEntry* table) const {
+  // Vose's alias method. Each of the m_nTerms entries is selected with
+  // equal probability and holds a level and its alias.
+  const unsigned int n = m_nTerms;
+  std::vector<double> q(n, 0.);
+  std::vector<unsigned int> small;
+  std::vector<unsigned int> large;
+  double sum = 0.;
+  for (unsigned int k = 0; k < n; ++k) sum += p[k];
+  for (unsigned int k = 0; k < n; ++k) {
+    CollisionEntry& entry = table[k];
+    entry.threshold = 1.;
+    entry.level.fill(k);
+    entry.cut.fill(cut[k]);
+    entry.par.fill(par[k]);
+    if (sum <= 0.) {
+      // No collisions at this energy; select the last level (as before).
+      entry.level.fill(n - 1);
+      entry.cut.fill(cut[n - 1]);
+      entry.par.fill(par[n - 1]);
+      continue;
+    }
+    q[k] = n * p[k] / sum;
+    if (q[k] < 1.) {
+      small.push_back(k);
+    } else {
+      large.push_back(k);
+    }
+  }
+  while (!small.empty() && !large.empty()) {
+    const unsigned int s = small.back();
+    small.pop_back();
+    const unsigned int l = large.back();
+    CollisionEntry& entry = table[s];
+    entry.threshold = q[s];
+    entry.level[1] = l;
+    entry.cut[1] = cut[l];
+    entry.par[1] = par[l];
+    q[l] -= 1. - q[s];
+    if (q[l] < 1.) {
+      large.pop_back();
+      small.push_back(l);
+    }
+  }
+  // The remaining entries (if any, due to rounding) keep their own level.
+}
+
 void MediumMagboltz::SetupGreenSawada() {
   for (unsigned int i = 0; i < m_nComponents; ++i) {
     const double ta = 1000.;
@@ -3080,7 +3233,8 @@ void MediumMagboltz::ComputeDeexcitation(int iLevel, int& fLevel) {
 }
 
 void MediumMagboltz::ComputeDeexcitationInternal(int iLevel, int& fLevel) {
-  m_dxcProducts.clear();
+  auto& products = DxcProducts();
+  products.clear();
 
   double t = 0.;
   fLevel = iLevel;
@@ -3116,7 +3270,7 @@ void MediumMagboltz::ComputeDeexcitationInternal(int iLevel, int& fLevel) {
         // Decay to a lower lying excited state.
         photon.energy -= m_deexcitations[fLevel].energy;
         if (photon.energy < Small) photon.energy = Small;
-        m_dxcProducts.push_back(std::move(photon));
+        products.push_back(std::move(photon));
         // Proceed with the next level in the cascade.
         iLevel = fLevel;
       } else {
@@ -3126,7 +3280,7 @@ void MediumMagboltz::ComputeDeexcitationInternal(int iLevel, int& fLevel) {
           delta = RndmVoigt(0., dxc.sDoppler, dxc.gPressure);
         }
         photon.energy += delta;
-        m_dxcProducts.push_back(std::move(photon));
+        products.push_back(std::move(photon));
         // Deexcitation cascade is over.
         fLevel = iLevel;
         return;
@@ -3143,7 +3297,7 @@ void MediumMagboltz::ComputeDeexcitationInternal(int iLevel, int& fLevel) {
         electron.energy -= m_deexcitations[fLevel].energy;
         if (electron.energy < Small) electron.energy = Small;
         ++m_nPenning;
-        m_dxcProducts.push_back(std::move(electron));
+        products.push_back(std::move(electron));
         // Proceed with the next level in the cascade.
         iLevel = fLevel;
       } else {
@@ -3151,7 +3305,7 @@ void MediumMagboltz::ComputeDeexcitationInternal(int iLevel, int& fLevel) {
         electron.energy -= m_minIonPot;
         if (electron.energy < Small) electron.energy = Small;
         ++m_nPenning;
-        m_dxcProducts.push_back(std::move(electron));
+        products.push_back(std::move(electron));
         // Deexcitation cascade is over.
         fLevel = iLevel;
         return;
@@ -3434,6 +3588,322 @@ void MediumMagboltz::RunMagboltz(
 }
 
 void MediumMagboltz::GenerateGasTable(const int numColl, const bool verbose) {
+  InitGasTable();
+
+  std::vector<double> val;
+  std::vector<ExcLevel> excLevels;
+  std::vector<IonLevel> ionLevels;
+  // Run through the grid of E- and B-fields and angles.
+  for (unsigned int i = 0; i < m_eFields.size(); ++i) {
+    const double e = m_eFields[i];
+    for (unsigned int j = 0; j < m_bAngles.size(); ++j) {
+      const double a = m_bAngles[j];
+      for (unsigned int k = 0; k < m_bFields.size(); ++k) {
+        const double b = m_bFields[k];
+        std::cout << m_className << "::GenerateGasTable: E = " << e
+                  << " V/cm, B = " << b << " T, angle: " << a << " rad\n";
+        RunGasTablePoint(e, b, a, numColl, verbose, val, excLevels,
+                         ionLevels);
+        // If not done yet, set the excitation and ionisation levels.
+        if (m_excLevels.empty() && m_ionLevels.empty()) {
+          SetExcitationIonisationLevels(excLevels, ionLevels);
+        }
+        SetGasTablePoint(i, j, k, val);
+      }
+    }
+  }
+  // Set the threshold indices.
+  SetThreshold(m_eAlp);
+  SetThreshold(m_eAtt);
+  CompileTables();
+}
+
+bool MediumMagboltz::GenerateGasTableParallel(const int numColl,
+                                              const unsigned int nWorkers,
+                                              const std::string& checkpoint,
+                                              const bool verbose,
+                                              const double timeout) {
+  const std::string hdr = m_className + "::GenerateGasTableParallel: ";
+  // The worker processes only inherit the calling thread. Locks held by
+  // other threads at the time of the fork would never be released.
+  if (ThreadPool::GetNumberOfWorkerThreads() > 0) {
+    std::cerr << hdr << "Cannot fork while thread pools exist.\n"
+              << "    Call this function before enabling parallel transport"
+              << " (or after disabling it).\n";
+    return false;
+  }
+  InitGasTable();
+
+  const unsigned int nEfields = m_eFields.size();
+  const unsigned int nBfields = m_bFields.size();
+  const unsigned int nAngles = m_bAngles.size();
+  const unsigned int nPoints = nEfields * nBfields * nAngles;
+  // Index of a grid point (in the order of the serial loop).
+  auto split = [&](const unsigned int p, unsigned int& i, unsigned int& j,
+                   unsigned int& k) {
+    k = p % nBfields;
+    j = (p / nBfields) % nAngles;
+    i = p / (nBfields * nAngles);
+  };
+  std::vector<bool> done(nPoints, false);
+  unsigned int nDone = 0;
+
+  // Read the results of a previous (interrupted) run.
+  const std::string header = GetGasTableHeader(numColl);
+  std::ofstream outfile;
+  if (!checkpoint.empty()) {
+    std::ifstream infile(checkpoint);
+    std::string contents;
+    if (infile) {
+      std::stringstream buffer;
+      buffer << infile.rdbuf();
+      contents = buffer.str();
+      infile.close();
+    }
+    if (!contents.empty()) {
+      std::istringstream is(contents);
+      std::string line;
+      std::getline(is, line);
+      if (line != header) {
+        std::cerr << hdr << "Checkpoint file " << checkpoint
+                  << " was written with different settings.\n";
+        return false;
+      }
+      std::vector<ExcLevel> excLevels;
+      std::vector<IonLevel> ionLevels;
+      std::vector<std::pair<unsigned int, std::vector<double> > > points;
+      ReadGasTableRecords(is, excLevels, ionLevels, points);
+      const size_t nValues = 14 + excLevels.size() + ionLevels.size();
+      for (const auto& point : points) {
+        // Skip incomplete records.
+        if (point.first >= nPoints || point.second.size() != nValues) {
+          continue;
+        }
+        if (nDone == 0) SetExcitationIonisationLevels(excLevels, ionLevels);
+        unsigned int i = 0, j = 0, k = 0;
+        split(point.first, i, j, k);
+        SetGasTablePoint(i, j, k, point.second);
+        if (!done[point.first]) ++nDone;
+        done[point.first] = true;
+      }
+    }
+    if (nDone > 0) {
+      outfile.open(checkpoint, std::ios::out | std::ios::app);
+      // Terminate an incomplete last line.
+      if (contents.back() != '\n') outfile << "\n";
+      std::cout << hdr << "Read " << nDone << " of " << nPoints
+                << " grid points from " << checkpoint << ".\n";
+    } else {
+      outfile.open(checkpoint, std::ios::out | std::ios::trunc);
+      outfile << header << "\n";
+    }
+    outfile << std::setprecision(17);
+    outfile.flush();
+    if (!outfile) {
+      std::cerr << hdr << "Could not write to " << checkpoint << ".\n";
+      return false;
+    }
+  }
+
+  std::deque<unsigned int> queue;
+  for (unsigned int p = 0; p < nPoints; ++p) {
+    if (!done[p]) queue.push_back(p);
+  }
+  std::vector<unsigned int> attempts(nPoints, 0);
+  constexpr unsigned int maxAttempts = 3;
+  const unsigned int nMax =
+      nWorkers > 0 ? nWorkers
+                   : std::max(std::thread::hardware_concurrency(), 1u);
+
+  typedef std::chrono::steady_clock Clock;
+  struct Worker {
+    pid_t pid;
+    int fd;
+    unsigned int point;
+    std::string output;
+    Clock::time_point start;
+  };
+  // Time [s] since a worker was started.
+  auto elapsed = [](const Worker& worker) {
+    return std::chrono::duration<double>(Clock::now() - worker.start).count();
+  };
+  std::vector<Worker> workers;
+  while (!queue.empty() || !workers.empty()) {
+    // Start new workers.
+    while (!queue.empty() && workers.size() < nMax) {
+      const unsigned int p = queue.front();
+      int fds[2];
+      if (pipe(fds) != 0) break;
+      std::cout.flush();
+      std::cerr.flush();
+      std::fflush(nullptr);
+      const pid_t pid = fork();
+      if (pid < 0) {
+        close(fds[0]);
+        close(fds[1]);
+        break;
+      }
+      if (pid == 0) {
+        // Worker process: run Magboltz and send the results to the parent.
+        close(fds[0]);
+        for (const auto& worker : workers) close(worker.fd);
+        if (!verbose) {
+          const int null = open("/dev/null", O_WRONLY);
+          if (null >= 0) {
+            dup2(null, STDOUT_FILENO);
+            close(null);
+          }
+        }
+        unsigned int i = 0, j = 0, k = 0;
+        split(p, i, j, k);
+        std::vector<double> val;
+        std::vector<ExcLevel> excLevels;
+        std::vector<IonLevel> ionLevels;
+        RunGasTablePoint(m_eFields[i], m_bFields[k], m_bAngles[j], numColl,
+                         verbose, val, excLevels, ionLevels);
+        std::ostringstream os;
+        os << std::setprecision(17);
+        for (const auto& exc : excLevels) {
+          os << "E " << exc.energy << " " << exc.label << "\n";
+        }
+        for (const auto& ion : ionLevels) {
+          os << "I " << ion.energy << " " << ion.label << "\n";
+        }
+        os << "P " << p << " " << val.size();
+        for (const double v : val) os << " " << v;
+        os << "\n";
+        const std::string out = os.str();
+        size_t nWritten = 0;
+        while (nWritten < out.size()) {
+          const ssize_t n =
+              write(fds[1], out.data() + nWritten, out.size() - nWritten);
+          if (n < 0 && errno == EINTR) continue;
+          if (n <= 0) _exit(1);
+          nWritten += n;
+        }
+        _exit(0);
+      }
+      close(fds[1]);
+      queue.pop_front();
+      ++attempts[p];
+      workers.push_back({pid, fds[0], p, "", Clock::now()});
+    }
+    if (workers.empty()) {
+      std::cerr << hdr << "Could not start a worker process.\n";
+      break;
+    }
+
+    // Collect the output of the workers, waiting at most until the
+    // first worker reaches the time limit.
+    std::vector<pollfd> pfds;
+    for (const auto& worker : workers) pfds.push_back({worker.fd, POLLIN, 0});
+    int wait = -1;
+    if (timeout > 0.) {
+      double left = timeout;
+      for (const auto& worker : workers) {
+        left = std::min(left, timeout - elapsed(worker));
+      }
+      wait = static_cast<int>(std::ceil(1000. * std::max(left, 0.)));
+      wait = std::min(wait, std::numeric_limits<int>::max() / 2);
+    }
+    if (poll(pfds.data(), pfds.size(), wait) < 0) {
+      if (errno == EINTR) continue;
+      std::cerr << hdr << "Error waiting for the worker processes.\n";
+      break;
+    }
+    for (size_t iw = workers.size(); iw-- > 0;) {
+      Worker& worker = workers[iw];
+      bool timedOut = false;
+      if (pfds[iw].revents == 0) {
+        if (timeout <= 0. || elapsed(worker) < timeout) continue;
+        // The worker is hung (or too slow); stop it.
+        kill(worker.pid, SIGKILL);
+        timedOut = true;
+      } else {
+        char buffer[4096];
+        const ssize_t n = read(worker.fd, buffer, sizeof(buffer));
+        if (n > 0) {
+          worker.output.append(buffer, n);
+          continue;
+        }
+        if (n < 0 && errno == EINTR) continue;
+      }
+      // The worker has finished (or crashed, or has been stopped).
+      close(worker.fd);
+      int status = 0;
+      while (waitpid(worker.pid, &status, 0) < 0 && errno == EINTR) {
+      }
+      const unsigned int p = worker.point;
+      unsigned int i = 0, j = 0, k = 0;
+      split(p, i, j, k);
+      std::vector<ExcLevel> excLevels;
+      std::vector<IonLevel> ionLevels;
+      std::vector<std::pair<unsigned int, std::vector<double> > > points;
+      std::istringstream is(worker.output);
+      ReadGasTableRecords(is, excLevels, ionLevels, points);
+      bool ok = !timedOut && WIFEXITED(status) && WEXITSTATUS(status) == 0 &&
+                points.size() == 1 && points[0].first == p;
+      if (ok && nDone == 0) {
+        SetExcitationIonisationLevels(excLevels, ionLevels);
+        if (outfile.is_open()) {
+          for (const auto& exc : m_excLevels) {
+            outfile << "E " << exc.energy << " " << exc.label << "\n";
+          }
+          for (const auto& ion : m_ionLevels) {
+            outfile << "I " << ion.energy << " " << ion.label << "\n";
+          }
+        }
+      }
+      ok = ok && points[0].second.size() ==
+                     14 + m_excLevels.size() + m_ionLevels.size();
+      if (ok) {
+        SetGasTablePoint(i, j, k, points[0].second);
+        done[p] = true;
+        ++nDone;
+        if (outfile.is_open()) {
+          outfile << "P " << p << " " << points[0].second.size();
+          for (const double v : points[0].second) outfile << " " << v;
+          outfile << "\n";
+          outfile.flush();
+        }
+        std::cout << hdr << "E = " << m_eFields[i] << " V/cm, B = "
+                  << m_bFields[k] << " T, angle: " << m_bAngles[j]
+                  << " rad (" << nDone << "/" << nPoints << ")\n";
+      } else if (attempts[p] < maxAttempts) {
+        std::cerr << hdr << "Worker for E = " << m_eFields[i]
+                  << " V/cm, B = " << m_bFields[k] << " T, angle: "
+                  << m_bAngles[j] << " rad "
+                  << (timedOut ? "timed out" : "failed") << ". Retrying.\n";
+        queue.push_back(p);
+      } else {
+        std::cerr << hdr << "Worker for E = " << m_eFields[i]
+                  << " V/cm, B = " << m_bFields[k] << " T, angle: "
+                  << m_bAngles[j] << " rad failed " << maxAttempts
+                  << " times. Giving up.\n";
+      }
+      workers.erase(workers.begin() + iw);
+    }
+  }
+  // Stop the remaining workers (in case of errors).
+  for (const auto& worker : workers) {
+    kill(worker.pid, SIGKILL);
+    close(worker.fd);
+    waitpid(worker.pid, nullptr, 0);
+  }
+
+  // Set the threshold indices.
+  SetThreshold(m_eAlp);
+  SetThreshold(m_eAtt);
+  CompileTables();
+  if (nDone < nPoints) {
+    std::cerr << hdr << nPoints - nDone << " of " << nPoints
+              << " grid points could not be computed.\n";
+    return false;
+  }
+  return true;
+}
+
+void MediumMagboltz::InitGasTable() {
   // Set the reference pressure and temperature.
   m_pressureTable = m_pressure;
   m_temperatureTable = m_temperature;
@@ -3457,9 +3927,14 @@ void MediumMagboltz::GenerateGasTable(const int numColl, const bool verbose) {
   m_ionRates.clear();
   m_excLevels.clear();
   m_ionLevels.clear();
-  std::vector<unsigned int> excLevelIndex;
-  std::vector<unsigned int> ionLevelIndex;
+}
 
+void MediumMagboltz::RunGasTablePoint(const double e, const double b,
+                                      const double a, const int numColl,
+                                      const bool verbose,
+                                      std::vector<double>& val,
+                                      std::vector<ExcLevel>& excLevels,
+                                      std::vector<IonLevel>& ionLevels) {
   double vx = 0., vy = 0., vz = 0.;
   double difl = 0., dift = 0.;
   double alpha = 0., eta = 0.;
@@ -3470,96 +3945,164 @@ void MediumMagboltz::GenerateGasTable(const int numColl, const bool verbose) {
   double alphatof = 0.;
   double lorerr = 0.;
   std::array<double, 6> difftens;
+  RunMagboltz(e, b, a, numColl, verbose, vx, vy, vz, difl, dift, alpha, eta,
+              lor, vxerr, vyerr, vzerr, diflerr, difterr, alphaerr, etaerr,
+              lorerr, alphatof, difftens);
+  val = {vx, vy, vz, difl, dift, lor, alpha, eta};
+  val.insert(val.end(), difftens.begin(), difftens.end());
+
+  // Retrieve the excitation and ionisation levels and rates.
+  excLevels.clear();
+  ionLevels.clear();
+  std::vector<double> excRates;
+  std::vector<double> ionRates;
+  for (long long il = 0; il < Magboltz::nMaxLevels; ++il) {
+    if (Magboltz::large_.iarry[il] <= 0) break;
+    // Skip levels that are not ionisations or inelastic collisions.
+    const int cstype = (Magboltz::large_.iarry[il] - 1) % 5;
+    if (cstype != 1 && cstype != 3) continue;
+    const int igas = int((Magboltz::large_.iarry[il] - 1) / 5);
+    std::string descr = GetDescription(il, Magboltz::scrip_.dscrpt);
+    if (cstype == 3) {
+      // Skip levels that are not excitations.
+      if (!(descr[1] == 'E' && descr[2] == 'X') &&
+          !(descr[0] == 'E' && descr[1] == 'X'))
+        continue;
+    }
+    descr = m_gas[igas] + descr;
+    if (cstype == 3) {
+      ExcLevel exc;
+      exc.label = descr;
+      exc.energy = Magboltz::large_.ein[il];
+      exc.prob = 0.;
+      exc.rms = 0.;
+      exc.dt = 0.;
+      excLevels.push_back(std::move(exc));
+      excRates.push_back(Magboltz::outpt_.icoln[il]);
+    } else {
+      IonLevel ion;
+      ion.label = descr;
+      ion.energy = Magboltz::large_.ein[il];
+      ionLevels.push_back(std::move(ion));
+      ionRates.push_back(Magboltz::outpt_.icoln[il]);
+    }
+  }
+  val.insert(val.end(), excRates.begin(), excRates.end());
+  val.insert(val.end(), ionRates.begin(), ionRates.end());
+}
 
-  // Run through the grid of E- and B-fields and angles.
-  for (unsigned int i = 0; i < nEfields; ++i) {
-    const double e = m_eFields[i];
-    for (unsigned int j = 0; j < nAngles; ++j) {
-      const double a = m_bAngles[j];
-      for (unsigned int k = 0; k < nBfields; ++k) {
-        const double b = m_bFields[k];
-        std::cout << m_className << "::GenerateGasTable: E = " << e
-                  << " V/cm, B = " << b << " T, angle: " << a << " rad\n";
-        RunMagboltz(e, b, a, numColl, verbose, vx, vy, vz, difl, dift, alpha,
-                    eta, lor, vxerr, vyerr, vzerr, diflerr, difterr, alphaerr,
-                    etaerr, lorerr, alphatof, difftens);
-        m_eVelE[j][k][i] = vz;
-        m_eVelX[j][k][i] = vy;
-        m_eVelB[j][k][i] = vx;
-        m_eDifL[j][k][i] = difl;
-        m_eDifT[j][k][i] = dift;
-        m_eLor[j][k][i] = lor;
-        m_eAlp[j][k][i] = alpha > 0. ? log(alpha) : -30.;
-        m_eAlp0[j][k][i] = alpha > 0. ? log(alpha) : -30.;
-        m_eAtt[j][k][i] = eta > 0. ? log(eta) : -30.;
-        for (unsigned int l = 0; l < 6; ++l) {
-          m_eDifM[l][j][k][i] = difftens[l];
-        }
-        // If not done yet, retrieve the excitation and ionisation levels.
-        if (m_excLevels.empty() && m_ionLevels.empty()) {
-          for (long long il = 0; il < Magboltz::nMaxLevels; ++il) {
-            if (Magboltz::large_.iarry[il] <= 0) break;
-            // Skip levels that are not ionisations or inelastic collisions.
-            const int cstype = (Magboltz::large_.iarry[il] - 1) % 5;
-            if (cstype != 1 && cstype != 3) continue;
-            const int igas = int((Magboltz::large_.iarry[il] - 1) / 5);
-            std::string descr = GetDescription(il, Magboltz::scrip_.dscrpt);
-            if (cstype == 3) {
-              // Skip levels that are not excitations.
-              if (!(descr[1] == 'E' && descr[2] == 'X') &&
-                  !(descr[0] == 'E' && descr[1] == 'X'))
-                continue;
-            }
-            descr = m_gas[igas] + descr;
-            if (cstype == 3) {
-              ExcLevel exc;
-              exc.label = descr;
-              exc.energy = Magboltz::large_.ein[il];
-              exc.prob = 0.;
-              exc.rms = 0.;
-              exc.dt = 0.;
-              m_excLevels.push_back(std::move(exc));
-              excLevelIndex.push_back(il);
-            } else {
-              IonLevel ion;
-              ion.label = descr;
-              ion.energy = Magboltz::large_.ein[il];
-              m_ionLevels.push_back(std::move(ion));
-              ionLevelIndex.push_back(il);
-            }
-          }
-          std::cout << m_className << "::GenerateGasTable: Found "
-                    << m_excLevels.size() << " excitations and "
-                    << m_ionLevels.size() << " ionisations.\n";
-          for (const auto& exc : m_excLevels) {
-            std::cout << "    " << exc.label << ", energy = " << exc.energy
-                      << " eV.\n";
-          }
-          for (const auto& ion : m_ionLevels) {
-            std::cout << "    " << ion.label << ", energy = " << ion.energy
-                      << " eV.\n";
-          }
-          Init(nEfields, nBfields, nAngles, m_excLevels.size(),
-               m_excRates, 0.);
-          Init(nEfields, nBfields, nAngles, m_ionLevels.size(),
-               m_ionRates, 0.);
-        }
-        // Retrieve the excitation and ionisation rates.
-        const unsigned int nExc = m_excLevels.size();
-        for (unsigned int ie = 0; ie < nExc; ++ie) {
-          const unsigned int level = excLevelIndex[ie];
-          m_excRates[ie][j][k][i] = Magboltz::outpt_.icoln[level];
-        }
-        const unsigned int nIon = m_ionLevels.size();
-        for (unsigned int ii = 0; ii < nIon; ++ii) {
-          const unsigned int level = ionLevelIndex[ii];
-          m_ionRates[ii][j][k][i] = Magboltz::outpt_.icoln[level];
-        }
+void MediumMagboltz::SetExcitationIonisationLevels(
+    const std::vector<ExcLevel>& excLevels,
+    const std::vector<IonLevel>& ionLevels) {
+  m_excLevels = excLevels;
+  m_ionLevels = ionLevels;
+  std::cout << m_className << "::GenerateGasTable: Found "
+            << m_excLevels.size() << " excitations and "
+            << m_ionLevels.size() << " ionisations.\n";
+  for (const auto& exc : m_excLevels) {
+    std::cout << "    " << exc.label << ", energy = " << exc.energy
+              << " eV.\n";
+  }
+  for (const auto& ion : m_ionLevels) {
+    std::cout << "    " << ion.label << ", energy = " << ion.energy
+              << " eV.\n";
+  }
+  Init(m_eFields.size(), m_bFields.size(), m_bAngles.size(),
+       m_excLevels.size(), m_excRates, 0.);
+  Init(m_eFields.size(), m_bFields.size(), m_bAngles.size(),
+       m_ionLevels.size(), m_ionRates, 0.);
+}
+
+void MediumMagboltz::SetGasTablePoint(const unsigned int i,
+                                      const unsigned int j,
+                                      const unsigned int k,
+                                      const std::vector<double>& val) {
+  // Values: velocity (B, ExB, E), diffusion (L, T), Lorentz angle,
+  // Townsend and attachment coefficients, diffusion tensor,
+  // excitation rates, ionisation rates.
+  m_eVelB[j][k][i] = val[0];
+  m_eVelX[j][k][i] = val[1];
+  m_eVelE[j][k][i] = val[2];
+  m_eDifL[j][k][i] = val[3];
+  m_eDifT[j][k][i] = val[4];
+  m_eLor[j][k][i] = val[5];
+  const double alpha = val[6];
+  const double eta = val[7];
+  m_eAlp[j][k][i] = alpha > 0. ? log(alpha) : -30.;
+  m_eAlp0[j][k][i] = alpha > 0. ? log(alpha) : -30.;
+  m_eAtt[j][k][i] = eta > 0. ? log(eta) : -30.;
+  for (unsigned int l = 0; l < 6; ++l) {
+    m_eDifM[l][j][k][i] = val[8 + l];
+  }
+  const unsigned int nExc = m_excLevels.size();
+  for (unsigned int ie = 0; ie < nExc; ++ie) {
+    m_excRates[ie][j][k][i] = val[14 + ie];
+  }
+  const unsigned int nIon = m_ionLevels.size();
+  for (unsigned int ii = 0; ii < nIon; ++ii) {
+    m_ionRates[ii][j][k][i] = val[14 + nExc + ii];
+  }
+}
+
+std::string MediumMagboltz::GetGasTableHeader(const int numColl) const {
+  // Settings which determine the results of a gas table calculation.
+  std::ostringstream os;
+  os << std::setprecision(17) << "Garfield++ gas table checkpoint, "
+     << numColl << " collisions, p = " << m_pressure
+     << ", T = " << m_temperature << ", gas motion: " << m_useGasMotion
+     << ", gases:";
+  for (unsigned int i = 0; i < m_nComponents; ++i) {
+    os << " " << m_gas[i] << " " << m_fraction[i];
+  }
+  os << ", E:";
+  for (const double e : m_eFields) os << " " << e;
+  os << ", B:";
+  for (const double b : m_bFields) os << " " << b;
+  os << ", angles:";
+  for (const double a : m_bAngles) os << " " << a;
+  return os.str();
+}
+
+void MediumMagboltz::ReadGasTableRecords(
+    std::istream& is, std::vector<ExcLevel>& excLevels,
+    std::vector<IonLevel>& ionLevels,
+    std::vector<std::pair<unsigned int, std::vector<double> > >& points) {
+  // Excitation ("E") and ionisation ("I") levels (energy, label)
+  // and results ("P") of grid points (index, number of values, values).
+  std::string line;
+  while (std::getline(is, line)) {
+    std::istringstream data(line);
+    char type = 0;
+    data >> type;
+    if (type == 'E' || type == 'I') {
+      double energy = 0.;
+      std::string label;
+      if (!(data >> energy) || data.get() != ' ') continue;
+      std::getline(data, label);
+      if (type == 'E') {
+        ExcLevel exc;
+        exc.label = label;
+        exc.energy = energy;
+        exc.prob = 0.;
+        exc.rms = 0.;
+        exc.dt = 0.;
+        excLevels.push_back(std::move(exc));
+      } else {
+        IonLevel ion;
+        ion.label = label;
+        ion.energy = energy;
+        ionLevels.push_back(std::move(ion));
       }
+    } else if (type == 'P') {
+      unsigned int index = 0;
+      size_t n = 0;
+      if (!(data >> index >> n)) continue;
+      std::vector<double> val(n, 0.);
+      size_t nRead = 0;
+      while (nRead < n && data >> val[nRead]) ++nRead;
+      if (nRead < n) continue;
+      points.emplace_back(index, std::move(val));
     }
   }
-  // Set the threshold indices.
-  SetThreshold(m_eAlp);
-  SetThreshold(m_eAtt);
 }
 }
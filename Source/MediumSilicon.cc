@@ -2,6 +2,7 @@
 #include <cmath>
 #include <fstream>
 #include <iostream>
+#include <limits>
 #include <sstream>
 
 #include "FundamentalConstants.hh"
@@ -10,6 +11,41 @@
 #include "Random.hh"
 #include "Utilities.hh"
 
+namespace {
+
+// Max. values of a rate table (looked up with the bin index clamped to
+// [iMin, n - 1]) below the upper edge of each band of nBins bins.
+std::vector<double> GetNullCollisionRates(const std::vector<double>& cf,
+                                          const int iMin, const int nBins) {
+  const int n = cf.size();
+  const int nBands = n / nBins;
+  std::vector<double> bounds(nBands, 0.);
+  double cfMax = 0.;
+  int i = iMin;
+  for (int k = 0; k < nBands; ++k) {
+    // Include the first bin of the next band.
+    const int last = std::min(std::max((k + 1) * nBins, iMin), n - 1);
+    for (; i <= last; ++i) cfMax = std::max(cfMax, cf[i]);
+    bounds[k] = cfMax;
+  }
+  return bounds;
+}
+
+double GetNullCollisionRate(const std::vector<double>& bounds,
+                            const double width, const double e,
+                            const double cfNull, double& emax) {
+  const unsigned int nBands = bounds.size();
+  unsigned int k = e > 0. ? std::min(e / width, double(nBands)) : 0;
+  if (k < nBands && (k + 1) * width <= e) ++k;
+  if (k >= nBands) {
+    emax = std::numeric_limits<double>::max();
+    return cfNull;
+  }
+  emax = (k + 1) * width;
+  return bounds[k];
+}
+}
+
 namespace Garfield {
 
 MediumSilicon::MediumSilicon()
@@ -730,6 +766,34 @@ double MediumSilicon::GetElectronNullCollisionRate(const int band) {
   return 0.;
 }
 
+double MediumSilicon::GetElectronNullCollisionRate(const double e,
+                                                   const int band,
+                                                   double& emax) {
+  if (m_isChanged) {
+    if (!UpdateTransportParameters()) {
+      std::cerr << m_className << "::GetElectronNullCollisionRate:\n"
+                << "    Error calculating the collision rates table.\n";
+      return 0.;
+    }
+    m_isChanged = false;
+  }
+
+  const double widthXL = nBinsNullBand * m_eStepXL;
+  if (band >= 0 && band < m_nValleysX) {
+    return GetNullCollisionRate(m_cfNullBandsX, widthXL, e,
+                                m_cfNullElectronsX, emax);
+  } else if (band >= m_nValleysX && band < m_nValleysX + m_nValleysL) {
+    return GetNullCollisionRate(m_cfNullBandsL, widthXL, e,
+                                m_cfNullElectronsL, emax);
+  } else if (band == m_nValleysX + m_nValleysL) {
+    return GetNullCollisionRate(m_cfNullBandsG, nBinsNullBand * m_eStepG, e,
+                                m_cfNullElectronsG, emax);
+  }
+  std::cerr << m_className << "::GetElectronNullCollisionRate:\n"
+            << "    Band index (" << band << ") out of range.\n";
+  return 0.;
+}
+
 double MediumSilicon::GetElectronCollisionRate(const double e, const int band) {
   if (e <= 0.) {
     std::cerr << m_className << "::GetElectronCollisionRate:\n"
@@ -737,7 +801,7 @@ double MediumSilicon::GetElectronCollisionRate(const double e, const int band) {
     return 0.;
   }
 
-  if (e > m_eFinalG) {
+  if (e > m_eFinalG && !m_frozen) {
     std::cerr << m_className << "::GetElectronCollisionRate:\n"
               << "    Collision rate at " << e << " eV (band " << band
               << ") is not included in the current table.\n"
@@ -782,11 +846,30 @@ double MediumSilicon::GetElectronCollisionRate(const double e, const int band) {
   return 0.;
 }
 
+double MediumSilicon::FreezeMicroscopicTables(const double emax) {
+  m_frozen = false;
+  if (emax > m_eFinalG) {
+    std::cerr << m_className << "::FreezeMicroscopicTables:\n"
+              << "    Increasing energy range to " << 1.05 * emax << " eV.\n";
+    SetMaxElectronEnergy(1.05 * emax);
+  }
+  if (m_isChanged) {
+    if (!UpdateTransportParameters()) {
+      std::cerr << m_className << "::FreezeMicroscopicTables:\n"
+                << "    Error calculating the collision rates table.\n";
+      return 0.;
+    }
+    m_isChanged = false;
+  }
+  m_frozen = true;
+  return m_eFinalG;
+}
+
 bool MediumSilicon::GetElectronCollision(
     const double e, int& type, int& level, double& e1, double& px, double& py,
     double& pz, std::vector<std::pair<int, double> >& secondaries, int& ndxc,
     int& band) {
-  if (e > m_eFinalG) {
+  if (e > m_eFinalG && !m_frozen) {
     std::cerr << m_className << "::GetElectronCollision:\n"
               << "    Requested electron energy (" << e << " eV) exceeds the "
               << "current energy range (" << m_eFinalG << " eV).\n"
@@ -1110,9 +1193,11 @@ void MediumSilicon::ResetCollisionCounters() {
   m_nCollElectronImpurity = 0;
   m_nCollElectronIonisation = 0;
   const auto nLevels = m_nLevelsX + m_nLevelsL + m_nLevelsG;
-  m_nCollElectronDetailed.assign(nLevels, 0);
+  m_nCollElectronDetailed = std::vector<Counter>(nLevels);
+  for (auto& n : m_nCollElectronDetailed) n = 0;
   const auto nBands = m_nValleysX + m_nValleysL + 1;
-  m_nCollElectronBand.assign(nBands, 0);
+  m_nCollElectronBand = std::vector<Counter>(nBands);
+  for (auto& n : m_nCollElectronBand) n = 0;
 }
 
 unsigned int MediumSilicon::GetNumberOfElectronCollisions() const {
@@ -1339,6 +1424,7 @@ bool MediumSilicon::UpdateTransportParameters() {
 
   if (!ElectronScatteringRates()) return false;
   if (!HoleScatteringRates()) return false;
+  ++m_revision;
 
   // Reset the collision counters.
   ResetCollisionCounters();
@@ -1968,6 +2054,9 @@ bool MediumSilicon::ElectronScatteringRates() {
     outfileX.close();
     outfileL.close();
   }
+  m_cfNullBandsX = GetNullCollisionRates(m_cfTotElectronsX, 0, nBinsNullBand);
+  m_cfNullBandsL =
+      GetNullCollisionRates(m_cfTotElectronsL, m_ieMinL, nBinsNullBand);
 
   std::ofstream outfileG;
   if (m_cfOutput) {
@@ -2006,6 +2095,8 @@ bool MediumSilicon::ElectronScatteringRates() {
   if (m_cfOutput) {
     outfileG.close();
   }
+  m_cfNullBandsG =
+      GetNullCollisionRates(m_cfTotElectronsG, m_ieMinG, nBinsNullBand);
 
   return true;
 }
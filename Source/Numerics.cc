@@ -1,6 +1,8 @@
+#include <algorithm>
 #include <cmath>
 #include <iostream>
 
+#include "FundamentalConstants.hh"
 #include "Numerics.hh"
 
 namespace Garfield {
@@ -1218,5 +1220,54 @@ bool Boxin3(const std::vector<std::vector<std::vector<double> > >& value,
   // std::cout << f << std::endl;
   return true;
 }
+
+void FFT::SetSize(const size_t n) {
+  m_n = 1;
+  unsigned int nBits = 0;
+  while (m_n < n) {
+    m_n <<= 1;
+    ++nBits;
+  }
+  m_permutation.resize(m_n);
+  for (size_t i = 0; i < m_n; ++i) {
+    size_t j = 0;
+    for (unsigned int b = 0; b < nBits; ++b) {
+      if (i & (size_t(1) << b)) j |= size_t(1) << (nBits - 1 - b);
+    }
+    m_permutation[i] = j;
+  }
+  m_twiddle.resize(m_n / 2);
+  for (size_t k = 0; k < m_n / 2; ++k) {
+    const double phi = -TwoPi * double(k) / m_n;
+    m_twiddle[k] = std::complex<double>(cos(phi), sin(phi));
+  }
+}
+
+void FFT::Inverse(std::complex<double>* a) const {
+  Transform(a, true);
+  const double scale = 1. / m_n;
+  for (size_t i = 0; i < m_n; ++i) a[i] *= scale;
+}
+
+void FFT::Transform(std::complex<double>* a, const bool inverse) const {
+  for (size_t i = 0; i < m_n; ++i) {
+    const size_t j = m_permutation[i];
+    if (i < j) std::swap(a[i], a[j]);
+  }
+  for (size_t len = 2; len <= m_n; len <<= 1) {
+    const size_t half = len / 2;
+    const size_t step = m_n / len;
+    for (size_t i = 0; i < m_n; i += len) {
+      for (size_t k = 0; k < half; ++k) {
+        const std::complex<double> w =
+            inverse ? std::conj(m_twiddle[k * step]) : m_twiddle[k * step];
+        const std::complex<double> u = a[i + k];
+        const std::complex<double> v = a[i + k + half] * w;
+        a[i + k] = u + v;
+        a[i + k + half] = u - v;
+      }
+    }
+  }
+}
 }
 }
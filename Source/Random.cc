@@ -83,6 +83,12 @@ double denlan(const double v) {
 }
 namespace Garfield {
 
+thread_local RandomEngine* threadRandomEngine = nullptr;
+
+void SetThreadRandomEngine(RandomEngine* engine) {
+  threadRandomEngine = engine;
+}
+
 double RndmLandau() {
   const double f[] = {
       0,         0,         0,         0,         0,         -2.244733,
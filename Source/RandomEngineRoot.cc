@@ -11,6 +11,7 @@ RandomEngineRoot::~RandomEngineRoot() {}
 
 void RandomEngineRoot::Seed(const unsigned int s) {
   m_rng.SetSeed(s);
+  ResetGaussianCache();
   std::cout << "RandomEngineRoot::Seed:\n"
             << "    Seed: " << m_rng.GetSeed() << "\n";
 }
@@ -0,0 +1,79 @@
+#include <iostream>
+
+#include "RandomEngineXoshiro.hh"
+
+namespace {
+
+uint64_t SplitMix64(uint64_t& x) {
+  uint64_t z = (x += 0x9e3779b97f4a7c15ULL);
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+  return z ^ (z >> 31);
+}
+
+}
+
+namespace Garfield {
+
+RandomEngineXoshiro::RandomEngineXoshiro() : RandomEngine() {
+  SetStream(0, 0, 0);
+}
+
+RandomEngineXoshiro::RandomEngineXoshiro(const uint64_t seed,
+                                         const uint64_t event,
+                                         const uint64_t thread)
+    : RandomEngine() {
+  SetStream(seed, event, thread);
+}
+
+void RandomEngineXoshiro::SetStream(const uint64_t seed, const uint64_t event,
+                                    const uint64_t thread) {
+  m_seed = seed;
+  m_event = event;
+  m_thread = thread;
+  // Hash the three keys into one 64-bit word, chaining SplitMix64 such that
+  // each key affects all bits of the result.
+  uint64_t h = seed;
+  h = SplitMix64(h) ^ event;
+  h = SplitMix64(h) ^ thread;
+  h = SplitMix64(h);
+  // Fill the state with the SplitMix64 sequence starting from the hash.
+  for (unsigned int i = 0; i < 4; ++i) m_s[i] = SplitMix64(h);
+  // An all-zero state is not allowed.
+  if ((m_s[0] | m_s[1] | m_s[2] | m_s[3]) == 0) m_s[0] = 1;
+  ResetGaussianCache();
+}
+
+void RandomEngineXoshiro::Jump() {
+  static const uint64_t poly[4] = {0x180ec6d33cfd0abaULL, 0xd5a61266f0c9392cULL,
+                                   0xa9582618e03fc9aaULL, 0x39abdc4529b1661cULL};
+  Jump(poly);
+}
+
+void RandomEngineXoshiro::LongJump() {
+  static const uint64_t poly[4] = {0x76e15d3efefdcbbfULL, 0xc5004e441c522fb3ULL,
+                                   0x77710069854ee241ULL, 0x39109bb02acbe635ULL};
+  Jump(poly);
+}
+
+void RandomEngineXoshiro::Jump(const uint64_t poly[4]) {
+  uint64_t s[4] = {0, 0, 0, 0};
+  for (unsigned int i = 0; i < 4; ++i) {
+    for (unsigned int b = 0; b < 64; ++b) {
+      if (poly[i] & (uint64_t(1) << b)) {
+        for (unsigned int j = 0; j < 4; ++j) s[j] ^= m_s[j];
+      }
+      Next();
+    }
+  }
+  for (unsigned int j = 0; j < 4; ++j) m_s[j] = s[j];
+  ResetGaussianCache();
+}
+
+void RandomEngineXoshiro::Print() {
+  std::cout << "RandomEngineXoshiro::Print:\n"
+            << "    Generator type: xoshiro256**\n"
+            << "    Seed: " << m_seed << ", event: " << m_event
+            << ", thread: " << m_thread << "\n";
+}
+}
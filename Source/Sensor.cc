@@ -7,6 +7,7 @@
 #include "GarfieldConstants.hh"
 #include "Numerics.hh"
 #include "Plotting.hh"
+#include "Random.hh"
 #include "Sensor.hh"
 
 namespace Garfield {
@@ -70,6 +71,96 @@ void Sensor::ElectricField(const double x, const double y, const double z,
   }
 }
 
+void Sensor::ElectricField(FieldQueryContext& context, const double x,
+                           const double y, const double z, double& ex,
+                           double& ey, double& ez, double& v, Medium*& medium,
+                           int& status) const {
+  ex = ey = ez = v = 0.;
+  status = -10;
+  medium = nullptr;
+  double fx, fy, fz, p;
+  Medium* med = nullptr;
+  int stat;
+  // Add up electric field contributions from all components.
+  for (auto component : m_components) {
+    component->ElectricField(context, x, y, z, fx, fy, fz, p, med, stat);
+    if (status != 0) {
+      status = stat;
+      medium = med;
+    }
+    if (stat == 0) {
+      ex += fx;
+      ey += fy;
+      ez += fz;
+      v += p;
+    }
+  }
+}
+
+void Sensor::ElectricField(FieldQueryContext& context, const double x,
+                           const double y, const double z, double& ex,
+                           double& ey, double& ez, Medium*& medium,
+                           int& status) const {
+  ex = ey = ez = 0.;
+  status = -10;
+  medium = nullptr;
+  double fx, fy, fz;
+  Medium* med = nullptr;
+  int stat;
+  // Add up electric field contributions from all components.
+  for (auto component : m_components) {
+    component->ElectricField(context, x, y, z, fx, fy, fz, med, stat);
+    if (status != 0) {
+      status = stat;
+      medium = med;
+    }
+    if (stat == 0) {
+      ex += fx;
+      ey += fy;
+      ez += fz;
+    }
+  }
+}
+
+void Sensor::ElectricFieldBatch(const size_t n, const double* x,
+                                const double* y, const double* z, double* ex,
+                                double* ey, double* ez, double* v,
+                                Medium** medium, int* status) {
+  if (m_components.size() == 1) {
+    // No need to add up contributions.
+    m_components[0]->ElectricFieldBatch(n, x, y, z, ex, ey, ez, v, medium,
+                                        status);
+    return;
+  }
+  std::fill_n(ex, n, 0.);
+  std::fill_n(ey, n, 0.);
+  std::fill_n(ez, n, 0.);
+  if (v) std::fill_n(v, n, 0.);
+  std::fill_n(medium, n, nullptr);
+  std::fill_n(status, n, -10);
+  if (m_components.empty()) return;
+  std::vector<double> fx(n), fy(n), fz(n), p(v ? n : 0);
+  std::vector<Medium*> med(n, nullptr);
+  std::vector<int> stat(n, 0);
+  // Add up electric field contributions from all components.
+  for (auto component : m_components) {
+    component->ElectricFieldBatch(n, x, y, z, fx.data(), fy.data(), fz.data(),
+                                  v ? p.data() : nullptr, med.data(),
+                                  stat.data());
+    for (size_t i = 0; i < n; ++i) {
+      if (status[i] != 0) {
+        status[i] = stat[i];
+        medium[i] = med[i];
+      }
+      if (stat[i] != 0) continue;
+      ex[i] += fx[i];
+      ey[i] += fy[i];
+      ez[i] += fz[i];
+      if (v) v[i] += p[i];
+    }
+  }
+}
+
 void Sensor::MagneticField(const double x, const double y, const double z,
                            double& bx, double& by, double& bz, int& status) {
   bx = by = bz = 0.;
@@ -92,7 +183,7 @@ void Sensor::WeightingField(const double x, const double y, const double z,
   for (const auto& electrode : m_electrodes) {
     if (electrode.label == label) {
       double fx = 0., fy = 0., fz = 0.;
-      electrode.comp->WeightingField(x, y, z, fx, fy, fz, label);
+      ElectrodeWeightingField(electrode, x, y, z, fx, fy, fz);
       wx += fx;
       wy += fy;
       wz += fz;
@@ -106,12 +197,26 @@ double Sensor::WeightingPotential(const double x, const double y,
   // Add up contributions from all components.
   for (const auto& electrode : m_electrodes) {
     if (electrode.label == label) {
-      v += electrode.comp->WeightingPotential(x, y, z, label);
+      v += ElectrodeWeightingPotential(electrode, x, y, z);
     }
   }
   return v;
 }
 
+void Sensor::WeightingField(const double x, const double y, const double z,
+                            double& wx, double& wy, double& wz,
+                            const int electrode) {
+  wx = wy = wz = 0.;
+  if (electrode < 0 || electrode >= (int)m_electrodes.size()) return;
+  ElectrodeWeightingField(m_electrodes[electrode], x, y, z, wx, wy, wz);
+}
+
+double Sensor::WeightingPotential(const double x, const double y,
+                                  const double z, const int electrode) {
+  if (electrode < 0 || electrode >= (int)m_electrodes.size()) return 0.;
+  return ElectrodeWeightingPotential(m_electrodes[electrode], x, y, z);
+}
+
 bool Sensor::GetMedium(const double x, const double y, const double z,
                        Medium*& m) {
   m = nullptr;
@@ -120,15 +225,44 @@ bool Sensor::GetMedium(const double x, const double y, const double z,
   if (m_components.empty()) return false;
 
   // Check if we are still in the same component as in the previous call.
-  if (m_lastComponent) {
-    m = m_lastComponent->GetMedium(x, y, z);
+  // The hint is copied, since the components may add slots to the context.
+  const int last = FieldQueryContext::Current().Hint(m_hintSlot);
+  if (last >= 0 && last < (int)m_components.size()) {
+    m = m_components[last]->GetMedium(x, y, z);
     if (m) return true;
   }
 
-  for (auto component : m_components) {
-    m = component->GetMedium(x, y, z);
+  const unsigned int nComponents = m_components.size();
+  for (unsigned int i = 0; i < nComponents; ++i) {
+    m = m_components[i]->GetMedium(x, y, z);
+    if (m) {
+      FieldQueryContext::Current().Hint(m_hintSlot) = i;
+      return true;
+    }
+  }
+  return false;
+}
+
+bool Sensor::GetMedium(FieldQueryContext& context, const double x,
+                       const double y, const double z, Medium*& m) const {
+  m = nullptr;
+
+  // Make sure there is at least one component.
+  if (m_components.empty()) return false;
+
+  // Check if we are still in the same component as in the previous call.
+  // The hint is copied, since the components may add slots to the context.
+  const int last = context.Hint(m_hintSlot);
+  if (last >= 0 && last < (int)m_components.size()) {
+    m = m_components[last]->GetMedium(context, x, y, z);
+    if (m) return true;
+  }
+
+  const unsigned int nComponents = m_components.size();
+  for (unsigned int i = 0; i < nComponents; ++i) {
+    m = m_components[i]->GetMedium(context, x, y, z);
     if (m) {
-      m_lastComponent = component;
+      context.Hint(m_hintSlot) = i;
       return true;
     }
   }
@@ -283,21 +417,306 @@ void Sensor::AddElectrode(ComponentBase* comp, const std::string& label) {
   Electrode electrode;
   electrode.comp = comp;
   electrode.label = label;
-  electrode.signal.resize(m_nTimeBins);
-  electrode.electronsignal.resize(m_nTimeBins);
-  electrode.ionsignal.resize(m_nTimeBins);
+  electrode.handle = -1;
   m_electrodes.push_back(std::move(electrode));
+  m_hasLastLabel = false;
+  if (m_hasSupport) m_supportChanged = true;
   std::cout << m_className << "::AddElectrode:\n"
             << "    Added readout electrode \"" << label << "\".\n"
             << "    All signals are reset.\n";
   ClearSignal();
 }
 
+int Sensor::GetElectrodeHandle(const std::string& label) const {
+  const int nElectrodes = m_electrodes.size();
+  for (int i = 0; i < nElectrodes; ++i) {
+    if (m_electrodes[i].label == label) return i;
+  }
+  return -1;
+}
+
+const std::vector<unsigned int>& Sensor::FindElectrodes(
+    const std::string& label) {
+  if (m_hasLastLabel && label == m_lastLabel) return m_lastLabelElectrodes;
+  m_lastLabel = label;
+  m_lastLabelElectrodes.clear();
+  const unsigned int nElectrodes = m_electrodes.size();
+  for (unsigned int i = 0; i < nElectrodes; ++i) {
+    if (m_electrodes[i].label == label) m_lastLabelElectrodes.push_back(i);
+  }
+  m_hasLastLabel = true;
+  return m_lastLabelElectrodes;
+}
+
+std::string Sensor::GetElectrodeLabel(const int electrode) const {
+  if (electrode < 0 || electrode >= (int)m_electrodes.size()) return "";
+  return m_electrodes[electrode].label;
+}
+
+void Sensor::UpdateElectrodeHandles() {
+  for (auto& electrode : m_electrodes) {
+    electrode.handle = electrode.comp->GetWeightingFieldHandle(electrode.label);
+  }
+}
+
+void Sensor::SetElectrodeBoundingBox(const std::string& label,
+                                     const double xmin, const double ymin,
+                                     const double zmin, const double xmax,
+                                     const double ymax, const double zmax) {
+  bool found = false;
+  for (auto& electrode : m_electrodes) {
+    if (electrode.label != label) continue;
+    electrode.hasBox = true;
+    electrode.box = {{std::min(xmin, xmax), std::min(ymin, ymax),
+                      std::min(zmin, zmax), std::max(xmin, xmax),
+                      std::max(ymin, ymax), std::max(zmin, zmax)}};
+    found = true;
+  }
+  if (!found) {
+    std::cerr << m_className << "::SetElectrodeBoundingBox: Electrode "
+              << label << " not found.\n";
+    return;
+  }
+  m_hasSupport = m_supportChanged = true;
+}
+
+void Sensor::SetElectrodeCutoff(const std::string& label, const double x,
+                                const double y, const double z,
+                                const double r) {
+  if (r <= 0.) {
+    std::cerr << m_className << "::SetElectrodeCutoff: Distance must be > 0.\n";
+    return;
+  }
+  bool found = false;
+  for (auto& electrode : m_electrodes) {
+    if (electrode.label != label) continue;
+    electrode.hasCutoff = true;
+    electrode.centre = {{x, y, z}};
+    electrode.cutoff2 = r * r;
+    found = true;
+  }
+  if (!found) {
+    std::cerr << m_className << "::SetElectrodeCutoff: Electrode " << label
+              << " not found.\n";
+    return;
+  }
+  m_hasSupport = m_supportChanged = true;
+}
+
+bool Sensor::ComputeElectrodeSupport(const double threshold,
+                                     const unsigned int nx,
+                                     const unsigned int ny,
+                                     const unsigned int nz) {
+  const std::string hdr = m_className + "::ComputeElectrodeSupport:";
+  if (m_electrodes.empty()) {
+    std::cerr << hdr << " No electrodes defined.\n";
+    return false;
+  }
+  if (nx == 0 || ny == 0 || nz == 0) {
+    std::cerr << hdr << " Number of cells must be > 0.\n";
+    return false;
+  }
+  double xmin = 0., ymin = 0., zmin = 0.;
+  double xmax = 0., ymax = 0., zmax = 0.;
+  if (!GetArea(xmin, ymin, zmin, xmax, ymax, zmax)) {
+    std::cerr << hdr << " User area not known.\n";
+    return false;
+  }
+  const std::array<double, 3> x0 = {{xmin, ymin, zmin}};
+  const std::array<double, 3> x1 = {{xmax, ymax, zmax}};
+  const std::array<unsigned int, 3> n = {{nx, ny, nz}};
+  std::array<double, 3> d;
+  for (unsigned int i = 0; i < 3; ++i) {
+    if (!(x1[i] > x0[i]) || std::isinf(x1[i] - x0[i])) {
+      std::cerr << hdr << " User area must be finite and non-empty.\n";
+      return false;
+    }
+    d[i] = (x1[i] - x0[i]) / n[i];
+  }
+  UpdateElectrodeHandles();
+
+  // Sample the weighting fields at the corners of the cells.
+  const unsigned int mx = nx + 1, my = ny + 1, mz = nz + 1;
+  const size_t nNodes = size_t(mx) * my * mz;
+  const size_t nCells = size_t(nx) * ny * nz;
+  std::vector<double> w(nNodes, 0.);
+  std::vector<char> flag(nCells, 0);
+  std::vector<std::vector<int> > lists(nCells);
+  const int nElectrodes = m_electrodes.size();
+  double maxError = 0.;
+  int worst = 0;
+  for (int i = 0; i < nElectrodes; ++i) {
+    auto& electrode = m_electrodes[i];
+    for (unsigned int ix = 0; ix < mx; ++ix) {
+      const double x = x0[0] + ix * d[0];
+      for (unsigned int iy = 0; iy < my; ++iy) {
+        const double y = x0[1] + iy * d[1];
+        for (unsigned int iz = 0; iz < mz; ++iz) {
+          const double z = x0[2] + iz * d[2];
+          double wx = 0., wy = 0., wz = 0.;
+          ElectrodeWeightingField(electrode, x, y, z, wx, wy, wz);
+          w[(size_t(ix) * my + iy) * mz + iz] =
+              sqrt(wx * wx + wy * wy + wz * wz);
+        }
+      }
+    }
+    // Keep the cells in which the field exceeds the threshold at a corner.
+    for (unsigned int ix = 0; ix < nx; ++ix) {
+      for (unsigned int iy = 0; iy < ny; ++iy) {
+        for (unsigned int iz = 0; iz < nz; ++iz) {
+          const size_t cell = (size_t(ix) * ny + iy) * nz + iz;
+          flag[cell] = 0;
+          for (unsigned int k = 0; k < 8 && !flag[cell]; ++k) {
+            const size_t node = (size_t(ix + (k & 1)) * my + iy +
+                                 ((k >> 1) & 1)) * mz + iz + (k >> 2);
+            if (w[node] > threshold) flag[cell] = 1;
+          }
+          if (flag[cell]) lists[cell].push_back(i);
+        }
+      }
+    }
+    // Estimate the neglected field at the centres of the cells outside
+    // the support. These points are not used for defining the support,
+    // so the field there can exceed the threshold.
+    double error = 0.;
+    for (unsigned int ix = 0; ix < nx; ++ix) {
+      const double x = x0[0] + (ix + 0.5) * d[0];
+      for (unsigned int iy = 0; iy < ny; ++iy) {
+        const double y = x0[1] + (iy + 0.5) * d[1];
+        for (unsigned int iz = 0; iz < nz; ++iz) {
+          const double z = x0[2] + (iz + 0.5) * d[2];
+          const size_t cell = (size_t(ix) * ny + iy) * nz + iz;
+          if (flag[cell] && IsInBox(electrode, x, y, z)) continue;
+          double wx = 0., wy = 0., wz = 0.;
+          ElectrodeWeightingField(electrode, x, y, z, wx, wy, wz);
+          error = std::max(error, sqrt(wx * wx + wy * wy + wz * wz));
+        }
+      }
+    }
+    electrode.hasMap = true;
+    electrode.cutoffError = error;
+    if (error > maxError) {
+      maxError = error;
+      worst = i;
+    }
+  }
+
+  // Store the lists of electrodes per cell.
+  m_mapOffsets.assign(nCells + 1, 0);
+  for (size_t i = 0; i < nCells; ++i) {
+    m_mapOffsets[i + 1] = m_mapOffsets[i] + lists[i].size();
+  }
+  m_mapElectrodes.clear();
+  m_mapElectrodes.reserve(m_mapOffsets.back());
+  for (const auto& list : lists) {
+    m_mapElectrodes.insert(m_mapElectrodes.end(), list.begin(), list.end());
+  }
+  for (unsigned int i = 0; i < 3; ++i) {
+    m_mapMin[i] = x0[i];
+    m_mapScale[i] = 1. / d[i];
+    m_mapN[i] = n[i];
+  }
+  m_hasSupport = true;
+  UpdateElectrodeSupport();
+
+  std::cout << hdr << "\n    Average number of electrodes per cell: "
+            << double(m_mapElectrodes.size()) / nCells << " (of "
+            << nElectrodes << ").\n"
+            << "    Largest neglected weighting field: " << maxError
+            << " cm-1 (electrode " << m_electrodes[worst].label << ").\n";
+  return true;
+}
+
+void Sensor::ClearElectrodeSupport() {
+  for (auto& electrode : m_electrodes) {
+    electrode.hasBox = electrode.hasCutoff = electrode.hasMap = false;
+    electrode.cutoffError = -1.;
+  }
+  m_hasSupport = m_supportChanged = false;
+  m_unrestricted.clear();
+  m_electrodeGrid.Clear();
+  m_gridElectrodes.clear();
+  m_mapOffsets.clear();
+  m_mapElectrodes.clear();
+}
+
+double Sensor::GetElectrodeCutoffError(const int electrode) const {
+  if (electrode < 0 || electrode >= (int)m_electrodes.size()) return -1.;
+  return m_electrodes[electrode].cutoffError;
+}
+
+void Sensor::UpdateElectrodeSupport() {
+  m_unrestricted.clear();
+  m_gridElectrodes.clear();
+  m_electrodeGrid.Clear();
+  m_hasSupport = false;
+  std::vector<std::array<double, 6> > boxes;
+  const int nElectrodes = m_electrodes.size();
+  for (int i = 0; i < nElectrodes; ++i) {
+    const auto& electrode = m_electrodes[i];
+    if (electrode.hasMap) {
+      m_hasSupport = true;
+      continue;
+    }
+    if (!electrode.hasBox && !electrode.hasCutoff) {
+      m_unrestricted.push_back(i);
+      continue;
+    }
+    m_hasSupport = true;
+    // Intersection of the bounding box and the box around the cutoff sphere.
+    std::array<double, 6> box = electrode.box;
+    if (electrode.hasCutoff) {
+      const double r = sqrt(electrode.cutoff2);
+      for (unsigned int j = 0; j < 3; ++j) {
+        const double b0 = electrode.centre[j] - r;
+        const double b1 = electrode.centre[j] + r;
+        box[j] = electrode.hasBox ? std::max(box[j], b0) : b0;
+        box[j + 3] = electrode.hasBox ? std::min(box[j + 3], b1) : b1;
+      }
+    }
+    boxes.push_back(box);
+    m_gridElectrodes.push_back(i);
+  }
+  if (!boxes.empty()) m_electrodeGrid.Build(boxes, true);
+  m_supportChanged = false;
+}
+
+long Sensor::GetMapCell(const double x, const double y, const double z) const {
+  if (m_mapOffsets.empty()) return -1;
+  const double p[3] = {x, y, z};
+  long cell = 0;
+  for (unsigned int i = 0; i < 3; ++i) {
+    const double u = (p[i] - m_mapMin[i]) * m_mapScale[i];
+    if (!(u >= 0. && u <= m_mapN[i])) return -1;
+    const unsigned int k =
+        std::min(static_cast<unsigned int>(u), m_mapN[i] - 1);
+    cell = cell * m_mapN[i] + k;
+  }
+  return cell;
+}
+
+bool Sensor::IsInSupport(const int i, const double x, const double y,
+                         const double z) const {
+  const auto& electrode = m_electrodes[i];
+  if (!IsInBox(electrode, x, y, z)) return false;
+  if (!electrode.hasMap) return true;
+  const long cell = GetMapCell(x, y, z);
+  if (cell < 0) return false;
+  return std::binary_search(m_mapElectrodes.begin() + m_mapOffsets[cell],
+                            m_mapElectrodes.begin() + m_mapOffsets[cell + 1],
+                            i);
+}
+
 void Sensor::Clear() {
   m_components.clear();
-  m_lastComponent = nullptr;
+  FieldQueryContext::Current().Hint(m_hintSlot) = -1;
   m_electrodes.clear();
+  m_hasLastLabel = false;
+  ClearElectrodeSupport();
+  m_charge.clear();
+  m_fTransferFFT.clear();
   m_nTimeBins = 200;
+  m_signals.Reset(0, m_nTimeBins);
   m_tStart = 0.;
   m_tStep = 10.;
   m_nEvents = 0;
@@ -337,13 +756,12 @@ bool Sensor::GetVoltageRange(double& vmin, double& vmax) {
 }
 
 void Sensor::ClearSignal() {
-  for (auto& electrode : m_electrodes) {
-    electrode.charge = 0.;
-    electrode.signal.assign(m_nTimeBins, 0.);
-    electrode.electronsignal.assign(m_nTimeBins, 0.);
-    electrode.ionsignal.assign(m_nTimeBins, 0.);
-  }
+  m_signals.Reset(m_electrodes.size(), m_nTimeBins);
+  m_charge.assign(m_electrodes.size(), 0.);
   m_nEvents = 0;
+  // The weighting fields may have been (re)loaded in the meantime.
+  UpdateElectrodeHandles();
+  if (m_supportChanged) UpdateElectrodeSupport();
 }
 
 void Sensor::AddSignal(const double q, const double t, const double dt,
@@ -351,31 +769,23 @@ void Sensor::AddSignal(const double q, const double t, const double dt,
                        const double vx, const double vy, const double vz) {
   if (m_debug) std::cout << m_className << "::AddSignal:\n";
   // Get the time bin.
-  if (t < m_tStart || dt <= 0.) {
-    if (m_debug) {
-      if (t < m_tStart) std::cout << "  Time " << t << " out of range.\n";
-      if (dt <= 0.) std::cout << "  Time step < 0.\n";
-    }
-    return;
-  }
-  const int bin = int((t - m_tStart) / m_tStep);
-  // Check if the starting time is outside the range
-  if (bin < 0 || bin >= (int)m_nTimeBins) {
-    if (m_debug) std::cout << "  Bin " << bin << " out of range.\n";
-    return;
-  }
+  const int bin = GetSignalBin(t, dt);
+  if (bin < 0) return;
   if (m_nEvents <= 0) m_nEvents = 1;
+  if (m_supportChanged) UpdateElectrodeSupport();
 
-  double wx = 0., wy = 0., wz = 0.;
   if (m_debug) {
     std::cout << "  Time: " << t << "\n"
               << "  Step: " << dt << "\n"
               << "  Charge: " << q << "\n"
               << "  Velocity: (" << vx << ", " << vy << ", " << vz << ")\n";
   }
-  for (auto& electrode : m_electrodes) {
+  const auto c = q < 0 ? SignalStore::Electron : SignalStore::Ion;
+  ForEachElectrode(x, y, z, [&](const int i) {
+    const auto& electrode = m_electrodes[i];
     // Calculate the weighting field for this electrode
-    electrode.comp->WeightingField(x, y, z, wx, wy, wz, electrode.label);
+    double wx = 0., wy = 0., wz = 0.;
+    ElectrodeWeightingField(electrode, x, y, z, wx, wy, wz);
     // Calculate the induced current
     const double cur = -q * (wx * vx + wy * vy + wz * vz);
     if (m_debug) {
@@ -383,43 +793,126 @@ void Sensor::AddSignal(const double q, const double t, const double dt,
                 << "    Weighting field: (" << wx << ", " << wy << ", " << wz
                 << ")\n    Induced charge: " << cur * dt << "\n";
     }
-    double delta = m_tStart + (bin + 1) * m_tStep - t;
-    // Check if the provided timestep extends over more than one time bin
-    if (dt > delta) {
-      electrode.signal[bin] += cur * delta;
-      if (q < 0) {
-        electrode.electronsignal[bin] += cur * delta;
-      } else {
-        electrode.ionsignal[bin] += cur * delta;
-      }
-      delta = dt - delta;
-      unsigned int j = 1;
-      while (delta > m_tStep && bin + j < m_nTimeBins) {
-        electrode.signal[bin + j] += cur * m_tStep;
-        if (q < 0) {
-          electrode.electronsignal[bin + j] += cur * m_tStep;
-        } else {
-          electrode.ionsignal[bin + j] += cur * m_tStep;
-        }
-        delta -= m_tStep;
-        ++j;
-      }
-      if (bin + j < m_nTimeBins) {
-        electrode.signal[bin + j] += cur * delta;
-        if (q < 0) {
-          electrode.electronsignal[bin + j] += cur * delta;
-        } else {
-          electrode.ionsignal[bin + j] += cur * delta;
-        }
-      }
-    } else {
-      electrode.signal[bin] += cur * dt;
-      if (q < 0) {
-        electrode.electronsignal[bin] += cur * dt;
-      } else {
-        electrode.ionsignal[bin] += cur * dt;
-      }
+    FillSignal(m_signals, i, c, t, dt, bin, cur);
+  });
+}
+
+void Sensor::ComputeInducedCurrents(const double q, const double x,
+                                    const double y, const double z,
+                                    const double vx, const double vy,
+                                    const double vz, double* currents) const {
+  std::fill(currents, currents + m_electrodes.size(), 0.);
+  ForEachElectrode(x, y, z, [&](const int i) {
+    double wx = 0., wy = 0., wz = 0.;
+    ElectrodeWeightingField(m_electrodes[i], x, y, z, wx, wy, wz);
+    currents[i] = -q * (wx * vx + wy * vy + wz * vz);
+  });
+}
+
+void Sensor::AddSignal(const double q, const double t, const double dt,
+                       const double* currents) {
+  const int bin = GetSignalBin(t, dt);
+  if (bin < 0) return;
+  if (m_nEvents <= 0) m_nEvents = 1;
+  const unsigned int nElectrodes = m_electrodes.size();
+  const auto c = q < 0 ? SignalStore::Electron : SignalStore::Ion;
+  for (unsigned int i = 0; i < nElectrodes; ++i) {
+    if (currents[i] == 0.) continue;
+    FillSignal(m_signals, i, c, t, dt, bin, currents[i]);
+  }
+}
+
+void Sensor::ResetSignalBuffer(SignalBuffer& buffer) const {
+  buffer.signals.Reset(m_electrodes.size(), m_nTimeBins);
+  buffer.charge.assign(m_electrodes.size(), 0.);
+  buffer.filled = false;
+}
+
+void Sensor::AddSignal(SignalBuffer& buffer, const double q, const double t,
+                       const double dt, const double x, const double y,
+                       const double z, const double vx, const double vy,
+                       const double vz) const {
+  const int bin = GetSignalBin(t, dt);
+  if (bin < 0) return;
+  buffer.filled = true;
+  const auto c = q < 0 ? SignalStore::Electron : SignalStore::Ion;
+  ForEachElectrode(x, y, z, [&](const int i) {
+    double wx = 0., wy = 0., wz = 0.;
+    ElectrodeWeightingField(m_electrodes[i], x, y, z, wx, wy, wz);
+    const double cur = -q * (wx * vx + wy * vy + wz * vz);
+    FillSignal(buffer.signals, i, c, t, dt, bin, cur);
+  });
+}
+
+void Sensor::AddInducedCharge(SignalBuffer& buffer, const double q,
+                              const double x0, const double y0,
+                              const double z0, const double x1,
+                              const double y1, const double z1) const {
+  auto add = [&](const int i) {
+    const auto& electrode = m_electrodes[i];
+    const double w0 = ElectrodeWeightingPotential(electrode, x0, y0, z0);
+    const double w1 = ElectrodeWeightingPotential(electrode, x1, y1, z1);
+    buffer.charge[i] += q * (w1 - w0);
+  };
+  // Take the electrodes which matter at either end point.
+  ForEachElectrode(x0, y0, z0, add);
+  if (!m_hasSupport) return;
+  ForEachElectrode(x1, y1, z1, [&](const int i) {
+    if (!IsInSupport(i, x0, y0, z0)) add(i);
+  });
+}
+
+void Sensor::AddSignalBuffer(const SignalBuffer& buffer) {
+  const unsigned int nElectrodes = m_electrodes.size();
+  if (buffer.charge.size() != nElectrodes ||
+      buffer.signals.GetNumberOfElectrodes() != nElectrodes ||
+      buffer.signals.GetNumberOfBins() != m_nTimeBins) {
+    std::cerr << m_className << "::AddSignalBuffer: Buffer does not match "
+              << "the electrodes or the time window.\n";
+    return;
+  }
+  if (buffer.filled && m_nEvents <= 0) m_nEvents = 1;
+  m_signals.Add(buffer.signals);
+  for (unsigned int i = 0; i < nElectrodes; ++i) {
+    m_charge[i] += buffer.charge[i];
+  }
+}
+
+int Sensor::GetSignalBin(const double t, const double dt) const {
+  if (t < m_tStart || dt <= 0.) {
+    if (m_debug) {
+      if (t < m_tStart) std::cout << "  Time " << t << " out of range.\n";
+      if (dt <= 0.) std::cout << "  Time step < 0.\n";
     }
+    return -1;
+  }
+  const int bin = int((t - m_tStart) / m_tStep);
+  // Check if the starting time is outside the range
+  if (bin < 0 || bin >= (int)m_nTimeBins) {
+    if (m_debug) std::cout << "  Bin " << bin << " out of range.\n";
+    return -1;
+  }
+  return bin;
+}
+
+void Sensor::FillSignal(SignalStore& signals, const unsigned int electrode,
+                        const SignalStore::Component c, const double t,
+                        const double dt, const int bin,
+                        const double cur) const {
+  double delta = m_tStart + (bin + 1) * m_tStep - t;
+  // Check if the provided timestep extends over more than one time bin
+  if (dt > delta) {
+    signals.Add(electrode, c, bin, cur * delta);
+    delta = dt - delta;
+    unsigned int j = 1;
+    while (delta > m_tStep && bin + j < m_nTimeBins) {
+      signals.Add(electrode, c, bin + j, cur * m_tStep);
+      delta -= m_tStep;
+      ++j;
+    }
+    if (bin + j < m_nTimeBins) signals.Add(electrode, c, bin + j, cur * delta);
+  } else {
+    signals.Add(electrode, c, bin, cur * dt);
   }
 }
 
@@ -427,22 +920,29 @@ void Sensor::AddInducedCharge(const double q, const double x0, const double y0,
                               const double z0, const double x1, const double y1,
                               const double z1) {
   if (m_debug) std::cout << m_className << "::AddInducedCharge:\n";
-  for (auto& electrode : m_electrodes) {
+  if (m_supportChanged) UpdateElectrodeSupport();
+  auto add = [&](const int i) {
+    const auto& electrode = m_electrodes[i];
     // Calculate the weighting potential at the starting point.
-    auto cmp = electrode.comp;
-    const double w0 = cmp->WeightingPotential(x0, y0, z0, electrode.label);
+    const double w0 = ElectrodeWeightingPotential(electrode, x0, y0, z0);
     // Calculate the weighting potential at the end point.
-    const double w1 = cmp->WeightingPotential(x1, y1, z1, electrode.label);
-    electrode.charge += q * (w1 - w0);
+    const double w1 = ElectrodeWeightingPotential(electrode, x1, y1, z1);
+    m_charge[i] += q * (w1 - w0);
     if (m_debug) {
       std::cout << "  Electrode " << electrode.label << ":\n"
                 << "    Weighting potential at (" << x0 << ", " << y0 << ", "
                 << z0 << "): " << w0 << "\n"
                 << "    Weighting potential at (" << x1 << ", " << y1 << ", "
                 << z1 << "): " << w1 << "\n"
-                << "    Induced charge: " << electrode.charge << "\n";
+                << "    Induced charge: " << m_charge[i] << "\n";
     }
-  }
+  };
+  // Take the electrodes which matter at either end point.
+  ForEachElectrode(x0, y0, z0, add);
+  if (!m_hasSupport) return;
+  ForEachElectrode(x1, y1, z1, [&](const int i) {
+    if (!IsInSupport(i, x0, y0, z0)) add(i);
+  });
 }
 
 void Sensor::SetTimeWindow(const double tstart, const double tstep,
@@ -467,12 +967,9 @@ void Sensor::SetTimeWindow(const double tstart, const double tstep,
   }
 
   std::cout << m_className << "::SetTimeWindow: Resetting all signals.\n";
-  for (auto& electrode : m_electrodes) {
-    electrode.signal.assign(m_nTimeBins, 0.);
-    electrode.electronsignal.assign(m_nTimeBins, 0.);
-    electrode.ionsignal.assign(m_nTimeBins, 0.);
-  }
+  m_signals.Reset(m_electrodes.size(), m_nTimeBins);
   m_nEvents = 0;
+  m_fTransferFFT.clear();
 }
 
 double Sensor::GetElectronSignal(const std::string& label,
@@ -480,40 +977,110 @@ double Sensor::GetElectronSignal(const std::string& label,
   if (m_nEvents == 0) return 0.;
   if (bin >= m_nTimeBins) return 0.;
   double sig = 0.;
-  for (const auto& electrode : m_electrodes) {
-    if (electrode.label == label) sig += electrode.electronsignal[bin];
+  for (const auto i : FindElectrodes(label)) {
+    sig += m_signals.Get(i, SignalStore::Electron, bin);
   }
-  return m_signalConversion * sig / (m_nEvents * m_tStep);
+  return SignalScale() * sig;
 }
 
 double Sensor::GetIonSignal(const std::string& label, const unsigned int bin) {
   if (m_nEvents == 0) return 0.;
   if (bin >= m_nTimeBins) return 0.;
   double sig = 0.;
-  for (const auto& electrode : m_electrodes) {
-    if (electrode.label == label) sig += electrode.ionsignal[bin];
+  for (const auto i : FindElectrodes(label)) {
+    sig += m_signals.Get(i, SignalStore::Ion, bin);
   }
-  return m_signalConversion * sig / (m_nEvents * m_tStep);
+  return SignalScale() * sig;
 }
 
 double Sensor::GetSignal(const std::string& label, const unsigned int bin) {
   if (m_nEvents == 0) return 0.;
   if (bin >= m_nTimeBins) return 0.;
   double sig = 0.;
-  for (const auto& electrode : m_electrodes) {
-    if (electrode.label == label) sig += electrode.signal[bin];
+  for (const auto i : FindElectrodes(label)) {
+    sig += m_signals.Get(i, SignalStore::Total, bin);
   }
-  return m_signalConversion * sig / (m_nEvents * m_tStep);
+  return SignalScale() * sig;
 }
 
 double Sensor::GetInducedCharge(const std::string& label) {
   if (m_nEvents == 0) return 0.;
   double charge = 0.;
-  for (const auto& electrode : m_electrodes) {
-    if (electrode.label == label) charge += electrode.charge;
+  for (const auto i : FindElectrodes(label)) charge += m_charge[i];
+  return charge / m_nEvents;
+}
+
+double Sensor::GetSignal(const int electrode, const unsigned int bin) {
+  if (m_nEvents == 0 || bin >= m_nTimeBins) return 0.;
+  if (electrode < 0 || electrode >= (int)m_electrodes.size()) return 0.;
+  return SignalScale() * m_signals.Get(electrode, SignalStore::Total, bin);
+}
+
+double Sensor::GetElectronSignal(const int electrode, const unsigned int bin) {
+  if (m_nEvents == 0 || bin >= m_nTimeBins) return 0.;
+  if (electrode < 0 || electrode >= (int)m_electrodes.size()) return 0.;
+  return SignalScale() * m_signals.Get(electrode, SignalStore::Electron, bin);
+}
+
+double Sensor::GetIonSignal(const int electrode, const unsigned int bin) {
+  if (m_nEvents == 0 || bin >= m_nTimeBins) return 0.;
+  if (electrode < 0 || electrode >= (int)m_electrodes.size()) return 0.;
+  return SignalScale() * m_signals.Get(electrode, SignalStore::Ion, bin);
+}
+
+double Sensor::GetInducedCharge(const int electrode) {
+  if (m_nEvents == 0) return 0.;
+  if (electrode < 0 || electrode >= (int)m_electrodes.size()) return 0.;
+  return m_charge[electrode] / m_nEvents;
+}
+
+bool Sensor::GetSignal(const int electrode, std::vector<double>& signal) {
+  return CopySignal(SignalStore::Total, electrode, signal);
+}
+
+bool Sensor::GetElectronSignal(const int electrode,
+                               std::vector<double>& signal) {
+  return CopySignal(SignalStore::Electron, electrode, signal);
+}
+
+bool Sensor::GetIonSignal(const int electrode, std::vector<double>& signal) {
+  return CopySignal(SignalStore::Ion, electrode, signal);
+}
+
+bool Sensor::CopySignal(const SignalStore::Component c, const int electrode,
+                        std::vector<double>& signal) const {
+  if (electrode < 0 || electrode >= (int)m_electrodes.size()) {
+    std::cerr << m_className << "::GetSignal: Index out of range.\n";
+    signal.clear();
+    return false;
   }
+  signal.assign(m_nTimeBins, 0.);
+  if (m_nEvents == 0) return true;
+  m_signals.Copy(electrode, c, SignalScale(), signal.data());
+  return true;
+}
 
-  return charge / m_nEvents;
+void Sensor::GetSignalMatrix(std::vector<double>& signals) {
+  const unsigned int nElectrodes = m_electrodes.size();
+  signals.assign(size_t(nElectrodes) * m_nTimeBins, 0.);
+  if (m_nEvents == 0) return;
+  const double scale = SignalScale();
+  for (unsigned int i = 0; i < nElectrodes; ++i) {
+    m_signals.Copy(i, SignalStore::Total, scale,
+                   signals.data() + size_t(i) * m_nTimeBins);
+  }
+}
+
+bool Sensor::GetSignalRanges(
+    const int electrode,
+    std::vector<std::pair<unsigned int, unsigned int> >& ranges) const {
+  ranges.clear();
+  if (electrode < 0 || electrode >= (int)m_electrodes.size()) {
+    std::cerr << m_className << "::GetSignalRanges: Index out of range.\n";
+    return false;
+  }
+  m_signals.GetRanges(electrode, ranges);
+  return true;
 }
 
 void Sensor::SetTransferFunction(double (*f)(double t)) {
@@ -525,6 +1092,7 @@ void Sensor::SetTransferFunction(double (*f)(double t)) {
   m_hasTransferFunction = true;
   m_transferFunctionTimes.clear();
   m_transferFunctionValues.clear();
+  m_fTransferFFT.clear();
 }
 
 void Sensor::SetTransferFunction(const std::vector<double>& times,
@@ -541,6 +1109,7 @@ void Sensor::SetTransferFunction(const std::vector<double>& times,
   m_transferFunctionValues = values;
   m_fTransfer = nullptr;
   m_hasTransferFunction = true;
+  m_fTransferFFT.clear();
 }
 
 double Sensor::InterpolateTransferFunctionTable(const double t) const {
@@ -581,47 +1150,94 @@ bool Sensor::ConvoluteSignal() {
     return false;
   }
 
-  // Set the range where the transfer function is valid.
-  double cnvMin = 0.;
-  double cnvMax = 1.e10;
-
-  std::vector<double> cnvTab(2 * m_nTimeBins, 0.);
-  int iOffset = m_nTimeBins;
-  // Evaluate the transfer function.
-  for (unsigned int i = 0; i < m_nTimeBins; ++i) {
-    // Negative time part.
-    double t = -i * m_tStep;
-    if (t < cnvMin || t > cnvMax) {
-      cnvTab[iOffset - i] = 0.;
-    } else if (m_fTransfer) {
-      cnvTab[iOffset - i] = m_fTransfer(t);
-    } else {
-      cnvTab[iOffset - i] = InterpolateTransferFunctionTable(t);
-    }
-    if (i < 1) continue;
-    // Positive time part.
-    t = i * m_tStep;
-    if (t < cnvMin || t > cnvMax) {
-      cnvTab[iOffset + i] = 0.;
-    } else if (m_fTransfer) {
-      cnvTab[iOffset + i] = m_fTransfer(t);
-    } else {
-      cnvTab[iOffset + i] = InterpolateTransferFunctionTable(t);
+  InitialiseFFT();
+  const unsigned int n = m_nTimeBins;
+  const size_t nFFT = m_fft.GetSize();
+  if (m_fTransferFFT.empty()) {
+    // Set the range where the transfer function is valid.
+    const double cnvMin = 0.;
+    const double cnvMax = 1.e10;
+    // Sample the transfer function at t = d * m_tStep, |d| < n,
+    // with negative times wrapped around to the end of the array.
+    m_fTransferFFT.assign(nFFT, 0.);
+    for (int d = 1 - int(n); d < int(n); ++d) {
+      const double t = d * m_tStep;
+      if (t < cnvMin || t > cnvMax) continue;
+      const double f = m_fTransfer ? m_fTransfer(t)
+                                   : InterpolateTransferFunctionTable(t);
+      m_fTransferFFT[d < 0 ? nFFT + d : d] = m_tStep * f;
+    }
+    m_fft.Forward(m_fTransferFFT.data());
+  }
+
+  // Convolute the signals of two electrodes at a time,
+  // one in the real and one in the imaginary part.
+  // Electrodes without signal are skipped.
+  std::vector<unsigned int> electrodes;
+  const unsigned int nElectrodes = m_electrodes.size();
+  for (unsigned int i = 0; i < nElectrodes; ++i) {
+    if (!m_signals.IsEmpty(i)) electrodes.push_back(i);
+  }
+  std::vector<std::complex<double> > z(nFFT);
+  std::vector<double> a(n, 0.), b(n, 0.);
+  const size_t nSignals = electrodes.size();
+  for (size_t i = 0; i < nSignals; i += 2) {
+    const bool pair = i + 1 < nSignals;
+    m_signals.Copy(electrodes[i], SignalStore::Total, 1., a.data());
+    if (pair) {
+      m_signals.Copy(electrodes[i + 1], SignalStore::Total, 1., b.data());
+    }
+    for (unsigned int j = 0; j < n; ++j) {
+      z[j] = std::complex<double>(a[j], pair ? b[j] : 0.);
+    }
+    std::fill(z.begin() + n, z.end(), 0.);
+    m_fft.Forward(z.data());
+    for (size_t k = 0; k < nFFT; ++k) z[k] *= m_fTransferFFT[k];
+    m_fft.Inverse(z.data());
+    for (unsigned int j = 0; j < n; ++j) {
+      a[j] = z[j].real();
+      b[j] = z[j].imag();
     }
+    StoreConvolutedSignal(electrodes[i], a);
+    if (pair) StoreConvolutedSignal(electrodes[i + 1], b);
   }
+  return true;
+}
 
-  std::vector<double> tmpSignal(m_nTimeBins, 0.);
-  // Loop over all electrodes.
-  for (auto& electrode : m_electrodes) {
-    for (unsigned int j = 0; j < m_nTimeBins; ++j) {
-      tmpSignal[j] = 0.;
-      for (unsigned int k = 0; k < m_nTimeBins; ++k) {
-        tmpSignal[j] += m_tStep * cnvTab[iOffset + j - k] * electrode.signal[k];
-      }
+void Sensor::SetConvolutionCutoff(const double fraction) {
+  if (fraction < 0. || fraction >= 1.) {
+    std::cerr << m_className << "::SetConvolutionCutoff:\n"
+              << "    Fraction must be in the range [0, 1).\n";
+    return;
+  }
+  m_convolutionCutoff = fraction;
+}
+
+void Sensor::StoreConvolutedSignal(const unsigned int electrode,
+                                   const std::vector<double>& signal) {
+  double eps = 0.;
+  if (m_convolutionCutoff > 0.) {
+    double vMax = 0.;
+    for (const double v : signal) vMax = std::max(vMax, std::abs(v));
+    eps = m_convolutionCutoff * vMax;
+  }
+  const unsigned int n = signal.size();
+  for (unsigned int j = 0; j < n; ++j) {
+    if (std::abs(signal[j]) > eps) {
+      m_signals.Set(electrode, SignalStore::Total, j, signal[j]);
+    } else if (m_signals.Get(electrode, SignalStore::Total, j) != 0.) {
+      m_signals.Set(electrode, SignalStore::Total, j, 0.);
     }
-    electrode.signal.swap(tmpSignal);
   }
-  return true;
+}
+
+void Sensor::InitialiseFFT() {
+  // Padding to at least 2 n - 1 points avoids wrap-around in the
+  // convolution.
+  const size_t n = 2 * size_t(m_nTimeBins) - 1;
+  if (m_fft.GetSize() >= n && m_fft.GetSize() < 2 * n) return;
+  m_fft.SetSize(n);
+  m_fTransferFFT.clear();
 }
 
 bool Sensor::IntegrateSignal() {
@@ -630,15 +1246,19 @@ bool Sensor::IntegrateSignal() {
     return false;
   }
 
-  for (auto& electrode : m_electrodes) {
-    for (unsigned int j = 0; j < m_nTimeBins; ++j) {
-      electrode.signal[j] *= m_tStep;
-      electrode.electronsignal[j] *= m_tStep;
-      electrode.ionsignal[j] *= m_tStep;
-      if (j > 0) {
-        electrode.signal[j] += electrode.signal[j - 1];
-        electrode.electronsignal[j] += electrode.electronsignal[j - 1];
-        electrode.ionsignal[j] += electrode.ionsignal[j - 1];
+  const unsigned int nElectrodes = m_electrodes.size();
+  std::vector<std::pair<unsigned int, unsigned int> > ranges;
+  const SignalStore::Component components[3] = {
+      SignalStore::Total, SignalStore::Electron, SignalStore::Ion};
+  for (unsigned int i = 0; i < nElectrodes; ++i) {
+    // The integral is zero before the first non-empty bin.
+    m_signals.GetRanges(i, ranges);
+    if (ranges.empty()) continue;
+    for (const auto c : components) {
+      double sum = 0.;
+      for (unsigned int j = ranges[0].first; j < m_nTimeBins; ++j) {
+        sum += m_tStep * m_signals.Get(i, c, j);
+        m_signals.Set(i, c, j, sum);
       }
     }
   }
@@ -661,18 +1281,60 @@ void Sensor::AddNoise(const bool total, const bool electron, const bool ion) {
   }
   if (m_nEvents == 0) m_nEvents = 1;
 
-  for (auto& electrode : m_electrodes) {
+  const unsigned int nElectrodes = m_electrodes.size();
+  for (unsigned int i = 0; i < nElectrodes; ++i) {
     double t = m_tStart + 0.5 * m_tStep;
     for (unsigned int j = 0; j < m_nTimeBins; ++j) {
       const double noise = m_fNoise(t);
-      if (total) electrode.signal[j] += noise;
-      if (electron) electrode.electronsignal[j] += noise;
-      if (ion) electrode.ionsignal[j] += noise;
+      if (total) m_signals.AddTo(i, SignalStore::Total, j, noise);
+      if (electron) m_signals.AddTo(i, SignalStore::Electron, j, noise);
+      if (ion) m_signals.AddTo(i, SignalStore::Ion, j, noise);
       t += m_tStep;
     }
   }
 }
 
+void Sensor::AddColoredNoise(double (*f)(double freq), const double sigma,
+                             const bool total, const bool electron,
+                             const bool ion) {
+  if (!f) {
+    std::cerr << m_className << "::AddColoredNoise: Null pointer.\n";
+    return;
+  }
+  if (m_nEvents == 0) m_nEvents = 1;
+
+  InitialiseFFT();
+  const unsigned int n = m_nTimeBins;
+  const size_t nFFT = m_fft.GetSize();
+  // Evaluate the response symmetrically, so the filtered noise is real.
+  const double df = 1. / (nFFT * m_tStep);
+  std::vector<double> response(nFFT);
+  for (size_t k = 0; k < nFFT; ++k) {
+    response[k] = f(std::min(k, nFFT - k) * df);
+  }
+  // Generate the noise of two electrodes at a time,
+  // one in the real and one in the imaginary part.
+  std::vector<std::complex<double> > z(nFFT);
+  const unsigned int nElectrodes = m_electrodes.size();
+  for (unsigned int i = 0; i < nElectrodes; i += 2) {
+    for (size_t k = 0; k < nFFT; ++k) {
+      const double re = sigma * RndmGaussian();
+      z[k] = std::complex<double>(re, sigma * RndmGaussian());
+    }
+    m_fft.Forward(z.data());
+    for (size_t k = 0; k < nFFT; ++k) z[k] *= response[k];
+    m_fft.Inverse(z.data());
+    for (unsigned int e = i; e < std::min(i + 2, nElectrodes); ++e) {
+      for (unsigned int j = 0; j < n; ++j) {
+        const double noise = e == i ? z[j].real() : z[j].imag();
+        if (total) m_signals.AddTo(e, SignalStore::Total, j, noise);
+        if (electron) m_signals.AddTo(e, SignalStore::Electron, j, noise);
+        if (ion) m_signals.AddTo(e, SignalStore::Ion, j, noise);
+      }
+    }
+  }
+}
+
 bool Sensor::ComputeThresholdCrossings(const double thr,
                                        const std::string& label, int& n) {
   // Reset the list of threshold crossings.
@@ -690,14 +1352,15 @@ bool Sensor::ComputeThresholdCrossings(const double thr,
 
   // Compute the total signal.
   std::vector<double> signal(m_nTimeBins, 0.);
+  std::vector<double> row(m_nTimeBins, 0.);
   // Loop over the electrodes.
   bool foundLabel = false;
-  for (const auto& electrode : m_electrodes) {
-    if (electrode.label == label) {
+  const unsigned int nElectrodes = m_electrodes.size();
+  for (unsigned int k = 0; k < nElectrodes; ++k) {
+    if (m_electrodes[k].label == label) {
       foundLabel = true;
-      for (unsigned int i = 0; i < m_nTimeBins; ++i) {
-        signal[i] += electrode.signal[i];
-      }
+      m_signals.Copy(k, SignalStore::Total, 1., row.data());
+      for (unsigned int i = 0; i < m_nTimeBins; ++i) signal[i] += row[i];
     }
   }
   if (!foundLabel) {
@@ -705,7 +1368,7 @@ bool Sensor::ComputeThresholdCrossings(const double thr,
               << label << " not found.\n";
     return false;
   }
-  const double scale = m_signalConversion / (m_nEvents * m_tStep);
+  const double scale = SignalScale();
   for (unsigned int i = 0; i < m_nTimeBins; ++i) signal[i] *= scale;
 
   // Establish the range.
@@ -0,0 +1,96 @@
+#include <algorithm>
+
+#include "SignalStore.hh"
+
+namespace {
+
+// Number of values per block.
+constexpr size_t ValuesPerBlock = 3 * Garfield::SignalStore::BlockSize;
+}
+
+namespace Garfield {
+
+constexpr unsigned int SignalStore::BlockSize;
+
+void SignalStore::Reset(const unsigned int nElectrodes,
+                        const unsigned int nBins) {
+  m_nBins = nBins;
+  m_blocks.resize(nElectrodes);
+  for (auto& blocks : m_blocks) blocks.clear();
+  m_nBlocks = 0;
+}
+
+void SignalStore::Add(const SignalStore& other) {
+  const unsigned int nElectrodes =
+      std::min(GetNumberOfElectrodes(), other.GetNumberOfElectrodes());
+  for (unsigned int i = 0; i < nElectrodes; ++i) {
+    for (const auto& block : other.m_blocks[i]) {
+      double* b = GetBlock(i, block.first);
+      const double* src = other.m_data.data() + block.second * ValuesPerBlock;
+      for (size_t k = 0; k < ValuesPerBlock; ++k) b[k] += src[k];
+    }
+  }
+}
+
+void SignalStore::Copy(const unsigned int electrode, const Component c,
+                       const double scale, double* values) const {
+  std::fill(values, values + m_nBins, 0.);
+  for (const auto& block : m_blocks[electrode]) {
+    const unsigned int first = block.first * BlockSize;
+    const unsigned int n = std::min(BlockSize, m_nBins - first);
+    const double* b = m_data.data() + block.second * ValuesPerBlock;
+    for (unsigned int k = 0; k < n; ++k) {
+      values[first + k] = scale * b[c * BlockSize + k];
+    }
+  }
+}
+
+void SignalStore::GetRanges(
+    const unsigned int electrode,
+    std::vector<std::pair<unsigned int, unsigned int> >& ranges) const {
+  ranges.clear();
+  for (const auto& block : m_blocks[electrode]) {
+    const unsigned int first = block.first * BlockSize;
+    const unsigned int last = std::min(first + BlockSize, m_nBins);
+    if (!ranges.empty() && ranges.back().second == first) {
+      ranges.back().second = last;
+    } else {
+      ranges.emplace_back(first, last);
+    }
+  }
+}
+
+double* SignalStore::GetBlock(const unsigned int electrode,
+                              const unsigned int block) {
+  auto& blocks = m_blocks[electrode];
+  // Blocks are mostly added in ascending order.
+  auto it = blocks.end();
+  if (!blocks.empty() && blocks.back().first >= block) {
+    it = std::lower_bound(blocks.begin(), blocks.end(),
+                          std::make_pair(block, 0u));
+    if (it->first == block) {
+      return m_data.data() + it->second * ValuesPerBlock;
+    }
+  }
+  // Allocate a new block (reusing the memory of a previous event).
+  const size_t offset = m_nBlocks * ValuesPerBlock;
+  if (m_data.size() < offset + ValuesPerBlock) {
+    m_data.resize(offset + ValuesPerBlock);
+  }
+  std::fill(m_data.begin() + offset, m_data.begin() + offset + ValuesPerBlock,
+            0.);
+  const unsigned int index = m_nBlocks;
+  blocks.insert(it, std::make_pair(block, index));
+  ++m_nBlocks;
+  return m_data.data() + offset;
+}
+
+const double* SignalStore::FindBlock(const unsigned int electrode,
+                                     const unsigned int block) const {
+  const auto& blocks = m_blocks[electrode];
+  const auto it = std::lower_bound(blocks.begin(), blocks.end(),
+                                   std::make_pair(block, 0u));
+  if (it == blocks.end() || it->first != block) return nullptr;
+  return m_data.data() + it->second * ValuesPerBlock;
+}
+}
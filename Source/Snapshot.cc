@@ -0,0 +1,137 @@
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <fstream>
+
+#include "Snapshot.hh"
+
+namespace {
+
+const uint32_t ByteOrder = 0x01020304;
+
+/// Header of a snapshot, followed by the payload.
+struct Header {
+  char tag[8];
+  uint32_t byteOrder;
+  uint32_t version;
+  /// Sizes of the record and pointer types used when writing.
+  uint32_t recordSize;
+  uint32_t pointerSize;
+  uint64_t payloadSize;
+  uint64_t checksum;
+};
+
+/// FNV-1a style hash over 64-bit words (and the remaining bytes).
+uint64_t Checksum(const char* data, const size_t n) {
+  constexpr uint64_t prime = 1099511628211ULL;
+  uint64_t h = 14695981039346656037ULL;
+  const size_t nWords = n / sizeof(uint64_t);
+  for (size_t i = 0; i < nWords; ++i) {
+    uint64_t word;
+    memcpy(&word, data + i * sizeof(uint64_t), sizeof(uint64_t));
+    h = (h ^ word) * prime;
+  }
+  for (size_t i = nWords * sizeof(uint64_t); i < n; ++i) {
+    h = (h ^ static_cast<unsigned char>(data[i])) * prime;
+  }
+  return h;
+}
+}
+
+namespace Garfield {
+
+bool Snapshot::Reader::ReadString(std::string& s) {
+  uint64_t n = 0;
+  if (!Read(&n, sizeof(n)) || static_cast<uint64_t>(end - p) < n) {
+    return false;
+  }
+  s.assign(p, n);
+  p += n;
+  return true;
+}
+
+void Snapshot::AppendString(std::vector<char>& buffer, const std::string& s) {
+  const uint64_t n = s.size();
+  Append(buffer, &n, sizeof(n));
+  buffer.insert(buffer.end(), s.begin(), s.end());
+}
+
+bool Snapshot::Write(const std::string& filename, const char* tag,
+                     const uint32_t version, const uint32_t recordSize,
+                     const std::vector<char>& payload, std::string& error) {
+  Header header;
+  memcpy(header.tag, tag, sizeof(header.tag));
+  header.byteOrder = ByteOrder;
+  header.version = version;
+  header.recordSize = recordSize;
+  header.pointerSize = sizeof(void*);
+  header.payloadSize = payload.size();
+  header.checksum = Checksum(payload.data(), payload.size());
+
+  std::ofstream outfile(filename, std::ios::binary | std::ios::trunc);
+  if (!outfile) {
+    error = "Could not open file " + filename + ".";
+    return false;
+  }
+  outfile.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  outfile.write(payload.data(), payload.size());
+  if (!outfile) {
+    error = "Error writing to " + filename + ".";
+    return false;
+  }
+  return true;
+}
+
+bool Snapshot::Open(const std::string& filename, const char* tag,
+                    const uint32_t version, const uint32_t recordSize,
+                    std::shared_ptr<void>& mapping, Reader& in,
+                    std::string& error) {
+  const int fd = open(filename.c_str(), O_RDONLY);
+  if (fd < 0) {
+    error = "Could not open file " + filename + ".";
+    return false;
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0 || st.st_size < static_cast<off_t>(sizeof(Header))) {
+    close(fd);
+    error = filename + " is not a snapshot.";
+    return false;
+  }
+  const size_t size = st.st_size;
+  void* addr = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (addr == MAP_FAILED) {
+    error = "Could not map file " + filename + ".";
+    return false;
+  }
+  mapping.reset(addr, [size](void* p) { munmap(p, size); });
+  const char* data = static_cast<const char*>(addr);
+
+  Header header;
+  memcpy(&header, data, sizeof(header));
+  if (memcmp(header.tag, tag, sizeof(header.tag)) != 0 ||
+      header.byteOrder != ByteOrder) {
+    error = filename + " is not a snapshot of this type " +
+            "(or has a different byte order).";
+    mapping.reset();
+    return false;
+  }
+  if (header.version != version || header.recordSize != recordSize ||
+      header.pointerSize != sizeof(void*)) {
+    error = filename + " was written by an incompatible version or platform.";
+    mapping.reset();
+    return false;
+  }
+  const char* payload = data + sizeof(header);
+  if (header.payloadSize != size - sizeof(header) ||
+      header.checksum != Checksum(payload, header.payloadSize)) {
+    error = filename + " is truncated or corrupt.";
+    mapping.reset();
+    return false;
+  }
+  in.p = payload;
+  in.end = payload + header.payloadSize;
+  return true;
+}
+}
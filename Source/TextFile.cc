@@ -0,0 +1,189 @@
+#include <errno.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <limits>
+
+#include "TextFile.hh"
+#include "ThreadPool.hh"
+
+namespace {
+
+// Below this number of items, loops are not split over threads.
+constexpr size_t MinParallel = 100000;
+
+// Powers of ten which are exactly representable as doubles.
+const double Pow10[] = {1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,
+                        1e8,  1e9,  1e10, 1e11, 1e12, 1e13, 1e14, 1e15,
+                        1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+
+bool IsDigit(const char c) { return c >= '0' && c <= '9'; }
+
+bool IsEndOfToken(const char c) { return c == ' ' || c == '\t' || c == '\0'; }
+}
+
+namespace Garfield {
+
+bool TextFile::Read(const std::string& filename) {
+  std::ifstream infile(filename, std::ios::binary | std::ios::ate);
+  if (!infile) return false;
+  const size_t size = static_cast<size_t>(infile.tellg());
+  infile.seekg(0);
+  m_data.resize(size + 1);
+  if (size > 0 && !infile.read(m_data.data(), size)) return false;
+  m_data[size] = '\0';
+
+  // Set up the thread pool once, for the splitting into lines and for
+  // all subsequent loops over the lines.
+  if (size < MinParallel || m_nThreads == 1) {
+    m_pool.reset();
+  } else if (!m_pool) {
+    m_pool.reset(new ThreadPool(m_nThreads));
+  }
+
+  // Find the line breaks, in parallel over blocks of the file.
+  const size_t nBlocks = m_pool ? m_pool->GetNumberOfThreads() : 1;
+  std::vector<std::vector<size_t> > starts(nBlocks);
+  const size_t blockSize = size / nBlocks + 1;
+  auto scan = [&](const size_t begin, const size_t end) {
+    for (size_t k = begin; k < end; ++k) {
+      const size_t i0 = k * blockSize;
+      const size_t i1 = std::min(i0 + blockSize, size);
+      const char* p = m_data.data() + i0;
+      const char* last = m_data.data() + i1;
+      while (p < last) {
+        p = static_cast<const char*>(memchr(p, '\n', last - p));
+        if (!p) break;
+        ++p;
+        if (p < m_data.data() + size) starts[k].push_back(p - m_data.data());
+      }
+    }
+  };
+  if (nBlocks == 1) {
+    scan(0, 1);
+  } else {
+    m_pool->ParallelFor(nBlocks,
+                        [&](const size_t k, unsigned int) { scan(k, k + 1); });
+  }
+  m_lines.clear();
+  size_t nLines = size > 0 ? 1 : 0;
+  for (const auto& s : starts) nLines += s.size();
+  m_lines.reserve(nLines);
+  if (size > 0) m_lines.push_back(0);
+  for (const auto& s : starts) {
+    m_lines.insert(m_lines.end(), s.begin(), s.end());
+  }
+
+  // Terminate the lines (each line only touches its own characters).
+  // The last line may or may not end with a line break.
+  const size_t eof = size > 0 && m_data[size - 1] == '\n' ? size - 1 : size;
+  ParallelFor(nLines, [&](const size_t begin, const size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+      const size_t last = i + 1 < nLines ? m_lines[i + 1] - 1 : eof;
+      m_data[last] = '\0';
+      if (last > m_lines[i] && m_data[last - 1] == '\r') {
+        m_data[last - 1] = '\0';
+      }
+    }
+  });
+  return true;
+}
+
+void TextFile::ParallelFor(
+    const size_t n, const std::function<void(size_t, size_t)>& f) const {
+  if (n == 0) return;
+  if (n < MinParallel || !m_pool) {
+    f(0, n);
+    return;
+  }
+  // Use a few blocks per thread to balance the load.
+  const size_t nBlocks = 4 * m_pool->GetNumberOfThreads();
+  const size_t blockSize = (n + nBlocks - 1) / nBlocks;
+  m_pool->ParallelFor(nBlocks, [&](const size_t k, unsigned int) {
+    const size_t begin = k * blockSize;
+    if (begin < n) f(begin, std::min(begin + blockSize, n));
+  });
+}
+
+bool TextFile::SkipTokens(const char*& p, const unsigned int n) {
+  for (unsigned int i = 0; i < n; ++i) {
+    if (!SkipBlanks(p)) return false;
+    SkipToken(p);
+  }
+  return true;
+}
+
+bool TextFile::ReadInteger(const char*& p, int& value) {
+  if (!SkipBlanks(p)) return false;
+  // The whole token must be an integer in the range of int.
+  char* end = nullptr;
+  errno = 0;
+  const long n = strtol(p, &end, 10);
+  if (end == p || !IsEndOfToken(*end) || errno == ERANGE ||
+      n < std::numeric_limits<int>::min() ||
+      n > std::numeric_limits<int>::max()) {
+    return false;
+  }
+  value = n;
+  p = end;
+  return true;
+}
+
+bool TextFile::ReadDouble(const char*& p, double& value) {
+  if (!SkipBlanks(p)) return false;
+  // Try the exact fast path: at most 15 significant digits and a
+  // power of ten which is exactly representable.
+  const char* q = p;
+  const bool negative = *q == '-';
+  if (*q == '-' || *q == '+') ++q;
+  uint64_t m = 0;
+  int nDigits = 0;
+  int exponent = 0;
+  bool digits = false;
+  for (; IsDigit(*q); ++q) {
+    digits = true;
+    m = 10 * m + (*q - '0');
+    if (m > 0) ++nDigits;
+  }
+  if (*q == '.') {
+    for (++q; IsDigit(*q); ++q) {
+      digits = true;
+      m = 10 * m + (*q - '0');
+      if (m > 0) ++nDigits;
+      --exponent;
+      if (nDigits > 15) break;
+    }
+  }
+  bool exact = digits && nDigits <= 15;
+  if (exact && (*q == 'e' || *q == 'E')) {
+    ++q;
+    const bool negativeExponent = *q == '-';
+    if (*q == '-' || *q == '+') ++q;
+    int e = 0;
+    exact = IsDigit(*q);
+    for (; IsDigit(*q) && e < 1000; ++q) e = 10 * e + (*q - '0');
+    exponent += negativeExponent ? -e : e;
+  }
+  if (exact && IsEndOfToken(*q) && exponent >= -22 && exponent <= 22) {
+    const double x = static_cast<double>(m);
+    value = exponent < 0 ? x / Pow10[-exponent] : x * Pow10[exponent];
+    if (negative) value = -value;
+    p = q;
+    return true;
+  }
+  char* end = nullptr;
+  const double x = strtod(p, &end);
+  if (end == p || !IsEndOfToken(*end)) return false;
+  value = x;
+  p = end;
+  return true;
+}
+
+bool TextFile::FirstTokenIs(const char* line, const char* token) {
+  if (!SkipBlanks(line)) return false;
+  const size_t n = strlen(token);
+  return strncmp(line, token, n) == 0 && IsEndOfToken(line[n]);
+}
+}
@@ -0,0 +1,151 @@
+#include <algorithm>
+
+#include "ThreadPool.hh"
+
+namespace {
+
+// Number of worker threads of all pools.
+std::atomic<unsigned int> nWorkerThreads{0};
+
+// Is the calling thread processing a loop (of any pool)?
+thread_local bool inLoop = false;
+
+// Set the loop flag of the calling thread while in scope.
+class LoopGuard {
+ public:
+  LoopGuard() : m_previous(inLoop) { inLoop = true; }
+  ~LoopGuard() { inLoop = m_previous; }
+
+ private:
+  bool m_previous;
+};
+}
+
+namespace Garfield {
+
+ThreadPool::ThreadPool(const unsigned int nThreads) {
+  unsigned int n = nThreads;
+  if (n == 0) n = std::max(std::thread::hardware_concurrency(), 1u);
+  // The calling thread also takes part in the loops.
+  m_ranges.reset(new Range[n]);
+  m_workers.reserve(n - 1);
+  for (unsigned int i = 1; i < n; ++i) {
+    m_workers.emplace_back(&ThreadPool::Work, this, i);
+  }
+  nWorkerThreads += m_workers.size();
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stop = true;
+  }
+  m_start.notify_all();
+  for (auto& worker : m_workers) worker.join();
+  nWorkerThreads -= m_workers.size();
+}
+
+unsigned int ThreadPool::GetNumberOfWorkerThreads() {
+  return nWorkerThreads.load();
+}
+
+void ThreadPool::ParallelFor(
+    const size_t n, const std::function<void(size_t, unsigned int)>& f) {
+  if (n == 0) return;
+  // Nested loops would wait for workers which are busy with the outer
+  // loop, so they are run by the calling thread instead.
+  std::unique_lock<std::mutex> loopLock(m_loopMutex, std::defer_lock);
+  if (m_workers.empty() || n == 1 || inLoop || !loopLock.try_lock()) {
+    LoopGuard guard;
+    for (size_t i = 0; i < n; ++i) f(i, 0);
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_task = &f;
+    m_abort = false;
+    // One contiguous range of indices per thread.
+    const size_t nThreads = GetNumberOfThreads();
+    for (size_t k = 0; k < nThreads; ++k) {
+      std::lock_guard<std::mutex> rangeLock(m_ranges[k].mutex);
+      m_ranges[k].begin = n * k / nThreads;
+      m_ranges[k].end = n * (k + 1) / nThreads;
+    }
+    m_busy = m_workers.size();
+    m_exception = nullptr;
+    ++m_epoch;
+  }
+  m_start.notify_all();
+  Run(f, 0);
+  std::unique_lock<std::mutex> lock(m_mutex);
+  m_done.wait(lock, [this] { return m_busy == 0; });
+  m_task = nullptr;
+  std::exception_ptr exception = m_exception;
+  m_exception = nullptr;
+  lock.unlock();
+  if (exception) std::rethrow_exception(exception);
+}
+
+void ThreadPool::Work(const unsigned int thread) {
+  unsigned long epoch = 0;
+  while (true) {
+    const std::function<void(size_t, unsigned int)>* task = nullptr;
+    {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      m_start.wait(lock, [&] { return m_stop || m_epoch != epoch; });
+      if (m_stop) return;
+      epoch = m_epoch;
+      task = m_task;
+    }
+    Run(*task, thread);
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      if (--m_busy == 0) m_done.notify_one();
+    }
+  }
+}
+
+void ThreadPool::Run(const std::function<void(size_t, unsigned int)>& f,
+                     const unsigned int thread) {
+  LoopGuard guard;
+  try {
+    size_t i = 0;
+    while (!m_abort && Next(thread, i)) f(i, thread);
+  } catch (...) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_exception) m_exception = std::current_exception();
+    // Skip the remaining indices.
+    m_abort = true;
+  }
+}
+
+bool ThreadPool::Next(const unsigned int thread, size_t& i) {
+  Range& own = m_ranges[thread];
+  {
+    std::lock_guard<std::mutex> lock(own.mutex);
+    if (own.begin < own.end) {
+      i = own.begin++;
+      return true;
+    }
+  }
+  // Steal the upper half of the indices left to another thread.
+  const unsigned int nThreads = GetNumberOfThreads();
+  for (unsigned int k = 1; k < nThreads; ++k) {
+    Range& victim = m_ranges[(thread + k) % nThreads];
+    size_t begin = 0, end = 0;
+    {
+      std::lock_guard<std::mutex> lock(victim.mutex);
+      if (victim.begin >= victim.end) continue;
+      end = victim.end;
+      begin = victim.end - (victim.end - victim.begin + 1) / 2;
+      victim.end = begin;
+    }
+    std::lock_guard<std::mutex> lock(own.mutex);
+    own.begin = begin + 1;
+    own.end = end;
+    i = begin;
+    return true;
+  }
+  return false;
+}
+}
@@ -38,8 +38,9 @@ void ClearBank(std::vector<Heed::gparticle*>& bank) {
 // Global functions and variables required by Heed
 namespace Heed {
 
-// Particle id number for book-keeping
-long last_particle_number;
+// Particle id number for book-keeping (separate counter for each thread,
+// such that TrackHeed objects can be used concurrently)
+thread_local long last_particle_number = 0;
 }
 
 // Actual class implementation
@@ -0,0 +1,329 @@
+#include <algorithm>
+#include <cmath>
+
+#include "TransportTable.hh"
+
+namespace {
+
+// Max. interpolation order in Numerics::Divdif.
+constexpr int MaxOrder = 10;
+
+// Newton coefficients used by Numerics::Divdif for a point in the interval
+// [a[ix - 1], a[ix]) (1-based index), for the given order m.
+// On return, d[0 ... m - 1] and t[0 ... m - 1] hold the coefficients and
+// nodes of the Newton formula and d[m] the highest-order coefficient.
+void NewtonCoefficients(const std::vector<double>& f,
+                        const std::vector<double>& a, const int ix,
+                        const int m, double* t, double* d) {
+  const int n = a.size();
+  const int mplus = m + 1;
+  // Collect the interpolation points, symmetrically around the interval.
+  int npts = m + 2 - (m % 2);
+  int ip = 0;
+  int l = 0;
+  do {
+    const int isub = ix + l;
+    if ((1 > isub) || (isub > n)) {
+      // Skip point.
+      npts = mplus;
+    } else {
+      // Insert point.
+      ip++;
+      t[ip - 1] = a[isub - 1];
+      d[ip - 1] = f[isub - 1];
+    }
+    if (ip < npts) {
+      l = -l;
+      if (l >= 0) {
+        l++;
+      }
+    }
+  } while (ip < npts);
+
+  const bool extra = npts != mplus;
+  // Divided-difference table.
+  for (l = 1; l <= m; l++) {
+    if (extra) {
+      const int isub = mplus - l;
+      d[m + 1] = (d[m + 1] - d[m - 1]) / (t[m + 1] - t[isub - 1]);
+    }
+    int i = mplus;
+    for (int j = l; j <= m; j++) {
+      const int isub = i - l;
+      d[i - 1] = (d[i - 1] - d[i - 1 - 1]) / (t[i - 1] - t[isub - 1]);
+      i--;
+    }
+  }
+  if (extra) d[mplus - 1] = 0.5 * (d[mplus - 1] + d[m + 1]);
+}
+
+// Shape functions along one axis, as in Numerics::Boxin3.
+// The coordinate x has been clamped to the grid and is located in
+// the interval [a[ig - 1], a[ig]].
+void ShapeFunctions(const std::vector<double>& a, const double x,
+                    const int ig, const unsigned int order, int& i0, int& i1,
+                    double* f) {
+  const int n = a.size();
+  f[0] = f[1] = f[2] = f[3] = 0.;
+  if (order == 0 || n == 1) {
+    // Nearest node.
+    i0 = n > 1 && fabs(x - a[ig]) < fabs(x - a[ig - 1]) ? ig : ig - 1;
+    if (n == 1) i0 = 0;
+    i1 = i0;
+    f[0] = 1.;
+  } else if (order == 1 || n == 2) {
+    const double xLocal = (x - a[ig - 1]) / (a[ig] - a[ig - 1]);
+    i0 = ig - 1;
+    i1 = ig;
+    f[0] = 1. - xLocal;
+    f[1] = xLocal;
+  } else {
+    const double xLocal = (x - a[ig - 1]) / (a[ig] - a[ig - 1]);
+    i0 = ig == 1 ? 0 : ig - 2;
+    if (ig == n - 1) i0 = ig - 2;
+    i1 = ig == 1 || ig == n - 1 ? i0 + 2 : i0 + 3;
+    f[0] = (x - a[i0 + 1]) * (x - a[i0 + 2]) /
+           ((a[i0] - a[i0 + 1]) * (a[i0] - a[i0 + 2]));
+    f[1] = (x - a[i0]) * (x - a[i0 + 2]) /
+           ((a[i0 + 1] - a[i0]) * (a[i0 + 1] - a[i0 + 2]));
+    f[2] = (x - a[i0]) * (x - a[i0 + 1]) /
+           ((a[i0 + 2] - a[i0]) * (a[i0 + 2] - a[i0 + 1]));
+    if (i1 == i0 + 3) {
+      // Average of the two parabolas.
+      f[0] *= (1. - xLocal);
+      f[1] = f[1] * (1. - xLocal) +
+             xLocal * (x - a[i0 + 2]) * (x - a[i0 + 3]) /
+                 ((a[i0 + 1] - a[i0 + 2]) * (a[i0 + 1] - a[i0 + 3]));
+      f[2] = f[2] * (1. - xLocal) +
+             xLocal * (x - a[i0 + 1]) * (x - a[i0 + 3]) /
+                 ((a[i0 + 2] - a[i0 + 1]) * (a[i0 + 2] - a[i0 + 3]));
+      f[3] = xLocal * (x - a[i0 + 1]) * (x - a[i0 + 2]) /
+             ((a[i0 + 3] - a[i0 + 1]) * (a[i0 + 3] - a[i0 + 2]));
+    }
+  }
+}
+}
+
+namespace Garfield {
+
+bool TransportTable::Grid::Axis::Set(const std::vector<double>& values) {
+  const size_t n = values.size();
+  if (n == 0) return false;
+  for (size_t i = 1; i < n; ++i) {
+    if (!(values[i] > values[i - 1])) return false;
+  }
+  x = values;
+  spacing = Spacing::Irregular;
+  scale = 0.;
+  if (n < 2) return true;
+  // Deviations (as a fraction of an interval) up to which the grid
+  // is considered regular; the interval is checked in any case.
+  constexpr double tol = 1.e-3;
+  const double d = (x[n - 1] - x[0]) / (n - 1);
+  bool regular = true;
+  for (size_t i = 1; i < n - 1; ++i) {
+    if (fabs(x[i] - (x[0] + i * d)) > tol * d) {
+      regular = false;
+      break;
+    }
+  }
+  if (regular) {
+    spacing = Spacing::Uniform;
+    scale = 1. / d;
+    return true;
+  }
+  if (x[0] <= 0.) return true;
+  const double r = log(x[n - 1] / x[0]) / (n - 1);
+  for (size_t i = 1; i < n - 1; ++i) {
+    if (fabs(log(x[i] / x[0]) - i * r) > tol * r) return true;
+  }
+  spacing = Spacing::Logarithmic;
+  scale = 1. / r;
+  return true;
+}
+
+unsigned int TransportTable::Grid::Axis::FindInterval(const double u) const {
+  const unsigned int n = x.size();
+  if (n < 2) return 0;
+  const unsigned int last = n - 2;
+  if (spacing == Spacing::Irregular) {
+    const unsigned int i = std::upper_bound(x.begin(), x.end(), u) - x.begin();
+    return i > 0 ? std::min(i - 1, last) : 0;
+  }
+  const double k = spacing == Spacing::Uniform ? (u - x[0]) * scale
+                                               : log(u / x[0]) * scale;
+  unsigned int i = 0;
+  if (k >= last) {
+    i = last;
+  } else if (k > 0.) {
+    i = static_cast<unsigned int>(k);
+  }
+  // Correct for rounding errors.
+  while (i > 0 && u < x[i]) --i;
+  while (i < last && u >= x[i + 1]) ++i;
+  return i;
+}
+
+bool TransportTable::Grid::Set(const std::vector<double>& efields,
+                               const std::vector<double>& bfields,
+                               const std::vector<double>& angles,
+                               const bool tab2d) {
+  m_e = Axis();
+  m_b = Axis();
+  m_a = Axis();
+  m_tab2d = false;
+  m_tol = 0.;
+  if (!m_e.Set(efields)) return false;
+  if (tab2d) {
+    if (!m_b.Set(bfields) || !m_a.Set(angles)) return false;
+    m_tab2d = true;
+  }
+  m_tol = 1.e-6 * (fabs(efields.front()) + fabs(efields.back()));
+  return true;
+}
+
+void TransportTable::Grid::Locate(Point& p) const {
+  p.grid = this;
+  const std::vector<double>& x = m_e.x;
+  const size_t n = x.size();
+  p.inside = p.e >= x[0] && p.e <= x[n - 1];
+  if (!m_tab2d) {
+    p.node = -1;
+    if (!p.inside) return;
+    // Points at the ends of the grid.
+    if (fabs(p.e - x[0]) < m_tol) {
+      p.node = 0;
+    } else if (fabs(p.e - x[n - 1]) < m_tol) {
+      p.node = n - 1;
+    } else {
+      p.ig[0] = m_e.FindInterval(p.e);
+    }
+    return;
+  }
+  // Ensure we are in the grid.
+  p.x[0] = std::min(std::max(p.e, x.front()), x.back());
+  p.x[1] = std::min(std::max(p.b, m_b.x.front()), m_b.x.back());
+  p.x[2] = std::min(std::max(p.a, m_a.x.front()), m_a.x.back());
+  p.ig[0] = m_e.FindInterval(p.x[0]);
+  p.ig[1] = m_b.FindInterval(p.x[1]);
+  p.ig[2] = m_a.FindInterval(p.x[2]);
+  p.hasShape[0] = p.hasShape[1] = p.hasShape[2] = false;
+}
+
+bool TransportTable::Build(
+    const std::vector<std::vector<std::vector<double> > >& tab,
+    const std::shared_ptr<const Grid>& grid, const unsigned int order,
+    const double eLinear) {
+  Clear();
+  if (tab.empty() || !grid) return false;
+  const std::vector<double>& efields = grid->m_e.x;
+  const size_t nE = efields.size();
+  if (nE == 0) return false;
+  if (grid->m_tab2d) {
+    // Numerics::Boxin3 is limited to second order.
+    if (order > 2 || tab.size() != grid->m_a.x.size()) return false;
+    for (const auto& plane : tab) {
+      if (plane.size() != grid->m_b.x.size()) {
+        Clear();
+        return false;
+      }
+      for (const auto& row : plane) {
+        if (row.size() != nE) {
+          Clear();
+          return false;
+        }
+        m_values.insert(m_values.end(), row.begin(), row.end());
+      }
+    }
+    m_grid = grid;
+    m_order = order;
+    m_eLinear = eLinear;
+    return true;
+  }
+
+  if (nE < 2 || order == 0 || tab[0].empty() || tab[0][0].size() != nE) {
+    return false;
+  }
+  // Order of each interval.
+  const unsigned int nIntervals = nE - 1;
+  std::vector<int> orders(nIntervals);
+  int mMax = 0;
+  for (unsigned int i = 0; i < nIntervals; ++i) {
+    const int mm = efields[i] < eLinear ? 1 : order;
+    orders[i] = std::min(std::min(mm, MaxOrder), int(nE) - 1);
+    mMax = std::max(mMax, orders[i]);
+  }
+  m_maxOrder = mMax;
+  const size_t stride = 2 * m_maxOrder + 1;
+  m_coefficients.assign(nIntervals * stride, 0.);
+  double t[MaxOrder + 2];
+  double d[MaxOrder + 2];
+  for (unsigned int i = 0; i < nIntervals; ++i) {
+    const int m = orders[i];
+    NewtonCoefficients(tab[0][0], efields, i + 1, m, t, d);
+    // Higher orders are padded with zero coefficients.
+    double* c = m_coefficients.data() + i * stride;
+    std::copy(d, d + m + 1, c);
+    std::copy(t, t + m, c + m_maxOrder + 1);
+    std::fill(c + m_maxOrder + 1 + m, c + stride, t[0]);
+  }
+  m_values = tab[0][0];
+  m_grid = grid;
+  return true;
+}
+
+void TransportTable::Clear() {
+  m_grid.reset();
+  m_order = 2;
+  m_eLinear = 0.;
+  m_values.clear();
+  m_maxOrder = 0;
+  m_coefficients.clear();
+}
+
+bool TransportTable::Interpolate1D(const Point& p, double& y) const {
+  if (!p.inside) return false;
+  if (p.node >= 0) {
+    y = m_values[p.node];
+    return true;
+  }
+  const size_t stride = 2 * m_maxOrder + 1;
+  const double* d = m_coefficients.data() + p.ig[0] * stride;
+  const double* t = d + m_maxOrder + 1;
+  double sum = d[m_maxOrder];
+  for (unsigned int j = m_maxOrder; j > 0; --j) {
+    sum = d[j - 1] + (p.e - t[j - 1]) * sum;
+  }
+  y = sum;
+  return true;
+}
+
+bool TransportTable::Interpolate3D(Point& p, double& y) const {
+  const unsigned int order = p.e < m_eLinear ? 1 : m_order;
+  const Grid::Axis* axes[3] = {&m_grid->m_e, &m_grid->m_b, &m_grid->m_a};
+  int* i0 = p.i0[order];
+  int* i1 = p.i1[order];
+  if (!p.hasShape[order]) {
+    for (unsigned int k = 0; k < 3; ++k) {
+      ShapeFunctions(axes[k]->x, p.x[k], p.ig[k] + 1, order, i0[k], i1[k],
+                     p.f[order][k]);
+    }
+    p.hasShape[order] = true;
+  }
+  const double* fE = p.f[order][0];
+  const double* fB = p.f[order][1];
+  const double* fA = p.f[order][2];
+  const size_t nB = m_grid->m_b.x.size();
+  const size_t nE = m_grid->m_e.x.size();
+  y = 0.;
+  for (int i = i0[2]; i <= i1[2]; ++i) {
+    for (int j = i0[1]; j <= i1[1]; ++j) {
+      const double* row = m_values.data() + (i * nB + j) * nE;
+      for (int k = i0[0]; k <= i1[0]; ++k) {
+        y += row[k] * fA[i - i0[2]] * fB[j - i0[1]] * fE[k - i0[0]];
+      }
+    }
+  }
+  return true;
+}
+}